@@ -106,6 +106,19 @@ void aligned_free(void *ptr);
 extern bool leak_detector_has_run;
 extern char free_after_leak_detection_message[];
 
+/* Allocations are counted in power of two size classes, the last one holds all larger sizes. */
+#define MEM_SIZE_CLASS_NUM 40
+
+int memory_usage_size_class(size_t size);
+void memory_usage_block_alloc(size_t size);
+void memory_usage_block_free(size_t size);
+size_t memory_usage_block_num(void);
+size_t memory_usage_current(void);
+size_t memory_usage_peak(void);
+void memory_usage_peak_reset(void);
+void memory_usage_size_classes(size_t r_alloc_num[MEM_SIZE_CLASS_NUM],
+                               size_t r_blocks_num[MEM_SIZE_CLASS_NUM]);
+
 /* Prototypes for counted allocator functions */
 size_t MEM_lockfree_allocN_len(const void *vmemh) ATTR_WARN_UNUSED_RESULT;
 void MEM_lockfree_freeN(void *vmemh);
@@ -0,0 +1,299 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup MEM
+ *
+ * Memory usage counters of the lock-free allocator.
+ *
+ * Every thread counts its own allocations, so the counters are not shared between threads and
+ * updating them doesn't need atomic read-modify-write operations. The totals are only computed
+ * when they are requested, by summing the counters of all threads.
+ *
+ * The peak memory usage can't be tracked exactly this way. It is updated whenever the memory
+ * usage of a thread changed by more than #peak_update_threshold since its last update, so the
+ * peak may be off by that amount per thread.
+ *
+ * Nothing in here may allocate memory: with `WITH_CXX_GUARDEDALLOC` `operator new` goes through
+ * the guarded allocator, which would call back into these counters while they are constructed or
+ * while #Global::locals_mutex is locked.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#include "MEM_guardedalloc.h"
+#include "mallocn_intern.h"
+
+namespace {
+
+/**
+ * Only the thread owning the counter modifies it, other threads only read it. Avoids the locked
+ * instructions of `fetch_add`.
+ */
+inline void counter_add(std::atomic<int64_t> &counter, const int64_t value)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+/* Same as `std::hardware_destructive_interference_size`, which isn't supported everywhere. */
+constexpr size_t cache_line_size = 64;
+
+constexpr int64_t peak_update_threshold = 1024 * 1024;
+
+struct Global;
+
+/** Counters of a single thread. Aligned so that threads don't share cache lines. */
+struct alignas(cache_line_size) Local {
+  /* Can be negative when memory allocated in another thread was freed in this thread. */
+  std::atomic<int64_t> blocks_num{0};
+  std::atomic<int64_t> mem_in_use{0};
+  /* Value of #mem_in_use when this thread updated the global peak the last time. */
+  int64_t mem_in_use_during_peak_update = 0;
+
+  std::atomic<int64_t> alloc_num_by_size_class[MEM_SIZE_CLASS_NUM] = {};
+  std::atomic<int64_t> blocks_num_by_size_class[MEM_SIZE_CLASS_NUM] = {};
+
+  bool is_main;
+
+  /* Link in #Global::locals. */
+  Local *prev = nullptr;
+  Local *next = nullptr;
+
+  Local();
+  ~Local();
+};
+
+/** Counters shared by all threads. */
+struct Global {
+  /* Protects #locals. */
+  std::mutex locals_mutex;
+  /* Counters of all running threads, linked in place so that adding a thread doesn't
+   * allocate. */
+  Local *locals = nullptr;
+
+  /* Counters of threads that have finished already, and of all allocations done after the main
+   * thread local data has been destructed at exit. */
+  std::atomic<int64_t> blocks_num_outside_locals{0};
+  std::atomic<int64_t> mem_in_use_outside_locals{0};
+  std::atomic<int64_t> alloc_num_by_size_class_outside_locals[MEM_SIZE_CLASS_NUM] = {};
+  std::atomic<int64_t> blocks_num_by_size_class_outside_locals[MEM_SIZE_CLASS_NUM] = {};
+
+  std::atomic<size_t> peak{0};
+
+  std::thread::id main_thread_id = std::this_thread::get_id();
+};
+
+/**
+ * Becomes false when the thread-local data of the main thread is destructed at exit. From then
+ * on, all memory is counted in the global counters, since other thread-local and static data may
+ * still be freed.
+ */
+std::atomic<bool> use_local_counters{true};
+
+/**
+ * Constructed on first use and never destructed, because allocations may still happen while
+ * static data is destructed. Uses static storage, since allocating it would count the allocation
+ * before the counters exist.
+ */
+Global &get_global()
+{
+  alignas(Global) static char global_buffer[sizeof(Global)];
+  static Global *global = new (global_buffer) Global();
+  return *global;
+}
+
+Local &get_local()
+{
+  static thread_local Local local;
+  return local;
+}
+
+Local::Local()
+{
+  Global &global = get_global();
+  is_main = std::this_thread::get_id() == global.main_thread_id;
+
+  std::lock_guard<std::mutex> lock{global.locals_mutex};
+  next = global.locals;
+  if (next) {
+    next->prev = this;
+  }
+  global.locals = this;
+}
+
+Local::~Local()
+{
+  Global &global = get_global();
+  std::lock_guard<std::mutex> lock{global.locals_mutex};
+  if (prev) {
+    prev->next = next;
+  }
+  else {
+    global.locals = next;
+  }
+  if (next) {
+    next->prev = prev;
+  }
+
+  global.blocks_num_outside_locals += blocks_num;
+  global.mem_in_use_outside_locals += mem_in_use;
+  for (int i = 0; i < MEM_SIZE_CLASS_NUM; i++) {
+    global.alloc_num_by_size_class_outside_locals[i] += alloc_num_by_size_class[i];
+    global.blocks_num_by_size_class_outside_locals[i] += blocks_num_by_size_class[i];
+  }
+
+  if (is_main) {
+    use_local_counters.store(false, std::memory_order_relaxed);
+  }
+}
+
+/** Expects #Global::locals_mutex to be locked. */
+int64_t mem_in_use_sum_locked(Global &global)
+{
+  int64_t sum = global.mem_in_use_outside_locals;
+  for (const Local *local = global.locals; local; local = local->next) {
+    sum += local->mem_in_use;
+  }
+  return sum;
+}
+
+void update_global_peak()
+{
+  Global &global = get_global();
+  size_t mem_in_use;
+  {
+    std::lock_guard<std::mutex> lock{global.locals_mutex};
+    mem_in_use = (size_t)std::max<int64_t>(mem_in_use_sum_locked(global), 0);
+  }
+
+  size_t peak = global.peak.load(std::memory_order_relaxed);
+  while (peak < mem_in_use && !global.peak.compare_exchange_weak(peak, mem_in_use)) {
+    /* Pass. */
+  }
+}
+
+}  // namespace
+
+int memory_usage_size_class(size_t size)
+{
+  int size_class = 0;
+  while (size > 1 && size_class < MEM_SIZE_CLASS_NUM - 1) {
+    size >>= 1;
+    size_class++;
+  }
+  return size_class;
+}
+
+void memory_usage_block_alloc(size_t size)
+{
+  const int size_class = memory_usage_size_class(size);
+
+  if (LIKELY(use_local_counters.load(std::memory_order_relaxed))) {
+    Local &local = get_local();
+    counter_add(local.blocks_num, 1);
+    counter_add(local.mem_in_use, (int64_t)size);
+    counter_add(local.alloc_num_by_size_class[size_class], 1);
+    counter_add(local.blocks_num_by_size_class[size_class], 1);
+
+    if (local.mem_in_use - local.mem_in_use_during_peak_update > peak_update_threshold) {
+      local.mem_in_use_during_peak_update = local.mem_in_use;
+      update_global_peak();
+    }
+  }
+  else {
+    Global &global = get_global();
+    global.blocks_num_outside_locals++;
+    global.mem_in_use_outside_locals += (int64_t)size;
+    global.alloc_num_by_size_class_outside_locals[size_class]++;
+    global.blocks_num_by_size_class_outside_locals[size_class]++;
+  }
+}
+
+void memory_usage_block_free(size_t size)
+{
+  const int size_class = memory_usage_size_class(size);
+
+  if (LIKELY(use_local_counters.load(std::memory_order_relaxed))) {
+    Local &local = get_local();
+    counter_add(local.blocks_num, -1);
+    counter_add(local.mem_in_use, -(int64_t)size);
+    counter_add(local.blocks_num_by_size_class[size_class], -1);
+
+    /* Freeing doesn't increase the peak, but a later allocation has to be compared against the
+     * lower usage. */
+    local.mem_in_use_during_peak_update = std::min(local.mem_in_use_during_peak_update,
+                                                   local.mem_in_use.load());
+  }
+  else {
+    Global &global = get_global();
+    global.blocks_num_outside_locals--;
+    global.mem_in_use_outside_locals -= (int64_t)size;
+    global.blocks_num_by_size_class_outside_locals[size_class]--;
+  }
+}
+
+size_t memory_usage_block_num(void)
+{
+  Global &global = get_global();
+  std::lock_guard<std::mutex> lock{global.locals_mutex};
+  int64_t blocks_num = global.blocks_num_outside_locals;
+  for (const Local *local = global.locals; local; local = local->next) {
+    blocks_num += local->blocks_num;
+  }
+  return (size_t)std::max<int64_t>(blocks_num, 0);
+}
+
+size_t memory_usage_current(void)
+{
+  Global &global = get_global();
+  std::lock_guard<std::mutex> lock{global.locals_mutex};
+  return (size_t)std::max<int64_t>(mem_in_use_sum_locked(global), 0);
+}
+
+size_t memory_usage_peak(void)
+{
+  update_global_peak();
+  return get_global().peak;
+}
+
+void memory_usage_peak_reset(void)
+{
+  Global &global = get_global();
+  std::lock_guard<std::mutex> lock{global.locals_mutex};
+  global.peak = (size_t)std::max<int64_t>(mem_in_use_sum_locked(global), 0);
+}
+
+void memory_usage_size_classes(size_t r_alloc_num[MEM_SIZE_CLASS_NUM],
+                               size_t r_blocks_num[MEM_SIZE_CLASS_NUM])
+{
+  Global &global = get_global();
+  std::lock_guard<std::mutex> lock{global.locals_mutex};
+  for (int i = 0; i < MEM_SIZE_CLASS_NUM; i++) {
+    int64_t alloc_num = global.alloc_num_by_size_class_outside_locals[i];
+    int64_t blocks_num = global.blocks_num_by_size_class_outside_locals[i];
+    for (const Local *local = global.locals; local; local = local->next) {
+      alloc_num += local->alloc_num_by_size_class[i];
+      blocks_num += local->blocks_num_by_size_class[i];
+    }
+    r_alloc_num[i] = (size_t)std::max<int64_t>(alloc_num, 0);
+    r_blocks_num[i] = (size_t)std::max<int64_t>(blocks_num, 0);
+  }
+}
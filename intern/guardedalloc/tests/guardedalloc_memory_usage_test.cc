@@ -0,0 +1,86 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <thread>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+#include "guardedalloc_test_base.h"
+
+namespace {
+
+/* Each thread frees the blocks allocated by the next one, so the per-thread counters go
+ * negative and only the sum is meaningful. */
+void AllocateInThreads(const int threads_num, const int blocks_num, const size_t block_size)
+{
+  std::vector<std::vector<void *>> blocks(threads_num);
+  std::vector<std::thread> threads;
+
+  for (int i = 0; i < threads_num; i++) {
+    threads.emplace_back([&, i]() {
+      for (int j = 0; j < blocks_num; j++) {
+        blocks[i].push_back(MEM_mallocN(block_size, __func__));
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+
+  EXPECT_GE(MEM_get_memory_blocks_in_use(), (unsigned int)(threads_num * blocks_num));
+  EXPECT_GE(MEM_get_memory_in_use(), (size_t)(threads_num * blocks_num) * block_size);
+
+  for (int i = 0; i < threads_num; i++) {
+    threads.emplace_back([&, i]() {
+      for (void *block : blocks[(i + 1) % threads_num]) {
+        MEM_freeN(block);
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace
+
+TEST_F(LockFreeAllocatorTest, MemoryUsageThreaded)
+{
+  const size_t mem_in_use = MEM_get_memory_in_use();
+  const unsigned int blocks_in_use = MEM_get_memory_blocks_in_use();
+  MEM_reset_peak_memory();
+
+  AllocateInThreads(4, 1000, 4096);
+
+  EXPECT_EQ(MEM_get_memory_in_use(), mem_in_use);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+  /* Every thread allocated enough to update the peak. */
+  EXPECT_GT(MEM_get_peak_memory(), mem_in_use);
+}
+
+TEST_F(LockFreeAllocatorTest, MemoryUsagePeak)
+{
+  MEM_reset_peak_memory();
+  const size_t mem_in_use = MEM_get_memory_in_use();
+  EXPECT_EQ(MEM_get_peak_memory(), mem_in_use);
+
+  const size_t size = 64 * 1024 * 1024;
+  void *block = MEM_mallocN(size, __func__);
+  MEM_freeN(block);
+
+  EXPECT_EQ(MEM_get_memory_in_use(), mem_in_use);
+  EXPECT_GE(MEM_get_peak_memory(), mem_in_use + size);
+}
+
+TEST_F(GuardedAllocatorTest, MemoryUsageThreaded)
+{
+  const size_t mem_in_use = MEM_get_memory_in_use();
+  const unsigned int blocks_in_use = MEM_get_memory_blocks_in_use();
+
+  AllocateInThreads(4, 1000, 4096);
+
+  EXPECT_EQ(MEM_get_memory_in_use(), mem_in_use);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
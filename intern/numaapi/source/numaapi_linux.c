@@ -276,6 +276,15 @@ bool numaAPI_RunThreadOnNode(int node) {
   return true;
 }
 
+bool numaAPI_RunThreadOnAllNodes(void) {
+  // Passing -1 allows the kernel to schedule the thread on all nodes again.
+  if (numa_run_on_node(-1) != 0) {
+    return false;
+  }
+  numa_set_localalloc();
+  return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Memory management.
 
@@ -72,6 +72,10 @@ bool numaAPI_RunThreadOnNode(int node) {
   return false;
 }
 
+bool numaAPI_RunThreadOnAllNodes(void) {
+  return false;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Memory management.
 
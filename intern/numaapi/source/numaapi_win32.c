@@ -262,6 +262,19 @@ bool numaAPI_RunThreadOnNode(int node) {
   return true;
 }
 
+bool numaAPI_RunThreadOnAllNodes(void) {
+  DWORD_PTR process_affinity_mask, system_affinity_mask;
+  if (GetProcessAffinityMask(GetCurrentProcess(),
+                             &process_affinity_mask,
+                             &system_affinity_mask) == 0) {
+    return false;
+  }
+  if (SetThreadAffinityMask(GetCurrentThread(), process_affinity_mask) == 0) {
+    return false;
+  }
+  return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Memory management.
 
@@ -75,6 +75,13 @@ typedef enum eCDAllocType {
   CD_REFERENCE = 3,
   /** Do a full copy of all layers, only allowed if source has same number of elements. */
   CD_DUPLICATE = 4,
+  /**
+   * Share the data of the source layers, only allowed if source has same number of elements.
+   * Source and destination layers are both treated like referenced layers: the data is only
+   * copied when one of them is duplicated for writing, see
+   * #CustomData_duplicate_referenced_layer. The data is freed with the last layer using it.
+   */
+  CD_SHARE = 5,
 } eCDAllocType;
 
 #define CD_TYPE_AS_MASK(_type) (CustomDataMask)((CustomDataMask)1 << (CustomDataMask)(_type))
@@ -225,7 +232,8 @@ bool CustomData_has_layer(const struct CustomData *data, int type);
 int CustomData_number_of_layers(const struct CustomData *data, int type);
 int CustomData_number_of_layers_typemask(const struct CustomData *data, CustomDataMask mask);
 
-/* duplicate data of a layer with flag NOFREE, and remove that flag.
+/* duplicate data of a layer with flag NOFREE, and remove that flag. Data of shared layers is
+ * only duplicated when it is still used by other layers.
  * returns the layer data */
 void *CustomData_duplicate_referenced_layer(struct CustomData *data,
                                             const int type,
@@ -395,7 +403,8 @@ void CustomData_bmesh_set_n(
  */
 void CustomData_bmesh_set_layer_n(struct CustomData *data, void *block, int n, const void *source);
 
-/* set the pointer of to the first layer of type. the old data is not freed.
+/* set the pointer of to the first layer of type. the old data is not freed. shared data stays
+ * owned by the other layers using it, only the data of a duplicated layer can be taken over.
  * returns the value of ptr if the layer is found, NULL otherwise
  */
 void *CustomData_set_layer(const struct CustomData *data, int type, void *ptr);
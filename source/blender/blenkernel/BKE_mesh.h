@@ -51,6 +51,7 @@ struct MVert;
 struct Main;
 struct MemArena;
 struct Mesh;
+struct MeshElemMap;
 struct ModifierData;
 struct Object;
 struct PointCloud;
@@ -101,6 +102,13 @@ struct Mesh *BKE_mesh_add(struct Main *bmain, const char *name);
 void BKE_mesh_copy_parameters_for_eval(struct Mesh *me_dst, const struct Mesh *me_src);
 void BKE_mesh_copy_parameters(struct Mesh *me_dst, const struct Mesh *me_src);
 void BKE_mesh_update_customdata_pointers(struct Mesh *me, const bool do_ensure_tess_cd);
+/* Duplicate the layers which are referenced or shared with other meshes, so that their arrays can
+ * be written in place. */
+void BKE_mesh_layers_ensure_writable(struct Mesh *me);
+/* For code keeping pointers to the arrays of an original mesh to write them in place: the layers
+ * are made writable and are not shared with copy-on-write meshes until the writing ends. */
+void BKE_mesh_write_in_place_begin(struct Mesh *me);
+void BKE_mesh_write_in_place_end(struct Mesh *me);
 void BKE_mesh_ensure_skin_customdata(struct Mesh *me);
 
 struct Mesh *BKE_mesh_new_nomain(
@@ -291,6 +299,16 @@ void BKE_mesh_calc_normals_poly_and_vertex(struct MVert *mvert,
                                            int mpoly_len,
                                            float (*r_poly_normals)[3],
                                            float (*r_vert_normals)[3]);
+void BKE_mesh_calc_normals_poly_and_vertex_with_map(struct MVert *mvert,
+                                                    int mvert_len,
+                                                    const struct MLoop *mloop,
+                                                    int mloop_len,
+                                                    const struct MPoly *mpoly,
+                                                    int mpoly_len,
+                                                    const struct MeshElemMap *vert_to_poly_map,
+                                                    float (*r_poly_normals)[3],
+                                                    float (*r_vert_normals)[3]);
+struct MVert *BKE_mesh_vert_normals_for_write(struct Mesh *mesh);
 void BKE_mesh_calc_normals(struct Mesh *me);
 void BKE_mesh_ensure_normals(struct Mesh *me);
 void BKE_mesh_ensure_normals_for_display(struct Mesh *mesh);
@@ -384,6 +402,7 @@ void BKE_lnor_spacearr_tls_join(MLoopNorSpaceArray *lnors_spacearr,
                                 MLoopNorSpaceArray *lnors_spacearr_tls);
 
 MLoopNorSpace *BKE_lnor_space_create(MLoopNorSpaceArray *lnors_spacearr);
+MLoopNorSpace *BKE_lnor_spaces_create(MLoopNorSpaceArray *lnors_spacearr, const int num);
 void BKE_lnor_space_define(MLoopNorSpace *lnor_space,
                            const float lnor[3],
                            float vec_ref[3],
@@ -417,6 +436,22 @@ void BKE_mesh_normals_loop_split(const struct MVert *mverts,
                                  MLoopNorSpaceArray *r_lnors_spacearr,
                                  short (*clnors_data)[2],
                                  int *r_loop_to_poly);
+void BKE_mesh_normals_loop_split_with_map(const struct MVert *mverts,
+                                          const int numVerts,
+                                          struct MEdge *medges,
+                                          const int numEdges,
+                                          struct MLoop *mloops,
+                                          float (*r_loopnors)[3],
+                                          const int numLoops,
+                                          struct MPoly *mpolys,
+                                          const float (*polynors)[3],
+                                          const int numPolys,
+                                          const bool use_split_normals,
+                                          const float split_angle,
+                                          MLoopNorSpaceArray *r_lnors_spacearr,
+                                          short (*clnors_data)[2],
+                                          int *r_loop_to_poly,
+                                          const struct MeshElemMap *edge_to_loop_map);
 
 void BKE_mesh_normals_loop_custom_set(const struct MVert *mverts,
                                       const int numVerts,
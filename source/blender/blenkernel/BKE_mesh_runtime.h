@@ -26,6 +26,8 @@
 
 //#include "BKE_customdata.h"  /* for CustomDataMask */
 
+#include "BLI_sys_types.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -36,6 +38,7 @@ struct Depsgraph;
 struct KeyBlock;
 struct MLoop;
 struct MLoopTri;
+struct MeshElemMap;
 struct MVertTri;
 struct Mesh;
 struct Object;
@@ -52,6 +55,37 @@ bool BKE_mesh_runtime_reset_edit_data(struct Mesh *mesh);
 void BKE_mesh_runtime_clear_geometry(struct Mesh *mesh);
 void BKE_mesh_runtime_clear_cache(struct Mesh *mesh);
 
+/* mesh_topology_cache.cc */
+
+typedef enum eMeshTopologyMapType {
+  MESH_TOPOLOGY_MAP_VERT_POLY = 0,
+  MESH_TOPOLOGY_MAP_VERT_LOOP = 1,
+  MESH_TOPOLOGY_MAP_VERT_EDGE = 2,
+  MESH_TOPOLOGY_MAP_EDGE_POLY = 3,
+  MESH_TOPOLOGY_MAP_EDGE_LOOP = 4,
+} eMeshTopologyMapType;
+#define MESH_TOPOLOGY_MAP_NUM 5
+
+typedef struct MeshTopologyMapStats {
+  /** Number of times a map of every type was requested. */
+  int64_t requests_num[MESH_TOPOLOGY_MAP_NUM];
+  /** Number of times a map of every type had to be built. */
+  int64_t builds_num[MESH_TOPOLOGY_MAP_NUM];
+} MeshTopologyMapStats;
+
+void BKE_mesh_runtime_topology_cache_share(struct Mesh *mesh_dst, const struct Mesh *mesh_src);
+void BKE_mesh_runtime_clear_topology_cache(struct Mesh *mesh);
+const struct MeshElemMap *BKE_mesh_runtime_topology_map_ensure(const struct Mesh *mesh,
+                                                               eMeshTopologyMapType type);
+const struct MeshElemMap *BKE_mesh_runtime_vert_poly_map_ensure(const struct Mesh *mesh);
+const struct MeshElemMap *BKE_mesh_runtime_vert_loop_map_ensure(const struct Mesh *mesh);
+const struct MeshElemMap *BKE_mesh_runtime_vert_edge_map_ensure(const struct Mesh *mesh);
+const struct MeshElemMap *BKE_mesh_runtime_edge_poly_map_ensure(const struct Mesh *mesh);
+const struct MeshElemMap *BKE_mesh_runtime_edge_loop_map_ensure(const struct Mesh *mesh);
+void BKE_mesh_runtime_topology_map_stats_get(MeshTopologyMapStats *r_stats);
+void BKE_mesh_runtime_topology_map_stats_reset(void);
+void BKE_mesh_runtime_topology_map_stats_print(void);
+
 void BKE_mesh_runtime_verttri_from_looptri(struct MVertTri *r_verttri,
                                            const struct MLoop *mloop,
                                            const struct MLoopTri *looptri,
@@ -76,6 +76,9 @@ typedef struct UndoStack {
    * within which all but the last undo-step is marked for skipping.
    */
   int group_level;
+
+  /** Largest total size of the data of all steps, for statistics. */
+  size_t data_size_peak;
 } UndoStack;
 
 typedef struct UndoStep {
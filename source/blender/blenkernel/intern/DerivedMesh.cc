@@ -816,7 +816,7 @@ static void mesh_calc_modifier_final_normals(const Mesh *mesh_input,
     if (!CustomData_has_layer(&mesh_final->pdata, CD_NORMAL)) {
       float(*polynors)[3] = (float(*)[3])CustomData_add_layer(
           &mesh_final->pdata, CD_NORMAL, CD_CALLOC, nullptr, mesh_final->totpoly);
-      BKE_mesh_calc_normals_poly_and_vertex(mesh_final->mvert,
+      BKE_mesh_calc_normals_poly_and_vertex(BKE_mesh_vert_normals_for_write(mesh_final),
                                             mesh_final->totvert,
                                             mesh_final->mloop,
                                             mesh_final->totloop,
@@ -1535,7 +1535,7 @@ static void editbmesh_calc_modifier_final_normals(Mesh *mesh_final,
     if (!CustomData_has_layer(&mesh_final->pdata, CD_NORMAL)) {
       float(*polynors)[3] = (float(*)[3])CustomData_add_layer(
           &mesh_final->pdata, CD_NORMAL, CD_CALLOC, nullptr, mesh_final->totpoly);
-      BKE_mesh_calc_normals_poly_and_vertex(mesh_final->mvert,
+      BKE_mesh_calc_normals_poly_and_vertex(BKE_mesh_vert_normals_for_write(mesh_final),
                                             mesh_final->totvert,
                                             mesh_final->mloop,
                                             mesh_final->totloop,
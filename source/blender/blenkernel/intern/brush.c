@@ -30,6 +30,7 @@
 #include "BLI_listbase.h"
 #include "BLI_math.h"
 #include "BLI_rand.h"
+#include "BLI_simd.h"
 
 #include "BLT_translation.h"
 
@@ -2473,6 +2474,67 @@ float BKE_brush_curve_strength(const Brush *br, float p, const float len)
   return strength;
 }
 
+/* Same as #BKE_brush_curve_strength for an array of distances, the presets are evaluated four
+ * distances at a time with SSE2 when available. `r_strength` may be the `dist` array. */
+void BKE_brush_curve_strength_array(
+    const Brush *br, const float *dist, const float len, float *r_strength, const int num)
+{
+  int i = 0;
+#ifdef BLI_HAVE_SSE2
+  if (br->curve_preset != BRUSH_CURVE_CUSTOM) {
+    const __m128 len_v = _mm_set1_ps(len);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    for (; i + 4 <= num; i += 4) {
+      const __m128 d = _mm_loadu_ps(&dist[i]);
+      const __m128 p = _mm_max_ps(_mm_sub_ps(one, _mm_div_ps(d, len_v)), zero);
+      const __m128 p2 = _mm_mul_ps(p, p);
+      __m128 strength;
+      switch (br->curve_preset) {
+        case BRUSH_CURVE_SHARP:
+          strength = p2;
+          break;
+        case BRUSH_CURVE_SMOOTH:
+          strength = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(3.0f), p), p),
+                                _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(two, p), p), p));
+          break;
+        case BRUSH_CURVE_SMOOTHER:
+          strength = _mm_mul_ps(
+              _mm_mul_ps(p2, p),
+              _mm_add_ps(
+                  _mm_mul_ps(p, _mm_sub_ps(_mm_mul_ps(p, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))),
+                  _mm_set1_ps(10.0f)));
+          break;
+        case BRUSH_CURVE_ROOT:
+          strength = _mm_sqrt_ps(p);
+          break;
+        case BRUSH_CURVE_LIN:
+          strength = p;
+          break;
+        case BRUSH_CURVE_SPHERE:
+          strength = _mm_sqrt_ps(_mm_sub_ps(_mm_mul_ps(two, p), p2));
+          break;
+        case BRUSH_CURVE_POW4:
+          strength = _mm_mul_ps(_mm_mul_ps(p2, p), p);
+          break;
+        case BRUSH_CURVE_INVSQUARE:
+          strength = _mm_mul_ps(p, _mm_sub_ps(two, p));
+          break;
+        case BRUSH_CURVE_CONSTANT:
+        default:
+          strength = one;
+          break;
+      }
+      _mm_storeu_ps(&r_strength[i], _mm_and_ps(_mm_cmplt_ps(d, len_v), strength));
+    }
+  }
+#endif
+  for (; i < num; i++) {
+    r_strength[i] = BKE_brush_curve_strength(br, dist[i], len);
+  }
+}
+
 /* Uses the brush curve control to find a strength value between 0 and 1 */
 float BKE_brush_curve_strength_clamped(Brush *br, float p, const float len)
 {
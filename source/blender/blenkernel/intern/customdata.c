@@ -62,6 +62,8 @@
 
 #include "CLG_log.h"
 
+#include "atomic_ops.h"
+
 /* only for customdata_data_transfer_interp_normal_normals */
 #include "data_transfer_intern.h"
 
@@ -2096,6 +2098,70 @@ static bool customdata_typemap_is_valid(const CustomData *data)
 }
 #endif
 
+/* -------------------------------------------------------------------- */
+/** \name Shared Layers
+ *
+ * Layers copied with #CD_SHARE use the data of the source layer instead of a copy of it. Shared
+ * layers keep a user count of the data, the last layer which is freed also frees the data.
+ * Otherwise they behave like referenced layers: writing to the data of any of them requires
+ * #CustomData_duplicate_referenced_layer, which only copies the data when it is still used by
+ * other layers.
+ *
+ * Layers of the same source may be shared from multiple threads at once, so the user count is
+ * only modified atomically.
+ * \{ */
+
+typedef struct CustomDataLayerSharing {
+  int users;
+} CustomDataLayerSharing;
+
+/**
+ * Add a user to the data of the layer, making it shared first when needed.
+ * Returns false when the layer does not own its data, so that it can't be shared.
+ */
+static bool customData_layer_sharing_add_user(CustomDataLayer *layer)
+{
+  if (layer->sharing == NULL) {
+    if (layer->flag & CD_FLAG_NOFREE) {
+      return false;
+    }
+    CustomDataLayerSharing *sharing = MEM_mallocN(sizeof(*sharing), __func__);
+    sharing->users = 1;
+    if (atomic_cas_ptr((void **)&layer->sharing, NULL, sharing) == NULL) {
+      atomic_fetch_and_or_int32(&layer->flag, CD_FLAG_NOFREE);
+    }
+    else {
+      /* Another thread shared the layer in the meantime. */
+      MEM_freeN(sharing);
+    }
+  }
+  atomic_add_and_fetch_int32(&layer->sharing->users, 1);
+  return true;
+}
+
+/**
+ * Remove the layer as a user of its shared data.
+ * Returns true when the layer was the last user, in which case the data has to be freed.
+ */
+static bool customData_layer_sharing_remove_user(CustomDataLayer *layer)
+{
+  CustomDataLayerSharing *sharing = layer->sharing;
+  layer->sharing = NULL;
+  layer->flag &= ~CD_FLAG_NOFREE;
+  if (atomic_sub_and_fetch_int32(&sharing->users, 1) == 0) {
+    MEM_freeN(sharing);
+    return true;
+  }
+  return false;
+}
+
+static bool customData_layer_sharing_is_single_user(CustomDataLayer *layer)
+{
+  return atomic_add_and_fetch_int32(&layer->sharing->users, 0) == 1;
+}
+
+/** \} */
+
 bool CustomData_merge(const struct CustomData *source,
                       struct CustomData *dest,
                       CustomDataMask mask,
@@ -2151,6 +2217,7 @@ bool CustomData_merge(const struct CustomData *source,
       case CD_ASSIGN:
       case CD_REFERENCE:
       case CD_DUPLICATE:
+      case CD_SHARE:
         data = layer->data;
         break;
       default:
@@ -2158,9 +2225,35 @@ bool CustomData_merge(const struct CustomData *source,
         break;
     }
 
-    if ((alloctype == CD_ASSIGN) && (flag & CD_FLAG_NOFREE)) {
+    if (alloctype == CD_SHARE) {
+      /* The source layer becomes shared as well, its data is not modified. */
+      CustomDataLayer *source_layer = (CustomDataLayer *)layer;
+      if (data && customData_layer_sharing_add_user(source_layer)) {
+        newlayer = customData_add_layer__internal(
+            dest, type, CD_REFERENCE, data, totelem, layer->name);
+        if (newlayer) {
+          newlayer->sharing = source_layer->sharing;
+        }
+        else {
+          /* Only drop the added user, the source layer keeps using the data. */
+          atomic_sub_and_fetch_int32(&source_layer->sharing->users, 1);
+        }
+      }
+      else {
+        newlayer = customData_add_layer__internal(
+            dest, type, CD_DUPLICATE, data, totelem, layer->name);
+      }
+    }
+    else if ((alloctype == CD_ASSIGN) && (flag & CD_FLAG_NOFREE)) {
       newlayer = customData_add_layer__internal(
           dest, type, CD_REFERENCE, data, totelem, layer->name);
+      if (newlayer && layer->sharing != NULL) {
+        /* The user of the source layer is taken over. The source layer keeps the
+         * #CD_FLAG_NOFREE flag, freeing it afterwards must neither free the data nor remove the
+         * user again. */
+        newlayer->sharing = layer->sharing;
+        ((CustomDataLayer *)layer)->sharing = NULL;
+      }
     }
     else {
       newlayer = customData_add_layer__internal(dest, type, alloctype, data, totelem, layer->name);
@@ -2187,16 +2280,23 @@ bool CustomData_merge(const struct CustomData *source,
   return changed;
 }
 
-/* NOTE: Take care of referenced layers by yourself! */
+static void *customData_duplicate_referenced_layer_index(CustomData *data,
+                                                         const int layer_index,
+                                                         const int totelem);
+
+/* NOTE: Take care of referenced layers by yourself! Shared layers are duplicated. */
 void CustomData_realloc(CustomData *data, int totelem)
 {
   for (int i = 0; i < data->totlayer; i++) {
     CustomDataLayer *layer = &data->layers[i];
-    const LayerTypeInfo *typeInfo;
+    const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+    if (layer->sharing != NULL && layer->data != NULL) {
+      const int old_totelem = (int)(MEM_allocN_len(layer->data) / typeInfo->size);
+      customData_duplicate_referenced_layer_index(data, i, old_totelem);
+    }
     if (layer->flag & CD_FLAG_NOFREE) {
       continue;
     }
-    typeInfo = layerType_getInfo(layer->type);
     layer->data = MEM_reallocN(layer->data, (size_t)totelem * typeInfo->size);
   }
 }
@@ -2216,25 +2316,33 @@ void CustomData_copy(const struct CustomData *source,
   CustomData_merge(source, dest, mask, alloctype, totelem);
 }
 
-static void customData_free_layer__internal(CustomDataLayer *layer, int totelem)
+static void customData_free_layer_data(const CustomDataLayer *layer, int totelem)
 {
-  const LayerTypeInfo *typeInfo;
+  const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+
+  if (typeInfo->free) {
+    typeInfo->free(layer->data, totelem, typeInfo->size);
+  }
 
+  if (layer->data) {
+    MEM_freeN(layer->data);
+  }
+}
+
+static void customData_free_layer__internal(CustomDataLayer *layer, int totelem)
+{
   if (layer->anonymous_id != NULL) {
     BKE_anonymous_attribute_id_decrement_weak(layer->anonymous_id);
     layer->anonymous_id = NULL;
   }
-  if (!(layer->flag & CD_FLAG_NOFREE) && layer->data) {
-    typeInfo = layerType_getInfo(layer->type);
-
-    if (typeInfo->free) {
-      typeInfo->free(layer->data, totelem, typeInfo->size);
-    }
-
-    if (layer->data) {
-      MEM_freeN(layer->data);
+  if (layer->sharing != NULL) {
+    if (customData_layer_sharing_remove_user(layer) && layer->data) {
+      customData_free_layer_data(layer, totelem);
     }
   }
+  else if (!(layer->flag & CD_FLAG_NOFREE) && layer->data) {
+    customData_free_layer_data(layer, totelem);
+  }
 }
 
 static void CustomData_external_free(CustomData *data)
@@ -2598,6 +2706,7 @@ static CustomDataLayer *customData_add_layer__internal(CustomData *data,
   data->layers[index].type = type;
   data->layers[index].flag = flag;
   data->layers[index].data = newlayerdata;
+  data->layers[index].sharing = NULL;
 
   /* Set default name if none exists. Note we only call DATA_()  once
    * we know there is a default name, to avoid overhead of locale lookups
@@ -2798,12 +2907,18 @@ static void *customData_duplicate_referenced_layer_index(CustomData *data,
 
   CustomDataLayer *layer = &data->layers[layer_index];
 
+  if (layer->sharing != NULL && customData_layer_sharing_is_single_user(layer)) {
+    /* No other layer uses the data anymore, it can be taken over without a copy. */
+    customData_layer_sharing_remove_user(layer);
+  }
+
   if (layer->flag & CD_FLAG_NOFREE) {
     /* MEM_dupallocN won't work in case of complex layers, like e.g.
      * CD_MDEFORMVERT, which has pointers to allocated data...
      * So in case a custom copy function is defined, use it!
      */
     const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+    CustomDataLayer old_layer = *layer;
 
     if (typeInfo->copy) {
       void *dst_data = MEM_malloc_arrayN(
@@ -2816,6 +2931,12 @@ static void *customData_duplicate_referenced_layer_index(CustomData *data,
     }
 
     layer->flag &= ~CD_FLAG_NOFREE;
+
+    /* Other users may have freed their layers while the data was copied. */
+    if (old_layer.sharing != NULL && customData_layer_sharing_remove_user(&old_layer)) {
+      customData_free_layer_data(&old_layer, totelem);
+    }
+    layer->sharing = NULL;
   }
 
   return layer->data;
@@ -3317,6 +3438,23 @@ const char *CustomData_get_layer_name(const CustomData *data, int type, int n)
   return (layer_index == -1) ? NULL : data->layers[layer_index].name;
 }
 
+/**
+ * Replace the data of a layer. When the old data is shared, the layer only stops using it and owns
+ * the new data: the old data stays valid for the other layers still using it and is freed with
+ * the last of them. When there are none, the caller takes over the old data, like for layers
+ * which are not shared.
+ */
+static void customData_layer_set_data(CustomDataLayer *layer, void *ptr)
+{
+  if (layer->data == ptr) {
+    return;
+  }
+  if (layer->sharing != NULL) {
+    customData_layer_sharing_remove_user(layer);
+  }
+  layer->data = ptr;
+}
+
 void *CustomData_set_layer(const CustomData *data, int type, void *ptr)
 {
   /* get the layer index of the first layer of type */
@@ -3326,7 +3464,7 @@ void *CustomData_set_layer(const CustomData *data, int type, void *ptr)
     return NULL;
   }
 
-  data->layers[layer_index].data = ptr;
+  customData_layer_set_data(&data->layers[layer_index], ptr);
 
   return ptr;
 }
@@ -3339,7 +3477,7 @@ void *CustomData_set_layer_n(const struct CustomData *data, int type, int n, voi
     return NULL;
   }
 
-  data->layers[layer_index].data = ptr;
+  customData_layer_set_data(&data->layers[layer_index], ptr);
 
   return ptr;
 }
@@ -5250,6 +5388,7 @@ void CustomData_blend_read(BlendDataReader *reader, CustomData *data, int count)
     }
 
     layer->flag &= ~CD_FLAG_NOFREE;
+    layer->sharing = NULL;
 
     if (CustomData_verify_versions(data, i)) {
       BLO_read_data_address(reader, &layer->data);
@@ -0,0 +1,178 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_customdata_types.h"
+
+#include "BKE_customdata.h"
+
+namespace blender::bke::tests {
+
+#define ELEM_NUM 16
+
+class CustomDataSharingTest : public testing::Test {
+ protected:
+  CustomData source;
+  size_t blocks_num_before;
+
+  void SetUp() override
+  {
+    blocks_num_before = MEM_get_memory_blocks_in_use();
+
+    CustomData_reset(&source);
+    float *values = (float *)CustomData_add_layer(
+        &source, CD_PROP_FLOAT, CD_CALLOC, nullptr, ELEM_NUM);
+    for (int i = 0; i < ELEM_NUM; i++) {
+      values[i] = (float)i;
+    }
+  }
+
+  void TearDown() override
+  {
+    /* All data is freed exactly once, double frees are caught by the allocator. */
+    EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_num_before);
+  }
+
+  static void share(const CustomData *src, CustomData *dst)
+  {
+    CustomData_copy(src, dst, CD_MASK_PROP_FLOAT, CD_SHARE, ELEM_NUM);
+  }
+
+  static float *values(const CustomData *data)
+  {
+    return (float *)CustomData_get_layer(data, CD_PROP_FLOAT);
+  }
+
+  static float *values_for_write(CustomData *data)
+  {
+    return (float *)CustomData_duplicate_referenced_layer(data, CD_PROP_FLOAT, ELEM_NUM);
+  }
+
+  static void expect_values(const CustomData *data, const float offset)
+  {
+    const float *data_values = values(data);
+    for (int i = 0; i < ELEM_NUM; i++) {
+      EXPECT_EQ(data_values[i], (float)i + offset);
+    }
+  }
+};
+
+TEST_F(CustomDataSharingTest, share_free)
+{
+  CustomData copy;
+  share(&source, &copy);
+  EXPECT_EQ(values(&copy), values(&source));
+  EXPECT_TRUE(CustomData_is_referenced_layer(&source, CD_PROP_FLOAT));
+  EXPECT_TRUE(CustomData_is_referenced_layer(&copy, CD_PROP_FLOAT));
+
+  /* The last layer using the data frees it, in either order. */
+  CustomData_free(&source, ELEM_NUM);
+  expect_values(&copy, 0.0f);
+  CustomData_free(&copy, ELEM_NUM);
+}
+
+TEST_F(CustomDataSharingTest, share_duplicate_free)
+{
+  CustomData copy;
+  share(&source, &copy);
+  const float *shared_values = values(&source);
+
+  /* Writing to the copy doesn't change the source. */
+  float *copy_values = values_for_write(&copy);
+  EXPECT_NE(copy_values, shared_values);
+  EXPECT_FALSE(CustomData_is_referenced_layer(&copy, CD_PROP_FLOAT));
+  for (int i = 0; i < ELEM_NUM; i++) {
+    copy_values[i] += 1.0f;
+  }
+  expect_values(&source, 0.0f);
+  expect_values(&copy, 1.0f);
+
+  /* The source is the only user left, it takes over the data without a copy. */
+  EXPECT_EQ(values_for_write(&source), shared_values);
+  EXPECT_FALSE(CustomData_is_referenced_layer(&source, CD_PROP_FLOAT));
+
+  CustomData_free(&copy, ELEM_NUM);
+  CustomData_free(&source, ELEM_NUM);
+}
+
+TEST_F(CustomDataSharingTest, share_chain)
+{
+  CustomData copy_a, copy_b;
+  share(&source, &copy_a);
+  share(&copy_a, &copy_b);
+  const float *shared_values = values(&source);
+  EXPECT_EQ(values(&copy_b), shared_values);
+
+  CustomData_free(&copy_a, ELEM_NUM);
+  EXPECT_NE(values_for_write(&source), shared_values);
+  expect_values(&source, 0.0f);
+  /* Only used by the second copy now. */
+  EXPECT_EQ(values_for_write(&copy_b), shared_values);
+
+  CustomData_free(&source, ELEM_NUM);
+  expect_values(&copy_b, 0.0f);
+  CustomData_free(&copy_b, ELEM_NUM);
+}
+
+TEST_F(CustomDataSharingTest, share_again_after_duplicate)
+{
+  for (int i = 0; i < 3; i++) {
+    CustomData copy;
+    share(&source, &copy);
+    values_for_write(&source)[0] = (float)i + 1.0f;
+    EXPECT_EQ(values(&copy)[0], (float)i);
+    CustomData_free(&copy, ELEM_NUM);
+  }
+  EXPECT_FALSE(CustomData_is_referenced_layer(&source, CD_PROP_FLOAT));
+  CustomData_free(&source, ELEM_NUM);
+}
+
+TEST_F(CustomDataSharingTest, assign_shared)
+{
+  CustomData copy, assigned;
+  share(&source, &copy);
+
+  /* Ownership of the user is transferred, freeing the assigned layers afterwards must not remove
+   * the user a second time. */
+  CustomData_copy(&copy, &assigned, CD_MASK_PROP_FLOAT, CD_ASSIGN, ELEM_NUM);
+  CustomData_free(&copy, ELEM_NUM);
+
+  CustomData_free(&source, ELEM_NUM);
+  expect_values(&assigned, 0.0f);
+  CustomData_free(&assigned, ELEM_NUM);
+}
+
+TEST_F(CustomDataSharingTest, set_layer_shared)
+{
+  CustomData copy;
+  share(&source, &copy);
+  const float *shared_values = values(&source);
+
+  /* The copy stops using the shared data, which stays owned by the source. */
+  float *new_values = (float *)MEM_calloc_arrayN(ELEM_NUM, sizeof(float), __func__);
+  CustomData_set_layer(&copy, CD_PROP_FLOAT, new_values);
+  EXPECT_FALSE(CustomData_is_referenced_layer(&copy, CD_PROP_FLOAT));
+  EXPECT_EQ(values(&copy), new_values);
+  EXPECT_EQ(values_for_write(&source), shared_values);
+
+  CustomData_free(&copy, ELEM_NUM);
+  expect_values(&source, 0.0f);
+  CustomData_free(&source, ELEM_NUM);
+}
+
+}  // namespace blender::bke::tests
@@ -5523,6 +5523,9 @@ void BKE_image_editors_update_frame(const Main *bmain, int cfra)
   /* This only updates images used by the user interface. For others the
    * dependency graph will call BKE_image_user_id_eval_animation. */
   wmWindowManager *wm = bmain->wm.first;
+  if (wm == NULL) {
+    return;
+  }
   image_walk_id_all_users(&wm->id, false, &cfra, image_editors_update_frame);
 }
 
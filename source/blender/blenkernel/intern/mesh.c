@@ -58,6 +58,7 @@
 #include "BKE_main.h"
 #include "BKE_material.h"
 #include "BKE_mesh.h"
+#include "BKE_mesh_mapping.h"
 #include "BKE_mesh_runtime.h"
 #include "BKE_mesh_wrapper.h"
 #include "BKE_modifier.h"
@@ -128,7 +129,13 @@ static void mesh_copy_data(Main *bmain, ID *id_dst, const ID *id_src, const int
 
   BKE_defgroup_copy_list(&mesh_dst->vertex_group_names, &mesh_src->vertex_group_names);
 
-  const eCDAllocType alloc_type = (flag & LIB_ID_COPY_CD_REFERENCE) ? CD_REFERENCE : CD_DUPLICATE;
+  eCDAllocType alloc_type = CD_DUPLICATE;
+  if (flag & LIB_ID_COPY_CD_REFERENCE) {
+    alloc_type = CD_REFERENCE;
+  }
+  else if ((flag & LIB_ID_COPY_CD_SHARE) && !mesh_src->runtime.is_written_in_place) {
+    alloc_type = CD_SHARE;
+  }
   CustomData_copy(&mesh_src->vdata, &mesh_dst->vdata, mask.vmask, alloc_type, mesh_dst->totvert);
   CustomData_copy(&mesh_src->edata, &mesh_dst->edata, mask.emask, alloc_type, mesh_dst->totedge);
   CustomData_copy(&mesh_src->ldata, &mesh_dst->ldata, mask.lmask, alloc_type, mesh_dst->totloop);
@@ -142,6 +149,12 @@ static void mesh_copy_data(Main *bmain, ID *id_dst, const ID *id_src, const int
 
   BKE_mesh_update_customdata_pointers(mesh_dst, do_tessface);
 
+  if (mesh_src->id.tag & LIB_TAG_NO_MAIN) {
+    /* Copies of evaluated meshes referencing the same topology can use the same maps. Original
+     * meshes are skipped, their topology may be edited in place by tools. */
+    BKE_mesh_runtime_topology_cache_share(mesh_dst, mesh_src);
+  }
+
   mesh_dst->edit_mesh = NULL;
 
   mesh_dst->mselect = MEM_dupallocN(mesh_dst->mselect);
@@ -870,6 +883,27 @@ void BKE_mesh_update_customdata_pointers(Mesh *me, const bool do_ensure_tess_cd)
   me->mloopuv = CustomData_get_layer(&me->ldata, CD_MLOOPUV);
 }
 
+void BKE_mesh_layers_ensure_writable(Mesh *me)
+{
+  CustomData_duplicate_referenced_layers(&me->vdata, me->totvert);
+  CustomData_duplicate_referenced_layers(&me->edata, me->totedge);
+  CustomData_duplicate_referenced_layers(&me->ldata, me->totloop);
+  CustomData_duplicate_referenced_layers(&me->pdata, me->totpoly);
+  /* Update pointers in case we duplicated referenced layers. */
+  BKE_mesh_update_customdata_pointers(me, false);
+}
+
+void BKE_mesh_write_in_place_begin(Mesh *me)
+{
+  BKE_mesh_layers_ensure_writable(me);
+  me->runtime.is_written_in_place = true;
+}
+
+void BKE_mesh_write_in_place_end(Mesh *me)
+{
+  me->runtime.is_written_in_place = false;
+}
+
 bool BKE_mesh_has_custom_loop_normals(Mesh *me)
 {
   if (me->edit_mesh) {
@@ -1926,7 +1960,7 @@ void BKE_mesh_calc_normals_split_ex(Mesh *mesh, MLoopNorSpaceArray *r_lnors_spac
   }
   else {
     polynors = MEM_malloc_arrayN(mesh->totpoly, sizeof(float[3]), __func__);
-    BKE_mesh_calc_normals_poly_and_vertex(mesh->mvert,
+    BKE_mesh_calc_normals_poly_and_vertex(BKE_mesh_vert_normals_for_write(mesh),
                                           mesh->totvert,
                                           mesh->mloop,
                                           mesh->totloop,
@@ -1937,21 +1971,28 @@ void BKE_mesh_calc_normals_split_ex(Mesh *mesh, MLoopNorSpaceArray *r_lnors_spac
     free_polynors = true;
   }
 
-  BKE_mesh_normals_loop_split(mesh->mvert,
-                              mesh->totvert,
-                              mesh->medge,
-                              mesh->totedge,
-                              mesh->mloop,
-                              r_loopnors,
-                              mesh->totloop,
-                              mesh->mpoly,
-                              (const float(*)[3])polynors,
-                              mesh->totpoly,
-                              use_split_normals,
-                              split_angle,
-                              r_lnors_spacearr,
-                              clnors,
-                              NULL);
+  /* Evaluated meshes keep their topology while deformed, use the cached edge to loop map. */
+  const MeshElemMap *edge_to_loop_map = (use_split_normals &&
+                                         (mesh->id.tag & LIB_TAG_NO_MAIN)) ?
+                                            BKE_mesh_runtime_edge_loop_map_ensure(mesh) :
+                                            NULL;
+
+  BKE_mesh_normals_loop_split_with_map(mesh->mvert,
+                                       mesh->totvert,
+                                       mesh->medge,
+                                       mesh->totedge,
+                                       mesh->mloop,
+                                       r_loopnors,
+                                       mesh->totloop,
+                                       mesh->mpoly,
+                                       (const float(*)[3])polynors,
+                                       mesh->totpoly,
+                                       use_split_normals,
+                                       split_angle,
+                                       r_lnors_spacearr,
+                                       clnors,
+                                       NULL,
+                                       edge_to_loop_map);
 
   if (free_polynors) {
     MEM_freeN(polynors);
@@ -25,6 +25,8 @@
  * \see bmesh_mesh_normals.c for the equivalent #BMesh functionality.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <climits>
 
 #include "MEM_guardedalloc.h"
@@ -41,12 +43,15 @@
 #include "BLI_memarena.h"
 #include "BLI_stack.h"
 #include "BLI_task.h"
+#include "BLI_task.hh"
 #include "BLI_utildefines.h"
 
 #include "BKE_customdata.h"
 #include "BKE_editmesh_cache.h"
 #include "BKE_global.h"
 #include "BKE_mesh.h"
+#include "BKE_mesh_mapping.h"
+#include "BKE_mesh_runtime.h"
 
 #include "atomic_ops.h"
 
@@ -57,6 +62,8 @@
 #  include "PIL_time_utildefines.h"
 #endif
 
+using blender::IndexRange;
+
 /* -------------------------------------------------------------------- */
 /** \name Private Utility Functions
  * \{ */
@@ -304,10 +311,188 @@ void BKE_mesh_calc_normals_poly_and_vertex(MVert *mvert,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Mesh Normal Calculation (Polygons & Vertices, Using a Vertex to Polygon Map)
+ *
+ * Implement #BKE_mesh_calc_normals_poly_and_vertex_with_map,
+ *
+ * Instead of accumulating the normals of polygons into their vertices, every vertex gathers the
+ * normals of its polygons. This avoids atomic operations on shared vertices, and since the
+ * polygons of a vertex are always visited in the same order, the result is deterministic.
+ * \{ */
+
+struct MeshCalcNormalsData_Gather {
+  MVert *mvert;
+  const MLoop *mloop;
+  const MPoly *mpoly;
+  const MeshElemMap *vert_to_poly_map;
+
+  const float (*pnors)[3];
+  /** Optional vertex normal output. */
+  float (*vnors)[3];
+};
+
+static void mesh_calc_normals_poly_newell_fn(void *__restrict userdata,
+                                             const int pidx,
+                                             const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const MeshCalcNormalsData_Gather *data = (MeshCalcNormalsData_Gather *)userdata;
+  const MPoly *mp = &data->mpoly[pidx];
+  const MLoop *ml = &data->mloop[mp->loopstart];
+  const MVert *mverts = data->mvert;
+  float *pnor = (float *)data->pnors[pidx];
+
+  /* Same as the polygon normal of #mesh_calc_normals_poly_and_vertex_accum_fn. */
+  zero_v3(pnor);
+  const float *v_curr = mverts[ml[mp->totloop - 1].v].co;
+  for (int i_next = 0; i_next < mp->totloop; i_next++) {
+    const float *v_next = mverts[ml[i_next].v].co;
+    add_newell_cross_v3_v3v3(pnor, v_curr, v_next);
+    v_curr = v_next;
+  }
+  if (UNLIKELY(normalize_v3(pnor) == 0.0f)) {
+    pnor[2] = 1.0f; /* Other axes set to zero. */
+  }
+}
+
+static void mesh_calc_normals_vertex_gather_fn(void *__restrict userdata,
+                                               const int vidx,
+                                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const MeshCalcNormalsData_Gather *data = (MeshCalcNormalsData_Gather *)userdata;
+  const MeshElemMap *vert_polys = &data->vert_to_poly_map[vidx];
+  MVert *mverts = data->mvert;
+  MVert *mv = &mverts[vidx];
+
+  float no[3] = {0.0f, 0.0f, 0.0f};
+  for (int i = 0; i < vert_polys->count; i++) {
+    const int pidx = vert_polys->indices[i];
+    /* A polygon using the vertex more than once is listed once for every corner, all of its
+     * corners are handled below already. */
+    if (i > 0 && pidx == vert_polys->indices[i - 1]) {
+      continue;
+    }
+    const MPoly *mp = &data->mpoly[pidx];
+    const MLoop *ml = &data->mloop[mp->loopstart];
+    const int i_end = mp->totloop - 1;
+
+    for (int i_curr = 0; i_curr <= i_end; i_curr++) {
+      if (ml[i_curr].v != (uint)vidx) {
+        continue;
+      }
+      const int i_prev = (i_curr == 0) ? i_end : i_curr - 1;
+      const int i_next = (i_curr == i_end) ? 0 : i_curr + 1;
+
+      /* Angle weighted polygon normal, like #mesh_calc_normals_poly_and_vertex_accum_fn. */
+      float edvec_prev[3], edvec_next[3];
+      sub_v3_v3v3(edvec_prev, mverts[ml[i_prev].v].co, mv->co);
+      normalize_v3(edvec_prev);
+      sub_v3_v3v3(edvec_next, mv->co, mverts[ml[i_next].v].co);
+      normalize_v3(edvec_next);
+
+      const float fac = saacos(-dot_v3v3(edvec_prev, edvec_next));
+      madd_v3_v3fl(no, data->pnors[pidx], fac);
+    }
+  }
+
+  if (UNLIKELY(normalize_v3(no) == 0.0f)) {
+    /* Following Mesh convention; we use vertex coordinate itself for normal in this case. */
+    normalize_v3_v3(no, mv->co);
+  }
+
+  normal_float_to_short_v3(mv->no, no);
+  if (data->vnors) {
+    copy_v3_v3(data->vnors[vidx], no);
+  }
+}
+
+/**
+ * Same as #BKE_mesh_calc_normals_poly_and_vertex, using a map from vertices to polygons sorted by
+ * polygon index, see #BKE_mesh_runtime_vert_poly_map_ensure.
+ */
+void BKE_mesh_calc_normals_poly_and_vertex_with_map(MVert *mvert,
+                                                    const int mvert_len,
+                                                    const MLoop *mloop,
+                                                    const int UNUSED(mloop_len),
+                                                    const MPoly *mpoly,
+                                                    const int mpoly_len,
+                                                    const MeshElemMap *vert_to_poly_map,
+                                                    float (*r_poly_normals)[3],
+                                                    float (*r_vert_normals)[3])
+{
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+
+  float(*pnors)[3] = r_poly_normals;
+  if (pnors == nullptr) {
+    pnors = (float(*)[3])MEM_malloc_arrayN((size_t)mpoly_len, sizeof(*pnors), __func__);
+  }
+
+  MeshCalcNormalsData_Gather data = {};
+  data.mvert = mvert;
+  data.mloop = mloop;
+  data.mpoly = mpoly;
+  data.vert_to_poly_map = vert_to_poly_map;
+  data.pnors = pnors;
+  data.vnors = r_vert_normals;
+
+  BLI_task_parallel_range(0, mpoly_len, &data, mesh_calc_normals_poly_newell_fn, &settings);
+  BLI_task_parallel_range(0, mvert_len, &data, mesh_calc_normals_vertex_gather_fn, &settings);
+
+  if (pnors != r_poly_normals) {
+    MEM_freeN(pnors);
+  }
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Mesh Normal Calculation
  * \{ */
 
+/**
+ * Vertex normals are stored in the vertex array, which may be referenced or shared by other
+ * meshes. Duplicate it when needed, so the normals can be written.
+ */
+MVert *BKE_mesh_vert_normals_for_write(Mesh *mesh)
+{
+  mesh->mvert = (MVert *)CustomData_duplicate_referenced_layer(
+      &mesh->vdata, CD_MVERT, mesh->totvert);
+  return mesh->mvert;
+}
+
+/**
+ * Evaluated meshes use the cached vertex to polygon map, which is shared by the copies made for
+ * every evaluation of a deforming mesh. Original meshes don't, since tools may change their
+ * topology in place.
+ */
+static void mesh_calc_normals_poly_and_vertex(Mesh *mesh, float (*r_poly_normals)[3])
+{
+  BKE_mesh_vert_normals_for_write(mesh);
+  if (mesh->id.tag & LIB_TAG_NO_MAIN) {
+    BKE_mesh_calc_normals_poly_and_vertex_with_map(mesh->mvert,
+                                                   mesh->totvert,
+                                                   mesh->mloop,
+                                                   mesh->totloop,
+                                                   mesh->mpoly,
+                                                   mesh->totpoly,
+                                                   BKE_mesh_runtime_vert_poly_map_ensure(mesh),
+                                                   r_poly_normals,
+                                                   nullptr);
+  }
+  else {
+    BKE_mesh_calc_normals_poly_and_vertex(mesh->mvert,
+                                          mesh->totvert,
+                                          mesh->mloop,
+                                          mesh->totloop,
+                                          mesh->mpoly,
+                                          mesh->totpoly,
+                                          r_poly_normals,
+                                          nullptr);
+  }
+}
+
 void BKE_mesh_ensure_normals(Mesh *mesh)
 {
   if (mesh->runtime.cd_dirty_vert & CD_MASK_NORMAL) {
@@ -350,14 +535,7 @@ void BKE_mesh_ensure_normals_for_display(Mesh *mesh)
 
     /* Calculate poly/vert normals. */
     if (do_vert_normals) {
-      BKE_mesh_calc_normals_poly_and_vertex(mesh->mvert,
-                                            mesh->totvert,
-                                            mesh->mloop,
-                                            mesh->totloop,
-                                            mesh->mpoly,
-                                            mesh->totpoly,
-                                            poly_nors,
-                                            nullptr);
+      mesh_calc_normals_poly_and_vertex(mesh, poly_nors);
     }
     else {
       BKE_mesh_calc_normals_poly(mesh->mvert,
@@ -387,14 +565,7 @@ void BKE_mesh_calc_normals(Mesh *mesh)
 #ifdef DEBUG_TIME
   TIMEIT_START_AVERAGED(BKE_mesh_calc_normals);
 #endif
-  BKE_mesh_calc_normals_poly_and_vertex(mesh->mvert,
-                                        mesh->totvert,
-                                        mesh->mloop,
-                                        mesh->totloop,
-                                        mesh->mpoly,
-                                        mesh->totpoly,
-                                        nullptr,
-                                        nullptr);
+  mesh_calc_normals_poly_and_vertex(mesh, nullptr);
 #ifdef DEBUG_TIME
   TIMEIT_END_AVERAGED(BKE_mesh_calc_normals);
 #endif
@@ -534,6 +705,20 @@ MLoopNorSpace *BKE_lnor_space_create(MLoopNorSpaceArray *lnors_spacearr)
   return (MLoopNorSpace *)BLI_memarena_calloc(lnors_spacearr->mem, sizeof(MLoopNorSpace));
 }
 
+/**
+ * Create a given number of spaces at once, in a single array.
+ * Unlike #BKE_lnor_space_create, the spaces can be defined from multiple threads afterwards.
+ */
+MLoopNorSpace *BKE_lnor_spaces_create(MLoopNorSpaceArray *lnors_spacearr, const int num)
+{
+  if (num == 0) {
+    return nullptr;
+  }
+  lnors_spacearr->num_spaces += num;
+  return (MLoopNorSpace *)BLI_memarena_calloc(lnors_spacearr->mem,
+                                              sizeof(MLoopNorSpace) * (size_t)num);
+}
+
 /* This threshold is a bit touchy (usual float precision issue), this value seems OK. */
 #define LNOR_SPACE_TRIGO_THRESHOLD (1.0f - 1e-4f)
 
@@ -744,12 +929,12 @@ void BKE_lnor_space_custom_normal_to_data(MLoopNorSpace *lnor_space,
   }
 }
 
+/** Number of polygons handled by every task. */
 #define LOOP_SPLIT_TASK_BLOCK_SIZE 1024
 
 struct LoopSplitTaskData {
   /* Specific to each instance (each task). */
 
-  /** We have to create those outside of tasks, since #MemArena is not thread-safe. */
   MLoopNorSpace *lnor_space;
   float (*lnor)[3];
   const MLoop *ml_curr;
@@ -783,10 +968,18 @@ struct LoopSplitTaskDataCommon {
   int (*edge_to_loops)[2];
   int *loop_to_poly;
   const float (*polynors)[3];
+  /** Optional, map from edges to their loops sorted by index. */
+  const MeshElemMap *edge_to_loop_map;
 
   int numEdges;
   int numLoops;
   int numPolys;
+
+  /**
+   * Some loops are degenerate: their edge doesn't connect their vertex to the next one of the
+   * polygon, or both are the same vertex. Set by #mesh_edges_sharp_tag.
+   */
+  bool has_degenerate_loops;
 };
 
 #define INDEX_UNSET INT_MIN
@@ -794,111 +987,174 @@ struct LoopSplitTaskDataCommon {
 /* See comment about edge_to_loops below. */
 #define IS_EDGE_SHARP(_e2l) (ELEM((_e2l)[1], INDEX_UNSET, INDEX_INVALID))
 
+/**
+ * Second value of edges used by more than two loops, until their sharpness is checked.
+ * Keeps their second loop, see #mesh_edges_sharp_tag. Applying it again gives the loop back.
+ */
+#define INDEX_NON_MANIFOLD(_ml_index) (-2 - (_ml_index))
+#define IS_INDEX_NON_MANIFOLD(_index) ((_index) < INDEX_INVALID && (_index) != INDEX_UNSET)
+
+/**
+ * Fill in the first two loops of every edge, before checking whether smooth edges are sharp.
+ * Edges used by more than two loops are tagged with #INDEX_NON_MANIFOLD.
+ */
+static void mesh_edge_loops_fill(LoopSplitTaskDataCommon *data)
+{
+  using namespace blender;
+  int(*edge_to_loops)[2] = data->edge_to_loops;
+
+  if (data->edge_to_loop_map) {
+    const MeshElemMap *edge_to_loop_map = data->edge_to_loop_map;
+    threading::parallel_for(IndexRange(data->numEdges), 4096, [&](const IndexRange range) {
+      for (const int me_index : range) {
+        const MeshElemMap &map = edge_to_loop_map[me_index];
+        int *e2l = edge_to_loops[me_index];
+        switch (map.count) {
+          case 0:
+            e2l[0] = e2l[1] = 0;
+            break;
+          case 1:
+            e2l[0] = map.indices[0];
+            e2l[1] = INDEX_UNSET;
+            break;
+          case 2:
+            e2l[0] = map.indices[0];
+            e2l[1] = map.indices[1];
+            break;
+          default:
+            e2l[0] = map.indices[0];
+            e2l[1] = INDEX_NON_MANIFOLD(map.indices[1]);
+            break;
+        }
+      }
+    });
+    return;
+  }
+
+  /* NOTE: edge_to_loops is expected to be zero initialized. */
+  const MLoop *mloops = data->mloops;
+  const MPoly *mpolys = data->mpolys;
+  for (const int mp_index : IndexRange(data->numPolys)) {
+    const MPoly *mp = &mpolys[mp_index];
+    for (const int ml_index : IndexRange(mp->loopstart, mp->totloop)) {
+      int *e2l = edge_to_loops[mloops[ml_index].e];
+      if ((e2l[0] | e2l[1]) == 0) {
+        /* 'Empty' edge until now, set e2l[0] (and e2l[1] to INDEX_UNSET to tag it as unset). */
+        e2l[0] = ml_index;
+        e2l[1] = INDEX_UNSET;
+      }
+      else if (e2l[1] == INDEX_UNSET) {
+        /* NOTE: we are sure that loop != 0 here ;). */
+        e2l[1] = ml_index;
+      }
+      else if (e2l[1] > 0) {
+        /* More than two loops using this edge. */
+        e2l[1] = INDEX_NON_MANIFOLD(e2l[1]);
+      }
+    }
+  }
+}
+
 static void mesh_edges_sharp_tag(LoopSplitTaskDataCommon *data,
                                  const bool check_angle,
                                  const float split_angle,
                                  const bool do_sharp_edges_tag)
 {
+  using namespace blender;
   const MVert *mverts = data->mverts;
-  const MEdge *medges = data->medges;
+  MEdge *medges = (MEdge *)data->medges;
   const MLoop *mloops = data->mloops;
 
   const MPoly *mpolys = data->mpolys;
 
-  const int numEdges = data->numEdges;
-  const int numPolys = data->numPolys;
-
   float(*loopnors)[3] = data->loopnors; /* NOTE: loopnors may be nullptr here. */
   const float(*polynors)[3] = data->polynors;
 
   int(*edge_to_loops)[2] = data->edge_to_loops;
   int *loop_to_poly = data->loop_to_poly;
 
-  BLI_bitmap *sharp_edges = do_sharp_edges_tag ? BLI_BITMAP_NEW(numEdges, __func__) : nullptr;
-
-  const MPoly *mp;
-  int mp_index;
-
   const float split_angle_cos = check_angle ? cosf(split_angle) : -1.0f;
 
-  for (mp = mpolys, mp_index = 0; mp_index < numPolys; mp++, mp_index++) {
-    const MLoop *ml_curr;
-    int *e2l;
-    int ml_curr_index = mp->loopstart;
-    const int ml_last_index = (ml_curr_index + mp->totloop) - 1;
-
-    ml_curr = &mloops[ml_curr_index];
+  std::atomic<bool> has_degenerate_loops = false;
 
-    for (; ml_curr_index <= ml_last_index; ml_curr++, ml_curr_index++) {
-      e2l = edge_to_loops[ml_curr->e];
+  threading::parallel_for(IndexRange(data->numPolys), 1024, [&](const IndexRange range) {
+    bool has_degenerate_loops_range = false;
+    for (const int mp_index : range) {
+      const MPoly *mp = &mpolys[mp_index];
+      const int ml_last_index = (mp->loopstart + mp->totloop) - 1;
+      for (const int ml_index : IndexRange(mp->loopstart, mp->totloop)) {
+        loop_to_poly[ml_index] = mp_index;
 
-      loop_to_poly[ml_curr_index] = mp_index;
+        /* Pre-populate all loop normals as if their verts were all-smooth,
+         * this way we don't have to compute those later!
+         */
+        if (loopnors) {
+          normal_short_to_float_v3(loopnors[ml_index], mverts[mloops[ml_index].v].no);
+        }
 
-      /* Pre-populate all loop normals as if their verts were all-smooth,
-       * this way we don't have to compute those later!
-       */
-      if (loopnors) {
-        normal_short_to_float_v3(loopnors[ml_curr_index], mverts[ml_curr->v].no);
+        const MLoop *ml = &mloops[ml_index];
+        const MLoop *ml_next = &mloops[(ml_index == ml_last_index) ? mp->loopstart :
+                                                                      ml_index + 1];
+        const MEdge *me = &medges[ml->e];
+        if (ml->v == ml_next->v || !((me->v1 == ml->v && me->v2 == ml_next->v) ||
+                                     (me->v2 == ml->v && me->v1 == ml_next->v))) {
+          has_degenerate_loops_range = true;
+        }
       }
+    }
+    if (has_degenerate_loops_range) {
+      has_degenerate_loops = true;
+    }
+  });
+  data->has_degenerate_loops = has_degenerate_loops;
 
-      /* Check whether current edge might be smooth or sharp */
-      if ((e2l[0] | e2l[1]) == 0) {
-        /* 'Empty' edge until now, set e2l[0] (and e2l[1] to INDEX_UNSET to tag it as unset). */
-        e2l[0] = ml_curr_index;
-        /* We have to check this here too, else we might miss some flat faces!!! */
-        e2l[1] = (mp->flag & ME_SMOOTH) ? INDEX_UNSET : INDEX_INVALID;
+  mesh_edge_loops_fill(data);
+
+  /* Check whether edges used by two or more loops might be smooth or sharp. */
+  threading::parallel_for(IndexRange(data->numEdges), 4096, [&](const IndexRange range) {
+    for (const int me_index : range) {
+      int *e2l = edge_to_loops[me_index];
+      if (e2l[1] == INDEX_UNSET) {
+        /* Boundary edge, always sharp. */
+        continue;
       }
-      else if (e2l[1] == INDEX_UNSET) {
-        const bool is_angle_sharp = (check_angle &&
-                                     dot_v3v3(polynors[loop_to_poly[e2l[0]]], polynors[mp_index]) <
-                                         split_angle_cos);
-
-        /* Second loop using this edge, time to test its sharpness.
-         * An edge is sharp if it is tagged as such, or its face is not smooth,
-         * or both poly have opposed (flipped) normals, i.e. both loops on the same edge share the
-         * same vertex, or angle between both its polys' normals is above split_angle value.
-         */
-        if (!(mp->flag & ME_SMOOTH) || (medges[ml_curr->e].flag & ME_SHARP) ||
-            ml_curr->v == mloops[e2l[0]].v || is_angle_sharp) {
-          /* NOTE: we are sure that loop != 0 here ;). */
-          e2l[1] = INDEX_INVALID;
-
-          /* We want to avoid tagging edges as sharp when it is already defined as such by
-           * other causes than angle threshold. */
-          if (do_sharp_edges_tag && is_angle_sharp) {
-            BLI_BITMAP_SET(sharp_edges, ml_curr->e, true);
-          }
-        }
-        else {
-          e2l[1] = ml_curr_index;
-        }
+      if (e2l[1] == 0) {
+        /* Loose edge. */
+        continue;
+      }
+
+      /* Edges used by more than two loops are always sharp. Like the other edges, they are still
+       * tagged as sharp when the angle between their first two polygons is too large. */
+      const bool is_manifold = !IS_INDEX_NON_MANIFOLD(e2l[1]);
+      const int ml_index_b = is_manifold ? e2l[1] : INDEX_NON_MANIFOLD(e2l[1]);
+
+      const int mp_index_a = loop_to_poly[e2l[0]];
+      const int mp_index_b = loop_to_poly[ml_index_b];
+      if (!(mpolys[mp_index_a].flag & ME_SMOOTH)) {
+        e2l[1] = INDEX_INVALID;
+        continue;
       }
-      else if (!IS_EDGE_SHARP(e2l)) {
-        /* More than two loops using this edge, tag as sharp if not yet done. */
+
+      const bool is_angle_sharp = (check_angle && dot_v3v3(polynors[mp_index_a],
+                                                           polynors[mp_index_b]) < split_angle_cos);
+
+      /* An edge is sharp if it is tagged as such, or its face is not smooth,
+       * or both poly have opposed (flipped) normals, i.e. both loops on the same edge share the
+       * same vertex, or angle between both its polys' normals is above split_angle value.
+       */
+      if (!is_manifold || !(mpolys[mp_index_b].flag & ME_SMOOTH) ||
+          (medges[me_index].flag & ME_SHARP) || mloops[e2l[0]].v == mloops[ml_index_b].v ||
+          is_angle_sharp) {
         e2l[1] = INDEX_INVALID;
 
         /* We want to avoid tagging edges as sharp when it is already defined as such by
          * other causes than angle threshold. */
-        if (do_sharp_edges_tag) {
-          BLI_BITMAP_SET(sharp_edges, ml_curr->e, false);
+        if (do_sharp_edges_tag && is_angle_sharp) {
+          medges[me_index].flag |= ME_SHARP;
         }
       }
-      /* Else, edge is already 'disqualified' (i.e. sharp)! */
     }
-  }
-
-  /* If requested, do actual tagging of edges as sharp in another loop. */
-  if (do_sharp_edges_tag) {
-    MEdge *me;
-    int me_index;
-    for (me = (MEdge *)medges, me_index = 0; me_index < numEdges; me++, me_index++) {
-      if (BLI_BITMAP_TEST(sharp_edges, me_index)) {
-        me->flag |= ME_SHARP;
-      }
-    }
-
-    MEM_freeN(sharp_edges);
-  }
+  });
 }
 
 /**
@@ -1283,42 +1539,18 @@ static void loop_split_worker_do(LoopSplitTaskDataCommon *common_data,
   }
 }
 
-static void loop_split_worker(TaskPool *__restrict pool, void *taskdata)
-{
-  LoopSplitTaskDataCommon *common_data = (LoopSplitTaskDataCommon *)BLI_task_pool_user_data(pool);
-  LoopSplitTaskData *data = (LoopSplitTaskData *)taskdata;
-
-  /* Temp edge vectors stack, only used when computing lnor spacearr. */
-  BLI_Stack *edge_vectors = common_data->lnors_spacearr ?
-                                BLI_stack_new(sizeof(float[3]), __func__) :
-                                nullptr;
-
-#ifdef DEBUG_TIME
-  TIMEIT_START_AVERAGED(loop_split_worker);
-#endif
-
-  for (int i = 0; i < LOOP_SPLIT_TASK_BLOCK_SIZE; i++, data++) {
-    /* A nullptr ml_curr is used to tag ended data! */
-    if (data->ml_curr == nullptr) {
-      break;
-    }
-
-    loop_split_worker_do(common_data, data, edge_vectors);
-  }
-
-  if (edge_vectors) {
-    BLI_stack_free(edge_vectors);
-  }
-
-#ifdef DEBUG_TIME
-  TIMEIT_END_AVERAGED(loop_split_worker);
-#endif
-}
-
 /**
- * Check whether given loop is part of an unknown-so-far cyclic smooth fan, or not.
+ * Check whether given loop is the entry point of a cyclic smooth fan, or not.
  * Needed because cyclic smooth fans have no obvious 'entry point',
  * and yet we need to walk them once, and only once.
+ *
+ * The entry point is the first loop of the fan in the order of the polygons, like when walking
+ * all loops in order. That way every loop can be checked on its own, from any thread.
+ *
+ * This relies on walking around the vertex always getting back to the initial loop, unless a sharp
+ * edge is found. With degenerate loops that is not the case, the walk can run into a cycle of
+ * other loops. Then \a skip_loops has to be given, and all loops have to be checked in order:
+ * loops found in a previous walk are tagged in it and end the walk.
  */
 static bool loop_split_generator_check_cyclic_smooth_fan(const MLoop *mloops,
                                                          const MPoly *mpolys,
@@ -1354,8 +1586,10 @@ static bool loop_split_generator_check_cyclic_smooth_fan(const MLoop *mloops,
   BLI_assert(mlfan_vert_index >= 0);
   BLI_assert(mpfan_curr_index >= 0);
 
-  BLI_assert(!BLI_BITMAP_TEST(skip_loops, mlfan_vert_index));
-  BLI_BITMAP_ENABLE(skip_loops, mlfan_vert_index);
+  if (skip_loops) {
+    BLI_assert(!BLI_BITMAP_TEST(skip_loops, mlfan_vert_index));
+    BLI_BITMAP_ENABLE(skip_loops, mlfan_vert_index);
+  }
 
   while (true) {
     /* Find next loop of the smooth fan. */
@@ -1376,140 +1610,164 @@ static bool loop_split_generator_check_cyclic_smooth_fan(const MLoop *mloops,
       return false;
     }
     /* Smooth loop/edge. */
-    if (BLI_BITMAP_TEST(skip_loops, mlfan_vert_index)) {
-      if (mlfan_vert_index == ml_curr_index) {
-        /* We walked around a whole cyclic smooth fan without finding any already-processed loop,
-         * means we can use initial `ml_curr` / `ml_prev` edge as start for this smooth fan. */
-        return true;
+    if (mlfan_vert_index == ml_curr_index) {
+      /* We walked around a whole cyclic smooth fan without finding any loop coming before the
+       * initial one, means we can use initial `ml_curr` / `ml_prev` edge as start for this smooth
+       * fan. */
+      return true;
+    }
+    if (skip_loops) {
+      if (BLI_BITMAP_TEST(skip_loops, mlfan_vert_index)) {
+        /* Already checked in some previous looping, we can abort. */
+        return false;
       }
-      /* Already checked in some previous looping, we can abort. */
+      /* We can skip it in future, and keep checking the smooth fan. */
+      BLI_BITMAP_ENABLE(skip_loops, mlfan_vert_index);
+    }
+    else if (mpfan_curr_index < mp_curr_index ||
+             (mpfan_curr_index == mp_curr_index && mlfan_vert_index < ml_curr_index)) {
+      /* The fan is walked from an earlier loop, if it is cyclic at all, we can abort. */
       return false;
     }
-
-    /* We can skip it in future, and keep checking the smooth fan. */
-    BLI_BITMAP_ENABLE(skip_loops, mlfan_vert_index);
   }
 }
 
-static void loop_split_generator(TaskPool *pool, LoopSplitTaskDataCommon *common_data)
-{
-  MLoopNorSpaceArray *lnors_spacearr = common_data->lnors_spacearr;
-  float(*loopnors)[3] = common_data->loopnors;
+/**
+ * Values of the loops of #loop_split_generator, telling whether a loop starts a smooth fan.
+ */
+enum {
+  /** The loop is part of a fan started by another loop. */
+  LOOP_SPLIT_SKIP = 0,
+  /** Both edges of the loop are sharp, it has its own normal. */
+  LOOP_SPLIT_SINGLE = 1,
+  /** The loop starts a fan, the smooth fan is walked from its previous edge. */
+  LOOP_SPLIT_FAN = 2,
+};
 
+/**
+ * \param skip_loops: Only for meshes with degenerate loops, see
+ * #loop_split_generator_check_cyclic_smooth_fan.
+ */
+static char loop_split_type_get(const LoopSplitTaskDataCommon *common_data,
+                                const int ml_curr_index,
+                                const int ml_prev_index,
+                                const int mp_index,
+                                BLI_bitmap *skip_loops)
+{
   const MLoop *mloops = common_data->mloops;
-  const MPoly *mpolys = common_data->mpolys;
-  const int *loop_to_poly = common_data->loop_to_poly;
   const int(*edge_to_loops)[2] = common_data->edge_to_loops;
-  const int numLoops = common_data->numLoops;
-  const int numPolys = common_data->numPolys;
-
-  const MPoly *mp;
-  int mp_index;
-
-  const MLoop *ml_curr;
-  const MLoop *ml_prev;
-  int ml_curr_index;
-  int ml_prev_index;
-
-  BLI_bitmap *skip_loops = BLI_BITMAP_NEW(numLoops, __func__);
-
-  LoopSplitTaskData *data_buff = nullptr;
-  int data_idx = 0;
-
-  /* Temp edge vectors stack, only used when computing lnor spacearr
-   * (and we are not multi-threading). */
-  BLI_Stack *edge_vectors = nullptr;
+  const MLoop *ml_curr = &mloops[ml_curr_index];
+  const MLoop *ml_prev = &mloops[ml_prev_index];
+  const int *e2l_curr = edge_to_loops[ml_curr->e];
+  const int *e2l_prev = edge_to_loops[ml_prev->e];
+
+  if (IS_EDGE_SHARP(e2l_curr)) {
+    return IS_EDGE_SHARP(e2l_prev) ? LOOP_SPLIT_SINGLE : LOOP_SPLIT_FAN;
+  }
+  if (skip_loops && BLI_BITMAP_TEST(skip_loops, ml_curr_index)) {
+    return LOOP_SPLIT_SKIP;
+  }
+
+  /* A smooth edge, we have to check for cyclic smooth fan case.
+   * If we find a new, never-processed cyclic smooth fan, we can do it now using that loop/edge
+   * as 'entry point', otherwise we can skip it. */
+
+  /* NOTE: In theory, we could make #loop_split_generator_check_cyclic_smooth_fan() store
+   * mlfan_vert_index'es and edge indexes in two stacks, to avoid having to fan again around
+   * the vert during actual computation of `clnor` & `clnorspace`.
+   * However, this would complicate the code, add more memory usage, and despite its logical
+   * complexity, #loop_manifold_fan_around_vert_next() is quite cheap in term of CPU cycles,
+   * so really think it's not worth it. */
+  if (loop_split_generator_check_cyclic_smooth_fan(mloops,
+                                                   common_data->mpolys,
+                                                   edge_to_loops,
+                                                   common_data->loop_to_poly,
+                                                   e2l_prev,
+                                                   skip_loops,
+                                                   ml_curr,
+                                                   ml_prev,
+                                                   ml_curr_index,
+                                                   ml_prev_index,
+                                                   mp_index)) {
+    return LOOP_SPLIT_FAN;
+  }
+  return LOOP_SPLIT_SKIP;
+}
 
-#ifdef DEBUG_TIME
-  TIMEIT_START_AVERAGED(loop_split_generator);
-#endif
+/**
+ * Find the loops starting smooth fans in a range of polygons.
+ *
+ * \param skip_loops: Only for meshes with degenerate loops, then all polygons have to be handled
+ * in order, see #loop_split_generator_check_cyclic_smooth_fan.
+ * \return The number of fans started in the range.
+ */
+static int loop_split_types_calc(const LoopSplitTaskDataCommon *common_data,
+                                 const IndexRange poly_range,
+                                 BLI_bitmap *skip_loops,
+                                 char *r_loop_split_types)
+{
+  const MPoly *mpolys = common_data->mpolys;
+  int fans_num = 0;
 
-  if (!pool) {
-    if (lnors_spacearr) {
-      edge_vectors = BLI_stack_new(sizeof(float[3]), __func__);
+  for (const int mp_index : poly_range) {
+    const MPoly *mp = &mpolys[mp_index];
+    const int ml_last_index = (mp->loopstart + mp->totloop) - 1;
+    int ml_prev_index = ml_last_index;
+    for (int ml_curr_index = mp->loopstart; ml_curr_index <= ml_last_index; ml_curr_index++) {
+      const char type = loop_split_type_get(
+          common_data, ml_curr_index, ml_prev_index, mp_index, skip_loops);
+      r_loop_split_types[ml_curr_index] = type;
+      fans_num += (type != LOOP_SPLIT_SKIP);
+      ml_prev_index = ml_curr_index;
     }
   }
+  return fans_num;
+}
 
-  /* We now know edges that can be smoothed (with their vector, and their two loops),
-   * and edges that will be hard! Now, time to generate the normals.
-   */
-  for (mp = mpolys, mp_index = 0; mp_index < numPolys; mp++, mp_index++) {
-    float(*lnors)[3];
-    const int ml_last_index = (mp->loopstart + mp->totloop) - 1;
-    ml_curr_index = mp->loopstart;
-    ml_prev_index = ml_last_index;
-
-    ml_curr = &mloops[ml_curr_index];
-    ml_prev = &mloops[ml_prev_index];
-    lnors = &loopnors[ml_curr_index];
+/**
+ * Compute the normals of the smooth fans started in a range of polygons.
+ *
+ * \param loop_split_types: Optional, the result of #loop_split_types_calc.
+ * \param lnor_spaces: The spaces of the fans started in the range, in the order of their first
+ * loops. Only used when computing the lnor space array.
+ */
+static void loop_split_worker(LoopSplitTaskDataCommon *common_data,
+                              const IndexRange poly_range,
+                              const char *loop_split_types,
+                              MLoopNorSpace *lnor_spaces)
+{
+  float(*loopnors)[3] = common_data->loopnors;
+  const MLoop *mloops = common_data->mloops;
+  const MPoly *mpolys = common_data->mpolys;
+  const int(*edge_to_loops)[2] = common_data->edge_to_loops;
 
-    for (; ml_curr_index <= ml_last_index; ml_curr++, ml_curr_index++, lnors++) {
-      const int *e2l_curr = edge_to_loops[ml_curr->e];
-      const int *e2l_prev = edge_to_loops[ml_prev->e];
+  /* Temp edge vectors stack, only used when computing lnor spacearr. */
+  BLI_Stack *edge_vectors = common_data->lnors_spacearr ?
+                                BLI_stack_new(sizeof(float[3]), __func__) :
+                                nullptr;
 
-#if 0
-      printf("Checking loop %d / edge %u / vert %u (sharp edge: %d, skiploop: %d)",
-             ml_curr_index,
-             ml_curr->e,
-             ml_curr->v,
-             IS_EDGE_SHARP(e2l_curr),
-             BLI_BITMAP_TEST_BOOL(skip_loops, ml_curr_index));
+#ifdef DEBUG_TIME
+  TIMEIT_START_AVERAGED(loop_split_worker);
 #endif
 
-      /* A smooth edge, we have to check for cyclic smooth fan case.
-       * If we find a new, never-processed cyclic smooth fan, we can do it now using that loop/edge
-       * as 'entry point', otherwise we can skip it. */
-
-      /* NOTE: In theory, we could make #loop_split_generator_check_cyclic_smooth_fan() store
-       * mlfan_vert_index'es and edge indexes in two stacks, to avoid having to fan again around
-       * the vert during actual computation of `clnor` & `clnorspace`.
-       * However, this would complicate the code, add more memory usage, and despite its logical
-       * complexity, #loop_manifold_fan_around_vert_next() is quite cheap in term of CPU cycles,
-       * so really think it's not worth it. */
-      if (!IS_EDGE_SHARP(e2l_curr) && (BLI_BITMAP_TEST(skip_loops, ml_curr_index) ||
-                                       !loop_split_generator_check_cyclic_smooth_fan(mloops,
-                                                                                     mpolys,
-                                                                                     edge_to_loops,
-                                                                                     loop_to_poly,
-                                                                                     e2l_prev,
-                                                                                     skip_loops,
-                                                                                     ml_curr,
-                                                                                     ml_prev,
-                                                                                     ml_curr_index,
-                                                                                     ml_prev_index,
-                                                                                     mp_index))) {
-        // printf("SKIPPING!\n");
-      }
-      else {
-        LoopSplitTaskData *data, data_local;
-
-        // printf("PROCESSING!\n");
-
-        if (pool) {
-          if (data_idx == 0) {
-            data_buff = (LoopSplitTaskData *)MEM_calloc_arrayN(
-                LOOP_SPLIT_TASK_BLOCK_SIZE, sizeof(*data_buff), __func__);
-          }
-          data = &data_buff[data_idx];
-        }
-        else {
-          data = &data_local;
-          memset(data, 0, sizeof(*data));
-        }
-
-        if (IS_EDGE_SHARP(e2l_curr) && IS_EDGE_SHARP(e2l_prev)) {
-          data->lnor = lnors;
-          data->ml_curr = ml_curr;
-          data->ml_prev = ml_prev;
-          data->ml_curr_index = ml_curr_index;
-#if 0 /* Not needed for 'single' loop. */
-          data->ml_prev_index = ml_prev_index;
-          data->e2l_prev = nullptr; /* Tag as 'single' task. */
-#endif
-          data->mp_index = mp_index;
-          if (lnors_spacearr) {
-            data->lnor_space = BKE_lnor_space_create(lnors_spacearr);
-          }
+  for (const int mp_index : poly_range) {
+    const MPoly *mp = &mpolys[mp_index];
+    const int ml_last_index = (mp->loopstart + mp->totloop) - 1;
+    int ml_prev_index = ml_last_index;
+    for (int ml_curr_index = mp->loopstart; ml_curr_index <= ml_last_index; ml_curr_index++) {
+      const char type = loop_split_types ?
+                            loop_split_types[ml_curr_index] :
+                            loop_split_type_get(
+                                common_data, ml_curr_index, ml_prev_index, mp_index, nullptr);
+
+      if (type != LOOP_SPLIT_SKIP) {
+        LoopSplitTaskData data = {nullptr};
+        data.ml_curr = &mloops[ml_curr_index];
+        data.ml_prev = &mloops[ml_prev_index];
+        data.ml_curr_index = ml_curr_index;
+        data.mp_index = mp_index;
+        if (type == LOOP_SPLIT_SINGLE) {
+          data.lnor = &loopnors[ml_curr_index];
         }
         /* We *do not need* to check/tag loops as already computed!
          * Due to the fact a loop only links to one of its two edges,
@@ -1521,73 +1779,123 @@ static void loop_split_generator(TaskPool *pool, LoopSplitTaskDataCommon *common
          * All this due/thanks to link between normals and loop ordering (i.e. winding).
          */
         else {
-#if 0 /* Not needed for 'fan' loops. */
-          data->lnor = lnors;
-#endif
-          data->ml_curr = ml_curr;
-          data->ml_prev = ml_prev;
-          data->ml_curr_index = ml_curr_index;
-          data->ml_prev_index = ml_prev_index;
-          data->e2l_prev = e2l_prev; /* Also tag as 'fan' task. */
-          data->mp_index = mp_index;
-          if (lnors_spacearr) {
-            data->lnor_space = BKE_lnor_space_create(lnors_spacearr);
-          }
-        }
-
-        if (pool) {
-          data_idx++;
-          if (data_idx == LOOP_SPLIT_TASK_BLOCK_SIZE) {
-            BLI_task_pool_push(pool, loop_split_worker, data_buff, true, nullptr);
-            data_idx = 0;
-          }
+          data.ml_prev_index = ml_prev_index;
+          data.e2l_prev = edge_to_loops[data.ml_prev->e]; /* Also tag as 'fan' task. */
         }
-        else {
-          loop_split_worker_do(common_data, data, edge_vectors);
+        if (lnor_spaces) {
+          data.lnor_space = lnor_spaces++;
         }
+
+        loop_split_worker_do(common_data, &data, edge_vectors);
       }
 
-      ml_prev = ml_curr;
       ml_prev_index = ml_curr_index;
     }
   }
 
-  /* Last block of data. Since it is calloc'ed and we use first nullptr item as stopper,
-   * everything is fine. */
-  if (pool && data_idx) {
-    BLI_task_pool_push(pool, loop_split_worker, data_buff, true, nullptr);
-  }
-
   if (edge_vectors) {
     BLI_stack_free(edge_vectors);
   }
-  MEM_freeN(skip_loops);
+
+#ifdef DEBUG_TIME
+  TIMEIT_END_AVERAGED(loop_split_worker);
+#endif
+}
+
+static void loop_split_generator(LoopSplitTaskDataCommon *common_data)
+{
+  using namespace blender;
+  MLoopNorSpaceArray *lnors_spacearr = common_data->lnors_spacearr;
+  const int numPolys = common_data->numPolys;
+
+#ifdef DEBUG_TIME
+  TIMEIT_START_AVERAGED(loop_split_generator);
+#endif
+
+  if (lnors_spacearr == nullptr && !common_data->has_degenerate_loops) {
+    /* Fans don't depend on each other, so they can be computed right when they are found. */
+    threading::parallel_for(
+        IndexRange(numPolys), LOOP_SPLIT_TASK_BLOCK_SIZE, [&](const IndexRange range) {
+          loop_split_worker(common_data, range, nullptr, nullptr);
+        });
+  }
+  else {
+    /* Find all fans first, to create their spaces in a single array, in the order of their first
+     * loops. The polygons are split into fixed blocks, so that the spaces of every block can be
+     * found from the number of fans in the blocks before it.
+     * With degenerate loops, the fans have to be found in order, on a single thread. */
+    const int blocks_num = (numPolys + LOOP_SPLIT_TASK_BLOCK_SIZE - 1) /
+                           LOOP_SPLIT_TASK_BLOCK_SIZE;
+    auto block_polys = [&](const int block) {
+      const int start = block * LOOP_SPLIT_TASK_BLOCK_SIZE;
+      return IndexRange(start, std::min(LOOP_SPLIT_TASK_BLOCK_SIZE, numPolys - start));
+    };
+
+    char *loop_split_types = (char *)MEM_malloc_arrayN(
+        (size_t)common_data->numLoops, sizeof(*loop_split_types), __func__);
+    int *block_offsets = (int *)MEM_malloc_arrayN(
+        (size_t)blocks_num, sizeof(*block_offsets), __func__);
+
+    if (common_data->has_degenerate_loops) {
+      BLI_bitmap *skip_loops = BLI_BITMAP_NEW(common_data->numLoops, __func__);
+      for (const int block : IndexRange(blocks_num)) {
+        block_offsets[block] = loop_split_types_calc(
+            common_data, block_polys(block), skip_loops, loop_split_types);
+      }
+      MEM_freeN(skip_loops);
+    }
+    else {
+      threading::parallel_for(IndexRange(blocks_num), 1, [&](const IndexRange range) {
+        for (const int block : range) {
+          block_offsets[block] = loop_split_types_calc(
+              common_data, block_polys(block), nullptr, loop_split_types);
+        }
+      });
+    }
+
+    int spaces_num = 0;
+    for (const int block : IndexRange(blocks_num)) {
+      const int fans_num = block_offsets[block];
+      block_offsets[block] = spaces_num;
+      spaces_num += fans_num;
+    }
+    MLoopNorSpace *lnor_spaces = lnors_spacearr ?
+                                     BKE_lnor_spaces_create(lnors_spacearr, spaces_num) :
+                                     nullptr;
+
+    threading::parallel_for(IndexRange(blocks_num), 1, [&](const IndexRange range) {
+      for (const int block : range) {
+        loop_split_worker(common_data,
+                          block_polys(block),
+                          loop_split_types,
+                          lnor_spaces ? lnor_spaces + block_offsets[block] : nullptr);
+      }
+    });
+
+    MEM_freeN(loop_split_types);
+    MEM_freeN(block_offsets);
+  }
 
 #ifdef DEBUG_TIME
   TIMEIT_END_AVERAGED(loop_split_generator);
 #endif
 }
 
-/**
- * Compute split normals, i.e. vertex normals associated with each poly (hence 'loop normals').
- * Useful to materialize sharp edges (or non-smooth faces) without actually modifying the geometry
- * (splitting edges).
- */
-void BKE_mesh_normals_loop_split(const MVert *mverts,
-                                 const int UNUSED(numVerts),
-                                 MEdge *medges,
-                                 const int numEdges,
-                                 MLoop *mloops,
-                                 float (*r_loopnors)[3],
-                                 const int numLoops,
-                                 MPoly *mpolys,
-                                 const float (*polynors)[3],
-                                 const int numPolys,
-                                 const bool use_split_normals,
-                                 const float split_angle,
-                                 MLoopNorSpaceArray *r_lnors_spacearr,
-                                 short (*clnors_data)[2],
-                                 int *r_loop_to_poly)
+static void mesh_normals_loop_split(const MVert *mverts,
+                                    MEdge *medges,
+                                    const int numEdges,
+                                    MLoop *mloops,
+                                    float (*r_loopnors)[3],
+                                    const int numLoops,
+                                    MPoly *mpolys,
+                                    const float (*polynors)[3],
+                                    const int numPolys,
+                                    const bool use_split_normals,
+                                    const float split_angle,
+                                    MLoopNorSpaceArray *r_lnors_spacearr,
+                                    short (*clnors_data)[2],
+                                    int *r_loop_to_poly,
+                                    const MeshElemMap *edge_to_loop_map)
 {
   /* For now this is not supported.
    * If we do not use split normals, we do not generate anything fancy! */
@@ -1674,6 +1982,7 @@ void BKE_mesh_normals_loop_split(const MVert *mverts,
   common_data.edge_to_loops = edge_to_loops;
   common_data.loop_to_poly = loop_to_poly;
   common_data.polynors = polynors;
+  common_data.edge_to_loop_map = edge_to_loop_map;
   common_data.numEdges = numEdges;
   common_data.numLoops = numLoops;
   common_data.numPolys = numPolys;
@@ -1681,19 +1990,7 @@ void BKE_mesh_normals_loop_split(const MVert *mverts,
   /* This first loop check which edges are actually smooth, and compute edge vectors. */
   mesh_edges_sharp_tag(&common_data, check_angle, split_angle, false);
 
-  if (numLoops < LOOP_SPLIT_TASK_BLOCK_SIZE * 8) {
-    /* Not enough loops to be worth the whole threading overhead. */
-    loop_split_generator(nullptr, &common_data);
-  }
-  else {
-    TaskPool *task_pool = BLI_task_pool_create(&common_data, TASK_PRIORITY_HIGH);
-
-    loop_split_generator(task_pool, &common_data);
-
-    BLI_task_pool_work_and_wait(task_pool);
-
-    BLI_task_pool_free(task_pool);
-  }
+  loop_split_generator(&common_data);
 
   MEM_freeN(edge_to_loops);
   if (!r_loop_to_poly) {
@@ -1711,6 +2008,83 @@ void BKE_mesh_normals_loop_split(const MVert *mverts,
 #endif
 }
 
+/**
+ * Compute split normals, i.e. vertex normals associated with each poly (hence 'loop normals').
+ * Useful to materialize sharp edges (or non-smooth faces) without actually modifying the geometry
+ * (splitting edges).
+ */
+void BKE_mesh_normals_loop_split(const MVert *mverts,
+                                 const int UNUSED(numVerts),
+                                 MEdge *medges,
+                                 const int numEdges,
+                                 MLoop *mloops,
+                                 float (*r_loopnors)[3],
+                                 const int numLoops,
+                                 MPoly *mpolys,
+                                 const float (*polynors)[3],
+                                 const int numPolys,
+                                 const bool use_split_normals,
+                                 const float split_angle,
+                                 MLoopNorSpaceArray *r_lnors_spacearr,
+                                 short (*clnors_data)[2],
+                                 int *r_loop_to_poly)
+{
+  mesh_normals_loop_split(mverts,
+                          medges,
+                          numEdges,
+                          mloops,
+                          r_loopnors,
+                          numLoops,
+                          mpolys,
+                          polynors,
+                          numPolys,
+                          use_split_normals,
+                          split_angle,
+                          r_lnors_spacearr,
+                          clnors_data,
+                          r_loop_to_poly,
+                          nullptr);
+}
+
+/**
+ * Same as #BKE_mesh_normals_loop_split, using a map from edges to loops sorted by loop index,
+ * see #BKE_mesh_runtime_edge_loop_map_ensure. The map only depends on the topology, so it can
+ * be kept while the mesh is deformed.
+ */
+void BKE_mesh_normals_loop_split_with_map(const MVert *mverts,
+                                          const int UNUSED(numVerts),
+                                          MEdge *medges,
+                                          const int numEdges,
+                                          MLoop *mloops,
+                                          float (*r_loopnors)[3],
+                                          const int numLoops,
+                                          MPoly *mpolys,
+                                          const float (*polynors)[3],
+                                          const int numPolys,
+                                          const bool use_split_normals,
+                                          const float split_angle,
+                                          MLoopNorSpaceArray *r_lnors_spacearr,
+                                          short (*clnors_data)[2],
+                                          int *r_loop_to_poly,
+                                          const MeshElemMap *edge_to_loop_map)
+{
+  mesh_normals_loop_split(mverts,
+                          medges,
+                          numEdges,
+                          mloops,
+                          r_loopnors,
+                          numLoops,
+                          mpolys,
+                          polynors,
+                          numPolys,
+                          use_split_normals,
+                          split_angle,
+                          r_lnors_spacearr,
+                          clnors_data,
+                          r_loop_to_poly,
+                          edge_to_loop_map);
+}
+
 #undef INDEX_UNSET
 #undef INDEX_INVALID
 #undef IS_EDGE_SHARP
@@ -2015,7 +2389,8 @@ static void mesh_set_custom_normals(Mesh *mesh, float (*r_custom_nors)[3], const
   short(*clnors)[2];
   const int numloops = mesh->totloop;
 
-  clnors = (short(*)[2])CustomData_get_layer(&mesh->ldata, CD_CUSTOMLOOPNORMAL);
+  clnors = (short(*)[2])CustomData_duplicate_referenced_layer(
+      &mesh->ldata, CD_CUSTOMLOOPNORMAL, numloops);
   if (clnors != nullptr) {
     memset(clnors, 0, sizeof(*clnors) * (size_t)numloops);
   }
@@ -2028,7 +2403,7 @@ static void mesh_set_custom_normals(Mesh *mesh, float (*r_custom_nors)[3], const
   bool free_polynors = false;
   if (polynors == nullptr) {
     polynors = (float(*)[3])MEM_mallocN(sizeof(float[3]) * (size_t)mesh->totpoly, __func__);
-    BKE_mesh_calc_normals_poly_and_vertex(mesh->mvert,
+    BKE_mesh_calc_normals_poly_and_vertex(BKE_mesh_vert_normals_for_write(mesh),
                                           mesh->totvert,
                                           mesh->mloop,
                                           mesh->totloop,
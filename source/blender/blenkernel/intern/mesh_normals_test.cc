@@ -0,0 +1,373 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_meshdata_types.h"
+
+#include "BLI_array.hh"
+#include "BLI_float3.hh"
+#include "BLI_map.hh"
+#include "BLI_math.h"
+#include "BLI_set.hh"
+#include "BLI_span.hh"
+#include "BLI_vector.hh"
+
+#include "BKE_mesh.h"
+#include "BKE_mesh_mapping.h"
+
+namespace blender::bke::tests {
+
+/* A wavy grid of quads, with a triangle fan in every other row so that vertices have a varying
+ * number of polygons. */
+struct NormalsTestMesh {
+  Array<MVert> verts;
+  Vector<MEdge> edges;
+  Vector<MLoop> loops;
+  Vector<MPoly> polys;
+  Map<std::pair<int, int>, int> edge_indices;
+};
+
+static int edge_get(NormalsTestMesh &mesh, const int v1, const int v2)
+{
+  return mesh.edge_indices.lookup_or_add_cb({std::min(v1, v2), std::max(v1, v2)}, [&]() {
+    MEdge edge = {};
+    edge.v1 = v1;
+    edge.v2 = v2;
+    mesh.edges.append(edge);
+    return int(mesh.edges.size() - 1);
+  });
+}
+
+static void add_poly(NormalsTestMesh &mesh, const Span<int> verts)
+{
+  MPoly poly = {};
+  poly.loopstart = mesh.loops.size();
+  poly.totloop = verts.size();
+  poly.flag = ME_SMOOTH;
+  mesh.polys.append(poly);
+  for (const int i : verts.index_range()) {
+    MLoop loop = {};
+    loop.v = verts[i];
+    loop.e = edge_get(mesh, verts[i], verts[(i + 1) % verts.size()]);
+    mesh.loops.append(loop);
+  }
+}
+
+static NormalsTestMesh normals_test_mesh_create(const int res)
+{
+  NormalsTestMesh mesh;
+  mesh.verts.reinitialize(res * res);
+  for (const int y : IndexRange(res)) {
+    for (const int x : IndexRange(res)) {
+      MVert &vert = mesh.verts[y * res + x];
+      vert = {};
+      vert.co[0] = float(x);
+      vert.co[1] = float(y);
+      vert.co[2] = sinf(float(x) * 0.7f) * cosf(float(y) * 0.3f);
+    }
+  }
+  for (const int y : IndexRange(res - 1)) {
+    for (const int x : IndexRange(res - 1)) {
+      const int v = y * res + x;
+      if (y % 2) {
+        add_poly(mesh, {v, v + 1, v + res + 1});
+        add_poly(mesh, {v, v + res + 1, v + res});
+      }
+      else {
+        add_poly(mesh, {v, v + 1, v + res + 1, v + res});
+      }
+    }
+  }
+  return mesh;
+}
+
+static void calc_normals_with_map(NormalsTestMesh &mesh,
+                                  MutableSpan<float3> poly_normals,
+                                  MutableSpan<float3> vert_normals)
+{
+  MeshElemMap *vert_to_poly_map;
+  int *vert_to_poly_indices;
+  BKE_mesh_vert_poly_map_create(&vert_to_poly_map,
+                                &vert_to_poly_indices,
+                                mesh.polys.data(),
+                                mesh.loops.data(),
+                                mesh.verts.size(),
+                                mesh.polys.size(),
+                                mesh.loops.size());
+  BKE_mesh_calc_normals_poly_and_vertex_with_map(mesh.verts.data(),
+                                                 mesh.verts.size(),
+                                                 mesh.loops.data(),
+                                                 mesh.loops.size(),
+                                                 mesh.polys.data(),
+                                                 mesh.polys.size(),
+                                                 vert_to_poly_map,
+                                                 (float(*)[3])poly_normals.data(),
+                                                 (float(*)[3])vert_normals.data());
+  MEM_freeN(vert_to_poly_map);
+  MEM_freeN(vert_to_poly_indices);
+}
+
+TEST(mesh_normals, GatherMatchesAccumulate)
+{
+  NormalsTestMesh mesh = normals_test_mesh_create(100);
+
+  Array<float3> poly_normals(mesh.polys.size());
+  Array<float3> vert_normals(mesh.verts.size());
+  BKE_mesh_calc_normals_poly_and_vertex(mesh.verts.data(),
+                                        mesh.verts.size(),
+                                        mesh.loops.data(),
+                                        mesh.loops.size(),
+                                        mesh.polys.data(),
+                                        mesh.polys.size(),
+                                        (float(*)[3])poly_normals.data(),
+                                        (float(*)[3])vert_normals.data());
+
+  Array<float3> poly_normals_gather(mesh.polys.size());
+  Array<float3> vert_normals_gather(mesh.verts.size());
+  calc_normals_with_map(mesh, poly_normals_gather, vert_normals_gather);
+
+  for (const int i : poly_normals.index_range()) {
+    EXPECT_V3_NEAR(poly_normals[i], poly_normals_gather[i], 1e-6f);
+  }
+  for (const int i : vert_normals.index_range()) {
+    EXPECT_V3_NEAR(vert_normals[i], vert_normals_gather[i], 1e-5f);
+  }
+}
+
+TEST(mesh_normals, GatherIsDeterministic)
+{
+  NormalsTestMesh mesh = normals_test_mesh_create(200);
+
+  Array<float3> poly_normals(mesh.polys.size());
+  Array<float3> vert_normals_a(mesh.verts.size());
+  Array<float3> vert_normals_b(mesh.verts.size());
+  calc_normals_with_map(mesh, poly_normals, vert_normals_a);
+  calc_normals_with_map(mesh, poly_normals, vert_normals_b);
+
+  EXPECT_EQ(memcmp(vert_normals_a.data(),
+                   vert_normals_b.data(),
+                   sizeof(float3) * size_t(vert_normals_a.size())),
+            0);
+}
+
+static void calc_normals_split(NormalsTestMesh &mesh,
+                               const Span<float3> poly_normals,
+                               const MeshElemMap *edge_to_loop_map,
+                               MLoopNorSpaceArray *r_lnors_spacearr,
+                               MutableSpan<float3> r_loop_normals)
+{
+  BKE_mesh_normals_loop_split_with_map(mesh.verts.data(),
+                                       mesh.verts.size(),
+                                       mesh.edges.data(),
+                                       mesh.edges.size(),
+                                       mesh.loops.data(),
+                                       (float(*)[3])r_loop_normals.data(),
+                                       mesh.loops.size(),
+                                       mesh.polys.data(),
+                                       (const float(*)[3])poly_normals.data(),
+                                       mesh.polys.size(),
+                                       true,
+                                       0.5f,
+                                       r_lnors_spacearr,
+                                       nullptr,
+                                       nullptr,
+                                       edge_to_loop_map);
+}
+
+/* Split normals are the same with and without the edge to loop map and the loop normal spaces,
+ * and every loop is part of exactly one space. */
+TEST(mesh_normals, SplitNormals)
+{
+  NormalsTestMesh mesh = normals_test_mesh_create(200);
+
+  Array<float3> poly_normals(mesh.polys.size());
+  BKE_mesh_calc_normals_poly_and_vertex(mesh.verts.data(),
+                                        mesh.verts.size(),
+                                        mesh.loops.data(),
+                                        mesh.loops.size(),
+                                        mesh.polys.data(),
+                                        mesh.polys.size(),
+                                        (float(*)[3])poly_normals.data(),
+                                        nullptr);
+
+  Array<Vector<int>> edge_loops(mesh.edges.size());
+  for (const int i : mesh.loops.index_range()) {
+    edge_loops[mesh.loops[i].e].append(i);
+  }
+  Array<MeshElemMap> edge_to_loop_map(mesh.edges.size());
+  for (const int i : edge_loops.index_range()) {
+    edge_to_loop_map[i].indices = edge_loops[i].data();
+    edge_to_loop_map[i].count = edge_loops[i].size();
+  }
+
+  Array<float3> loop_normals(mesh.loops.size());
+  calc_normals_split(mesh, poly_normals, nullptr, nullptr, loop_normals);
+
+  Array<float3> loop_normals_map(mesh.loops.size());
+  calc_normals_split(mesh, poly_normals, edge_to_loop_map.data(), nullptr, loop_normals_map);
+
+  MLoopNorSpaceArray lnors_spacearr = {nullptr};
+  Array<float3> loop_normals_spaces(mesh.loops.size());
+  calc_normals_split(mesh, poly_normals, nullptr, &lnors_spacearr, loop_normals_spaces);
+
+  for (const int i : loop_normals.index_range()) {
+    EXPECT_EQ(loop_normals[i], loop_normals_map[i]);
+    EXPECT_EQ(loop_normals[i], loop_normals_spaces[i]);
+  }
+
+  Set<const MLoopNorSpace *> spaces;
+  for (const int i : mesh.loops.index_range()) {
+    const MLoopNorSpace *lnor_space = lnors_spacearr.lspacearr[i];
+    ASSERT_NE(lnor_space, nullptr);
+    spaces.add(lnor_space);
+  }
+  EXPECT_EQ(spaces.size(), lnors_spacearr.num_spaces);
+  /* The wavy mesh has smooth and sharp fans. */
+  EXPECT_GT(spaces.size(), 0);
+  EXPECT_LT(spaces.size(), mesh.loops.size());
+
+  BKE_lnor_spacearr_free(&lnors_spacearr);
+}
+
+static NormalsTestMesh normals_test_mesh_from_coords(const Span<float3> coords)
+{
+  NormalsTestMesh mesh;
+  mesh.verts.reinitialize(coords.size());
+  for (const int i : coords.index_range()) {
+    mesh.verts[i] = {};
+    copy_v3_v3(mesh.verts[i].co, coords[i]);
+  }
+  return mesh;
+}
+
+/* Three quads sharing the edge (0, 1). Two of them are coplanar, the third is at a right angle,
+ * and is added second when `fin_second` is true. */
+static NormalsTestMesh normals_test_mesh_non_manifold_create(const bool fin_second)
+{
+  NormalsTestMesh mesh = normals_test_mesh_from_coords({{0.0f, 0.0f, 0.0f},
+                                                        {1.0f, 0.0f, 0.0f},
+                                                        {1.0f, 1.0f, 0.0f},
+                                                        {0.0f, 1.0f, 0.0f},
+                                                        {1.0f, -1.0f, 0.0f},
+                                                        {0.0f, -1.0f, 0.0f},
+                                                        {0.0f, 0.0f, 1.0f},
+                                                        {1.0f, 0.0f, 1.0f}});
+  add_poly(mesh, {0, 1, 2, 3});
+  if (fin_second) {
+    add_poly(mesh, {0, 1, 7, 6});
+    add_poly(mesh, {1, 0, 5, 4});
+  }
+  else {
+    add_poly(mesh, {1, 0, 5, 4});
+    add_poly(mesh, {0, 1, 7, 6});
+  }
+  return mesh;
+}
+
+static Array<float3> calc_poly_normals(NormalsTestMesh &mesh)
+{
+  Array<float3> poly_normals(mesh.polys.size());
+  BKE_mesh_calc_normals_poly_and_vertex(mesh.verts.data(),
+                                        mesh.verts.size(),
+                                        mesh.loops.data(),
+                                        mesh.loops.size(),
+                                        mesh.polys.data(),
+                                        mesh.polys.size(),
+                                        (float(*)[3])poly_normals.data(),
+                                        nullptr);
+  return poly_normals;
+}
+
+/* Like for manifold edges, the angle between the first two polygons of an edge used by more
+ * polygons decides whether it is tagged sharp. */
+TEST(mesh_normals, EdgesSharpFromAngleNonManifold)
+{
+  for (const bool fin_second : {false, true}) {
+    NormalsTestMesh mesh = normals_test_mesh_non_manifold_create(fin_second);
+    const Array<float3> poly_normals = calc_poly_normals(mesh);
+    BKE_edges_sharp_from_angle_set(mesh.verts.data(),
+                                   mesh.verts.size(),
+                                   mesh.edges.data(),
+                                   mesh.edges.size(),
+                                   mesh.loops.data(),
+                                   mesh.loops.size(),
+                                   mesh.polys.data(),
+                                   (const float(*)[3])poly_normals.data(),
+                                   mesh.polys.size(),
+                                   0.5f);
+    const int shared_edge = edge_get(mesh, 0, 1);
+    for (const int i : mesh.edges.index_range()) {
+      const bool expect_sharp = fin_second && i == shared_edge;
+      EXPECT_EQ((mesh.edges[i].flag & ME_SHARP) != 0, expect_sharp);
+    }
+  }
+}
+
+/* Edges used by more than two polygons always split the normals. */
+TEST(mesh_normals, SplitNormalsNonManifold)
+{
+  NormalsTestMesh mesh = normals_test_mesh_non_manifold_create(false);
+  const Array<float3> poly_normals = calc_poly_normals(mesh);
+
+  MLoopNorSpaceArray lnors_spacearr = {nullptr};
+  Array<float3> loop_normals(mesh.loops.size());
+  calc_normals_split(mesh, poly_normals, nullptr, &lnors_spacearr, loop_normals);
+
+  EXPECT_EQ(lnors_spacearr.num_spaces, mesh.loops.size());
+  for (const int i : mesh.polys.index_range()) {
+    const MPoly &poly = mesh.polys[i];
+    for (const int loop_index : IndexRange(poly.loopstart, poly.totloop)) {
+      EXPECT_V3_NEAR(loop_normals[loop_index], poly_normals[i], 1e-6f);
+    }
+  }
+
+  BKE_lnor_spacearr_free(&lnors_spacearr);
+}
+
+/* Polygons using a vertex twice, and loops whose edge doesn't connect their vertex to the next
+ * one. Walking around vertex 1 from loop 1 ends up in a cycle that doesn't contain loop 1. */
+TEST(mesh_normals, SplitNormalsDegenerate)
+{
+  NormalsTestMesh mesh = normals_test_mesh_from_coords(
+      {{0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {-1.0f, 1.0f, 0.0f}});
+  add_poly(mesh, {3, 1, 0});
+  add_poly(mesh, {2, 1, 2});
+  add_poly(mesh, {0, 2, 2});
+  mesh.loops[5].e = edge_get(mesh, 1, 3);
+  mesh.loops[8].e = edge_get(mesh, 0, 1);
+  const Array<float3> poly_normals = calc_poly_normals(mesh);
+
+  MLoopNorSpaceArray lnors_spacearr = {nullptr};
+  Array<float3> loop_normals(mesh.loops.size());
+  calc_normals_split(mesh, poly_normals, nullptr, &lnors_spacearr, loop_normals);
+
+  /* The first loop of the space of every loop as found by the serial implementation, which
+   * doesn't give loop 4 a space. */
+  const Array<int> expected_first_loops = {0, 0, 2, 0, -1, 0, 0, 7, 2};
+  Map<const MLoopNorSpace *, int> first_loops;
+  for (const int i : mesh.loops.index_range()) {
+    const MLoopNorSpace *lnor_space = lnors_spacearr.lspacearr[i];
+    EXPECT_EQ(lnor_space ? first_loops.lookup_or_add(lnor_space, i) : -1,
+              expected_first_loops[i]);
+  }
+  EXPECT_EQ(first_loops.size(), lnors_spacearr.num_spaces);
+
+  BKE_lnor_spacearr_free(&lnors_spacearr);
+}
+
+}  // namespace blender::bke::tests
@@ -0,0 +1,404 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bke
+ *
+ * Topology maps of a mesh, built lazily and kept in #Mesh_Runtime.
+ *
+ * The cache belongs to the topology arrays rather than to a single mesh: copies of evaluated
+ * meshes which reference the same #MPoly, #MLoop and #MEdge arrays share the cache of their
+ * source. This way the maps survive the copies made for every evaluation of a deforming mesh.
+ *
+ * The arrays the cache was created for are stored as its key. A mesh whose arrays have been
+ * replaced since, doesn't use the cache anymore. Code changing the topology arrays in place has
+ * to call #BKE_mesh_runtime_clear_geometry, like for the other run-time caches.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BLI_task.hh"
+#include "BLI_utildefines.h"
+
+#include "BKE_mesh_mapping.h"
+#include "BKE_mesh_runtime.h"
+
+#include "atomic_ops.h"
+
+using blender::IndexRange;
+
+struct MeshTopologyMap {
+  /** One element for every vertex or edge, the indices point into #indices. */
+  MeshElemMap *elems;
+  int *indices;
+};
+
+struct MeshTopologyCache {
+  /** Meshes using the cache, protected by #topology_cache_users_mutex. */
+  int users;
+
+  /** Topology arrays the cache was created for. */
+  const MPoly *mpoly;
+  const MLoop *mloop;
+  const MEdge *medge;
+  int totvert;
+  int totedge;
+  int totpoly;
+  int totloop;
+
+  /** Protects building the maps below. */
+  std::mutex mutex;
+
+  MeshTopologyMap maps[MESH_TOPOLOGY_MAP_NUM];
+};
+
+/**
+ * Protects attaching and detaching caches from meshes. This is only locked briefly and never
+ * while building maps, so it can be global.
+ */
+static std::mutex topology_cache_users_mutex;
+
+static std::atomic<int64_t> topology_map_requests_num[MESH_TOPOLOGY_MAP_NUM];
+static std::atomic<int64_t> topology_map_builds_num[MESH_TOPOLOGY_MAP_NUM];
+
+static const char *topology_map_names[MESH_TOPOLOGY_MAP_NUM] = {
+    "Vertex to polygon",
+    "Vertex to loop",
+    "Vertex to edge",
+    "Edge to polygon",
+    "Edge to loop",
+};
+
+/* -------------------------------------------------------------------- */
+/** \name Map Construction
+ *
+ * The maps are built in parallel: elements are counted and filled in with atomic operations, the
+ * indices of every element are sorted afterwards. This gives the same maps as the serial
+ * functions in 'mesh_mapping.c', for meshes with polygons in the order of their loops.
+ * \{ */
+
+/**
+ * \param add_sources: Calls its second argument with the element and the index to add to the map,
+ * for all sources in the given range.
+ */
+template<typename AddSourcesFn>
+static MeshTopologyMap topology_map_build(const int elems_num,
+                                          const int indices_num,
+                                          const int sources_num,
+                                          const AddSourcesFn &add_sources)
+{
+  using namespace blender;
+  MeshTopologyMap map;
+  map.elems = (MeshElemMap *)MEM_calloc_arrayN(
+      (size_t)elems_num, sizeof(*map.elems), "MeshTopologyMap.elems");
+  map.indices = (int *)MEM_malloc_arrayN(
+      (size_t)indices_num, sizeof(*map.indices), "MeshTopologyMap.indices");
+
+  threading::parallel_for(IndexRange(sources_num), 4096, [&](const IndexRange range) {
+    add_sources(range, [&](const int elem, const int UNUSED(index)) {
+      atomic_add_and_fetch_int32(&map.elems[elem].count, 1);
+    });
+  });
+
+  int *indices = map.indices;
+  for (const int elem : IndexRange(elems_num)) {
+    map.elems[elem].indices = indices;
+    indices += map.elems[elem].count;
+    /* Reset 'count' for use as index when filling in the indices. */
+    map.elems[elem].count = 0;
+  }
+  BLI_assert(indices == map.indices + indices_num);
+
+  threading::parallel_for(IndexRange(sources_num), 4096, [&](const IndexRange range) {
+    add_sources(range, [&](const int elem, const int index) {
+      const int slot = atomic_fetch_and_add_int32(&map.elems[elem].count, 1);
+      map.elems[elem].indices[slot] = index;
+    });
+  });
+
+  threading::parallel_for(IndexRange(elems_num), 4096, [&](const IndexRange range) {
+    for (const int elem : range) {
+      std::sort(map.elems[elem].indices, map.elems[elem].indices + map.elems[elem].count);
+    }
+  });
+
+  return map;
+}
+
+static MeshTopologyMap topology_map_build(const eMeshTopologyMapType type, const Mesh *mesh)
+{
+  const MPoly *mpoly = mesh->mpoly;
+  const MLoop *mloop = mesh->mloop;
+  const MEdge *medge = mesh->medge;
+
+  switch (type) {
+    case MESH_TOPOLOGY_MAP_VERT_POLY:
+      return topology_map_build(
+          mesh->totvert, mesh->totloop, mesh->totpoly, [&](const IndexRange range, auto add) {
+            for (const int i : range) {
+              const MPoly &mp = mpoly[i];
+              for (const int j : IndexRange(mp.loopstart, mp.totloop)) {
+                add(mloop[j].v, i);
+              }
+            }
+          });
+    case MESH_TOPOLOGY_MAP_VERT_LOOP:
+      return topology_map_build(
+          mesh->totvert, mesh->totloop, mesh->totpoly, [&](const IndexRange range, auto add) {
+            for (const int i : range) {
+              const MPoly &mp = mpoly[i];
+              for (const int j : IndexRange(mp.loopstart, mp.totloop)) {
+                add(mloop[j].v, j);
+              }
+            }
+          });
+    case MESH_TOPOLOGY_MAP_VERT_EDGE:
+      return topology_map_build(
+          mesh->totvert, mesh->totedge * 2, mesh->totedge, [&](const IndexRange range, auto add) {
+            for (const int i : range) {
+              add(medge[i].v1, i);
+              add(medge[i].v2, i);
+            }
+          });
+    case MESH_TOPOLOGY_MAP_EDGE_POLY:
+      return topology_map_build(
+          mesh->totedge, mesh->totloop, mesh->totpoly, [&](const IndexRange range, auto add) {
+            for (const int i : range) {
+              const MPoly &mp = mpoly[i];
+              for (const int j : IndexRange(mp.loopstart, mp.totloop)) {
+                add(mloop[j].e, i);
+              }
+            }
+          });
+    case MESH_TOPOLOGY_MAP_EDGE_LOOP:
+      return topology_map_build(
+          mesh->totedge, mesh->totloop, mesh->totpoly, [&](const IndexRange range, auto add) {
+            for (const int i : range) {
+              const MPoly &mp = mpoly[i];
+              for (const int j : IndexRange(mp.loopstart, mp.totloop)) {
+                add(mloop[j].e, j);
+              }
+            }
+          });
+  }
+  BLI_assert_unreachable();
+  return {nullptr, nullptr};
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Cache Users
+ * \{ */
+
+static MeshTopologyCache *topology_cache_new(const Mesh *mesh)
+{
+  MeshTopologyCache *cache = OBJECT_GUARDED_NEW(MeshTopologyCache);
+  cache->users = 1;
+  cache->mpoly = mesh->mpoly;
+  cache->mloop = mesh->mloop;
+  cache->medge = mesh->medge;
+  cache->totvert = mesh->totvert;
+  cache->totedge = mesh->totedge;
+  cache->totpoly = mesh->totpoly;
+  cache->totloop = mesh->totloop;
+  for (MeshTopologyMap &map : cache->maps) {
+    map = {nullptr, nullptr};
+  }
+  return cache;
+}
+
+static bool topology_cache_matches(const MeshTopologyCache *cache, const Mesh *mesh)
+{
+  return cache->mpoly == mesh->mpoly && cache->mloop == mesh->mloop &&
+         cache->medge == mesh->medge && cache->totvert == mesh->totvert &&
+         cache->totedge == mesh->totedge && cache->totpoly == mesh->totpoly &&
+         cache->totloop == mesh->totloop;
+}
+
+/** Expects #topology_cache_users_mutex to be locked. */
+static void topology_cache_release(MeshTopologyCache *cache)
+{
+  BLI_assert(cache->users > 0);
+  if (--cache->users > 0) {
+    return;
+  }
+  for (MeshTopologyMap &map : cache->maps) {
+    MEM_SAFE_FREE(map.elems);
+    MEM_SAFE_FREE(map.indices);
+  }
+  OBJECT_GUARDED_DELETE(cache, MeshTopologyCache);
+}
+
+/** Get the cache of the mesh, replacing it when it was created for other topology arrays. */
+static MeshTopologyCache &topology_cache_ensure(const Mesh *mesh)
+{
+  /* Only fills a cache, the mesh can be considered logically const. */
+  Mesh_Runtime &runtime = const_cast<Mesh_Runtime &>(mesh->runtime);
+
+  std::lock_guard<std::mutex> lock{topology_cache_users_mutex};
+  if (runtime.topology_cache != nullptr && !topology_cache_matches(runtime.topology_cache, mesh)) {
+    topology_cache_release(runtime.topology_cache);
+    runtime.topology_cache = nullptr;
+  }
+  if (runtime.topology_cache == nullptr) {
+    runtime.topology_cache = topology_cache_new(mesh);
+  }
+  return *runtime.topology_cache;
+}
+
+/**
+ * Let the copy of an evaluated mesh use the topology cache of its source, when the copy references
+ * the same topology arrays. The cache is created when the source has none yet, so that the maps
+ * are shared even when they are only requested from the copies.
+ */
+void BKE_mesh_runtime_topology_cache_share(Mesh *mesh_dst, const Mesh *mesh_src)
+{
+  BLI_assert(mesh_dst->runtime.topology_cache == nullptr);
+  if (mesh_dst->mpoly != mesh_src->mpoly || mesh_dst->mloop != mesh_src->mloop ||
+      mesh_dst->medge != mesh_src->medge) {
+    return;
+  }
+  if (mesh_dst->totpoly == 0 && mesh_dst->totedge == 0) {
+    return;
+  }
+
+  Mesh_Runtime &runtime_src = const_cast<Mesh_Runtime &>(mesh_src->runtime);
+
+  std::lock_guard<std::mutex> lock{topology_cache_users_mutex};
+  MeshTopologyCache *cache = runtime_src.topology_cache;
+  if (cache == nullptr) {
+    cache = runtime_src.topology_cache = topology_cache_new(mesh_src);
+  }
+  if (!topology_cache_matches(cache, mesh_dst)) {
+    return;
+  }
+  cache->users++;
+  mesh_dst->runtime.topology_cache = cache;
+}
+
+void BKE_mesh_runtime_clear_topology_cache(Mesh *mesh)
+{
+  if (mesh->runtime.topology_cache == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock{topology_cache_users_mutex};
+  topology_cache_release(mesh->runtime.topology_cache);
+  mesh->runtime.topology_cache = nullptr;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Map Access
+ * \{ */
+
+/**
+ * Get a topology map of the mesh, building it when no mesh sharing the topology has built it yet.
+ * The indices of every element are sorted, so that the maps can be used to accumulate values in a
+ * deterministic order.
+ *
+ * \note The map is owned by the mesh and must not be freed.
+ * \note Original meshes keep the map until #BKE_mesh_runtime_clear_geometry is called, so code
+ * changing their topology in place has to call it.
+ */
+const MeshElemMap *BKE_mesh_runtime_topology_map_ensure(const Mesh *mesh,
+                                                        const eMeshTopologyMapType type)
+{
+  MeshTopologyCache &cache = topology_cache_ensure(mesh);
+  MeshTopologyMap &map = cache.maps[type];
+
+  topology_map_requests_num[type]++;
+
+  std::lock_guard<std::mutex> lock{cache.mutex};
+  if (map.elems == nullptr) {
+    /* Isolate since map creation is multithreaded and we are holding a lock. */
+    blender::threading::isolate_task([&]() { map = topology_map_build(type, mesh); });
+    topology_map_builds_num[type]++;
+  }
+  return map.elems;
+}
+
+const MeshElemMap *BKE_mesh_runtime_vert_poly_map_ensure(const Mesh *mesh)
+{
+  return BKE_mesh_runtime_topology_map_ensure(mesh, MESH_TOPOLOGY_MAP_VERT_POLY);
+}
+
+const MeshElemMap *BKE_mesh_runtime_vert_loop_map_ensure(const Mesh *mesh)
+{
+  return BKE_mesh_runtime_topology_map_ensure(mesh, MESH_TOPOLOGY_MAP_VERT_LOOP);
+}
+
+const MeshElemMap *BKE_mesh_runtime_vert_edge_map_ensure(const Mesh *mesh)
+{
+  return BKE_mesh_runtime_topology_map_ensure(mesh, MESH_TOPOLOGY_MAP_VERT_EDGE);
+}
+
+const MeshElemMap *BKE_mesh_runtime_edge_poly_map_ensure(const Mesh *mesh)
+{
+  return BKE_mesh_runtime_topology_map_ensure(mesh, MESH_TOPOLOGY_MAP_EDGE_POLY);
+}
+
+const MeshElemMap *BKE_mesh_runtime_edge_loop_map_ensure(const Mesh *mesh)
+{
+  return BKE_mesh_runtime_topology_map_ensure(mesh, MESH_TOPOLOGY_MAP_EDGE_LOOP);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Statistics
+ * \{ */
+
+void BKE_mesh_runtime_topology_map_stats_get(MeshTopologyMapStats *r_stats)
+{
+  for (const int type : IndexRange(MESH_TOPOLOGY_MAP_NUM)) {
+    r_stats->requests_num[type] = topology_map_requests_num[type];
+    r_stats->builds_num[type] = topology_map_builds_num[type];
+  }
+}
+
+void BKE_mesh_runtime_topology_map_stats_reset(void)
+{
+  for (const int type : IndexRange(MESH_TOPOLOGY_MAP_NUM)) {
+    topology_map_requests_num[type] = 0;
+    topology_map_builds_num[type] = 0;
+  }
+}
+
+void BKE_mesh_runtime_topology_map_stats_print(void)
+{
+  MeshTopologyMapStats stats;
+  BKE_mesh_runtime_topology_map_stats_get(&stats);
+
+  printf("Mesh topology maps:\n");
+  for (const int type : IndexRange(MESH_TOPOLOGY_MAP_NUM)) {
+    printf("  %-18s requested %8lld times, built %8lld times\n",
+           topology_map_names[type],
+           (long long)stats.requests_num[type],
+           (long long)stats.builds_num[type]);
+  }
+}
+
+/** \} */
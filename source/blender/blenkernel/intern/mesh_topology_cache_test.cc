@@ -0,0 +1,217 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "testing/testing.h"
+
+#include <algorithm>
+
+#include "MEM_guardedalloc.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BLI_map.hh"
+#include "BLI_span.hh"
+#include "BLI_vector.hh"
+
+#include "BKE_mesh_mapping.h"
+#include "BKE_mesh_runtime.h"
+
+namespace blender::bke::tests {
+
+struct TopologyTestMesh {
+  int verts_num = 0;
+  Vector<MEdge> edges;
+  Vector<MLoop> loops;
+  Vector<MPoly> polys;
+  Map<std::pair<int, int>, int> edge_indices;
+  Mesh mesh;
+};
+
+static int edge_get(TopologyTestMesh &mesh, const int v1, const int v2)
+{
+  return mesh.edge_indices.lookup_or_add_cb({std::min(v1, v2), std::max(v1, v2)}, [&]() {
+    MEdge edge = {};
+    edge.v1 = v1;
+    edge.v2 = v2;
+    mesh.edges.append(edge);
+    return int(mesh.edges.size() - 1);
+  });
+}
+
+static void add_poly(TopologyTestMesh &mesh, const Span<int> verts)
+{
+  MPoly poly = {};
+  poly.loopstart = mesh.loops.size();
+  poly.totloop = verts.size();
+  mesh.polys.append(poly);
+  for (const int i : verts.index_range()) {
+    MLoop loop = {};
+    loop.v = verts[i];
+    loop.e = edge_get(mesh, verts[i], verts[(i + 1) % verts.size()]);
+    mesh.loops.append(loop);
+  }
+}
+
+/* Only the topology arrays are used by the cache, the mesh doesn't own them. */
+static void mesh_update(TopologyTestMesh &mesh)
+{
+  memset(&mesh.mesh, 0, sizeof(mesh.mesh));
+  mesh.mesh.medge = mesh.edges.data();
+  mesh.mesh.mloop = mesh.loops.data();
+  mesh.mesh.mpoly = mesh.polys.data();
+  mesh.mesh.totvert = mesh.verts_num;
+  mesh.mesh.totedge = mesh.edges.size();
+  mesh.mesh.totloop = mesh.loops.size();
+  mesh.mesh.totpoly = mesh.polys.size();
+}
+
+/* A grid of quads with a triangle fan in every other row, large enough to be built by many
+ * tasks. The odd rows are added after the even rows, so that the polygons around a vertex are far
+ * apart and likely added to the maps by different threads. */
+static void add_grid(TopologyTestMesh &mesh, const int res)
+{
+  const int vert_offset = mesh.verts_num;
+  mesh.verts_num += res * res;
+  Vector<int> rows;
+  for (const int y : IndexRange(res - 1)) {
+    if (y % 2 == 0) {
+      rows.append(y);
+    }
+  }
+  for (const int y : IndexRange(res - 1)) {
+    if (y % 2) {
+      rows.append(y);
+    }
+  }
+  for (const int y : rows) {
+    for (const int x : IndexRange(res - 1)) {
+      const int v = vert_offset + y * res + x;
+      if (y % 2) {
+        add_poly(mesh, {v, v + 1, v + res + 1});
+        add_poly(mesh, {v, v + res + 1, v + res});
+      }
+      else {
+        add_poly(mesh, {v, v + 1, v + res + 1, v + res});
+      }
+    }
+  }
+}
+
+/* Topology that manifold meshes don't have. */
+static void add_degenerate(TopologyTestMesh &mesh)
+{
+  const int v = mesh.verts_num;
+  mesh.verts_num += 9;
+  /* Three polygons sharing the edge (v, v + 1). */
+  add_poly(mesh, {v, v + 1, v + 2});
+  add_poly(mesh, {v + 1, v, v + 3});
+  add_poly(mesh, {v, v + 1, v + 4});
+  /* A polygon using the vertex v + 5 twice, and the edge (v + 5, v + 6) twice. */
+  add_poly(mesh, {v + 5, v + 6, v + 5, v + 2});
+  /* A loose edge and an isolated vertex. */
+  edge_get(mesh, v + 6, v + 7);
+}
+
+static void expect_map_eq(const MeshElemMap *map,
+                          const MeshElemMap *map_expected,
+                          const int elems_num)
+{
+  for (const int i : IndexRange(elems_num)) {
+    const Span<int> indices(map[i].indices, map[i].count);
+    const Span<int> indices_expected(map_expected[i].indices, map_expected[i].count);
+    ASSERT_EQ(indices.size(), indices_expected.size());
+    EXPECT_EQ_ARRAY(indices.data(), indices_expected.data(), indices.size());
+    /* Data transfer and the skin modifier depend on the order. */
+    EXPECT_TRUE(std::is_sorted(indices.begin(), indices.end()));
+  }
+}
+
+static void expect_maps_match_serial(TopologyTestMesh &mesh)
+{
+  mesh_update(mesh);
+  const Mesh *me = &mesh.mesh;
+
+  MeshElemMap *map;
+  int *indices;
+
+  BKE_mesh_vert_poly_map_create(
+      &map, &indices, me->mpoly, me->mloop, me->totvert, me->totpoly, me->totloop);
+  expect_map_eq(BKE_mesh_runtime_vert_poly_map_ensure(me), map, me->totvert);
+  MEM_freeN(map);
+  MEM_freeN(indices);
+
+  BKE_mesh_vert_loop_map_create(
+      &map, &indices, me->mpoly, me->mloop, me->totvert, me->totpoly, me->totloop);
+  expect_map_eq(BKE_mesh_runtime_vert_loop_map_ensure(me), map, me->totvert);
+  MEM_freeN(map);
+  MEM_freeN(indices);
+
+  BKE_mesh_vert_edge_map_create(&map, &indices, me->medge, me->totvert, me->totedge);
+  expect_map_eq(BKE_mesh_runtime_vert_edge_map_ensure(me), map, me->totvert);
+  MEM_freeN(map);
+  MEM_freeN(indices);
+
+  BKE_mesh_edge_poly_map_create(
+      &map, &indices, me->medge, me->totedge, me->mpoly, me->totpoly, me->mloop, me->totloop);
+  expect_map_eq(BKE_mesh_runtime_edge_poly_map_ensure(me), map, me->totedge);
+  MEM_freeN(map);
+  MEM_freeN(indices);
+
+  /* The serial map stores the loop using the edge followed by the next loop of its polygon, the
+   * cached map only stores the first. */
+  BKE_mesh_edge_loop_map_create(
+      &map, &indices, me->medge, me->totedge, me->mpoly, me->totpoly, me->mloop, me->totloop);
+  const MeshElemMap *edge_loop_map = BKE_mesh_runtime_edge_loop_map_ensure(me);
+  for (const int i : IndexRange(me->totedge)) {
+    ASSERT_EQ(edge_loop_map[i].count * 2, map[i].count);
+    for (const int j : IndexRange(edge_loop_map[i].count)) {
+      EXPECT_EQ(edge_loop_map[i].indices[j], map[i].indices[j * 2]);
+    }
+  }
+  MEM_freeN(map);
+  MEM_freeN(indices);
+
+  /* Requesting a map again doesn't rebuild it. */
+  EXPECT_EQ(BKE_mesh_runtime_vert_poly_map_ensure(me), BKE_mesh_runtime_vert_poly_map_ensure(me));
+
+  BKE_mesh_runtime_clear_topology_cache(&mesh.mesh);
+}
+
+TEST(mesh_topology_cache, Grid)
+{
+  TopologyTestMesh mesh;
+  add_grid(mesh, 150);
+  expect_maps_match_serial(mesh);
+}
+
+TEST(mesh_topology_cache, Degenerate)
+{
+  TopologyTestMesh mesh;
+  add_grid(mesh, 4);
+  add_degenerate(mesh);
+  add_grid(mesh, 3);
+  expect_maps_match_serial(mesh);
+}
+
+TEST(mesh_topology_cache, Empty)
+{
+  TopologyTestMesh mesh;
+  mesh.verts_num = 3;
+  edge_get(mesh, 0, 1);
+  expect_maps_match_serial(mesh);
+}
+
+}  // namespace blender::bke::tests
@@ -172,7 +172,8 @@ static bool grid_materials_match(const DMFlagMat *f1, const DMFlagMat *f2)
 
 /* Adapted from BLI_kdopbvh.c */
 /* Returns the index of the first element on the right of the partition */
-static int partition_indices(int *prim_indices, int lo, int hi, int axis, float mid, BBC *prim_bbc)
+static int partition_indices(
+    int *prim_indices, int lo, int hi, int axis, float mid, const BBC *prim_bbc)
 {
   int i = lo, j = hi;
   for (;;) {
@@ -249,18 +250,21 @@ void pbvh_grow_nodes(PBVH *pbvh, int totnode)
   pbvh->totnode = totnode;
 }
 
-/* Add a vertex to the map, with a positive value for unique vertices and
+/* Add a vertex to the map, with a positive value for vertices owned by the node and
  * a negative value for additional vertices */
-static int map_insert_vert(
-    PBVH *pbvh, GHash *map, unsigned int *face_verts, unsigned int *uniq_verts, int vertex)
+static int map_insert_vert(const int *vert_owners,
+                           const int node_index,
+                           GHash *map,
+                           unsigned int *face_verts,
+                           unsigned int *uniq_verts,
+                           int vertex)
 {
   void *key, **value_p;
 
   key = POINTER_FROM_INT(vertex);
   if (!BLI_ghash_ensure_p(map, key, &value_p)) {
     int value_i;
-    if (BLI_BITMAP_TEST(pbvh->vert_bitmap, vertex) == 0) {
-      BLI_BITMAP_ENABLE(pbvh->vert_bitmap, vertex);
+    if (vert_owners[vertex] == node_index) {
       value_i = *uniq_verts;
       (*uniq_verts)++;
     }
@@ -276,8 +280,9 @@ static int map_insert_vert(
 }
 
 /* Find vertices used by the faces in this node and update the draw buffers */
-static void build_mesh_leaf_node(PBVH *pbvh, PBVHNode *node)
+static void build_mesh_leaf_node(PBVH *pbvh, PBVHNode *node, const int *vert_owners)
 {
+  const int node_index = node - pbvh->nodes;
   bool has_visible = false;
 
   node->uniq_verts = node->face_verts = 0;
@@ -297,8 +302,12 @@ static void build_mesh_leaf_node(PBVH *pbvh, PBVHNode *node)
   for (int i = 0; i < totface; i++) {
     const MLoopTri *lt = &pbvh->looptri[node->prim_indices[i]];
     for (int j = 0; j < 3; j++) {
-      face_vert_indices[i][j] = map_insert_vert(
-          pbvh, map, &node->face_verts, &node->uniq_verts, pbvh->mloop[lt->tri[j]].v);
+      face_vert_indices[i][j] = map_insert_vert(vert_owners,
+                                                node_index,
+                                                map,
+                                                &node->face_verts,
+                                                &node->uniq_verts,
+                                                pbvh->mloop[lt->tri[j]].v);
     }
 
     if (has_visible == false) {
@@ -342,15 +351,6 @@ static void build_mesh_leaf_node(PBVH *pbvh, PBVHNode *node)
   BLI_ghash_free(map, NULL, NULL);
 }
 
-static void update_vb(PBVH *pbvh, PBVHNode *node, BBC *prim_bbc, int offset, int count)
-{
-  BB_reset(&node->vb);
-  for (int i = offset + count - 1; i >= offset; i--) {
-    BB_expand_with_bb(&node->vb, (BB *)(&prim_bbc[pbvh->prim_indices[i]]));
-  }
-  node->orig_vb = node->vb;
-}
-
 /* Returns the number of visible quads in the nodes' grids. */
 int BKE_pbvh_count_grid_quads(BLI_bitmap **grid_hidden,
                               const int *grid_indices,
@@ -412,24 +412,6 @@ static void build_grid_leaf_node(PBVH *pbvh, PBVHNode *node)
   BKE_pbvh_node_mark_rebuild_draw(node);
 }
 
-static void build_leaf(PBVH *pbvh, int node_index, BBC *prim_bbc, int offset, int count)
-{
-  pbvh->nodes[node_index].flag |= PBVH_Leaf;
-
-  pbvh->nodes[node_index].prim_indices = pbvh->prim_indices + offset;
-  pbvh->nodes[node_index].totprim = count;
-
-  /* Still need vb for searches */
-  update_vb(pbvh, &pbvh->nodes[node_index], prim_bbc, offset, count);
-
-  if (pbvh->looptri) {
-    build_mesh_leaf_node(pbvh, pbvh->nodes + node_index);
-  }
-  else {
-    build_grid_leaf_node(pbvh, pbvh->nodes + node_index);
-  }
-}
-
 /* Return zero if all primitives in the node can be drawn with the
  * same material (including flat/smooth shading), non-zero otherwise */
 static bool leaf_needs_material_split(PBVH *pbvh, int offset, int count)
@@ -464,73 +446,457 @@ static bool leaf_needs_material_split(PBVH *pbvh, int offset, int count)
   return false;
 }
 
-/* Recursively build a node in the tree
- *
- * vb is the voxel box around all of the primitives contained in
- * this node.
- *
- * cb is the bounding box around all the centroids of the primitives
- * contained in this node
+/* -------------------------------------------------------------------- */
+/** \name Tree Building
  *
- * offset and start indicate a range in the array of primitive indices
- */
+ * The tree is built in two steps. First the primitives are split recursively into a temporary
+ * tree of #PBVHBuildNode, with large sub-trees built in separate tasks. Then the temporary tree
+ * is converted to PBVH nodes, and the leaves are filled in parallel.
+ * \{ */
+
+/* Ranges with more primitives are split in separate tasks, and their bounds and bins are
+ * computed in parallel. */
+#define BUILD_TASK_MIN_PRIMS 4096
+
+/* Number of primitives handled by one iteration of the parallel bounds and bins passes. */
+#define BUILD_BLOCK_SIZE 1024
 
-static void build_sub(PBVH *pbvh, int node_index, BB *cb, BBC *prim_bbc, int offset, int count)
+/* Number of bins the centroid bounds are divided in to evaluate split candidates. */
+#define BUILD_SAH_BINS 16
+
+typedef struct PBVHBuildContext {
+  PBVH *pbvh;
+  const BBC *prim_bbc;
+  int *prim_indices;
+  int leaf_limit;
+  /* Split leaves with different materials, for mesh and grids PBVHs. */
+  bool use_material_split;
+} PBVHBuildContext;
+
+typedef struct BuildBounds {
+  /* Bounds of the primitives. */
+  BB vb;
+  /* Bounds of the primitive centroids. */
+  BB cb;
+} BuildBounds;
+
+typedef struct BuildBins {
+  BuildBounds bounds[BUILD_SAH_BINS];
+  int count[BUILD_SAH_BINS];
+} BuildBins;
+
+typedef struct BuildRangeData {
+  const PBVHBuildContext *ctx;
+  /* Range in the array of primitive indices. */
+  int offset, count;
+  /* Bins along the axis, for the bins pass. */
+  int axis;
+  float bmin;
+  float scale;
+} BuildRangeData;
+
+/* Run a pass over the range in blocks of primitives, in parallel if the range is large. */
+static void build_range_pass(BuildRangeData *data,
+                             TaskParallelRangeFunc func,
+                             void *userdata_chunk,
+                             const size_t userdata_chunk_size,
+                             TaskParallelReduceFunc func_reduce)
 {
-  int end;
-  BB cb_backing;
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = data->count > BUILD_TASK_MIN_PRIMS;
+  settings.min_iter_per_thread = BUILD_TASK_MIN_PRIMS / BUILD_BLOCK_SIZE;
+  settings.userdata_chunk = userdata_chunk;
+  settings.userdata_chunk_size = userdata_chunk_size;
+  settings.func_reduce = func_reduce;
+  const int totblock = (data->count + BUILD_BLOCK_SIZE - 1) / BUILD_BLOCK_SIZE;
+  BLI_task_parallel_range(0, totblock, data, func, &settings);
+}
+
+static void build_bounds_task_cb(void *__restrict userdata,
+                                 const int block,
+                                 const TaskParallelTLS *__restrict tls)
+{
+  const BuildRangeData *data = userdata;
+  const PBVHBuildContext *ctx = data->ctx;
+  BuildBounds *bounds = tls->userdata_chunk;
+  const int start = data->offset + block * BUILD_BLOCK_SIZE;
+  const int end = min_ii(start + BUILD_BLOCK_SIZE, data->offset + data->count);
+  for (int i = start; i < end; i++) {
+    const BBC *bbc = &ctx->prim_bbc[ctx->prim_indices[i]];
+    BB_expand_with_bb(&bounds->vb, (BB *)bbc);
+    BB_expand(&bounds->cb, bbc->bcentroid);
+  }
+}
+
+static void build_bounds_reduce(const void *__restrict UNUSED(userdata),
+                                void *__restrict chunk_join,
+                                void *__restrict chunk)
+{
+  BuildBounds *join = chunk_join;
+  BuildBounds *bounds = chunk;
+  BB_expand_with_bb(&join->vb, &bounds->vb);
+  BB_expand_with_bb(&join->cb, &bounds->cb);
+}
+
+static void build_bounds_calc(const PBVHBuildContext *ctx, PBVHBuildNode *node)
+{
+  BuildRangeData data = {ctx, node->offset, node->count};
+  BuildBounds bounds;
+  BB_reset(&bounds.vb);
+  BB_reset(&bounds.cb);
+  build_range_pass(&data, build_bounds_task_cb, &bounds, sizeof(bounds), build_bounds_reduce);
+  node->vb = bounds.vb;
+  node->cb = bounds.cb;
+}
+
+BLI_INLINE int build_bin_index(const float centroid, const float bmin, const float scale)
+{
+  const int bin = (int)((centroid - bmin) * scale);
+  return CLAMPIS(bin, 0, BUILD_SAH_BINS - 1);
+}
+
+static void build_bins_task_cb(void *__restrict userdata,
+                               const int block,
+                               const TaskParallelTLS *__restrict tls)
+{
+  const BuildRangeData *data = userdata;
+  const PBVHBuildContext *ctx = data->ctx;
+  BuildBins *bins = tls->userdata_chunk;
+  const int start = data->offset + block * BUILD_BLOCK_SIZE;
+  const int end = min_ii(start + BUILD_BLOCK_SIZE, data->offset + data->count);
+  for (int i = start; i < end; i++) {
+    const BBC *bbc = &ctx->prim_bbc[ctx->prim_indices[i]];
+    const int bin = build_bin_index(bbc->bcentroid[data->axis], data->bmin, data->scale);
+    BB_expand_with_bb(&bins->bounds[bin].vb, (BB *)bbc);
+    BB_expand(&bins->bounds[bin].cb, bbc->bcentroid);
+    bins->count[bin]++;
+  }
+}
+
+static void build_bins_reduce(const void *__restrict UNUSED(userdata),
+                              void *__restrict chunk_join,
+                              void *__restrict chunk)
+{
+  BuildBins *join = chunk_join;
+  BuildBins *bins = chunk;
+  for (int i = 0; i < BUILD_SAH_BINS; i++) {
+    build_bounds_reduce(NULL, &join->bounds[i], &bins->bounds[i]);
+    join->count[i] += bins->count[i];
+  }
+}
+
+static float bb_half_area(const BB *bb)
+{
+  float dim[3];
+  sub_v3_v3v3(dim, bb->bmax, bb->bmin);
+  return dim[0] * dim[1] + dim[1] * dim[2] + dim[2] * dim[0];
+}
+
+/* Find the bin to split at with the surface area heuristic, which keeps the bounds of the
+ * children tight. Splits which leave less than an eighth of the primitives on one side are not
+ * considered, so leaves stay balanced. Returns the first bin of the right side, or zero when
+ * there is no valid split. */
+static int build_sah_split_find(const BuildBins *bins, const int count)
+{
+  float area_right[BUILD_SAH_BINS];
+  int count_right[BUILD_SAH_BINS];
+  BB bb;
+  BB_reset(&bb);
+  int num = 0;
+  for (int i = BUILD_SAH_BINS - 1; i > 0; i--) {
+    BB_expand_with_bb(&bb, (BB *)&bins->bounds[i].vb);
+    num += bins->count[i];
+    area_right[i] = bb_half_area(&bb);
+    count_right[i] = num;
+  }
+
+  const int min_count = max_ii(count / 8, 1);
+  float best_cost = FLT_MAX;
+  int best_bin = 0;
+  BB_reset(&bb);
+  num = 0;
+  for (int i = 1; i < BUILD_SAH_BINS; i++) {
+    BB_expand_with_bb(&bb, (BB *)&bins->bounds[i - 1].vb);
+    num += bins->count[i - 1];
+    if (num < min_count || count_right[i] < min_count) {
+      continue;
+    }
+    const float cost = bb_half_area(&bb) * num + area_right[i] * count_right[i];
+    if (cost < best_cost) {
+      best_cost = cost;
+      best_bin = i;
+    }
+  }
+  return best_bin;
+}
+
+/* Returns the index of the first element on the right of the partition */
+static int partition_indices_bin(int *prim_indices,
+                                 int lo,
+                                 int hi,
+                                 const BuildRangeData *data,
+                                 const int split_bin,
+                                 const BBC *prim_bbc)
+{
+  int i = lo, j = hi;
+  while (i <= j) {
+    const float centroid = prim_bbc[prim_indices[i]].bcentroid[data->axis];
+    if (build_bin_index(centroid, data->bmin, data->scale) < split_bin) {
+      i++;
+    }
+    else {
+      SWAP(int, prim_indices[i], prim_indices[j]);
+      j--;
+    }
+  }
+  return i;
+}
+
+/* Partition primitives along the axis with the widest range of primitive centroids.
+ * Returns the index of the first element on the right of the partition. When the split is found
+ * with bins, the bounds of both sides are known from the bins and are returned too. */
+static int build_partition(const PBVHBuildContext *ctx,
+                           const PBVHBuildNode *node,
+                           BuildBounds r_bounds[2],
+                           bool *r_has_bounds)
+{
+  const int offset = node->offset;
+  const int count = node->count;
+  const BB *cb = &node->cb;
+  const int axis = BB_widest_axis(cb);
+  const float extent = cb->bmax[axis] - cb->bmin[axis];
+  const float scale = (extent > 0.0f) ? BUILD_SAH_BINS / extent : 0.0f;
+
+  *r_has_bounds = false;
+
+  if (scale > 0.0f && isfinite(scale)) {
+    BuildRangeData data = {ctx, offset, count, axis, cb->bmin[axis], scale};
+    BuildBins bins;
+    for (int i = 0; i < BUILD_SAH_BINS; i++) {
+      BB_reset(&bins.bounds[i].vb);
+      BB_reset(&bins.bounds[i].cb);
+      bins.count[i] = 0;
+    }
+    build_range_pass(&data, build_bins_task_cb, &bins, sizeof(bins), build_bins_reduce);
+
+    const int split_bin = build_sah_split_find(&bins, count);
+    if (split_bin != 0) {
+      for (int i = 0; i < 2; i++) {
+        BB_reset(&r_bounds[i].vb);
+        BB_reset(&r_bounds[i].cb);
+      }
+      for (int i = 0; i < BUILD_SAH_BINS; i++) {
+        build_bounds_reduce(NULL, &r_bounds[i < split_bin ? 0 : 1], &bins.bounds[i]);
+      }
+      *r_has_bounds = true;
+      return partition_indices_bin(
+          ctx->prim_indices, offset, offset + count - 1, &data, split_bin, ctx->prim_bbc);
+    }
+  }
+
+  /* Fall back to splitting at the middle of the centroid bounds. */
+  return partition_indices(ctx->prim_indices,
+                           offset,
+                           offset + count - 1,
+                           axis,
+                           (cb->bmax[axis] + cb->bmin[axis]) * 0.5f,
+                           ctx->prim_bbc);
+}
+
+static void build_sub_task(TaskPool *__restrict pool, void *taskdata);
+
+/* Recursively build a node in the tree
+ *
+ * The node's offset and count indicate a range in the array of primitive indices, and its bounds
+ * are already computed. Children with many primitives are pushed to the task pool, the others
+ * are built right away. */
+static void build_sub(const PBVHBuildContext *ctx, TaskPool *pool, PBVHBuildNode *node)
+{
+  const int offset = node->offset;
+  const int count = node->count;
 
   /* Decide whether this is a leaf or not */
-  const bool below_leaf_limit = count <= pbvh->leaf_limit;
+  const bool below_leaf_limit = count <= ctx->leaf_limit;
   if (below_leaf_limit) {
-    if (!leaf_needs_material_split(pbvh, offset, count)) {
-      build_leaf(pbvh, node_index, prim_bbc, offset, count);
+    if (!ctx->use_material_split || !leaf_needs_material_split(ctx->pbvh, offset, count)) {
       return;
     }
   }
 
+  BuildBounds child_bounds[2];
+  bool has_child_bounds = false;
+  int end;
+  if (!below_leaf_limit) {
+    end = build_partition(ctx, node, child_bounds, &has_child_bounds);
+  }
+  else {
+    /* Partition primitives by material */
+    end = partition_indices_material(ctx->pbvh, offset, offset + count - 1);
+  }
+
+  /* Build children */
+  for (int i = 0; i < 2; i++) {
+    PBVHBuildNode *child = MEM_callocN(sizeof(*child), __func__);
+    child->offset = (i == 0) ? offset : end;
+    child->count = (i == 0) ? end - offset : offset + count - end;
+    if (has_child_bounds) {
+      child->vb = child_bounds[i].vb;
+      child->cb = child_bounds[i].cb;
+    }
+    else {
+      build_bounds_calc(ctx, child);
+    }
+    node->children[i] = child;
+    if (child->count > BUILD_TASK_MIN_PRIMS) {
+      BLI_task_pool_push(pool, build_sub_task, child, false, NULL);
+    }
+    else {
+      build_sub(ctx, pool, child);
+    }
+  }
+}
+
+static void build_sub_task(TaskPool *__restrict pool, void *taskdata)
+{
+  const PBVHBuildContext *ctx = BLI_task_pool_user_data(pool);
+  build_sub(ctx, pool, taskdata);
+}
+
+PBVHBuildNode *pbvh_build_tree(PBVH *pbvh,
+                               const BBC *prim_bbc,
+                               int *prim_indices,
+                               const int totprim,
+                               const bool use_material_split)
+{
+  PBVHBuildContext ctx = {
+      .pbvh = pbvh,
+      .prim_bbc = prim_bbc,
+      .prim_indices = prim_indices,
+      .leaf_limit = pbvh->leaf_limit,
+      .use_material_split = use_material_split,
+  };
+
+  PBVHBuildNode *root = MEM_callocN(sizeof(*root), __func__);
+  root->count = totprim;
+  build_bounds_calc(&ctx, root);
+
+  TaskPool *pool = BLI_task_pool_create(&ctx, TASK_PRIORITY_HIGH);
+  build_sub(&ctx, pool, root);
+  BLI_task_pool_work_and_wait(pool);
+  BLI_task_pool_free(pool);
+
+  return root;
+}
+
+void pbvh_build_tree_free(PBVHBuildNode *node)
+{
+  if (node->children[0]) {
+    pbvh_build_tree_free(node->children[0]);
+    pbvh_build_tree_free(node->children[1]);
+  }
+  MEM_freeN(node);
+}
+
+static int build_tree_leaf_count(const PBVHBuildNode *node)
+{
+  if (node->children[0] == NULL) {
+    return 1;
+  }
+  return build_tree_leaf_count(node->children[0]) + build_tree_leaf_count(node->children[1]);
+}
+
+static void build_nodes_create_recursive(PBVH *pbvh,
+                                         PBVHBuildNode *build_node,
+                                         const int node_index,
+                                         PBVHBuildNode **leaves,
+                                         int *totleaf)
+{
+  build_node->node_index = node_index;
+  pbvh->nodes[node_index].vb = build_node->vb;
+  pbvh->nodes[node_index].orig_vb = build_node->vb;
+
+  if (build_node->children[0] == NULL) {
+    pbvh->nodes[node_index].flag |= PBVH_Leaf;
+    leaves[(*totleaf)++] = build_node;
+    return;
+  }
+
   /* Add two child nodes */
-  pbvh->nodes[node_index].children_offset = pbvh->totnode;
+  const int children_offset = pbvh->totnode;
+  pbvh->nodes[node_index].children_offset = children_offset;
   pbvh_grow_nodes(pbvh, pbvh->totnode + 2);
 
-  /* Update parent node bounding box */
-  update_vb(pbvh, &pbvh->nodes[node_index], prim_bbc, offset, count);
+  build_nodes_create_recursive(pbvh, build_node->children[0], children_offset, leaves, totleaf);
+  build_nodes_create_recursive(
+      pbvh, build_node->children[1], children_offset + 1, leaves, totleaf);
+}
 
-  if (!below_leaf_limit) {
-    /* Find axis with widest range of primitive centroids */
-    if (!cb) {
-      cb = &cb_backing;
-      BB_reset(cb);
-      for (int i = offset + count - 1; i >= offset; i--) {
-        BB_expand(cb, prim_bbc[pbvh->prim_indices[i]].bcentroid);
-      }
+PBVHBuildNode **pbvh_build_nodes_create(PBVH *pbvh, PBVHBuildNode *root, int *r_totleaf)
+{
+  BLI_assert(pbvh->totnode == 1);
+  PBVHBuildNode **leaves = MEM_malloc_arrayN(
+      build_tree_leaf_count(root), sizeof(*leaves), "PBVH build leaves");
+  *r_totleaf = 0;
+  build_nodes_create_recursive(pbvh, root, 0, leaves, r_totleaf);
+  return leaves;
+}
+
+void pbvh_vert_owner_claim(int *owner, const int node_index)
+{
+  int old_owner = *owner;
+  while (old_owner == -1 || node_index < old_owner) {
+    const int prev_owner = atomic_cas_int32(owner, old_owner, node_index);
+    if (prev_owner == old_owner) {
+      break;
+    }
+    old_owner = prev_owner;
+  }
+}
+
+typedef struct PBVHBuildLeavesData {
+  PBVH *pbvh;
+  PBVHBuildNode **leaves;
+  /* Index of the node owning every vertex, for mesh PBVHs. */
+  int *vert_owners;
+} PBVHBuildLeavesData;
+
+static void build_mesh_leaf_claim_verts_task_cb(void *__restrict userdata,
+                                                const int i,
+                                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  PBVHBuildLeavesData *data = userdata;
+  const PBVH *pbvh = data->pbvh;
+  const PBVHBuildNode *leaf = data->leaves[i];
+  for (int p = leaf->offset; p < leaf->offset + leaf->count; p++) {
+    const MLoopTri *lt = &pbvh->looptri[pbvh->prim_indices[p]];
+    for (int j = 0; j < 3; j++) {
+      pbvh_vert_owner_claim(&data->vert_owners[pbvh->mloop[lt->tri[j]].v], leaf->node_index);
     }
-    const int axis = BB_widest_axis(cb);
+  }
+}
 
-    /* Partition primitives along that axis */
-    end = partition_indices(pbvh->prim_indices,
-                            offset,
-                            offset + count - 1,
-                            axis,
-                            (cb->bmax[axis] + cb->bmin[axis]) * 0.5f,
-                            prim_bbc);
+static void build_leaf_task_cb(void *__restrict userdata,
+                               const int i,
+                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  PBVHBuildLeavesData *data = userdata;
+  PBVH *pbvh = data->pbvh;
+  const PBVHBuildNode *leaf = data->leaves[i];
+  PBVHNode *node = &pbvh->nodes[leaf->node_index];
+
+  node->prim_indices = pbvh->prim_indices + leaf->offset;
+  node->totprim = leaf->count;
+
+  if (pbvh->looptri) {
+    build_mesh_leaf_node(pbvh, node, data->vert_owners);
   }
   else {
-    /* Partition primitives by material */
-    end = partition_indices_material(pbvh, offset, offset + count - 1);
+    build_grid_leaf_node(pbvh, node);
   }
-
-  /* Build children */
-  build_sub(pbvh, pbvh->nodes[node_index].children_offset, NULL, prim_bbc, offset, end - offset);
-  build_sub(pbvh,
-            pbvh->nodes[node_index].children_offset + 1,
-            NULL,
-            prim_bbc,
-            end,
-            offset + count - end);
 }
 
-static void pbvh_build(PBVH *pbvh, BB *cb, BBC *prim_bbc, int totprim)
+static void pbvh_build(PBVH *pbvh, BBC *prim_bbc, int totprim)
 {
   if (totprim != pbvh->totprim) {
     pbvh->totprim = totprim;
@@ -552,7 +918,75 @@ static void pbvh_build(PBVH *pbvh, BB *cb, BBC *prim_bbc, int totprim)
   }
 
   pbvh->totnode = 1;
-  build_sub(pbvh, 0, cb, prim_bbc, 0, totprim);
+
+  PBVHBuildNode *root = pbvh_build_tree(pbvh, prim_bbc, pbvh->prim_indices, totprim, true);
+  int totleaf;
+  PBVHBuildNode **leaves = pbvh_build_nodes_create(pbvh, root, &totleaf);
+
+  PBVHBuildLeavesData data = {
+      .pbvh = pbvh,
+      .leaves = leaves,
+  };
+  TaskParallelSettings settings;
+  BKE_pbvh_parallel_range_settings(&settings, true, totleaf);
+
+  /* Vertices shared by multiple leaves are owned by the leaf with the lowest index, that's where
+   * they are counted as unique. */
+  if (pbvh->looptri) {
+    data.vert_owners = MEM_malloc_arrayN(pbvh->totvert, sizeof(int), "PBVH vert owners");
+    copy_vn_i(data.vert_owners, pbvh->totvert, -1);
+    BLI_task_parallel_range(0, totleaf, &data, build_mesh_leaf_claim_verts_task_cb, &settings);
+  }
+  BLI_task_parallel_range(0, totleaf, &data, build_leaf_task_cb, &settings);
+
+  MEM_SAFE_FREE(data.vert_owners);
+  MEM_freeN(leaves);
+  pbvh_build_tree_free(root);
+}
+
+/** \} */
+
+typedef struct PBVHPrimBoundsData {
+  const PBVH *pbvh;
+  BBC *prim_bbc;
+} PBVHPrimBoundsData;
+
+static void pbvh_mesh_prim_bounds_task_cb(void *__restrict userdata,
+                                          const int i,
+                                          const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  PBVHPrimBoundsData *data = userdata;
+  const PBVH *pbvh = data->pbvh;
+  const MLoopTri *lt = &pbvh->looptri[i];
+  const int sides = 3;
+  BBC *bbc = data->prim_bbc + i;
+
+  BB_reset((BB *)bbc);
+
+  for (int j = 0; j < sides; j++) {
+    BB_expand((BB *)bbc, pbvh->verts[pbvh->mloop[lt->tri[j]].v].co);
+  }
+
+  BBC_update_centroid(bbc);
+}
+
+static void pbvh_grids_prim_bounds_task_cb(void *__restrict userdata,
+                                           const int i,
+                                           const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  PBVHPrimBoundsData *data = userdata;
+  const PBVH *pbvh = data->pbvh;
+  const CCGKey *key = &pbvh->gridkey;
+  CCGElem *grid = pbvh->grids[i];
+  BBC *bbc = data->prim_bbc + i;
+
+  BB_reset((BB *)bbc);
+
+  for (int j = 0; j < key->grid_area; j++) {
+    BB_expand((BB *)bbc, CCG_elem_offset_co(key, grid, j));
+  }
+
+  BBC_update_centroid(bbc);
 }
 
 /**
@@ -574,7 +1008,6 @@ void BKE_pbvh_build_mesh(PBVH *pbvh,
                          int looptri_num)
 {
   BBC *prim_bbc = NULL;
-  BB cb;
 
   pbvh->mesh = mesh;
   pbvh->type = PBVH_FACES;
@@ -582,7 +1015,6 @@ void BKE_pbvh_build_mesh(PBVH *pbvh,
   pbvh->mloop = mloop;
   pbvh->looptri = looptri;
   pbvh->verts = verts;
-  pbvh->vert_bitmap = BLI_BITMAP_NEW(totvert, "bvh->vert_bitmap");
   pbvh->totvert = totvert;
   pbvh->leaf_limit = LEAF_LIMIT;
   pbvh->vdata = vdata;
@@ -592,33 +1024,23 @@ void BKE_pbvh_build_mesh(PBVH *pbvh,
   pbvh->face_sets_color_seed = mesh->face_sets_color_seed;
   pbvh->face_sets_color_default = mesh->face_sets_color_default;
 
-  BB_reset(&cb);
-
   /* For each face, store the AABB and the AABB centroid */
   prim_bbc = MEM_mallocN(sizeof(BBC) * looptri_num, "prim_bbc");
 
-  for (int i = 0; i < looptri_num; i++) {
-    const MLoopTri *lt = &looptri[i];
-    const int sides = 3;
-    BBC *bbc = prim_bbc + i;
-
-    BB_reset((BB *)bbc);
-
-    for (int j = 0; j < sides; j++) {
-      BB_expand((BB *)bbc, verts[pbvh->mloop[lt->tri[j]].v].co);
-    }
-
-    BBC_update_centroid(bbc);
-
-    BB_expand(&cb, bbc->bcentroid);
-  }
+  PBVHPrimBoundsData data = {
+      .pbvh = pbvh,
+      .prim_bbc = prim_bbc,
+  };
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+  BLI_task_parallel_range(0, looptri_num, &data, pbvh_mesh_prim_bounds_task_cb, &settings);
 
   if (looptri_num) {
-    pbvh_build(pbvh, &cb, prim_bbc, looptri_num);
+    pbvh_build(pbvh, prim_bbc, looptri_num);
   }
 
   MEM_freeN(prim_bbc);
-  MEM_freeN(pbvh->vert_bitmap);
 }
 
 /* Do a full rebuild with on Grids data structure */
@@ -641,29 +1063,19 @@ void BKE_pbvh_build_grids(PBVH *pbvh,
   pbvh->grid_hidden = grid_hidden;
   pbvh->leaf_limit = max_ii(LEAF_LIMIT / (gridsize * gridsize), 1);
 
-  BB cb;
-  BB_reset(&cb);
-
   /* For each grid, store the AABB and the AABB centroid */
   BBC *prim_bbc = MEM_mallocN(sizeof(BBC) * totgrid, "prim_bbc");
 
-  for (int i = 0; i < totgrid; i++) {
-    CCGElem *grid = grids[i];
-    BBC *bbc = prim_bbc + i;
-
-    BB_reset((BB *)bbc);
-
-    for (int j = 0; j < gridsize * gridsize; j++) {
-      BB_expand((BB *)bbc, CCG_elem_offset_co(key, grid, j));
-    }
-
-    BBC_update_centroid(bbc);
-
-    BB_expand(&cb, bbc->bcentroid);
-  }
+  PBVHPrimBoundsData data = {
+      .pbvh = pbvh,
+      .prim_bbc = prim_bbc,
+  };
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(0, totgrid, &data, pbvh_grids_prim_bounds_task_cb, &settings);
 
   if (totgrid) {
-    pbvh_build(pbvh, &cb, prim_bbc, totgrid);
+    pbvh_build(pbvh, prim_bbc, totgrid);
   }
 
   MEM_freeN(prim_bbc);
@@ -24,7 +24,7 @@
 #include "BLI_ghash.h"
 #include "BLI_heap_simple.h"
 #include "BLI_math.h"
-#include "BLI_memarena.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_DerivedMesh.h"
@@ -1679,198 +1679,92 @@ void pbvh_bmesh_normals_update(PBVHNode **nodes, int totnode)
   }
 }
 
-struct FastNodeBuildInfo {
-  int totface; /* number of faces */
-  int start;   /* start of faces in array */
-  struct FastNodeBuildInfo *child1;
-  struct FastNodeBuildInfo *child2;
-};
-
-/**
- * Recursively split the node if it exceeds the leaf_limit.
- * This function is multi-thread-able since each invocation applies
- * to a sub part of the arrays.
- */
-static void pbvh_bmesh_node_limit_ensure_fast(
-    PBVH *pbvh, BMFace **nodeinfo, BBC *bbc_array, struct FastNodeBuildInfo *node, MemArena *arena)
+typedef struct PBVHBMeshBuildLeavesData {
+  PBVH *pbvh;
+  PBVHBuildNode **leaves;
+  /* Faces in the order of the build tree. */
+  BMFace **faces;
+  const int *face_indices;
+} PBVHBMeshBuildLeavesData;
+
+/* Tag faces of the leaf with its node, and claim its vertices. Vertices shared by multiple leaves
+ * are owned by the leaf with the lowest index. */
+static void pbvh_bmesh_build_leaf_claim_task_cb(void *__restrict userdata,
+                                                const int i,
+                                                const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  struct FastNodeBuildInfo *child1, *child2;
-
-  if (node->totface <= pbvh->leaf_limit) {
-    return;
-  }
-
-  /* Calculate bounding box around primitive centroids */
-  BB cb;
-  BB_reset(&cb);
-  for (int i = 0; i < node->totface; i++) {
-    BMFace *f = nodeinfo[i + node->start];
-    BBC *bbc = &bbc_array[BM_elem_index_get(f)];
-
-    BB_expand(&cb, bbc->bcentroid);
-  }
-
-  /* initialize the children */
-
-  /* Find widest axis and its midpoint */
-  const int axis = BB_widest_axis(&cb);
-  const float mid = (cb.bmax[axis] + cb.bmin[axis]) * 0.5f;
-
-  int num_child1 = 0, num_child2 = 0;
-
-  /* split vertices along the middle line */
-  const int end = node->start + node->totface;
-  for (int i = node->start; i < end - num_child2; i++) {
-    BMFace *f = nodeinfo[i];
-    BBC *bbc = &bbc_array[BM_elem_index_get(f)];
-
-    if (bbc->bcentroid[axis] > mid) {
-      int i_iter = end - num_child2 - 1;
-      int candidate = -1;
-      /* found a face that should be part of another node, look for a face to substitute with */
-
-      for (; i_iter > i; i_iter--) {
-        BMFace *f_iter = nodeinfo[i_iter];
-        const BBC *bbc_iter = &bbc_array[BM_elem_index_get(f_iter)];
-        if (bbc_iter->bcentroid[axis] <= mid) {
-          candidate = i_iter;
-          break;
-        }
+  PBVHBMeshBuildLeavesData *data = userdata;
+  const PBVH *pbvh = data->pbvh;
+  const PBVHBuildNode *leaf = data->leaves[i];
+  const int cd_vert_node_offset = pbvh->cd_vert_node_offset;
+  const int cd_face_node_offset = pbvh->cd_face_node_offset;
 
-        num_child2++;
-      }
+  for (int p = leaf->offset; p < leaf->offset + leaf->count; p++) {
+    BMFace *f = data->faces[data->face_indices[p]];
 
-      if (candidate != -1) {
-        BMFace *tmp = nodeinfo[i];
-        nodeinfo[i] = nodeinfo[candidate];
-        nodeinfo[candidate] = tmp;
-        /* increase both counts */
-        num_child1++;
-        num_child2++;
-      }
-      else {
-        /* not finding candidate means second half of array part is full of
-         * second node parts, just increase the number of child nodes for it */
-        num_child2++;
-      }
-    }
-    else {
-      num_child1++;
-    }
-  }
+    /* Update ownership of faces */
+    BM_ELEM_CD_SET_INT(f, cd_face_node_offset, leaf->node_index);
 
-  /* ensure at least one child in each node */
-  if (num_child2 == 0) {
-    num_child2++;
-    num_child1--;
-  }
-  else if (num_child1 == 0) {
-    num_child1++;
-    num_child2--;
+    BMLoop *l_first = BM_FACE_FIRST_LOOP(f);
+    BMLoop *l_iter = l_first;
+    do {
+      pbvh_vert_owner_claim(BM_ELEM_CD_GET_VOID_P(l_iter->v, cd_vert_node_offset),
+                            leaf->node_index);
+    } while ((l_iter = l_iter->next) != l_first);
   }
-
-  /* at this point, faces should have been split along the array range sequentially,
-   * each sequential part belonging to one node only */
-  BLI_assert((num_child1 + num_child2) == node->totface);
-
-  node->child1 = child1 = BLI_memarena_alloc(arena, sizeof(struct FastNodeBuildInfo));
-  node->child2 = child2 = BLI_memarena_alloc(arena, sizeof(struct FastNodeBuildInfo));
-
-  child1->totface = num_child1;
-  child1->start = node->start;
-  child2->totface = num_child2;
-  child2->start = node->start + num_child1;
-  child1->child1 = child1->child2 = child2->child1 = child2->child2 = NULL;
-
-  pbvh_bmesh_node_limit_ensure_fast(pbvh, nodeinfo, bbc_array, child1, arena);
-  pbvh_bmesh_node_limit_ensure_fast(pbvh, nodeinfo, bbc_array, child2, arena);
 }
 
-static void pbvh_bmesh_create_nodes_fast_recursive(
-    PBVH *pbvh, BMFace **nodeinfo, BBC *bbc_array, struct FastNodeBuildInfo *node, int node_index)
+/* Populate the leaf with faces and vertices and tag it accordingly. */
+static void pbvh_bmesh_build_leaf_task_cb(void *__restrict userdata,
+                                          const int i,
+                                          const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  PBVHNode *n = pbvh->nodes + node_index;
-  /* two cases, node does not have children or does have children */
-  if (node->child1) {
-    int children_offset = pbvh->totnode;
-
-    n->children_offset = children_offset;
-    pbvh_grow_nodes(pbvh, pbvh->totnode + 2);
-    pbvh_bmesh_create_nodes_fast_recursive(
-        pbvh, nodeinfo, bbc_array, node->child1, children_offset);
-    pbvh_bmesh_create_nodes_fast_recursive(
-        pbvh, nodeinfo, bbc_array, node->child2, children_offset + 1);
-
-    n = &pbvh->nodes[node_index];
-
-    /* Update bounding box */
-    BB_reset(&n->vb);
-    BB_expand_with_bb(&n->vb, &pbvh->nodes[n->children_offset].vb);
-    BB_expand_with_bb(&n->vb, &pbvh->nodes[n->children_offset + 1].vb);
-    n->orig_vb = n->vb;
-  }
-  else {
-    /* node does not have children so it's a leaf node, populate with faces and tag accordingly
-     * this is an expensive part but it's not so easily thread-able due to vertex node indices */
-    const int cd_vert_node_offset = pbvh->cd_vert_node_offset;
-    const int cd_face_node_offset = pbvh->cd_face_node_offset;
-
-    bool has_visible = false;
-
-    n->flag = PBVH_Leaf;
-    n->bm_faces = BLI_gset_ptr_new_ex("bm_faces", node->totface);
-
-    /* Create vert hash sets */
-    n->bm_unique_verts = BLI_gset_ptr_new("bm_unique_verts");
-    n->bm_other_verts = BLI_gset_ptr_new("bm_other_verts");
+  PBVHBMeshBuildLeavesData *data = userdata;
+  PBVH *pbvh = data->pbvh;
+  const PBVHBuildNode *leaf = data->leaves[i];
+  PBVHNode *n = &pbvh->nodes[leaf->node_index];
+  const int cd_vert_node_offset = pbvh->cd_vert_node_offset;
 
-    BB_reset(&n->vb);
+  bool has_visible = false;
 
-    const int end = node->start + node->totface;
+  n->flag = PBVH_Leaf;
+  n->bm_faces = BLI_gset_ptr_new_ex("bm_faces", leaf->count);
 
-    for (int i = node->start; i < end; i++) {
-      BMFace *f = nodeinfo[i];
-      BBC *bbc = &bbc_array[BM_elem_index_get(f)];
+  /* Create vert hash sets */
+  n->bm_unique_verts = BLI_gset_ptr_new("bm_unique_verts");
+  n->bm_other_verts = BLI_gset_ptr_new("bm_other_verts");
 
-      /* Update ownership of faces */
-      BLI_gset_insert(n->bm_faces, f);
-      BM_ELEM_CD_SET_INT(f, cd_face_node_offset, node_index);
+  for (int p = leaf->offset; p < leaf->offset + leaf->count; p++) {
+    BMFace *f = data->faces[data->face_indices[p]];
 
-      /* Update vertices */
-      BMLoop *l_first = BM_FACE_FIRST_LOOP(f);
-      BMLoop *l_iter = l_first;
-      do {
-        BMVert *v = l_iter->v;
-        if (!BLI_gset_haskey(n->bm_unique_verts, v)) {
-          if (BM_ELEM_CD_GET_INT(v, cd_vert_node_offset) != DYNTOPO_NODE_NONE) {
-            BLI_gset_add(n->bm_other_verts, v);
-          }
-          else {
-            BLI_gset_insert(n->bm_unique_verts, v);
-            BM_ELEM_CD_SET_INT(v, cd_vert_node_offset, node_index);
-          }
-        }
-        /* Update node bounding box */
-      } while ((l_iter = l_iter->next) != l_first);
+    BLI_gset_insert(n->bm_faces, f);
 
-      if (!BM_elem_flag_test(f, BM_ELEM_HIDDEN)) {
-        has_visible = true;
+    /* Update vertices */
+    BMLoop *l_first = BM_FACE_FIRST_LOOP(f);
+    BMLoop *l_iter = l_first;
+    do {
+      BMVert *v = l_iter->v;
+      if (BM_ELEM_CD_GET_INT(v, cd_vert_node_offset) == leaf->node_index) {
+        BLI_gset_add(n->bm_unique_verts, v);
       }
+      else {
+        BLI_gset_add(n->bm_other_verts, v);
+      }
+    } while ((l_iter = l_iter->next) != l_first);
 
-      BB_expand_with_bb(&n->vb, (BB *)bbc);
+    if (!BM_elem_flag_test(f, BM_ELEM_HIDDEN)) {
+      has_visible = true;
     }
+  }
 
-    BLI_assert(n->vb.bmin[0] <= n->vb.bmax[0] && n->vb.bmin[1] <= n->vb.bmax[1] &&
-               n->vb.bmin[2] <= n->vb.bmax[2]);
-
-    n->orig_vb = n->vb;
+  BLI_assert(n->vb.bmin[0] <= n->vb.bmax[0] && n->vb.bmin[1] <= n->vb.bmax[1] &&
+             n->vb.bmin[2] <= n->vb.bmax[2]);
 
-    /* Build GPU buffers for new node and update vertex normals */
-    BKE_pbvh_node_mark_rebuild_draw(n);
+  /* Build GPU buffers for new node and update vertex normals */
+  BKE_pbvh_node_mark_rebuild_draw(n);
 
-    BKE_pbvh_node_fully_hidden_set(n, !has_visible);
-    n->flag |= PBVH_UpdateNormals;
-  }
+  BKE_pbvh_node_fully_hidden_set(n, !has_visible);
+  n->flag |= PBVH_UpdateNormals;
 }
 
 /***************************** Public API *****************************/
@@ -1901,8 +1795,8 @@ void BKE_pbvh_build_bmesh(PBVH *pbvh,
 
   /* bounding box array of all faces, no need to recalculate every time */
   BBC *bbc_array = MEM_mallocN(sizeof(BBC) * bm->totface, "BBC");
-  BMFace **nodeinfo = MEM_mallocN(sizeof(*nodeinfo) * bm->totface, "nodeinfo");
-  MemArena *arena = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE, "fast PBVH node storage");
+  BMFace **faces = MEM_mallocN(sizeof(*faces) * bm->totface, "faces");
+  int *face_indices = MEM_mallocN(sizeof(*face_indices) * bm->totface, "face_indices");
 
   BMIter iter;
   BMFace *f;
@@ -1920,7 +1814,8 @@ void BKE_pbvh_build_bmesh(PBVH *pbvh,
 
     /* so we can do direct lookups on 'bbc_array' */
     BM_elem_index_set(f, i); /* set_dirty! */
-    nodeinfo[i] = f;
+    faces[i] = f;
+    face_indices[i] = i;
     BM_ELEM_CD_SET_INT(f, cd_face_node_offset, DYNTOPO_NODE_NONE);
   }
   /* Likely this is already dirty. */
@@ -1931,26 +1826,34 @@ void BKE_pbvh_build_bmesh(PBVH *pbvh,
     BM_ELEM_CD_SET_INT(v, cd_vert_node_offset, DYNTOPO_NODE_NONE);
   }
 
-  /* setup root node */
-  struct FastNodeBuildInfo rootnode = {0};
-  rootnode.totface = bm->totface;
-
-  /* start recursion, assign faces to nodes accordingly */
-  pbvh_bmesh_node_limit_ensure_fast(pbvh, nodeinfo, bbc_array, &rootnode, arena);
-
-  /* We now have all faces assigned to a node,
-   * next we need to assign those to the gsets of the nodes. */
+  /* Assign faces to nodes. */
+  PBVHBuildNode *root = pbvh_build_tree(pbvh, bbc_array, face_indices, bm->totface, false);
 
   /* Start with all faces in the root node */
   pbvh->nodes = MEM_callocN(sizeof(PBVHNode), "PBVHNode");
   pbvh->totnode = 1;
 
-  /* take root node and visit and populate children recursively */
-  pbvh_bmesh_create_nodes_fast_recursive(pbvh, nodeinfo, bbc_array, &rootnode, 0);
-
-  BLI_memarena_free(arena);
+  /* We now have all faces assigned to a node,
+   * next we need to assign those to the gsets of the nodes. */
+  int totleaf;
+  PBVHBuildNode **leaves = pbvh_build_nodes_create(pbvh, root, &totleaf);
+
+  PBVHBMeshBuildLeavesData data = {
+      .pbvh = pbvh,
+      .leaves = leaves,
+      .faces = faces,
+      .face_indices = face_indices,
+  };
+  TaskParallelSettings settings;
+  BKE_pbvh_parallel_range_settings(&settings, true, totleaf);
+  BLI_task_parallel_range(0, totleaf, &data, pbvh_bmesh_build_leaf_claim_task_cb, &settings);
+  BLI_task_parallel_range(0, totleaf, &data, pbvh_bmesh_build_leaf_task_cb, &settings);
+
+  MEM_freeN(leaves);
+  pbvh_build_tree_free(root);
   MEM_freeN(bbc_array);
-  MEM_freeN(nodeinfo);
+  MEM_freeN(faces);
+  MEM_freeN(face_indices);
 }
 
 /* Collapse short edges, subdivide long edges */
@@ -150,10 +150,6 @@ struct PBVH {
   int totgrid;
   BLI_bitmap **grid_hidden;
 
-  /* Only used during BVH build and update,
-   * don't need to remain valid after */
-  BLI_bitmap *vert_bitmap;
-
 #ifdef PERFCNTRS
   int perf_modified;
 #endif
@@ -178,6 +174,18 @@ struct PBVH {
   struct SubdivCCG *subdiv_ccg;
 };
 
+/* Node of the temporary tree used while building a PBVH. */
+typedef struct PBVHBuildNode {
+  /* Range of the node's primitives in the array of primitive indices. */
+  int offset, count;
+  /* Bounds of the node's primitives and of their centroids. */
+  BB vb, cb;
+  /* Both null for leaves. */
+  struct PBVHBuildNode *children[2];
+  /* Index in the PBVH nodes array, set by #pbvh_build_nodes_create. */
+  int node_index;
+} PBVHBuildNode;
+
 /* pbvh.c */
 void BB_reset(BB *bb);
 void BB_expand(BB *bb, const float co[3]);
@@ -185,6 +193,21 @@ void BB_expand_with_bb(BB *bb, BB *bb2);
 void BBC_update_centroid(BBC *bbc);
 int BB_widest_axis(const BB *bb);
 void pbvh_grow_nodes(PBVH *bvh, int totnode);
+
+/* Split primitives into a tree, reordering the primitive indices so the primitives of every node
+ * are in a contiguous range. Sub-trees are built in parallel. */
+PBVHBuildNode *pbvh_build_tree(PBVH *pbvh,
+                               const BBC *prim_bbc,
+                               int *prim_indices,
+                               int totprim,
+                               bool use_material_split);
+void pbvh_build_tree_free(PBVHBuildNode *node);
+/* Create PBVH nodes for the tree, with the root at the existing first node. Returns the leaves of
+ * the tree in depth-first order. */
+PBVHBuildNode **pbvh_build_nodes_create(PBVH *pbvh, PBVHBuildNode *root, int *r_totleaf);
+/* Make the node the owner of a vertex, unless a node with a lower index owns it already.
+ * An owner of -1 means the vertex has no owner yet. Thread-safe. */
+void pbvh_vert_owner_claim(int *owner, int node_index);
 bool ray_face_intersection_quad(const float ray_start[3],
                                 struct IsectRayPrecalc *isect_precalc,
                                 const float t0[3],
@@ -35,6 +35,7 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "opensubdiv_capi_type.h"
 #include "opensubdiv_evaluator_capi.h"
 #include "opensubdiv_topology_refiner_capi.h"
 
@@ -168,6 +169,11 @@ void BKE_subdiv_eval_init_displacement(Subdiv *subdiv)
 
 /* ========================== Single point queries ========================== */
 
+static bool derivatives_are_valid(const float dPdu[3], const float dPdv[3])
+{
+  return !(is_zero_v3(dPdu) || is_zero_v3(dPdv) || equals_v3v3(dPdu, dPdv));
+}
+
 void BKE_subdiv_eval_limit_point(
     Subdiv *subdiv, const int ptex_face_index, const float u, const float v, float r_P[3])
 {
@@ -196,7 +202,7 @@ void BKE_subdiv_eval_limit_point_and_derivatives(Subdiv *subdiv,
    * that giving totally unusable derivatives. */
 
   if (r_dPdu != NULL && r_dPdv != NULL) {
-    if ((is_zero_v3(r_dPdu) || is_zero_v3(r_dPdv)) || equals_v3v3(r_dPdu, r_dPdv)) {
+    if (!derivatives_are_valid(r_dPdu, r_dPdv)) {
       subdiv->evaluator->evaluateLimit(subdiv->evaluator,
                                        ptex_face_index,
                                        u * 0.999f + 0.0005f,
@@ -274,6 +280,45 @@ void BKE_subdiv_eval_final_point(
   }
 }
 
+/* ============================ Batched queries ============================= */
+
+void BKE_subdiv_eval_limit_points(Subdiv *subdiv,
+                                  const OpenSubdiv_PatchCoord *patch_coords,
+                                  const int num_patch_coords,
+                                  float (*r_P)[3])
+{
+  subdiv->evaluator->evaluatePatchesLimit(
+      subdiv->evaluator, patch_coords, num_patch_coords, &r_P[0][0], NULL, NULL);
+}
+
+void BKE_subdiv_eval_limit_points_and_derivatives(Subdiv *subdiv,
+                                                  const OpenSubdiv_PatchCoord *patch_coords,
+                                                  const int num_patch_coords,
+                                                  float (*r_P)[3],
+                                                  float (*r_dPdu)[3],
+                                                  float (*r_dPdv)[3])
+{
+  subdiv->evaluator->evaluatePatchesLimit(subdiv->evaluator,
+                                          patch_coords,
+                                          num_patch_coords,
+                                          &r_P[0][0],
+                                          &r_dPdu[0][0],
+                                          &r_dPdv[0][0]);
+  /* Same as for the single point query: step inside of the face where derivatives are
+   * degenerate. Those points are rare, so they are evaluated one by one. */
+  for (int i = 0; i < num_patch_coords; i++) {
+    if (!derivatives_are_valid(r_dPdu[i], r_dPdv[i])) {
+      subdiv->evaluator->evaluateLimit(subdiv->evaluator,
+                                       patch_coords[i].ptex_face,
+                                       patch_coords[i].u * 0.999f + 0.0005f,
+                                       patch_coords[i].v * 0.999f + 0.0005f,
+                                       r_P[i],
+                                       r_dPdu[i],
+                                       r_dPdv[i]);
+    }
+  }
+}
+
 /* ===================  Patch queries at given resolution =================== */
 
 /* Move buffer forward by a given number of bytes. */
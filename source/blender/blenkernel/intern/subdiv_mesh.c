@@ -31,6 +31,7 @@
 
 #include "BLI_alloca.h"
 #include "BLI_math_vector.h"
+#include "BLI_task.h"
 
 #include "BKE_customdata.h"
 #include "BKE_key.h"
@@ -41,6 +42,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "opensubdiv_capi_type.h"
+
 /* -------------------------------------------------------------------- */
 /** \name Subdivision Context
  * \{ */
@@ -72,6 +75,10 @@ typedef struct SubdivMeshContext {
   float (*accumulated_normals)[3];
   /* Per-subdivided vertex counter of averaged values. */
   int *accumulated_counters;
+  /* Limit surface coordinates of inner vertices, indexed by subdivided vertex. Positions and
+   * normals of those vertices are evaluated in batches after the traversal. Other vertices have a
+   * ptex face index of -1. */
+  OpenSubdiv_PatchCoord *inner_vertex_patch_coords;
   /* Denotes whether normals can be evaluated from a limit surface. One case
    * when it's not possible is when displacement is used. */
   bool can_evaluate_normals;
@@ -113,10 +120,21 @@ static void subdiv_mesh_prepare_accumulator(SubdivMeshContext *ctx, int num_vert
       sizeof(*ctx->accumulated_counters), num_vertices, "subdiv accumulated counters");
 }
 
+static void subdiv_mesh_prepare_inner_vertex_patch_coords(SubdivMeshContext *ctx,
+                                                          int num_vertices)
+{
+  ctx->inner_vertex_patch_coords = MEM_malloc_arrayN(
+      num_vertices, sizeof(*ctx->inner_vertex_patch_coords), "subdiv inner patch coords");
+  for (int i = 0; i < num_vertices; i++) {
+    ctx->inner_vertex_patch_coords[i].ptex_face = -1;
+  }
+}
+
 static void subdiv_mesh_context_free(SubdivMeshContext *ctx)
 {
   MEM_SAFE_FREE(ctx->accumulated_normals);
   MEM_SAFE_FREE(ctx->accumulated_counters);
+  MEM_SAFE_FREE(ctx->inner_vertex_patch_coords);
 }
 
 /** \} */
@@ -450,27 +468,6 @@ static void subdiv_mesh_tls_free(void *tls_v)
 
 /** \} */
 
-/* -------------------------------------------------------------------- */
-/** \name Evaluation helper functions
- * \{ */
-
-static void eval_final_point_and_vertex_normal(Subdiv *subdiv,
-                                               const int ptex_face_index,
-                                               const float u,
-                                               const float v,
-                                               float r_P[3],
-                                               short r_N[3])
-{
-  if (subdiv->displacement_evaluator == NULL) {
-    BKE_subdiv_eval_limit_point_and_short_normal(subdiv, ptex_face_index, u, v, r_P, r_N);
-  }
-  else {
-    BKE_subdiv_eval_final_point(subdiv, ptex_face_index, u, v, r_P);
-  }
-}
-
-/** \} */
-
 /* -------------------------------------------------------------------- */
 /** \name Accumulation helpers
  * \{ */
@@ -526,6 +523,7 @@ static bool subdiv_mesh_topology_info(const SubdivForeachContext *foreach_contex
       subdiv_context->coarse_mesh, num_vertices, num_edges, 0, num_loops, num_polygons, mask);
   subdiv_mesh_ctx_cache_custom_data_layers(subdiv_context);
   subdiv_mesh_prepare_accumulator(subdiv_context, num_vertices);
+  subdiv_mesh_prepare_inner_vertex_patch_coords(subdiv_context, num_vertices);
   return true;
 }
 
@@ -783,7 +781,6 @@ static void subdiv_mesh_vertex_inner(const SubdivForeachContext *foreach_context
 {
   SubdivMeshContext *ctx = foreach_context->user_data;
   SubdivMeshTLS *tls = tls_v;
-  Subdiv *subdiv = ctx->subdiv;
   const Mesh *coarse_mesh = ctx->coarse_mesh;
   const MPoly *coarse_mpoly = coarse_mesh->mpoly;
   const MPoly *coarse_poly = &coarse_mpoly[coarse_poly_index];
@@ -792,8 +789,11 @@ static void subdiv_mesh_vertex_inner(const SubdivForeachContext *foreach_context
   MVert *subdiv_vert = &subdiv_mvert[subdiv_vertex_index];
   subdiv_mesh_ensure_vertex_interpolation(ctx, tls, coarse_poly, coarse_corner);
   subdiv_vertex_data_interpolate(ctx, subdiv_vert, &tls->vertex_interpolation, u, v);
-  eval_final_point_and_vertex_normal(
-      subdiv, ptex_face_index, u, v, subdiv_vert->co, subdiv_vert->no);
+  /* Position and normal are evaluated in batches, see #subdiv_mesh_eval_inner_vertices. */
+  OpenSubdiv_PatchCoord *patch_coord = &ctx->inner_vertex_patch_coords[subdiv_vertex_index];
+  patch_coord->ptex_face = ptex_face_index;
+  patch_coord->u = u;
+  patch_coord->v = v;
   subdiv_mesh_tag_center_vertex(coarse_poly, subdiv_vert, u, v);
 }
 
@@ -1156,6 +1156,121 @@ static void subdiv_mesh_vertex_of_loose_edge(const struct SubdivForeachContext *
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Batched evaluation of inner vertices
+ * \{ */
+
+/* Matches the number of patch coordinates the evaluator converts without a heap allocation. */
+#define INNER_VERTICES_BATCH_SIZE (32 * 32)
+
+typedef struct SubdivMeshEvalTLS {
+  OpenSubdiv_PatchCoord *patch_coords;
+  int *vertex_indices;
+  float (*P)[3];
+  float (*dPdu)[3];
+  float (*dPdv)[3];
+} SubdivMeshEvalTLS;
+
+static void subdiv_mesh_eval_tls_ensure(SubdivMeshEvalTLS *tls)
+{
+  if (tls->patch_coords != NULL) {
+    return;
+  }
+  tls->patch_coords = MEM_malloc_arrayN(
+      INNER_VERTICES_BATCH_SIZE, sizeof(*tls->patch_coords), "subdiv batch patch coords");
+  tls->vertex_indices = MEM_malloc_arrayN(
+      INNER_VERTICES_BATCH_SIZE, sizeof(*tls->vertex_indices), "subdiv batch vertex indices");
+  tls->P = MEM_malloc_arrayN(INNER_VERTICES_BATCH_SIZE, sizeof(*tls->P), "subdiv batch P");
+  tls->dPdu = MEM_malloc_arrayN(
+      INNER_VERTICES_BATCH_SIZE, sizeof(*tls->dPdu), "subdiv batch dPdu");
+  tls->dPdv = MEM_malloc_arrayN(
+      INNER_VERTICES_BATCH_SIZE, sizeof(*tls->dPdv), "subdiv batch dPdv");
+}
+
+static void subdiv_mesh_eval_tls_free(const void *__restrict UNUSED(userdata),
+                                      void *__restrict tls_v)
+{
+  SubdivMeshEvalTLS *tls = tls_v;
+  MEM_SAFE_FREE(tls->patch_coords);
+  MEM_SAFE_FREE(tls->vertex_indices);
+  MEM_SAFE_FREE(tls->P);
+  MEM_SAFE_FREE(tls->dPdu);
+  MEM_SAFE_FREE(tls->dPdv);
+}
+
+static void subdiv_mesh_eval_inner_vertices_task(void *__restrict userdata,
+                                                 const int batch_index,
+                                                 const TaskParallelTLS *__restrict tls_v)
+{
+  SubdivMeshContext *ctx = userdata;
+  SubdivMeshEvalTLS *tls = tls_v->userdata_chunk;
+  Subdiv *subdiv = ctx->subdiv;
+  Mesh *subdiv_mesh = ctx->subdiv_mesh;
+  MVert *subdiv_mvert = subdiv_mesh->mvert;
+  const int start_vertex_index = batch_index * INNER_VERTICES_BATCH_SIZE;
+  const int end_vertex_index = min_ii(start_vertex_index + INNER_VERTICES_BATCH_SIZE,
+                                      subdiv_mesh->totvert);
+  /* Gather inner vertices of the batch. */
+  int num_patch_coords = 0;
+  for (int i = start_vertex_index; i < end_vertex_index; i++) {
+    const OpenSubdiv_PatchCoord *patch_coord = &ctx->inner_vertex_patch_coords[i];
+    if (patch_coord->ptex_face == -1) {
+      continue;
+    }
+    subdiv_mesh_eval_tls_ensure(tls);
+    tls->patch_coords[num_patch_coords] = *patch_coord;
+    tls->vertex_indices[num_patch_coords] = i;
+    num_patch_coords++;
+  }
+  if (num_patch_coords == 0) {
+    return;
+  }
+  BKE_subdiv_eval_limit_points_and_derivatives(
+      subdiv, tls->patch_coords, num_patch_coords, tls->P, tls->dPdu, tls->dPdv);
+  /* Scatter evaluated points to the vertices. */
+  for (int i = 0; i < num_patch_coords; i++) {
+    MVert *subdiv_vert = &subdiv_mvert[tls->vertex_indices[i]];
+    copy_v3_v3(subdiv_vert->co, tls->P[i]);
+    if (subdiv->displacement_evaluator == NULL) {
+      float N[3];
+      cross_v3_v3v3(N, tls->dPdu[i], tls->dPdv[i]);
+      normalize_v3(N);
+      normal_float_to_short_v3(subdiv_vert->no, N);
+    }
+    else {
+      const OpenSubdiv_PatchCoord *patch_coord = &tls->patch_coords[i];
+      float D[3];
+      BKE_subdiv_eval_displacement(subdiv,
+                                   patch_coord->ptex_face,
+                                   patch_coord->u,
+                                   patch_coord->v,
+                                   tls->dPdu[i],
+                                   tls->dPdv[i],
+                                   D);
+      add_v3_v3(subdiv_vert->co, D);
+    }
+  }
+}
+
+/* Evaluate limit surface positions and normals of all inner vertices. Every task handles a range
+ * of vertices with a single evaluator call, using buffers which are kept for the whole thread. */
+static void subdiv_mesh_eval_inner_vertices(SubdivMeshContext *ctx)
+{
+  const int num_batches = (ctx->subdiv_mesh->totvert + INNER_VERTICES_BATCH_SIZE - 1) /
+                          INNER_VERTICES_BATCH_SIZE;
+  SubdivMeshEvalTLS tls = {NULL};
+  TaskParallelSettings parallel_range_settings;
+  BLI_parallel_range_settings_defaults(&parallel_range_settings);
+  parallel_range_settings.userdata_chunk = &tls;
+  parallel_range_settings.userdata_chunk_size = sizeof(tls);
+  parallel_range_settings.func_free = subdiv_mesh_eval_tls_free;
+  parallel_range_settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(
+      0, num_batches, ctx, subdiv_mesh_eval_inner_vertices_task, &parallel_range_settings);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Initialization
  * \{ */
@@ -1227,6 +1342,9 @@ Mesh *BKE_subdiv_to_mesh(Subdiv *subdiv,
   foreach_context.user_data_tls_size = sizeof(SubdivMeshTLS);
   foreach_context.user_data_tls = &tls;
   BKE_subdiv_foreach_subdiv_geometry(subdiv, &foreach_context, settings, coarse_mesh);
+  if (subdiv_context.subdiv_mesh != NULL) {
+    subdiv_mesh_eval_inner_vertices(&subdiv_context);
+  }
   BKE_subdiv_stats_end(&subdiv->stats, SUBDIV_STATS_SUBDIV_TO_MESH_GEOMETRY);
   Mesh *result = subdiv_context.subdiv_mesh;
   // BKE_mesh_validate(result, true, true);
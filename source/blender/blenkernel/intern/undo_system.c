@@ -262,6 +262,15 @@ static void undosys_stack_validate(UndoStack *UNUSED(ustack), bool UNUSED(expect
 }
 #endif
 
+static size_t undosys_stack_data_size(const UndoStack *ustack)
+{
+  size_t data_size_all = 0;
+  LISTBASE_FOREACH (const UndoStep *, us, &ustack->steps) {
+    data_size_all += us->data_size;
+  }
+  return data_size_all;
+}
+
 UndoStack *BKE_undosys_stack_create(void)
 {
   UndoStack *ustack = MEM_callocN(sizeof(UndoStack), __func__);
@@ -284,6 +293,7 @@ void BKE_undosys_stack_clear(UndoStack *ustack)
   }
   BLI_listbase_clear(&ustack->steps);
   ustack->step_active = NULL;
+  ustack->data_size_peak = 0;
 }
 
 void BKE_undosys_stack_clear_active(UndoStack *ustack)
@@ -598,6 +608,15 @@ UndoPushReturn BKE_undosys_step_push_with_type(UndoStack *ustack,
     ustack->step_active->skip = true;
   }
 
+  const size_t data_size_all = undosys_stack_data_size(ustack);
+  ustack->data_size_peak = MAX2(ustack->data_size_peak, data_size_all);
+  CLOG_INFO(&LOG,
+            1,
+            "step_size=%zu, stack_size=%zu, stack_size_peak=%zu",
+            ustack->step_active->data_size,
+            data_size_all,
+            ustack->data_size_peak);
+
   undosys_stack_validate(ustack, true);
   return (retval | UNDO_PUSH_RET_SUCCESS);
 }
@@ -1050,7 +1069,7 @@ void BKE_undosys_print(UndoStack *ustack)
          BLI_listbase_count(&ustack->steps));
   int index = 0;
   LISTBASE_FOREACH (UndoStep *, us, &ustack->steps) {
-    printf("[%c%c%c%c] %3d {%p} type='%s', name='%s'\n",
+    printf("[%c%c%c%c] %3d {%p} type='%s', name='%s', size=%zu\n",
            (us == ustack->step_active) ? '*' : ' ',
            us->is_applied ? '#' : ' ',
            (us == ustack->step_active_memfile) ? 'M' : ' ',
@@ -1058,9 +1077,11 @@ void BKE_undosys_print(UndoStack *ustack)
            index,
            (void *)us,
            us->type->name,
-           us->name);
+           us->name,
+           us->data_size);
     index++;
   }
+  printf("Undo size %zu, peak %zu\n", undosys_stack_data_size(ustack), ustack->data_size_peak);
 }
 
 /** \} */
@@ -65,6 +65,35 @@ class GuardedAllocator {
   }
 };
 
+namespace pool_allocator {
+void *allocate(size_t size, size_t alignment, const char *name);
+void deallocate(void *ptr);
+/** Memory taken from the system for the pool, including unused blocks. */
+size_t reserved_memory_get();
+}  // namespace pool_allocator
+
+/**
+ * Serves small allocations from thread-local free lists, without a header per allocation and
+ * without going through the system allocator. This is meant for containers that are created and
+ * destroyed very often, e.g. `Vector<int, 4, PoolAllocator>`. Memory can be freed in another
+ * thread than it was allocated in.
+ *
+ * Allocations larger than 4 KiB are passed on to the guarded allocator. The memory used by the
+ * pool itself is not counted by the guarded allocator, and it is not given back to the system.
+ */
+class PoolAllocator {
+ public:
+  void *allocate(size_t size, size_t alignment, const char *name)
+  {
+    return pool_allocator::allocate(size, alignment, name);
+  }
+
+  void deallocate(void *ptr)
+  {
+    pool_allocator::deallocate(ptr);
+  }
+};
+
 /**
  * This is a wrapper around malloc/free. Only use this when the GuardedAllocator cannot be
  * used. This can be the case when the allocated memory might live longer than Blender's
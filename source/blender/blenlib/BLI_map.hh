@@ -1257,6 +1257,20 @@ template<typename Key,
 using RawMap =
     Map<Key, Value, InlineBufferCapacity, ProbingStrategy, Hash, IsEqual, Slot, RawAllocator>;
 
+/**
+ * Same as a normal Map, but uses the #PoolAllocator. This is useful for many short-lived maps.
+ */
+template<typename Key,
+         typename Value,
+         int64_t InlineBufferCapacity = default_inline_buffer_capacity(sizeof(Key) +
+                                                                       sizeof(Value)),
+         typename ProbingStrategy = DefaultProbingStrategy,
+         typename Hash = DefaultHash<Key>,
+         typename IsEqual = DefaultEquality,
+         typename Slot = typename DefaultMapSlot<Key, Value>::type>
+using PoolMap =
+    Map<Key, Value, InlineBufferCapacity, ProbingStrategy, Hash, IsEqual, Slot, PoolAllocator>;
+
 /**
  * A wrapper for std::unordered_map with the API of blender::Map. This can be used for
  * benchmarking.
@@ -398,6 +398,18 @@ struct BoundingBox {
 /** Assume bounding boxes have been expanded by a sufficient epsilon. */
 bool bbs_might_intersect(const BoundingBox &bb_a, const BoundingBox &bb_b);
 
+/**
+ * Exact #orient3d of the vertices, decided with their double coordinates when the error bound
+ * allows it, falling back to their exact coordinates otherwise.
+ */
+int filtered_orient3d(const Vert *a, const Vert *b, const Vert *c, const Vert *d);
+
+/**
+ * Print and reset how often the filtered predicates needed exact arithmetic.
+ * Only counted when `PERFDEBUG` is defined in `mesh_intersect.cc`.
+ */
+void dump_filter_perfdata();
+
 /**
  * The output will have duplicate vertices merged and degenerate triangles ignored.
  * If the input has overlapping co-planar triangles, then there will be
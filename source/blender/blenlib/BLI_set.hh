@@ -922,4 +922,16 @@ template<typename Key,
          typename Slot = typename DefaultSetSlot<Key>::type>
 using RawSet = Set<Key, InlineBufferCapacity, ProbingStrategy, Hash, IsEqual, Slot, RawAllocator>;
 
+/**
+ * Same as a normal Set, but uses the #PoolAllocator. This is useful for many short-lived sets.
+ */
+template<typename Key,
+         int64_t InlineBufferCapacity = default_inline_buffer_capacity(sizeof(Key)),
+         typename ProbingStrategy = DefaultProbingStrategy,
+         typename Hash = DefaultHash<Key>,
+         typename IsEqual = DefaultEquality,
+         typename Slot = typename DefaultSetSlot<Key>::type>
+using PoolSet =
+    Set<Key, InlineBufferCapacity, ProbingStrategy, Hash, IsEqual, Slot, PoolAllocator>;
+
 }  // namespace blender
@@ -48,6 +48,12 @@ void BLI_task_scheduler_init(void);
 void BLI_task_scheduler_exit(void);
 int BLI_task_scheduler_num_threads(void);
 
+/* Limit the number of threads that background task pools use, so that long running background
+ * work leaves threads available for the user interface. Zero for no limit. Must be called before
+ * #BLI_task_scheduler_init. */
+void BLI_task_scheduler_background_threads_set(int num_threads);
+int BLI_task_scheduler_background_threads_get(void);
+
 /* Task Pool
  *
  * Pool of tasks that will be executed by the central task scheduler. For each
@@ -43,6 +43,7 @@
 #  endif
 #endif
 
+#include "BLI_function_ref.hh"
 #include "BLI_index_range.hh"
 #include "BLI_utildefines.h"
 
@@ -77,6 +78,29 @@ void parallel_for(IndexRange range, int64_t grain_size, const Function &function
 #endif
 }
 
+namespace detail {
+void parallel_for_numa_impl(IndexRange range, FunctionRef<void(IndexRange)> function);
+}
+
+/**
+ * Same as #parallel_for, but the range is split into one contiguous part per NUMA node, and each
+ * part is only processed by threads running on that node. Memory that is first written to in the
+ * loop is then allocated on the node that processes it, so later loops over the same range with
+ * the same split only access memory of their own node.
+ *
+ * Falls back to #parallel_for on systems with a single NUMA node.
+ */
+template<typename Function>
+void parallel_for_numa(IndexRange range, int64_t grain_size, const Function &function)
+{
+  if (range.size() == 0) {
+    return;
+  }
+  detail::parallel_for_numa_impl(range, [&](const IndexRange node_range) {
+    parallel_for(node_range, grain_size, function);
+  });
+}
+
 template<typename Value, typename Function, typename Reduction>
 Value parallel_reduce(IndexRange range,
                       int64_t grain_size,
@@ -999,4 +999,11 @@ class Vector {
 template<typename T, int64_t InlineBufferCapacity = default_inline_buffer_capacity(sizeof(T))>
 using RawVector = Vector<T, InlineBufferCapacity, RawAllocator>;
 
+/**
+ * Same as a normal Vector, but uses the #PoolAllocator. This is useful for many short-lived
+ * vectors that outgrow their inline buffer.
+ */
+template<typename T, int64_t InlineBufferCapacity = default_inline_buffer_capacity(sizeof(T))>
+using PoolVector = Vector<T, InlineBufferCapacity, PoolAllocator>;
+
 } /* namespace blender */
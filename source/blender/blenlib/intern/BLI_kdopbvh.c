@@ -40,7 +40,6 @@
 
 #include "MEM_guardedalloc.h"
 
-#include "BLI_alloca.h"
 #include "BLI_heap_simple.h"
 #include "BLI_kdopbvh.h"
 #include "BLI_math.h"
@@ -1264,40 +1263,129 @@ static bool tree_overlap_traverse_num(BVHOverlapData_Thread *data_thread,
   return false;
 }
 
+/* Aim for this many tasks per thread, so threads that finish early can steal the remaining
+ * node pairs, one pair of large overlapping sub-trees can easily be most of the work. */
+#define KDOPBVH_OVERLAP_TASKS_PER_THREAD 8
+
 /**
- * Use to check the total number of threads #BLI_bvhtree_overlap will use.
+ * Use to check the total number of tasks #BLI_bvhtree_overlap will use,
+ * the `thread` argument passed to #BVHTree_OverlapCallback is always below this.
  *
- * \warning Must be the first tree passed to #BLI_bvhtree_overlap!
+ * `thread` is the index of the task the overlap is found in, results of the tasks are merged
+ * in that order, so they don't depend on how the tasks are scheduled.
+ * This only depends on the task scheduler, \a tree is unused and may be NULL.
  */
-int BLI_bvhtree_overlap_thread_num(const BVHTree *tree)
+int BLI_bvhtree_overlap_thread_num(const BVHTree *UNUSED(tree))
 {
-  return (int)MIN2(tree->tree_type, tree->nodes[tree->totleaf]->totnode);
+  return max_ii(BLI_task_scheduler_num_threads(), 1) * KDOPBVH_OVERLAP_TASKS_PER_THREAD;
 }
 
-static void bvhtree_overlap_task_cb(void *__restrict userdata,
-                                    const int j,
-                                    const TaskParallelTLS *__restrict UNUSED(tls))
-{
-  BVHOverlapData_Thread *data = &((BVHOverlapData_Thread *)userdata)[j];
-  BVHOverlapData_Shared *data_shared = data->shared;
+typedef struct BVHOverlapData_Tasks {
+  BVHOverlapData_Shared *shared;
+  BVHOverlapData_Thread *thread_data;
+  uint max_interactions;
+
+  /* Node pairs to traverse, one per task. */
+  const BVHNode *(*node_pairs)[2];
+} BVHOverlapData_Tasks;
+
+/**
+ * Descend both trees breadth first until there are enough node pairs for \a tasks_num_max
+ * tasks, only keeping the pairs that overlap. There are never more pairs than that.
+ * The result matches the traversal from the roots since child bounds are inside their parents.
+ *
+ * \param split_tree2: When false only nodes from the first tree are split,
+ * needed for `max_interactions` which counts the overlaps below each node of the first tree.
+ */
+static int bvhtree_overlap_task_split(const BVHOverlapData_Shared *data,
+                                      const BVHNode *root1,
+                                      const BVHNode *root2,
+                                      const bool split_tree2,
+                                      const int tasks_num_max,
+                                      const BVHNode *(**r_node_pairs)[2])
+{
+  const int children_max = data->tree1->tree_type * (split_tree2 ? data->tree2->tree_type : 1);
+  const BVHNode *(*pairs)[2] = MEM_malloc_arrayN(1, sizeof(*pairs), __func__);
+  int pairs_len = 1;
+  pairs[0][0] = root1;
+  pairs[0][1] = root2;
+
+  bool is_split = true;
+  while (is_split && pairs_len < tasks_num_max) {
+    const BVHNode *(*pairs_next)[2] = MEM_malloc_arrayN(
+        (size_t)(pairs_len * children_max), sizeof(*pairs_next), __func__);
+    int pairs_next_len = 0;
+    is_split = false;
+
+    for (int i = 0; i < pairs_len; i++) {
+      const BVHNode *node1 = pairs[i][0];
+      const BVHNode *node2 = pairs[i][1];
+      const bool split_node2 = split_tree2 && node2->totnode;
+      const int pairs_next_len_prev = pairs_next_len;
+
+      /* Leaf pairs can't be split. */
+      if (node1->totnode || split_node2) {
+        const int node1_len = node1->totnode ? node1->totnode : 1;
+        const int node2_len = split_node2 ? node2->totnode : 1;
+        for (int j1 = 0; j1 < node1_len; j1++) {
+          const BVHNode *child1 = node1->totnode ? node1->children[j1] : node1;
+          for (int j2 = 0; j2 < node2_len; j2++) {
+            const BVHNode *child2 = split_node2 ? node2->children[j2] : node2;
+            if (tree_overlap_test(child1, child2, data->start_axis, data->stop_axis)) {
+              pairs_next[pairs_next_len][0] = child1;
+              pairs_next[pairs_next_len][1] = child2;
+              pairs_next_len++;
+            }
+          }
+        }
+
+        /* Keep the pair when its children would exceed the maximum, with the pairs left. */
+        if (pairs_next_len + (pairs_len - i - 1) <= tasks_num_max) {
+          is_split = true;
+          continue;
+        }
+        pairs_next_len = pairs_next_len_prev;
+      }
+
+      pairs_next[pairs_next_len][0] = node1;
+      pairs_next[pairs_next_len][1] = node2;
+      pairs_next_len++;
+    }
+
+    MEM_freeN((void *)pairs);
+    pairs = pairs_next;
+    pairs_len = pairs_next_len;
+  }
 
+  *r_node_pairs = pairs;
+  return pairs_len;
+}
+
+static void bvhtree_overlap_traverse_pair(BVHOverlapData_Thread *data,
+                                          const BVHNode *node1,
+                                          const BVHNode *node2)
+{
   if (data->max_interactions) {
-    tree_overlap_traverse_num(data,
-                              data_shared->tree1->nodes[data_shared->tree1->totleaf]->children[j],
-                              data_shared->tree2->nodes[data_shared->tree2->totleaf]);
+    tree_overlap_traverse_num(data, node1, node2);
   }
-  else if (data_shared->callback) {
-    tree_overlap_traverse_cb(data,
-                             data_shared->tree1->nodes[data_shared->tree1->totleaf]->children[j],
-                             data_shared->tree2->nodes[data_shared->tree2->totleaf]);
+  else if (data->shared->callback) {
+    tree_overlap_traverse_cb(data, node1, node2);
   }
   else {
-    tree_overlap_traverse(data,
-                          data_shared->tree1->nodes[data_shared->tree1->totleaf]->children[j],
-                          data_shared->tree2->nodes[data_shared->tree2->totleaf]);
+    tree_overlap_traverse(data, node1, node2);
   }
 }
 
+static void bvhtree_overlap_task_cb(void *__restrict userdata,
+                                    const int j,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHOverlapData_Tasks *data_tasks = (BVHOverlapData_Tasks *)userdata;
+  BVHOverlapData_Thread *data = &data_tasks->thread_data[j];
+
+  bvhtree_overlap_traverse_pair(data, data_tasks->node_pairs[j][0], data_tasks->node_pairs[j][1]);
+}
+
 BVHTreeOverlap *BLI_bvhtree_overlap_ex(
     const BVHTree *tree1,
     const BVHTree *tree2,
@@ -1315,13 +1403,12 @@ BVHTreeOverlap *BLI_bvhtree_overlap_ex(
   /* 'RETURN_PAIRS' was not implemented without 'max_interactions'. */
   BLI_assert(overlap_pairs || max_interactions);
 
-  const int root_node_len = BLI_bvhtree_overlap_thread_num(tree1);
-  const int thread_num = use_threading ? root_node_len : 1;
+  int thread_num = 1;
   int j;
   size_t total = 0;
   BVHTreeOverlap *overlap = NULL, *to = NULL;
   BVHOverlapData_Shared data_shared;
-  BVHOverlapData_Thread *data = BLI_array_alloca(data, (size_t)thread_num);
+  BVHOverlapData_Thread *data;
   axis_t start_axis, stop_axis;
 
   /* check for compatibility of both trees (can't compare 14-DOP with 18-DOP) */
@@ -1351,6 +1438,22 @@ BVHTreeOverlap *BLI_bvhtree_overlap_ex(
   data_shared.callback = callback;
   data_shared.userdata = userdata;
 
+  BVHOverlapData_Tasks data_tasks;
+  data_tasks.shared = &data_shared;
+  data_tasks.max_interactions = max_interactions;
+
+  if (use_threading) {
+    thread_num = bvhtree_overlap_task_split(&data_shared,
+                                            root1,
+                                            root2,
+                                            max_interactions == 0,
+                                            BLI_bvhtree_overlap_thread_num(tree1),
+                                            &data_tasks.node_pairs);
+  }
+
+  /* Each task (node pair) has its own results and starts counting `max_interactions` again,
+   * as each root child did before the split. */
+  data = MEM_malloc_arrayN((size_t)thread_num, sizeof(*data), __func__);
   for (j = 0; j < thread_num; j++) {
     /* init BVHOverlapData_Thread */
     data[j].shared = &data_shared;
@@ -1362,21 +1465,17 @@ BVHTreeOverlap *BLI_bvhtree_overlap_ex(
   }
 
   if (use_threading) {
+    data_tasks.thread_data = data;
+
     TaskParallelSettings settings;
     BLI_parallel_range_settings_defaults(&settings);
     settings.min_iter_per_thread = 1;
-    BLI_task_parallel_range(0, root_node_len, data, bvhtree_overlap_task_cb, &settings);
+    BLI_task_parallel_range(0, thread_num, &data_tasks, bvhtree_overlap_task_cb, &settings);
+
+    MEM_freeN((void *)data_tasks.node_pairs);
   }
   else {
-    if (max_interactions) {
-      tree_overlap_traverse_num(data, root1, root2);
-    }
-    else if (callback) {
-      tree_overlap_traverse_cb(data, root1, root2);
-    }
-    else {
-      tree_overlap_traverse(data, root1, root2);
-    }
+    bvhtree_overlap_traverse_pair(data, root1, root2);
   }
 
   if (overlap_pairs) {
@@ -1395,6 +1494,8 @@ BVHTreeOverlap *BLI_bvhtree_overlap_ex(
     *r_overlap_tot = (uint)total;
   }
 
+  MEM_freeN(data);
+
   return overlap;
 }
 
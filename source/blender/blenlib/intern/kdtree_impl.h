@@ -22,6 +22,7 @@
 
 #include "BLI_kdtree_impl.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_strict_flags.h"
 #include "BLI_utildefines.h"
 
@@ -52,12 +53,19 @@ struct KDTree {
 #endif
 };
 
-#define KD_STACK_INIT 100     /* initial size for array (on the stack) */
+/* Initial size for array (on the stack). A balanced tree never needs more than its depth + 1,
+ * so searches don't allocate in practice. */
+#define KD_STACK_INIT 100
 #define KD_NEAR_ALLOC_INC 100 /* alloc increment for collecting nearest */
 #define KD_FOUND_ALLOC_INC 50 /* alloc increment for collecting nearest */
 
 #define KD_NODE_UNSET ((uint)-1)
 
+/* Balance sub-trees with at least this many nodes in parallel. */
+#define KD_BALANCE_PARALLEL_MIN 8192
+/* Number of queries per task for batched searches. */
+#define KD_BATCH_GRAIN_SIZE 256
+
 /**
  * When set we know all values are unbalanced,
  * otherwise clear them when re-balancing: see T62210.
@@ -145,6 +153,24 @@ void BLI_kdtree_nd_(insert)(KDTree *tree, int index, const float co[KD_DIMS])
 #endif
 }
 
+typedef struct KDTreeBalanceTask {
+  KDTreeNode *nodes;
+  uint nodes_len;
+  uint axis;
+  uint ofs;
+  uint *r_root;
+} KDTreeBalanceTask;
+
+static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs);
+
+static void kdtree_balance_task_fn(void *__restrict userdata,
+                                   const int i,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBalanceTask *task = &((const KDTreeBalanceTask *)userdata)[i];
+  *task->r_root = kdtree_balance(task->nodes, task->nodes_len, task->axis, task->ofs);
+}
+
 static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const uint ofs)
 {
   KDTreeNode *node;
@@ -194,9 +220,23 @@ static uint kdtree_balance(KDTreeNode *nodes, uint nodes_len, uint axis, const u
   node = &nodes[median];
   node->d = axis;
   axis = (axis + 1) % KD_DIMS;
-  node->left = kdtree_balance(nodes, median, axis, ofs);
-  node->right = kdtree_balance(
-      nodes + median + 1, (nodes_len - (median + 1)), axis, (median + 1) + ofs);
+
+  if (nodes_len >= KD_BALANCE_PARALLEL_MIN) {
+    /* Both halves are independent, the node itself is in neither of them. */
+    KDTreeBalanceTask tasks[2] = {
+        {nodes, median, axis, ofs, &node->left},
+        {nodes + median + 1, nodes_len - (median + 1), axis, (median + 1) + ofs, &node->right},
+    };
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1;
+    BLI_task_parallel_range(0, 2, tasks, kdtree_balance_task_fn, &settings);
+  }
+  else {
+    node->left = kdtree_balance(nodes, median, axis, ofs);
+    node->right = kdtree_balance(
+        nodes + median + 1, (nodes_len - (median + 1)), axis, (median + 1) + ofs);
+  }
 
   return median + ofs;
 }
@@ -806,6 +846,168 @@ finally:
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Batched Searches
+ *
+ * Answer many queries at once from multiple threads. Searches only use their stack, so this scales
+ * with the number of threads, results are the same as calling the single query functions.
+ * \{ */
+
+typedef struct KDTreeBatchData {
+  const KDTree *tree;
+  const float (*co)[KD_DIMS];
+
+  /* #BLI_kdtree_nd_(find_nearest_batch) */
+  int *r_index;
+
+  /* #BLI_kdtree_nd_(find_nearest_n_batch) */
+  KDTreeNearest *r_nearest;
+  uint nearest_len_capacity;
+  int *r_nearest_len;
+
+  /* #BLI_kdtree_nd_(range_search_batch_cb) */
+  float range;
+  bool (*search_cb)(
+      void *user_data, int co_index, int index, const float co[KD_DIMS], float dist_sq);
+  void *user_data;
+} KDTreeBatchData;
+
+static void kdtree_batch_settings(TaskParallelSettings *settings, const int co_len)
+{
+  BLI_parallel_range_settings_defaults(settings);
+  settings->use_threading = (co_len > KD_BATCH_GRAIN_SIZE);
+  settings->min_iter_per_thread = KD_BATCH_GRAIN_SIZE;
+}
+
+static void kdtree_find_nearest_batch_fn(void *__restrict userdata,
+                                         const int i,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchData *data = userdata;
+  const int index = BLI_kdtree_nd_(find_nearest)(
+      data->tree, data->co[i], data->r_nearest ? &data->r_nearest[i] : NULL);
+  if (data->r_index) {
+    data->r_index[i] = index;
+  }
+}
+
+/**
+ * #BLI_kdtree_3d_find_nearest for every coordinate in \a co.
+ *
+ * \param r_index: Optional, index of the nearest point or -1, for each coordinate.
+ * \param r_nearest: Optional, nearest point for each coordinate.
+ */
+void BLI_kdtree_nd_(find_nearest_batch)(const KDTree *tree,
+                                        const float (*co)[KD_DIMS],
+                                        const int co_len,
+                                        int *r_index,
+                                        KDTreeNearest *r_nearest)
+{
+  KDTreeBatchData data = {
+      .tree = tree,
+      .co = co,
+      .r_index = r_index,
+      .r_nearest = r_nearest,
+  };
+  TaskParallelSettings settings;
+  kdtree_batch_settings(&settings, co_len);
+  BLI_task_parallel_range(0, co_len, &data, kdtree_find_nearest_batch_fn, &settings);
+}
+
+static void kdtree_find_nearest_n_batch_fn(void *__restrict userdata,
+                                           const int i,
+                                           const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchData *data = userdata;
+  const int nearest_len = BLI_kdtree_nd_(find_nearest_n)(
+      data->tree,
+      data->co[i],
+      &data->r_nearest[(size_t)i * data->nearest_len_capacity],
+      data->nearest_len_capacity);
+  if (data->r_nearest_len) {
+    data->r_nearest_len[i] = nearest_len;
+  }
+}
+
+/**
+ * #BLI_kdtree_3d_find_nearest_n for every coordinate in \a co.
+ *
+ * \param r_nearest: Array of `co_len * nearest_len_capacity` items,
+ * the nearest points of `co[i]` start at `r_nearest[i * nearest_len_capacity]`.
+ * \param r_nearest_len: Optional, number of points found for each coordinate.
+ */
+void BLI_kdtree_nd_(find_nearest_n_batch)(const KDTree *tree,
+                                          const float (*co)[KD_DIMS],
+                                          const int co_len,
+                                          KDTreeNearest *r_nearest,
+                                          const uint nearest_len_capacity,
+                                          int *r_nearest_len)
+{
+  KDTreeBatchData data = {
+      .tree = tree,
+      .co = co,
+      .r_nearest = r_nearest,
+      .nearest_len_capacity = nearest_len_capacity,
+      .r_nearest_len = r_nearest_len,
+  };
+  TaskParallelSettings settings;
+  kdtree_batch_settings(&settings, co_len);
+  BLI_task_parallel_range(0, co_len, &data, kdtree_find_nearest_n_batch_fn, &settings);
+}
+
+typedef struct KDTreeRangeBatchQuery {
+  const KDTreeBatchData *data;
+  int co_index;
+} KDTreeRangeBatchQuery;
+
+static bool kdtree_range_search_batch_cb(void *user_data,
+                                         int index,
+                                         const float co[KD_DIMS],
+                                         float dist_sq)
+{
+  const KDTreeRangeBatchQuery *query = user_data;
+  return query->data->search_cb(query->data->user_data, query->co_index, index, co, dist_sq);
+}
+
+static void kdtree_range_search_batch_fn(void *__restrict userdata,
+                                         const int i,
+                                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const KDTreeBatchData *data = userdata;
+  KDTreeRangeBatchQuery query = {data, i};
+  BLI_kdtree_nd_(range_search_cb)(
+      data->tree, data->co[i], data->range, kdtree_range_search_batch_cb, &query);
+}
+
+/**
+ * #BLI_kdtree_3d_range_search_cb for every coordinate in \a co.
+ *
+ * \param search_cb: Called with the index of the coordinate in \a co for every point in range,
+ * from multiple threads. A false return value stops the search for that coordinate only.
+ */
+void BLI_kdtree_nd_(range_search_batch_cb)(
+    const KDTree *tree,
+    const float (*co)[KD_DIMS],
+    const int co_len,
+    const float range,
+    bool (*search_cb)(
+        void *user_data, int co_index, int index, const float co[KD_DIMS], float dist_sq),
+    void *user_data)
+{
+  KDTreeBatchData data = {
+      .tree = tree,
+      .co = co,
+      .range = range,
+      .search_cb = search_cb,
+      .user_data = user_data,
+  };
+  TaskParallelSettings settings;
+  kdtree_batch_settings(&settings, co_len);
+  BLI_task_parallel_range(0, co_len, &data, kdtree_range_search_batch_fn, &settings);
+}
+
+/** \} */
+
 /**
  * Use when we want to loop over nodes ordered by index.
  * Requires indices to be aligned with nodes.
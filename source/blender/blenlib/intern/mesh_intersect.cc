@@ -22,6 +22,7 @@
 #ifdef WITH_GMP
 
 #  include <algorithm>
+#  include <atomic>
 #  include <fstream>
 #  include <iostream>
 #  include <memory>
@@ -66,6 +67,22 @@ static void incperfcount(int countnum);
 static void bumpperfcount(int countnum, int amt);
 static void doperfmax(int maxnum, int val);
 static void dump_perfdata(void);
+
+/* Counts of filtered predicates and of those that needed exact arithmetic. These are kept apart
+ * from the other counts, since they are incremented from threads and from mesh_boolean.cc. */
+enum FilterStat {
+  FILTER_STAT_PLANE_SIDE = 0,
+  FILTER_STAT_PLANE_SIDE_EXACT,
+  FILTER_STAT_ORIENT3D,
+  FILTER_STAT_ORIENT3D_EXACT,
+  FILTER_STAT_TOT,
+};
+static std::atomic<int64_t> filter_stats[FILTER_STAT_TOT];
+
+static void filter_stats_inc(FilterStat stat)
+{
+  filter_stats[stat].fetch_add(1, std::memory_order_relaxed);
+}
 #  endif
 
 /** For debugging, can disable threading in intersect code with this static constant. */
@@ -1149,6 +1166,9 @@ static int filter_plane_side(const double3 &p,
                              const double3 &abs_plane_p,
                              const double3 &abs_plane_no)
 {
+#  ifdef PERFDEBUG
+  filter_stats_inc(FILTER_STAT_PLANE_SIDE);
+#  endif
   double d = double3::dot(p - plane_p, plane_no);
   if (d == 0.0) {
     return 0;
@@ -1161,6 +1181,39 @@ static int filter_plane_side(const double3 &p,
   return 0;
 }
 
+/**
+ * Index of #orient3d calculated with doubles, for input coordinates with index 1:
+ * the differences have index 2, the cross product coordinates 6 and the dot product 11.
+ */
+constexpr int index_orient3d = 11;
+
+int filtered_orient3d(const Vert *a, const Vert *b, const Vert *c, const Vert *d)
+{
+#  ifdef PERFDEBUG
+  filter_stats_inc(FILTER_STAT_ORIENT3D);
+#  endif
+  const double3 ad = a->co - d->co;
+  const double3 bd = b->co - d->co;
+  const double3 cd = c->co - d->co;
+  const double det = ad.z * (bd.x * cd.y - cd.x * bd.y) + bd.z * (cd.x * ad.y - ad.x * cd.y) +
+                     cd.z * (ad.x * bd.y - bd.x * ad.y);
+
+  const double3 sup_ad = double3::abs(a->co) + double3::abs(d->co);
+  const double3 sup_bd = double3::abs(b->co) + double3::abs(d->co);
+  const double3 sup_cd = double3::abs(c->co) + double3::abs(d->co);
+  const double supremum = sup_ad.z * (sup_bd.x * sup_cd.y + sup_cd.x * sup_bd.y) +
+                          sup_bd.z * (sup_cd.x * sup_ad.y + sup_ad.x * sup_cd.y) +
+                          sup_cd.z * (sup_ad.x * sup_bd.y + sup_bd.x * sup_ad.y);
+  const double err_bound = supremum * index_orient3d * DBL_EPSILON;
+  if (fabs(det) > err_bound) {
+    return det > 0 ? 1 : -1;
+  }
+#  ifdef PERFDEBUG
+  filter_stats_inc(FILTER_STAT_ORIENT3D_EXACT);
+#  endif
+  return orient3d(a->co_exact, b->co_exact, c->co_exact, d->co_exact);
+}
+
 /*
  * interesect_tri_tri and helper functions.
  * This code uses the algorithm of Guigue and Devillers, as described
@@ -1191,31 +1244,12 @@ static inline mpq3 tti_interp(
 }
 
 /**
- * Return +1, 0, -1 as a + ad is above, on, or below the oriented plane containing a, b, c in CCW
- * order. This is the same as -oriented(a, b, c, a + ad), but uses fewer arithmetic operations.
- * TODO: change arguments to `const Vert *` and use floating filters.
- * The ba, ca, n, and dotbuf arguments are used as temporaries; declaring them
- * in the caller can avoid many allocs and frees of mpq3 and mpq_class structures.
+ * Return +1, 0, -1 as d is above, on, or below the oriented plane containing a, b, c in CCW
+ * order. This is the same as `-orient3d(a, b, c, d)`, decided with doubles when possible.
  */
-static inline int tti_above(const mpq3 &a,
-                            const mpq3 &b,
-                            const mpq3 &c,
-                            const mpq3 &ad,
-                            mpq3 &ba,
-                            mpq3 &ca,
-                            mpq3 &n,
-                            mpq3 &dotbuf)
+static inline int tti_above(const Vert *a, const Vert *b, const Vert *c, const Vert *d)
 {
-  ba = b;
-  ba -= a;
-  ca = c;
-  ca -= a;
-
-  n.x = ba.y * ca.z - ba.z * ca.y;
-  n.y = ba.z * ca.x - ba.x * ca.z;
-  n.z = ba.x * ca.y - ba.y * ca.x;
-
-  return sgn(mpq3::dot_with_buffer(ad, n, dotbuf));
+  return -filtered_orient3d(a, b, c, d);
 }
 
 /**
@@ -1231,16 +1265,22 @@ static inline int tti_above(const mpq3 &a,
  *   of the plane and at least one of q1 and r1 are off the plane.
  * Similarly for p2, q2, r2 with respect to the first triangle's plane.
  */
-static ITT_value itt_canon2(const mpq3 &p1,
-                            const mpq3 &q1,
-                            const mpq3 &r1,
-                            const mpq3 &p2,
-                            const mpq3 &q2,
-                            const mpq3 &r2,
+static ITT_value itt_canon2(const Vert *vp1,
+                            const Vert *vq1,
+                            const Vert *vr1,
+                            const Vert *vp2,
+                            const Vert *vq2,
+                            const Vert *vr2,
                             const mpq3 &n1,
                             const mpq3 &n2)
 {
   constexpr int dbg_level = 0;
+  const mpq3 &p1 = vp1->co_exact;
+  const mpq3 &q1 = vq1->co_exact;
+  const mpq3 &r1 = vr1->co_exact;
+  const mpq3 &p2 = vp2->co_exact;
+  const mpq3 &q2 = vq2->co_exact;
+  const mpq3 &r2 = vr2->co_exact;
   if (dbg_level > 0) {
     std::cout << "\ntri_tri_intersect_canon:\n";
     std::cout << "p1=" << p1 << " q1=" << q1 << " r1=" << r1 << "\n";
@@ -1256,17 +1296,16 @@ static ITT_value itt_canon2(const mpq3 &p1,
     std::cout << "n1=(" << n1[0].get_d() << "," << n1[1].get_d() << "," << n1[2].get_d() << ")\n";
     std::cout << "n2=(" << n2[0].get_d() << "," << n2[1].get_d() << "," << n2[2].get_d() << ")\n";
   }
-  mpq3 p1p2 = p2 - p1;
   mpq3 intersect_1;
   mpq3 intersect_2;
-  mpq3 buf[4];
+  mpq3 buf[3];
   bool no_overlap = false;
   /* Top test in classification tree. */
-  if (tti_above(p1, q1, r2, p1p2, buf[0], buf[1], buf[2], buf[3]) > 0) {
+  if (tti_above(vp1, vq1, vr2, vp2) > 0) {
     /* Middle right test in classification tree. */
-    if (tti_above(p1, r1, r2, p1p2, buf[0], buf[1], buf[2], buf[3]) <= 0) {
+    if (tti_above(vp1, vr1, vr2, vp2) <= 0) {
       /* Bottom right test in classification tree. */
-      if (tti_above(p1, r1, q2, p1p2, buf[0], buf[1], buf[2], buf[3]) > 0) {
+      if (tti_above(vp1, vr1, vq2, vp2) > 0) {
         /* Overlap is [k [i l] j]. */
         if (dbg_level > 0) {
           std::cout << "overlap [k [i l] j]\n";
@@ -1295,7 +1334,7 @@ static ITT_value itt_canon2(const mpq3 &p1,
   }
   else {
     /* Middle left test in classification tree. */
-    if (tti_above(p1, q1, q2, p1p2, buf[0], buf[1], buf[2], buf[3]) < 0) {
+    if (tti_above(vp1, vq1, vq2, vp2) < 0) {
       /* No overlap: [i j] [k l]. */
       if (dbg_level > 0) {
         std::cout << "no overlap: [i j] [k l]\n";
@@ -1304,7 +1343,7 @@ static ITT_value itt_canon2(const mpq3 &p1,
     }
     else {
       /* Bottom left test in classification tree. */
-      if (tti_above(p1, r1, q2, p1p2, buf[0], buf[1], buf[2], buf[3]) >= 0) {
+      if (tti_above(vp1, vr1, vq2, vp2) >= 0) {
         /* Overlap is [k [i j] l]. */
         if (dbg_level > 0) {
           std::cout << "overlap [k [i j] l]\n";
@@ -1341,12 +1380,12 @@ static ITT_value itt_canon2(const mpq3 &p1,
 
 /* Helper function for intersect_tri_tri. Arguments have been canonicalized for triangle 1. */
 
-static ITT_value itt_canon1(const mpq3 &p1,
-                            const mpq3 &q1,
-                            const mpq3 &r1,
-                            const mpq3 &p2,
-                            const mpq3 &q2,
-                            const mpq3 &r2,
+static ITT_value itt_canon1(const Vert *p1,
+                            const Vert *q1,
+                            const Vert *r1,
+                            const Vert *p2,
+                            const Vert *q2,
+                            const Vert *r2,
                             const mpq3 &n1,
                             const mpq3 &n2,
                             int sp2,
@@ -1481,16 +1520,25 @@ static ITT_value intersect_tri_tri(const IMesh &tm, int t1, int t2)
 
   const mpq3 &n2 = tri2.plane->norm_exact;
   if (sp1 == 0) {
+#  ifdef PERFDEBUG
+    filter_stats_inc(FILTER_STAT_PLANE_SIDE_EXACT);
+#  endif
     buf[0] = p1;
     buf[0] -= r2;
     sp1 = sgn(mpq3::dot_with_buffer(buf[0], n2, buf[1]));
   }
   if (sq1 == 0) {
+#  ifdef PERFDEBUG
+    filter_stats_inc(FILTER_STAT_PLANE_SIDE_EXACT);
+#  endif
     buf[0] = q1;
     buf[0] -= r2;
     sq1 = sgn(mpq3::dot_with_buffer(buf[0], n2, buf[1]));
   }
   if (sr1 == 0) {
+#  ifdef PERFDEBUG
+    filter_stats_inc(FILTER_STAT_PLANE_SIDE_EXACT);
+#  endif
     buf[0] = r1;
     buf[0] -= r2;
     sr1 = sgn(mpq3::dot_with_buffer(buf[0], n2, buf[1]));
@@ -1513,16 +1561,25 @@ static ITT_value intersect_tri_tri(const IMesh &tm, int t1, int t2)
   /* Repeat for signs of t2's vertices with respect to plane of t1. */
   const mpq3 &n1 = tri1.plane->norm_exact;
   if (sp2 == 0) {
+#  ifdef PERFDEBUG
+    filter_stats_inc(FILTER_STAT_PLANE_SIDE_EXACT);
+#  endif
     buf[0] = p2;
     buf[0] -= r1;
     sp2 = sgn(mpq3::dot_with_buffer(buf[0], n1, buf[1]));
   }
   if (sq2 == 0) {
+#  ifdef PERFDEBUG
+    filter_stats_inc(FILTER_STAT_PLANE_SIDE_EXACT);
+#  endif
     buf[0] = q2;
     buf[0] -= r1;
     sq2 = sgn(mpq3::dot_with_buffer(buf[0], n1, buf[1]));
   }
   if (sr2 == 0) {
+#  ifdef PERFDEBUG
+    filter_stats_inc(FILTER_STAT_PLANE_SIDE_EXACT);
+#  endif
     buf[0] = r2;
     buf[0] -= r1;
     sr2 = sgn(mpq3::dot_with_buffer(buf[0], n1, buf[1]));
@@ -1548,49 +1605,49 @@ static ITT_value intersect_tri_tri(const IMesh &tm, int t1, int t2)
   ITT_value ans;
   if (sp1 > 0) {
     if (sq1 > 0) {
-      ans = itt_canon1(r1, p1, q1, p2, r2, q2, n1, n2, sp2, sr2, sq2);
+      ans = itt_canon1(vr1, vp1, vq1, vp2, vr2, vq2, n1, n2, sp2, sr2, sq2);
     }
     else if (sr1 > 0) {
-      ans = itt_canon1(q1, r1, p1, p2, r2, q2, n1, n2, sp2, sr2, sq2);
+      ans = itt_canon1(vq1, vr1, vp1, vp2, vr2, vq2, n1, n2, sp2, sr2, sq2);
     }
     else {
-      ans = itt_canon1(p1, q1, r1, p2, q2, r2, n1, n2, sp2, sq2, sr2);
+      ans = itt_canon1(vp1, vq1, vr1, vp2, vq2, vr2, n1, n2, sp2, sq2, sr2);
     }
   }
   else if (sp1 < 0) {
     if (sq1 < 0) {
-      ans = itt_canon1(r1, p1, q1, p2, q2, r2, n1, n2, sp2, sq2, sr2);
+      ans = itt_canon1(vr1, vp1, vq1, vp2, vq2, vr2, n1, n2, sp2, sq2, sr2);
     }
     else if (sr1 < 0) {
-      ans = itt_canon1(q1, r1, p1, p2, q2, r2, n1, n2, sp2, sq2, sr2);
+      ans = itt_canon1(vq1, vr1, vp1, vp2, vq2, vr2, n1, n2, sp2, sq2, sr2);
     }
     else {
-      ans = itt_canon1(p1, q1, r1, p2, r2, q2, n1, n2, sp2, sr2, sq2);
+      ans = itt_canon1(vp1, vq1, vr1, vp2, vr2, vq2, n1, n2, sp2, sr2, sq2);
     }
   }
   else {
     if (sq1 < 0) {
       if (sr1 >= 0) {
-        ans = itt_canon1(q1, r1, p1, p2, r2, q2, n1, n2, sp2, sr2, sq2);
+        ans = itt_canon1(vq1, vr1, vp1, vp2, vr2, vq2, n1, n2, sp2, sr2, sq2);
       }
       else {
-        ans = itt_canon1(p1, q1, r1, p2, q2, r2, n1, n2, sp2, sq2, sr2);
+        ans = itt_canon1(vp1, vq1, vr1, vp2, vq2, vr2, n1, n2, sp2, sq2, sr2);
       }
     }
     else if (sq1 > 0) {
       if (sr1 > 0) {
-        ans = itt_canon1(p1, q1, r1, p2, r2, q2, n1, n2, sp2, sr2, sq2);
+        ans = itt_canon1(vp1, vq1, vr1, vp2, vr2, vq2, n1, n2, sp2, sr2, sq2);
       }
       else {
-        ans = itt_canon1(q1, r1, p1, p2, q2, r2, n1, n2, sp2, sq2, sr2);
+        ans = itt_canon1(vq1, vr1, vp1, vp2, vq2, vr2, n1, n2, sp2, sq2, sr2);
       }
     }
     else {
       if (sr1 > 0) {
-        ans = itt_canon1(r1, p1, q1, p2, q2, r2, n1, n2, sp2, sq2, sr2);
+        ans = itt_canon1(vr1, vp1, vq1, vp2, vq2, vr2, n1, n2, sp2, sq2, sr2);
       }
       else if (sr1 < 0) {
-        ans = itt_canon1(r1, p1, q1, p2, r2, q2, n1, n2, sp2, sr2, sq2);
+        ans = itt_canon1(vr1, vp1, vq1, vp2, vr2, vq2, n1, n2, sp2, sr2, sq2);
       }
       else {
         if (dbg_level > 0) {
@@ -3273,9 +3330,27 @@ static void dump_perfdata(void)
     std::cout << perfdata->max_name[i] << " = " << perfdata->max[i] << "\n";
   }
   delete perfdata;
+  dump_filter_perfdata();
 }
 #  endif
 
+void dump_filter_perfdata()
+{
+#  ifdef PERFDEBUG
+  const char *names[] = {"plane side", "orient3d"};
+  std::cout << "\nFILTER PERFDATA\n";
+  for (int i = 0; i < FILTER_STAT_TOT; i += 2) {
+    const int64_t calls = filter_stats[i].exchange(0);
+    const int64_t exact = filter_stats[i + 1].exchange(0);
+    std::cout << names[i / 2] << ": " << calls << " filtered, " << exact << " exact";
+    if (calls != 0) {
+      std::cout << " (" << 100.0 * (double)exact / (double)calls << "% fallback)";
+    }
+    std::cout << "\n";
+  }
+#  endif
+}
+
 }  // namespace blender::meshintersect
 
 #endif  // WITH_GMP
@@ -0,0 +1,352 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * Small allocations of the #PoolAllocator are served from per-thread free lists, one for every
+ * power of two size class. Larger allocations are passed on to the guarded allocator.
+ *
+ * Blocks don't have a header. They are cut from slabs that are aligned to their size, so the slab
+ * of a block is found by masking its address. The slab header stores the size class and the
+ * thread cache that owns the slab. A page map registers the address range of all slabs, to tell
+ * pool blocks apart from guarded allocations in #PoolAllocator::deallocate.
+ *
+ * A block freed by another thread than the owner of its slab is pushed onto a lock-free list of
+ * the owning thread cache, which the owner takes over once its own free list is empty. Thread
+ * caches of exited threads that took slabs are kept and reused by new threads, so blocks can
+ * outlive the thread that allocated them.
+ *
+ * Slabs and thread caches are allocated from the system, slabs are never freed. That memory is
+ * not counted by the guarded allocator, see #pool_allocator::reserved_memory_get.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_allocator.hh"
+#include "BLI_assert.h"
+#include "BLI_math_bits.h"
+#include "BLI_utildefines.h"
+
+namespace blender::pool_allocator {
+
+/* -------------------------------------------------------------------- */
+/** \name Slabs and Page Map
+ * \{ */
+
+constexpr int SIZE_CLASS_MIN_SHIFT = 4;
+constexpr int SIZE_CLASS_NUM = 9;
+/** Largest block served from the pool (4 KiB). */
+constexpr size_t BLOCK_SIZE_MAX = size_t(1) << (SIZE_CLASS_MIN_SHIFT + SIZE_CLASS_NUM - 1);
+
+constexpr int SLAB_SHIFT = 16;
+constexpr size_t SLAB_SIZE = size_t(1) << SLAB_SHIFT;
+constexpr int SLABS_PER_REGION = 16;
+
+/* Two level page map with one byte per slab. Covers 48 bit addresses, which is all that common
+ * 64 bit platforms hand out to user space. Memory outside of that range is not used for slabs. */
+constexpr int PAGE_MAP_LEAF_SHIFT = 16;
+constexpr uintptr_t PAGE_MAP_LEAF_SIZE = uintptr_t(1) << PAGE_MAP_LEAF_SHIFT;
+constexpr uintptr_t PAGE_MAP_ROOT_SIZE = uintptr_t(1)
+                                         << (48 - SLAB_SHIFT - PAGE_MAP_LEAF_SHIFT);
+
+struct ThreadCache;
+
+struct FreeBlock {
+  FreeBlock *next;
+};
+
+struct SlabHeader {
+  ThreadCache *owner;
+  int size_class;
+};
+
+struct SizeClassCache {
+  /** Blocks freed by the owning thread. Only accessed by the owning thread. */
+  FreeBlock *free_list = nullptr;
+  /** Blocks freed by other threads. */
+  std::atomic<FreeBlock *> remote_free_list{nullptr};
+  /** Unused part of the slab that was taken last. */
+  char *slab_unused_begin = nullptr;
+  char *slab_unused_end = nullptr;
+};
+
+struct ThreadCache {
+  SizeClassCache size_classes[SIZE_CLASS_NUM];
+  /** Number of slabs taken by the cache, their headers point to it. */
+  int slabs_num = 0;
+  /** Next cache of an exited thread, waiting to be reused. */
+  ThreadCache *next_orphan = nullptr;
+};
+
+static std::atomic<uint8_t *> page_map[PAGE_MAP_ROOT_SIZE];
+
+/** Protects the slab and orphan lists below. */
+static std::mutex global_mutex;
+static char *free_slabs = nullptr;
+static ThreadCache *orphan_caches = nullptr;
+static std::atomic<size_t> reserved_memory{0};
+
+static int size_class_from_size(const size_t size)
+{
+  if (size <= (size_t(1) << SIZE_CLASS_MIN_SHIFT)) {
+    return 0;
+  }
+  /* Round up to the next power of two. */
+  const int shift = 32 - int(bitscan_reverse_uint(uint(size - 1)));
+  return shift - SIZE_CLASS_MIN_SHIFT;
+}
+
+static size_t size_class_block_size(const int size_class)
+{
+  return size_t(1) << (size_class + SIZE_CLASS_MIN_SHIFT);
+}
+
+/** Find the slab of a block, null if the pointer does not belong to a slab. */
+static SlabHeader *slab_from_ptr(const void *ptr)
+{
+  const uintptr_t slab_index = uintptr_t(ptr) >> SLAB_SHIFT;
+  const uintptr_t root_index = slab_index >> PAGE_MAP_LEAF_SHIFT;
+  if (root_index >= PAGE_MAP_ROOT_SIZE) {
+    return nullptr;
+  }
+  const uint8_t *leaf = page_map[root_index].load(std::memory_order_acquire);
+  if (leaf == nullptr || leaf[slab_index & (PAGE_MAP_LEAF_SIZE - 1)] == 0) {
+    return nullptr;
+  }
+  return reinterpret_cast<SlabHeader *>(slab_index << SLAB_SHIFT);
+}
+
+/** Expects #global_mutex to be locked. */
+static bool page_map_register_slab(const char *slab)
+{
+  const uintptr_t slab_index = uintptr_t(slab) >> SLAB_SHIFT;
+  const uintptr_t root_index = slab_index >> PAGE_MAP_LEAF_SHIFT;
+  if (root_index >= PAGE_MAP_ROOT_SIZE) {
+    return false;
+  }
+  uint8_t *leaf = page_map[root_index].load(std::memory_order_relaxed);
+  if (leaf == nullptr) {
+    leaf = static_cast<uint8_t *>(calloc(PAGE_MAP_LEAF_SIZE, sizeof(uint8_t)));
+    if (leaf == nullptr) {
+      return false;
+    }
+    reserved_memory += PAGE_MAP_LEAF_SIZE;
+    page_map[root_index].store(leaf, std::memory_order_release);
+  }
+  leaf[slab_index & (PAGE_MAP_LEAF_SIZE - 1)] = 1;
+  return true;
+}
+
+/** Expects #global_mutex to be locked. */
+static void region_add(void)
+{
+  /* One slab more, for the alignment. */
+  char *region = static_cast<char *>(malloc(SLAB_SIZE * (SLABS_PER_REGION + 1)));
+  if (region == nullptr) {
+    return;
+  }
+  reserved_memory += SLAB_SIZE * (SLABS_PER_REGION + 1);
+
+  char *slab = reinterpret_cast<char *>((uintptr_t(region) + SLAB_SIZE - 1) & ~(SLAB_SIZE - 1));
+  for (int i = 0; i < SLABS_PER_REGION; i++, slab += SLAB_SIZE) {
+    if (!page_map_register_slab(slab)) {
+      /* The remaining slabs are not usable, leave them unused. */
+      return;
+    }
+    *reinterpret_cast<char **>(slab) = free_slabs;
+    free_slabs = slab;
+  }
+}
+
+/** Null when no memory is available for the pool. */
+static char *slab_take(void)
+{
+  std::lock_guard<std::mutex> lock{global_mutex};
+  if (free_slabs == nullptr) {
+    region_add();
+    if (free_slabs == nullptr) {
+      return nullptr;
+    }
+  }
+  char *slab = free_slabs;
+  free_slabs = *reinterpret_cast<char **>(slab);
+  return slab;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Thread Caches
+ * \{ */
+
+static void thread_cache_free(ThreadCache *cache)
+{
+  reserved_memory -= sizeof(ThreadCache);
+  cache->~ThreadCache();
+  free(cache);
+}
+
+/** Hands the cache over to the next thread when the thread exits. */
+struct ThreadCacheHandle {
+  ThreadCache *cache = nullptr;
+
+  ~ThreadCacheHandle()
+  {
+    if (cache == nullptr) {
+      return;
+    }
+    if (cache->slabs_num == 0) {
+      /* No block refers to the cache. */
+      thread_cache_free(cache);
+    }
+    else {
+      std::lock_guard<std::mutex> lock{global_mutex};
+      cache->next_orphan = orphan_caches;
+      orphan_caches = cache;
+    }
+    /* Blocks freed after this point are passed to the cache like from any other thread. */
+    cache = nullptr;
+  }
+};
+
+static thread_local ThreadCacheHandle thread_cache_handle;
+
+static ThreadCache *thread_cache_create(void)
+{
+  {
+    std::lock_guard<std::mutex> lock{global_mutex};
+    if (orphan_caches) {
+      ThreadCache *cache = orphan_caches;
+      orphan_caches = cache->next_orphan;
+      cache->next_orphan = nullptr;
+      return cache;
+    }
+  }
+  /* Allocated from the system like the slabs, the cache outlives the thread as long as blocks of
+   * its slabs may be freed. Not using `new`, which is guarded with `WITH_CXX_GUARDEDALLOC`. */
+  void *cache = calloc(1, sizeof(ThreadCache));
+  if (cache == nullptr) {
+    return nullptr;
+  }
+  reserved_memory += sizeof(ThreadCache);
+  return new (cache) ThreadCache();
+}
+
+/** Null when no memory is available for the cache. */
+static ThreadCache *thread_cache_get(void)
+{
+  if (UNLIKELY(thread_cache_handle.cache == nullptr)) {
+    thread_cache_handle.cache = thread_cache_create();
+  }
+  return thread_cache_handle.cache;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Allocation
+ * \{ */
+
+static void *size_class_allocate(ThreadCache &cache, const int size_class)
+{
+  SizeClassCache &size_class_cache = cache.size_classes[size_class];
+
+  if (size_class_cache.free_list == nullptr &&
+      size_class_cache.remote_free_list.load(std::memory_order_relaxed) != nullptr) {
+    size_class_cache.free_list = size_class_cache.remote_free_list.exchange(
+        nullptr, std::memory_order_acquire);
+  }
+  if (size_class_cache.free_list) {
+    FreeBlock *block = size_class_cache.free_list;
+    size_class_cache.free_list = block->next;
+    return block;
+  }
+
+  const size_t block_size = size_class_block_size(size_class);
+  if (size_class_cache.slab_unused_begin == size_class_cache.slab_unused_end) {
+    char *slab = slab_take();
+    if (slab == nullptr) {
+      return nullptr;
+    }
+    cache.slabs_num++;
+    SlabHeader *header = reinterpret_cast<SlabHeader *>(slab);
+    header->owner = &cache;
+    header->size_class = size_class;
+    /* The header takes the space of the first blocks, so all blocks stay aligned to their size. */
+    size_class_cache.slab_unused_begin = slab + std::max(block_size, sizeof(SlabHeader));
+    size_class_cache.slab_unused_end = slab + SLAB_SIZE;
+  }
+  void *block = size_class_cache.slab_unused_begin;
+  size_class_cache.slab_unused_begin += block_size;
+  return block;
+}
+
+void *allocate(const size_t size, const size_t alignment, const char *name)
+{
+  BLI_assert(is_power_of_2_i(static_cast<int>(alignment)));
+  /* Blocks are aligned to their size. */
+  const size_t block_size = std::max(size, alignment);
+  if (block_size <= BLOCK_SIZE_MAX) {
+    ThreadCache *cache = thread_cache_get();
+    if (LIKELY(cache)) {
+      void *block = size_class_allocate(*cache, size_class_from_size(block_size));
+      if (LIKELY(block)) {
+        return block;
+      }
+    }
+  }
+  return MEM_mallocN_aligned(size, alignment, name);
+}
+
+void deallocate(void *ptr)
+{
+  SlabHeader *slab = slab_from_ptr(ptr);
+  if (slab == nullptr) {
+    MEM_freeN(ptr);
+    return;
+  }
+
+  FreeBlock *block = static_cast<FreeBlock *>(ptr);
+  SizeClassCache &size_class_cache = slab->owner->size_classes[slab->size_class];
+  if (slab->owner == thread_cache_handle.cache) {
+    block->next = size_class_cache.free_list;
+    size_class_cache.free_list = block;
+    return;
+  }
+
+  block->next = size_class_cache.remote_free_list.load(std::memory_order_relaxed);
+  while (!size_class_cache.remote_free_list.compare_exchange_weak(
+      block->next, block, std::memory_order_release, std::memory_order_relaxed)) {
+    /* Pass. */
+  }
+}
+
+size_t reserved_memory_get()
+{
+  return reserved_memory;
+}
+
+/** \} */
+
+}  // namespace blender::pool_allocator
+
@@ -33,6 +33,8 @@
 #include "BLI_task.h"
 #include "BLI_threads.h"
 
+#include "BLI_task_private.hh"
+
 #ifdef WITH_TBB
 #  include <tbb/blocked_range.h>
 #  include <tbb/task_arena.h>
@@ -162,6 +164,13 @@ struct TaskPool {
 #ifdef WITH_TBB
   /* TBB task pool. */
   TBBTaskGroup tbb_group;
+  /* Arena to run the tasks in, null for the default arena. */
+  tbb::task_arena *tbb_arena;
+  /* Tasks pushed into #tbb_arena and not finished yet. */
+  int tbb_arena_tasks_num;
+  ThreadMutex tbb_arena_mutex;
+  ThreadCondition tbb_arena_cond;
+  volatile bool tbb_arena_is_canceling;
 #endif
   volatile bool is_suspended;
   BLI_mempool *suspended_mempool;
@@ -186,6 +195,68 @@ void Task::operator()() const
  * Tasks may be suspended until in all are created, to make it possible to
  * initialize data structures and create tasks in a single pass. */
 
+#ifdef WITH_TBB
+/* Tasks in a separate arena.
+ *
+ * Entering an arena blocks while all its slots are taken, which for the background arena means
+ * until a long running task finishes. So tasks are enqueued into the arena without entering it,
+ * and waiting is done on a counter of unfinished tasks. Only tasks pushed from within the arena
+ * use the task group, so that waiting for them can run them. */
+
+/* Arena of the task the thread is running, null outside of a task in a separate arena. */
+static thread_local tbb::task_arena *tbb_arena_current = nullptr;
+
+static void tbb_arena_task_run(TaskPool *pool, Task *task)
+{
+  if (!pool->tbb_arena_is_canceling) {
+    tbb::task_arena *arena_prev = tbb_arena_current;
+    tbb_arena_current = pool->tbb_arena;
+    (*task)();
+    tbb_arena_current = arena_prev;
+  }
+  task->~Task();
+  MEM_freeN(task);
+
+  /* The pool may be freed as soon as the mutex is unlocked. */
+  BLI_mutex_lock(&pool->tbb_arena_mutex);
+  if (--pool->tbb_arena_tasks_num == 0) {
+    BLI_condition_notify_all(&pool->tbb_arena_cond);
+  }
+  BLI_mutex_unlock(&pool->tbb_arena_mutex);
+}
+
+static void tbb_arena_task_pool_run(TaskPool *pool, Task &&task)
+{
+  Task *task_mem = (Task *)MEM_mallocN(sizeof(Task), __func__);
+  new (task_mem) Task(std::move(task));
+
+  BLI_mutex_lock(&pool->tbb_arena_mutex);
+  pool->tbb_arena_tasks_num++;
+  BLI_mutex_unlock(&pool->tbb_arena_mutex);
+
+  if (tbb_arena_current == pool->tbb_arena) {
+    pool->tbb_group.run([pool, task_mem]() { tbb_arena_task_run(pool, task_mem); });
+  }
+  else {
+    pool->tbb_arena->enqueue([pool, task_mem]() { tbb_arena_task_run(pool, task_mem); });
+  }
+}
+
+static void tbb_arena_task_pool_wait(TaskPool *pool)
+{
+  if (tbb_arena_current == pool->tbb_arena) {
+    /* Run nested tasks while waiting, all other threads of the arena may be waiting too. */
+    pool->tbb_group.wait();
+  }
+
+  BLI_mutex_lock(&pool->tbb_arena_mutex);
+  while (pool->tbb_arena_tasks_num > 0) {
+    BLI_condition_wait(&pool->tbb_arena_cond, &pool->tbb_arena_mutex);
+  }
+  BLI_mutex_unlock(&pool->tbb_arena_mutex);
+}
+#endif
+
 static void tbb_task_pool_create(TaskPool *pool, TaskPriority priority)
 {
   if (pool->type == TASK_POOL_TBB_SUSPENDED) {
@@ -197,6 +268,10 @@ static void tbb_task_pool_create(TaskPool *pool, TaskPriority priority)
   if (pool->use_threads) {
     new (&pool->tbb_group) TBBTaskGroup(priority);
   }
+  if (pool->tbb_arena) {
+    BLI_mutex_init(&pool->tbb_arena_mutex);
+    BLI_condition_init(&pool->tbb_arena_cond);
+  }
 #else
   UNUSED_VARS(priority);
 #endif
@@ -217,6 +292,10 @@ static void tbb_task_pool_run(TaskPool *pool, Task &&task)
 #endif
   }
 #ifdef WITH_TBB
+  else if (pool->tbb_arena) {
+    /* Execute in separate arena, without blocking. */
+    tbb_arena_task_pool_run(pool, std::move(task));
+  }
   else if (pool->use_threads) {
     /* Execute in TBB task group. */
     pool->tbb_group.run(std::move(task));
@@ -244,7 +323,10 @@ static void tbb_task_pool_work_and_wait(TaskPool *pool)
   }
 
 #ifdef WITH_TBB
-  if (pool->use_threads) {
+  if (pool->tbb_arena) {
+    tbb_arena_task_pool_wait(pool);
+  }
+  else if (pool->use_threads) {
     /* This is called wait(), but internally it can actually do work. This
      * matters because we don't want recursive usage of task pools to run
      * out of threads and get stuck. */
@@ -256,7 +338,13 @@ static void tbb_task_pool_work_and_wait(TaskPool *pool)
 static void tbb_task_pool_cancel(TaskPool *pool)
 {
 #ifdef WITH_TBB
-  if (pool->use_threads) {
+  if (pool->tbb_arena) {
+    /* Tasks not started yet are skipped, running tasks can check for cancellation. */
+    pool->tbb_arena_is_canceling = true;
+    tbb_arena_task_pool_wait(pool);
+    pool->tbb_arena_is_canceling = false;
+  }
+  else if (pool->use_threads) {
     pool->tbb_group.cancel();
     pool->tbb_group.wait();
   }
@@ -268,6 +356,9 @@ static void tbb_task_pool_cancel(TaskPool *pool)
 static bool tbb_task_pool_canceled(TaskPool *pool)
 {
 #ifdef WITH_TBB
+  if (pool->tbb_arena) {
+    return pool->tbb_arena_is_canceling;
+  }
   if (pool->use_threads) {
     return tbb::is_current_task_group_canceling();
   }
@@ -281,6 +372,12 @@ static bool tbb_task_pool_canceled(TaskPool *pool)
 static void tbb_task_pool_free(TaskPool *pool)
 {
 #ifdef WITH_TBB
+  if (pool->tbb_arena) {
+    /* Enqueued tasks still use the pool. */
+    tbb_arena_task_pool_wait(pool);
+    BLI_condition_end(&pool->tbb_arena_cond);
+    BLI_mutex_end(&pool->tbb_arena_mutex);
+  }
   if (pool->use_threads) {
     pool->tbb_group.~TBBTaskGroup();
   }
@@ -367,16 +464,20 @@ static TaskPool *task_pool_create_ex(void *userdata, TaskPoolType type, TaskPrio
 {
   const bool use_threads = BLI_task_scheduler_num_threads() > 1 && type != TASK_POOL_NO_THREADS;
 
-  /* Background task pool uses regular TBB scheduling if available. Only when
-   * building without TBB or running with -t 1 do we need to ensure these tasks
-   * do not block the main thread. */
+  /* Allocate task pool. */
+  TaskPool *pool = (TaskPool *)MEM_callocN(sizeof(TaskPool), "TaskPool");
+
+  /* Background task pool uses regular TBB scheduling if available, in an arena
+   * with fewer threads when background work is limited. Only when building
+   * without TBB or running with -t 1 do we need to ensure these tasks do not
+   * block the main thread. */
   if (type == TASK_POOL_BACKGROUND && use_threads) {
     type = TASK_POOL_TBB;
+#ifdef WITH_TBB
+    pool->tbb_arena = task_scheduler_background_arena();
+#endif
   }
 
-  /* Allocate task pool. */
-  TaskPool *pool = (TaskPool *)MEM_callocN(sizeof(TaskPool), "TaskPool");
-
   pool->type = type;
   pool->use_threads = use_threads;
 
@@ -23,24 +23,120 @@
 #include "MEM_guardedalloc.h"
 
 #include "BLI_task.h"
+#include "BLI_task.hh"
 #include "BLI_threads.h"
 
+#include "BLI_task_private.hh"
+
+#include "numaapi.h"
+
 #ifdef WITH_TBB
 /* Need to include at least one header to get the version define. */
 #  include <tbb/blocked_range.h>
 #  include <tbb/task_arena.h>
+#  include <tbb/task_group.h>
 #  if TBB_INTERFACE_VERSION_MAJOR >= 10
 #    include <tbb/global_control.h>
 #    define WITH_TBB_GLOBAL_CONTROL
 #  endif
+#  if TBB_INTERFACE_VERSION_MAJOR >= 11
+#    include <tbb/task_scheduler_observer.h>
+#    define WITH_TBB_NUMA_ARENAS
+#  endif
+#endif
+
+/* NUMA Task Arenas
+ *
+ * On systems with multiple NUMA nodes there is a task arena per node. Threads are pinned to the
+ * node while they work in its arena, so memory they allocate and first touch is local to the node.
+ * Threads are unpinned again when they leave the arena, to run tasks of other arenas anywhere. */
+
+#ifdef WITH_TBB_NUMA_ARENAS
+/* Node of the arena the thread is working in, -1 when not in a NUMA node arena. */
+static thread_local int numa_thread_node = -1;
+
+class NumaNodeObserver : public tbb::task_scheduler_observer {
+ private:
+  int node_;
+
+ public:
+  NumaNodeObserver(tbb::task_arena &arena, int node)
+      : tbb::task_scheduler_observer(arena), node_(node)
+  {
+    observe(true);
+  }
+
+  void on_scheduler_entry(bool UNUSED(is_worker)) override
+  {
+    numaAPI_RunThreadOnNode(node_);
+    numa_thread_node = node_;
+  }
+
+  void on_scheduler_exit(bool UNUSED(is_worker)) override
+  {
+    numa_thread_node = -1;
+    numaAPI_RunThreadOnAllNodes();
+  }
+};
+
+struct NumaNodeArena {
+  tbb::task_arena arena;
+  NumaNodeObserver observer;
+
+  NumaNodeArena(int node, int num_processors) : arena(num_processors), observer(arena, node)
+  {
+  }
+};
+
+static NumaNodeArena **numa_node_arenas = nullptr;
+static int numa_node_arenas_num = 0;
+
+static void numa_node_arenas_init(void)
+{
+  if (numaAPI_Initialize() != NUMAAPI_SUCCESS) {
+    return;
+  }
+  const int num_nodes = numaAPI_GetNumNodes();
+  int num_available_nodes = 0;
+  for (int node = 0; node < num_nodes; node++) {
+    if (numaAPI_IsNodeAvailable(node)) {
+      num_available_nodes++;
+    }
+  }
+  if (num_available_nodes < 2) {
+    return;
+  }
+
+  numa_node_arenas = (NumaNodeArena **)MEM_malloc_arrayN(
+      num_available_nodes, sizeof(NumaNodeArena *), __func__);
+  for (int node = 0; node < num_nodes; node++) {
+    if (numaAPI_IsNodeAvailable(node)) {
+      numa_node_arenas[numa_node_arenas_num++] = OBJECT_GUARDED_NEW(
+          NumaNodeArena, node, numaAPI_GetNumNodeProcessors(node));
+    }
+  }
+}
+
+static void numa_node_arenas_exit(void)
+{
+  for (int i = 0; i < numa_node_arenas_num; i++) {
+    OBJECT_GUARDED_DELETE(numa_node_arenas[i], NumaNodeArena);
+  }
+  MEM_SAFE_FREE(numa_node_arenas);
+  numa_node_arenas_num = 0;
+}
 #endif
 
 /* Task Scheduler */
 
 static int task_scheduler_num_threads = 1;
+static int task_scheduler_background_threads = 0;
 #ifdef WITH_TBB_GLOBAL_CONTROL
 static tbb::global_control *task_scheduler_global_control = nullptr;
 #endif
+#ifdef WITH_TBB
+static tbb::task_arena *task_scheduler_background_task_arena = nullptr;
+#endif
 
 void BLI_task_scheduler_init()
 {
@@ -64,10 +160,40 @@ void BLI_task_scheduler_init()
 #else
   task_scheduler_num_threads = BLI_system_thread_count();
 #endif
+
+#ifdef WITH_TBB_NUMA_ARENAS
+  /* With a lower number of threads than processors, the threads can't be spread over the nodes
+   * in a useful way. */
+  if (num_threads_override == 0) {
+    numa_node_arenas_init();
+  }
+#endif
+
+#ifdef WITH_TBB
+  if (task_scheduler_background_threads > 0 &&
+      task_scheduler_background_threads < task_scheduler_num_threads) {
+    /* No slots are reserved for master threads, so the tasks run even when no thread waits for
+     * the pool. Task pools only enqueue tasks into the arena and never enter it from outside,
+     * since that would block until a slot is free. */
+#  if TBB_INTERFACE_VERSION_MAJOR >= 12
+    task_scheduler_background_task_arena = OBJECT_GUARDED_NEW(
+        tbb::task_arena, task_scheduler_background_threads, 0, tbb::task_arena::priority::low);
+#  else
+    task_scheduler_background_task_arena = OBJECT_GUARDED_NEW(
+        tbb::task_arena, task_scheduler_background_threads, 0);
+#  endif
+  }
+#endif
 }
 
 void BLI_task_scheduler_exit()
 {
+#ifdef WITH_TBB
+  OBJECT_GUARDED_SAFE_DELETE(task_scheduler_background_task_arena, tbb::task_arena);
+#endif
+#ifdef WITH_TBB_NUMA_ARENAS
+  numa_node_arenas_exit();
+#endif
 #ifdef WITH_TBB_GLOBAL_CONTROL
   OBJECT_GUARDED_DELETE(task_scheduler_global_control, tbb::global_control);
 #endif
@@ -78,6 +204,23 @@ int BLI_task_scheduler_num_threads()
   return task_scheduler_num_threads;
 }
 
+void BLI_task_scheduler_background_threads_set(int num_threads)
+{
+  task_scheduler_background_threads = num_threads;
+}
+
+int BLI_task_scheduler_background_threads_get()
+{
+  return task_scheduler_background_threads;
+}
+
+#ifdef WITH_TBB
+tbb::task_arena *task_scheduler_background_arena()
+{
+  return task_scheduler_background_task_arena;
+}
+#endif
+
 void BLI_task_isolate(void (*func)(void *userdata), void *userdata)
 {
 #ifdef WITH_TBB
@@ -86,3 +229,36 @@ void BLI_task_isolate(void (*func)(void *userdata), void *userdata)
   func(userdata);
 #endif
 }
+
+namespace blender::threading::detail {
+
+void parallel_for_numa_impl(IndexRange range, FunctionRef<void(IndexRange)> function)
+{
+#ifdef WITH_TBB_NUMA_ARENAS
+  /* Nested loops stay in the node of the outer loop. */
+  if (numa_node_arenas_num < 2 || numa_thread_node != -1 || range.size() < numa_node_arenas_num) {
+    function(range);
+    return;
+  }
+
+  /* Tasks have to be spawned and waited for from within the arena. */
+  tbb::task_group *groups = new tbb::task_group[numa_node_arenas_num];
+  for (int i = 0; i < numa_node_arenas_num; i++) {
+    const int64_t begin = range.size() * i / numa_node_arenas_num;
+    const int64_t end = range.size() * (i + 1) / numa_node_arenas_num;
+    const IndexRange node_range = range.slice(begin, end - begin);
+    tbb::task_group &group = groups[i];
+    numa_node_arenas[i]->arena.execute(
+        [&]() { group.run([&function, node_range]() { function(node_range); }); });
+  }
+  for (int i = 0; i < numa_node_arenas_num; i++) {
+    tbb::task_group &group = groups[i];
+    numa_node_arenas[i]->arena.execute([&]() { group.wait(); });
+  }
+  delete[] groups;
+#else
+  function(range);
+#endif
+}
+
+}  // namespace blender::threading::detail
@@ -2,7 +2,11 @@
 
 #include "testing/testing.h"
 
-/* TODO: ray intersection, overlap ... etc. */
+/* TODO: ray intersection ... etc. */
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
 
 #include "MEM_guardedalloc.h"
 
@@ -10,6 +14,7 @@
 #include "BLI_kdopbvh.h"
 #include "BLI_math_vector.h"
 #include "BLI_rand.h"
+#include "BLI_task.h"
 
 /* -------------------------------------------------------------------- */
 /* Helper Functions */
@@ -132,3 +137,181 @@ TEST(kdopbvh, OptimalFindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12, true);
 }
+
+/* -------------------------------------------------------------------- */
+/* Overlap */
+
+/* Large enough for the overlap to be split into tasks. */
+#define OVERLAP_SEGMENTS_LEN 5000
+
+static BVHTree *segments_tree_new(int segments_len, int random_seed)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  BVHTree *tree = BLI_bvhtree_new(segments_len, 0.0f, 4, 26);
+
+  for (int i = 0; i < segments_len; i++) {
+    float co[2][3];
+    rng_v3_round(co[0], 3, rng, 1000, 10.0f);
+    rng_v3_round(co[1], 3, rng, 1000, 1.0f);
+    add_v3_v3(co[1], co[0]);
+    BLI_bvhtree_insert(tree, i, co[0], 2);
+  }
+  BLI_bvhtree_balance(tree);
+  BLI_rng_free(rng);
+  return tree;
+}
+
+struct OverlapThreadData {
+  int thread_num;
+  std::vector<std::atomic<bool>> thread_busy;
+  std::atomic<bool> is_valid;
+};
+
+static bool overlap_thread_check_cb(void *userdata, int index_a, int index_b, int thread)
+{
+  OverlapThreadData *data = (OverlapThreadData *)userdata;
+  if (thread < 0 || thread >= data->thread_num) {
+    data->is_valid = false;
+    return true;
+  }
+  /* No other running task may use the same thread. */
+  if (data->thread_busy[thread].exchange(true)) {
+    data->is_valid = false;
+  }
+  data->thread_busy[thread] = false;
+  return (index_a + index_b) % 3 != 0;
+}
+
+static std::vector<std::pair<int, int>> overlap_sorted(const BVHTree *tree1,
+                                                       const BVHTree *tree2,
+                                                       BVHTree_OverlapCallback callback,
+                                                       void *userdata,
+                                                       int flag)
+{
+  uint overlap_len = 0;
+  BVHTreeOverlap *overlap = BLI_bvhtree_overlap_ex(
+      tree1, tree2, &overlap_len, callback, userdata, 0, flag | BVH_OVERLAP_RETURN_PAIRS);
+
+  std::vector<std::pair<int, int>> result;
+  for (uint i = 0; i < overlap_len; i++) {
+    result.emplace_back(overlap[i].indexA, overlap[i].indexB);
+  }
+  std::sort(result.begin(), result.end());
+  if (overlap) {
+    MEM_freeN(overlap);
+  }
+  return result;
+}
+
+static void overlap_threaded_test(const BVHTree *tree1, const BVHTree *tree2)
+{
+  OverlapThreadData data;
+  data.thread_num = BLI_bvhtree_overlap_thread_num(tree1);
+  data.thread_busy = std::vector<std::atomic<bool>>(data.thread_num);
+  data.is_valid = true;
+
+  for (BVHTree_OverlapCallback callback : {(BVHTree_OverlapCallback) nullptr,
+                                           (BVHTree_OverlapCallback)overlap_thread_check_cb}) {
+    const std::vector<std::pair<int, int>> expected = overlap_sorted(
+        tree1, tree2, callback, &data, 0);
+    const std::vector<std::pair<int, int>> result = overlap_sorted(
+        tree1, tree2, callback, &data, BVH_OVERLAP_USE_THREADING);
+    EXPECT_FALSE(expected.empty());
+    EXPECT_EQ(result, expected);
+  }
+  EXPECT_TRUE(data.is_valid);
+}
+
+TEST(kdopbvh, OverlapThreaded)
+{
+  BVHTree *tree1 = segments_tree_new(OVERLAP_SEGMENTS_LEN, 1);
+  BVHTree *tree2 = segments_tree_new(OVERLAP_SEGMENTS_LEN, 2);
+  overlap_threaded_test(tree1, tree2);
+  BLI_bvhtree_free(tree1);
+  BLI_bvhtree_free(tree2);
+}
+
+TEST(kdopbvh, OverlapThreadedSelf)
+{
+  BVHTree *tree = segments_tree_new(OVERLAP_SEGMENTS_LEN, 3);
+  overlap_threaded_test(tree, tree);
+  BLI_bvhtree_free(tree);
+}
+
+static std::vector<std::pair<int, int>> overlap_unsorted(const BVHTree *tree1,
+                                                         const BVHTree *tree2,
+                                                         BVHTree_OverlapCallback callback,
+                                                         void *userdata)
+{
+  uint overlap_len = 0;
+  BVHTreeOverlap *overlap = BLI_bvhtree_overlap(tree1, tree2, &overlap_len, callback, userdata);
+
+  std::vector<std::pair<int, int>> result;
+  for (uint i = 0; i < overlap_len; i++) {
+    result.emplace_back(overlap[i].indexA, overlap[i].indexB);
+  }
+  if (overlap) {
+    MEM_freeN(overlap);
+  }
+  return result;
+}
+
+TEST(kdopbvh, OverlapThreadedOrder)
+{
+  BVHTree *tree1 = segments_tree_new(OVERLAP_SEGMENTS_LEN, 4);
+  BVHTree *tree2 = segments_tree_new(OVERLAP_SEGMENTS_LEN, 5);
+
+  /* Results are in the order of the tasks, whichever thread runs them. */
+  const std::vector<std::pair<int, int>> expected = overlap_unsorted(
+      tree1, tree2, nullptr, nullptr);
+  EXPECT_FALSE(expected.empty());
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(overlap_unsorted(tree1, tree2, nullptr, nullptr), expected);
+  }
+
+  BLI_bvhtree_free(tree1);
+  BLI_bvhtree_free(tree2);
+}
+
+static void overlap_nested_task_cb(void *__restrict userdata,
+                                   const int i,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  std::atomic<int> *sum = (std::atomic<int> *)userdata;
+  *sum += i;
+}
+
+static bool overlap_nested_cb(void *userdata, int index_a, int index_b, int thread)
+{
+  /* Callbacks running tasks of their own must not block the overlap tasks. */
+  std::atomic<int> sum(0);
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, 4, &sum, overlap_nested_task_cb, &settings);
+  if (sum != 0 + 1 + 2 + 3) {
+    ((OverlapThreadData *)userdata)->is_valid = false;
+  }
+
+  return overlap_thread_check_cb(userdata, index_a, index_b, thread);
+}
+
+TEST(kdopbvh, OverlapThreadedNested)
+{
+  BVHTree *tree = segments_tree_new(OVERLAP_SEGMENTS_LEN, 6);
+
+  OverlapThreadData data;
+  data.thread_num = BLI_bvhtree_overlap_thread_num(tree);
+  data.thread_busy = std::vector<std::atomic<bool>>(data.thread_num);
+  data.is_valid = true;
+
+  const std::vector<std::pair<int, int>> expected = overlap_sorted(
+      tree, tree, overlap_thread_check_cb, &data, 0);
+  const std::vector<std::pair<int, int>> result = overlap_sorted(
+      tree, tree, overlap_nested_cb, &data, BVH_OVERLAP_USE_THREADING);
+  EXPECT_FALSE(expected.empty());
+  EXPECT_EQ(result, expected);
+  EXPECT_TRUE(data.is_valid);
+
+  BLI_bvhtree_free(tree);
+}
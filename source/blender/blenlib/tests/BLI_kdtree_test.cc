@@ -0,0 +1,168 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <atomic>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_kdtree.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+
+/* -------------------------------------------------------------------- */
+/* Helper Functions */
+
+/* Large enough for the balancing to go parallel. */
+#define POINTS_NUM 50000
+#define QUERIES_NUM 2000
+
+static float (*random_points(const int points_num, const int seed))[3]
+{
+  float(*points)[3] = (float(*)[3])MEM_malloc_arrayN(points_num, sizeof(*points), __func__);
+  RNG *rng = BLI_rng_new(seed);
+  for (int i = 0; i < points_num; i++) {
+    BLI_rng_get_float_unit_v3(rng, points[i]);
+    mul_v3_fl(points[i], BLI_rng_get_float(rng) * 10.0f);
+  }
+  BLI_rng_free(rng);
+  return points;
+}
+
+static KDTree_3d *tree_from_points(const float (*points)[3], const int points_num)
+{
+  KDTree_3d *tree = BLI_kdtree_3d_new(points_num);
+  for (int i = 0; i < points_num; i++) {
+    BLI_kdtree_3d_insert(tree, i, points[i]);
+  }
+  BLI_kdtree_3d_balance(tree);
+  return tree;
+}
+
+/* -------------------------------------------------------------------- */
+/* Tests */
+
+TEST(kdtree, FindNearestBruteForce)
+{
+  float(*points)[3] = random_points(POINTS_NUM, 0);
+  float(*queries)[3] = random_points(QUERIES_NUM, 1);
+  KDTree_3d *tree = tree_from_points(points, POINTS_NUM);
+
+  for (int i = 0; i < QUERIES_NUM; i++) {
+    float best_dist_sq = FLT_MAX;
+    for (int j = 0; j < POINTS_NUM; j++) {
+      best_dist_sq = min_ff(best_dist_sq, len_squared_v3v3(queries[i], points[j]));
+    }
+
+    KDTreeNearest_3d nearest;
+    const int index = BLI_kdtree_3d_find_nearest(tree, queries[i], &nearest);
+    ASSERT_NE(index, -1);
+    EXPECT_EQ(len_squared_v3v3(queries[i], points[index]), best_dist_sq);
+  }
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(points);
+  MEM_freeN(queries);
+}
+
+TEST(kdtree, FindNearestBatch)
+{
+  float(*points)[3] = random_points(POINTS_NUM, 2);
+  float(*queries)[3] = random_points(QUERIES_NUM, 3);
+  KDTree_3d *tree = tree_from_points(points, POINTS_NUM);
+
+  int *indices = (int *)MEM_malloc_arrayN(QUERIES_NUM, sizeof(int), __func__);
+  KDTreeNearest_3d *nearest = (KDTreeNearest_3d *)MEM_malloc_arrayN(
+      QUERIES_NUM, sizeof(*nearest), __func__);
+  BLI_kdtree_3d_find_nearest_batch(tree, queries, QUERIES_NUM, indices, nearest);
+
+  for (int i = 0; i < QUERIES_NUM; i++) {
+    KDTreeNearest_3d expected;
+    EXPECT_EQ(indices[i], BLI_kdtree_3d_find_nearest(tree, queries[i], &expected));
+    EXPECT_EQ(nearest[i].index, expected.index);
+    EXPECT_EQ(nearest[i].dist, expected.dist);
+  }
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(indices);
+  MEM_freeN(nearest);
+  MEM_freeN(points);
+  MEM_freeN(queries);
+}
+
+TEST(kdtree, FindNearestNBatch)
+{
+  const uint nearest_len_capacity = 8;
+  float(*points)[3] = random_points(POINTS_NUM, 4);
+  float(*queries)[3] = random_points(QUERIES_NUM, 5);
+  KDTree_3d *tree = tree_from_points(points, POINTS_NUM);
+
+  KDTreeNearest_3d *nearest = (KDTreeNearest_3d *)MEM_malloc_arrayN(
+      QUERIES_NUM * nearest_len_capacity, sizeof(*nearest), __func__);
+  int *nearest_len = (int *)MEM_malloc_arrayN(QUERIES_NUM, sizeof(int), __func__);
+  BLI_kdtree_3d_find_nearest_n_batch(
+      tree, queries, QUERIES_NUM, nearest, nearest_len_capacity, nearest_len);
+
+  for (int i = 0; i < QUERIES_NUM; i++) {
+    KDTreeNearest_3d expected[nearest_len_capacity];
+    const int expected_len = BLI_kdtree_3d_find_nearest_n(
+        tree, queries[i], expected, nearest_len_capacity);
+    ASSERT_EQ(nearest_len[i], expected_len);
+    for (int j = 0; j < expected_len; j++) {
+      EXPECT_EQ(nearest[i * nearest_len_capacity + j].index, expected[j].index);
+    }
+  }
+
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(nearest);
+  MEM_freeN(nearest_len);
+  MEM_freeN(points);
+  MEM_freeN(queries);
+}
+
+struct RangeBatchData {
+  const float (*points)[3];
+  const float (*queries)[3];
+  std::atomic<int> *found;
+  float range;
+  std::atomic<bool> is_valid;
+};
+
+static bool range_batch_cb(
+    void *user_data, int co_index, int index, const float co[3], float dist_sq)
+{
+  RangeBatchData *data = (RangeBatchData *)user_data;
+  if (!equals_v3v3(co, data->points[index]) ||
+      len_squared_v3v3(co, data->queries[co_index]) != dist_sq ||
+      dist_sq > data->range * data->range) {
+    data->is_valid = false;
+  }
+  data->found[co_index]++;
+  return true;
+}
+
+TEST(kdtree, RangeSearchBatch)
+{
+  float(*points)[3] = random_points(POINTS_NUM, 6);
+  float(*queries)[3] = random_points(QUERIES_NUM, 7);
+  KDTree_3d *tree = tree_from_points(points, POINTS_NUM);
+
+  std::atomic<int> *found = new std::atomic<int>[QUERIES_NUM]();
+  RangeBatchData data = {points, queries, found, 0.5f, {true}};
+  BLI_kdtree_3d_range_search_batch_cb(tree, queries, QUERIES_NUM, 0.5f, range_batch_cb, &data);
+  EXPECT_TRUE(data.is_valid);
+
+  for (int i = 0; i < QUERIES_NUM; i++) {
+    KDTreeNearest_3d *expected = nullptr;
+    const int expected_len = BLI_kdtree_3d_range_search(tree, queries[i], &expected, 0.5f);
+    EXPECT_EQ(found[i], expected_len);
+    if (expected) {
+      MEM_freeN(expected);
+    }
+  }
+
+  delete[] found;
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(points);
+  MEM_freeN(queries);
+}
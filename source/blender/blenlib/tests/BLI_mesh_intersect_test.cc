@@ -9,6 +9,7 @@
 #include "PIL_time.h"
 
 #include "BLI_array.hh"
+#include "BLI_math_boolean.hh"
 #include "BLI_math_mpq.hh"
 #include "BLI_mesh_intersect.hh"
 #include "BLI_mpq3.hh"
@@ -804,6 +805,34 @@ TEST(mesh_intersect, RectCross)
     write_obj_mesh(out, "test_rectcross");
   }
 }
+
+TEST(mesh_intersect, FilteredOrient3d)
+{
+  /* Points on and very near the plane x + y + z = 1, most with coordinates that doubles can't
+   * represent, so the filter has to fall back to exact arithmetic for some of them. */
+  IMeshArena arena;
+  const mpq_class tiny(1, mpz_class(1) << 80);
+  const Vert *a = arena.add_or_find_vert(mpq3(1, 0, 0), 0);
+  const Vert *b = arena.add_or_find_vert(mpq3(0, 1, 0), 1);
+  const Vert *c = arena.add_or_find_vert(mpq3(0, 0, 1), 2);
+  Vector<const Vert *> tests;
+  for (int i = 1; i < 10; i++) {
+    const mpq_class x(1, i + 2);
+    const mpq_class y(i, 3 * i + 7);
+    const mpq_class z = 1 - x - y;
+    tests.append(arena.add_or_find_vert(mpq3(x, y, z), 3 * i));
+    tests.append(arena.add_or_find_vert(mpq3(x, y, z + tiny), 3 * i + 1));
+    tests.append(arena.add_or_find_vert(mpq3(x, y - tiny, z), 3 * i + 2));
+  }
+  tests.append(arena.add_or_find_vert(mpq3(1, 1, 1), 100));
+  tests.append(arena.add_or_find_vert(mpq3(-1, 0, 0), 101));
+
+  for (const Vert *d : tests) {
+    const int expected = orient3d(a->co_exact, b->co_exact, c->co_exact, d->co_exact);
+    EXPECT_EQ(filtered_orient3d(a, b, c, d), expected);
+    EXPECT_EQ(filtered_orient3d(b, a, c, d), -expected);
+  }
+}
 #  endif
 
 #  if DO_PERF_TESTS
@@ -0,0 +1,149 @@
+/* Apache License, Version 2.0 */
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+#include "BLI_allocator.hh"
+#include "BLI_array.hh"
+#include "BLI_linear_allocator.hh"
+#include "BLI_map.hh"
+#include "BLI_set.hh"
+#include "BLI_vector.hh"
+#include "testing/testing.h"
+
+namespace blender::tests {
+
+static bool is_aligned(void *ptr, size_t alignment)
+{
+  return (uintptr_t(ptr) & (alignment - 1)) == 0;
+}
+
+TEST(pool_allocator, AllocationAlignment)
+{
+  PoolAllocator allocator;
+  Vector<void *> blocks;
+  for (const size_t alignment : {1, 4, 8, 16, 64, 256, 512}) {
+    for (const size_t size : {0, 1, 3, 16, 17, 100, 1000, 4096, 5000, 100000}) {
+      void *ptr = allocator.allocate(size, alignment, __func__);
+      EXPECT_TRUE(is_aligned(ptr, alignment));
+      memset(ptr, 0xff, size);
+      blocks.append(ptr);
+    }
+  }
+  for (void *ptr : blocks) {
+    allocator.deallocate(ptr);
+  }
+}
+
+TEST(pool_allocator, NoOverlap)
+{
+  PoolAllocator allocator;
+  Vector<int *> blocks;
+  for (const int i : IndexRange(10000)) {
+    const int size = 1 + i % 50;
+    int *ptr = static_cast<int *>(allocator.allocate(sizeof(int) * size, alignof(int), __func__));
+    for (const int j : IndexRange(size)) {
+      ptr[j] = i;
+    }
+    blocks.append(ptr);
+  }
+  for (const int i : blocks.index_range()) {
+    for (const int j : IndexRange(1 + i % 50)) {
+      EXPECT_EQ(blocks[i][j], i);
+    }
+    allocator.deallocate(blocks[i]);
+  }
+}
+
+TEST(pool_allocator, ReuseFreedBlock)
+{
+  PoolAllocator allocator;
+  void *ptr1 = allocator.allocate(40, 8, __func__);
+  allocator.deallocate(ptr1);
+  void *ptr2 = allocator.allocate(64, 8, __func__);
+  EXPECT_EQ(ptr1, ptr2);
+  allocator.deallocate(ptr2);
+}
+
+TEST(pool_allocator, LargeAllocationsAreGuarded)
+{
+  PoolAllocator allocator;
+  const unsigned int blocks_in_use = MEM_get_memory_blocks_in_use();
+  void *small = allocator.allocate(4096, 8, __func__);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+  void *large = allocator.allocate(4097, 8, __func__);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use + 1);
+  allocator.deallocate(small);
+  allocator.deallocate(large);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_in_use);
+}
+
+/* Blocks allocated in other threads are freed in the main thread. The freed blocks are reused by
+ * the threads of the next round, so the pool does not grow anymore after the first round. */
+TEST(pool_allocator, FreeInOtherThread)
+{
+  const int threads_num = 4;
+  const int blocks_num = 10000;
+  size_t reserved_memory = 0;
+
+  for (const int round : IndexRange(5)) {
+    Array<Vector<void *>> blocks(threads_num);
+    std::atomic<int> finished_num = 0;
+    Vector<std::thread> threads;
+    for (const int i : IndexRange(threads_num)) {
+      threads.append(std::thread([&, i]() {
+        PoolAllocator allocator;
+        for (const int j : IndexRange(blocks_num)) {
+          blocks[i].append(allocator.allocate(16 << (j % 4), 8, __func__));
+        }
+        /* Keep all threads alive until every one has taken a thread cache. */
+        finished_num++;
+        while (finished_num < threads_num) {
+          std::this_thread::yield();
+        }
+      }));
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+
+    PoolAllocator allocator;
+    for (const Vector<void *> &thread_blocks : blocks) {
+      for (void *ptr : thread_blocks) {
+        allocator.deallocate(ptr);
+      }
+    }
+
+    if (round == 0) {
+      reserved_memory = pool_allocator::reserved_memory_get();
+    }
+    else {
+      EXPECT_EQ(pool_allocator::reserved_memory_get(), reserved_memory);
+    }
+  }
+}
+
+TEST(pool_allocator, Containers)
+{
+  PoolVector<int> vector;
+  PoolMap<int, int> map;
+  PoolSet<int> set;
+  for (const int i : IndexRange(1000)) {
+    vector.append(i);
+    map.add(i, i * 2);
+    set.add(i);
+  }
+  EXPECT_EQ(vector.size(), 1000);
+  EXPECT_EQ(vector[500], 500);
+  EXPECT_EQ(map.lookup(500), 1000);
+  EXPECT_TRUE(set.contains(999));
+
+  LinearAllocator<PoolAllocator> linear_allocator;
+  for (const int i : IndexRange(1000)) {
+    int *value = linear_allocator.construct<int>(i).release();
+    EXPECT_EQ(*value, i);
+  }
+}
+
+}  // namespace blender::tests
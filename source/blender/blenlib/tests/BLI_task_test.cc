@@ -1,6 +1,7 @@
 /* Apache License, Version 2.0 */
 
 #include "testing/testing.h"
+#include <atomic>
 #include <cstring>
 
 #include "atomic_ops.h"
@@ -12,6 +13,7 @@
 #include "BLI_listbase.h"
 #include "BLI_mempool.h"
 #include "BLI_task.h"
+#include "BLI_task.hh"
 
 #define NUM_ITEMS 10000
 
@@ -280,3 +282,139 @@ TEST(task, ListBaseIter)
   MEM_freeN(items_buffer);
   BLI_threadapi_exit();
 }
+
+/* *** Parallel iterations split over NUMA nodes. *** */
+
+TEST(task, ParallelForNuma)
+{
+  BLI_threadapi_init();
+  BLI_task_scheduler_init();
+
+  const int items_num = 100000;
+  std::atomic<int> *visited = new std::atomic<int>[items_num]();
+  blender::threading::parallel_for_numa(
+      blender::IndexRange(items_num), 256, [&](const blender::IndexRange range) {
+        /* Nested loops run on the node of the outer loop. */
+        blender::threading::parallel_for_numa(range, 64, [&](const blender::IndexRange subrange) {
+          for (const int i : subrange) {
+            visited[i]++;
+          }
+        });
+      });
+
+  for (int i = 0; i < items_num; i++) {
+    EXPECT_EQ(visited[i], 1);
+  }
+  delete[] visited;
+
+  BLI_task_scheduler_exit();
+  BLI_threadapi_exit();
+}
+
+/* *** Background task pools with a limited number of threads. *** */
+
+struct BackgroundPoolData {
+  std::atomic<int> done_num = 0;
+  std::atomic<int> running_num = 0;
+  std::atomic<int> running_max = 0;
+  std::atomic<bool> release = false;
+};
+
+static void task_background_run(TaskPool *__restrict pool, void *UNUSED(taskdata))
+{
+  BackgroundPoolData *data = (BackgroundPoolData *)BLI_task_pool_user_data(pool);
+  const int running_num = ++data->running_num;
+  int running_max = data->running_max;
+  while (running_num > running_max &&
+         !data->running_max.compare_exchange_weak(running_max, running_num)) {
+    /* Pass. */
+  }
+  for (volatile int i = 0; i < 10000; i++) {
+    /* Pass. */
+  }
+  data->running_num--;
+  data->done_num++;
+}
+
+TEST(task, BackgroundPoolThreadsLimit)
+{
+  BLI_threadapi_init();
+  BLI_task_scheduler_background_threads_set(1);
+  BLI_task_scheduler_init();
+
+  BackgroundPoolData data;
+  TaskPool *pool = BLI_task_pool_create_background(&data, TASK_PRIORITY_LOW);
+  for (int i = 0; i < 100; i++) {
+    BLI_task_pool_push(pool, task_background_run, nullptr, false, nullptr);
+  }
+  BLI_task_pool_work_and_wait(pool);
+  BLI_task_pool_free(pool);
+
+  EXPECT_EQ(data.done_num, 100);
+  EXPECT_EQ(data.running_max, 1);
+
+  BLI_task_scheduler_exit();
+  BLI_task_scheduler_background_threads_set(0);
+  BLI_threadapi_exit();
+}
+
+static void task_background_block_run(TaskPool *__restrict pool, void *UNUSED(taskdata))
+{
+  BackgroundPoolData *data = (BackgroundPoolData *)BLI_task_pool_user_data(pool);
+  /* Keeps a thread of the arena busy until released. */
+  data->running_num++;
+  while (!data->release) {
+    /* Pass. */
+  }
+  data->done_num++;
+}
+
+static void task_background_cancel_run(TaskPool *__restrict pool, void *UNUSED(taskdata))
+{
+  BackgroundPoolData *data = (BackgroundPoolData *)BLI_task_pool_user_data(pool);
+  while (!BLI_task_pool_current_canceled(pool)) {
+    /* Pass. */
+  }
+  data->done_num++;
+}
+
+TEST(task, BackgroundPoolPushNonBlocking)
+{
+  BLI_threadapi_init();
+  /* The background arena needs more threads than it uses itself. */
+  BLI_system_num_threads_override_set(4);
+  BLI_task_scheduler_background_threads_set(2);
+  BLI_task_scheduler_init();
+
+  BackgroundPoolData data;
+  TaskPool *pool = BLI_task_pool_create_background(&data, TASK_PRIORITY_LOW);
+
+  /* Pushing returns while the arena is busy. */
+  for (int i = 0; i < 2; i++) {
+    BLI_task_pool_push(pool, task_background_block_run, nullptr, false, nullptr);
+  }
+  while (data.running_num < 2) {
+    /* Pass. */
+  }
+  for (int i = 0; i < 100; i++) {
+    BLI_task_pool_push(pool, task_background_run, nullptr, false, nullptr);
+  }
+  data.release = true;
+  BLI_task_pool_work_and_wait(pool);
+  EXPECT_EQ(data.done_num, 102);
+
+  /* Cancel finishes the running tasks and skips the others. */
+  data.done_num = 0;
+  for (int i = 0; i < 100; i++) {
+    BLI_task_pool_push(pool, task_background_cancel_run, nullptr, false, nullptr);
+  }
+  BLI_task_pool_cancel(pool);
+  EXPECT_LE(data.done_num, 2);
+
+  BLI_task_pool_free(pool);
+
+  BLI_task_scheduler_exit();
+  BLI_task_scheduler_background_threads_set(0);
+  BLI_system_num_threads_override_set(0);
+  BLI_threadapi_exit();
+}
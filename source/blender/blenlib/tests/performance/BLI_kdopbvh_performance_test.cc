@@ -0,0 +1,209 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_kdopbvh.h"
+#include "BLI_math.h"
+#include "BLI_utildefines.h"
+
+#include "PIL_time.h"
+
+#define NUM_RUN_AVERAGED 10
+
+#define TIMEIT_START(var) \
+  { \
+    double averaged_timing = 0.0; \
+    for (int run = 0; run < NUM_RUN_AVERAGED; run++) { \
+      const double init_time = PIL_check_seconds_timer();
+
+#define TIMEIT_END(var) \
+  averaged_timing += PIL_check_seconds_timer() - init_time; \
+  } \
+  printf("\t%s: done in %fs on average over %d runs\n", \
+         var, \
+         averaged_timing / NUM_RUN_AVERAGED, \
+         NUM_RUN_AVERAGED); \
+  } \
+  (void)0
+
+/* A triangulated grid folded onto itself, like a cloth sheet in a crumpled state. */
+struct TriGrid {
+  float (*verts)[3];
+  int (*tris)[3];
+  int tris_len;
+};
+
+static TriGrid tri_grid_new(const int res, const float offset[3], const float fold)
+{
+  TriGrid grid;
+  grid.verts = (float(*)[3])MEM_malloc_arrayN(res * res, sizeof(*grid.verts), __func__);
+  grid.tris_len = (res - 1) * (res - 1) * 2;
+  grid.tris = (int(*)[3])MEM_malloc_arrayN(grid.tris_len, sizeof(*grid.tris), __func__);
+
+  for (int y = 0; y < res; y++) {
+    for (int x = 0; x < res; x++) {
+      const float u = (float)x / (float)(res - 1);
+      const float v = (float)y / (float)(res - 1);
+      float *co = grid.verts[y * res + x];
+      co[0] = sinf(u * fold) * 0.5f;
+      co[1] = v;
+      co[2] = u * 0.2f + sinf(v * fold * 0.5f) * 0.02f;
+      add_v3_v3(co, offset);
+    }
+  }
+
+  int(*tri)[3] = grid.tris;
+  for (int y = 0; y < res - 1; y++) {
+    for (int x = 0; x < res - 1; x++, tri += 2) {
+      const int v = y * res + x;
+      ARRAY_SET_ITEMS(tri[0], v, v + 1, v + res + 1);
+      ARRAY_SET_ITEMS(tri[1], v, v + res + 1, v + res);
+    }
+  }
+  return grid;
+}
+
+static void tri_grid_free(TriGrid *grid)
+{
+  MEM_freeN(grid->verts);
+  MEM_freeN(grid->tris);
+}
+
+static BVHTree *tri_grid_bvhtree(const TriGrid *grid, const float epsilon)
+{
+  BVHTree *tree = BLI_bvhtree_new(grid->tris_len, epsilon, 4, 26);
+  for (int i = 0; i < grid->tris_len; i++) {
+    float co[3][3];
+    for (int j = 0; j < 3; j++) {
+      copy_v3_v3(co[j], grid->verts[grid->tris[i][j]]);
+    }
+    BLI_bvhtree_insert(tree, i, co[0], 3);
+  }
+  BLI_bvhtree_balance(tree);
+  return tree;
+}
+
+struct OverlapData {
+  const TriGrid *grid_a, *grid_b;
+};
+
+/* Similar to cloth self collision, only skip neighbors. */
+static bool cloth_self_overlap_cb(void *userdata, int index_a, int index_b, int UNUSED(thread))
+{
+  const OverlapData *data = (const OverlapData *)userdata;
+  if (index_a >= index_b) {
+    return false;
+  }
+  const int *tri_a = data->grid_a->tris[index_a];
+  const int *tri_b = data->grid_a->tris[index_b];
+  for (int i = 0; i < 3; i++) {
+    if (ELEM(tri_a[i], UNPACK3(tri_b))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Similar to edit-mesh BVH overlap, test the triangles intersect. */
+static bool editmesh_overlap_cb(void *userdata, int index_a, int index_b, int UNUSED(thread))
+{
+  const OverlapData *data = (const OverlapData *)userdata;
+  const int *tri_a = data->grid_a->tris[index_a];
+  const int *tri_b = data->grid_b->tris[index_b];
+  float ix_pair[2][3];
+  return isect_tri_tri_v3(data->grid_a->verts[tri_a[0]],
+                          data->grid_a->verts[tri_a[1]],
+                          data->grid_a->verts[tri_a[2]],
+                          data->grid_b->verts[tri_b[0]],
+                          data->grid_b->verts[tri_b[1]],
+                          data->grid_b->verts[tri_b[2]],
+                          ix_pair[0],
+                          ix_pair[1]);
+}
+
+static void overlap_test(const char *id,
+                         const BVHTree *tree_a,
+                         const BVHTree *tree_b,
+                         BVHTree_OverlapCallback callback,
+                         OverlapData *data)
+{
+  uint overlap_len = 0;
+  BVHTreeOverlap *overlap;
+
+  TIMEIT_START("Overlap, single thread");
+  overlap = BLI_bvhtree_overlap_ex(
+      tree_a, tree_b, &overlap_len, callback, data, 0, BVH_OVERLAP_RETURN_PAIRS);
+  MEM_SAFE_FREE(overlap);
+  TIMEIT_END("Overlap, single thread");
+
+  TIMEIT_START("Overlap, threaded");
+  overlap = BLI_bvhtree_overlap(tree_a, tree_b, &overlap_len, callback, data);
+  MEM_SAFE_FREE(overlap);
+  TIMEIT_END("Overlap, threaded");
+
+  printf("\t%s: %u overlapping pairs, %d threads\n",
+         id,
+         overlap_len,
+         BLI_bvhtree_overlap_thread_num(tree_a));
+}
+
+static void cloth_self_overlap_test(const char *id, const int res)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  const float offset[3] = {0.0f};
+  TriGrid grid = tri_grid_new(res, offset, 40.0f);
+  BVHTree *tree = tri_grid_bvhtree(&grid, 0.002f);
+  OverlapData data = {&grid, &grid};
+
+  overlap_test(id, tree, tree, cloth_self_overlap_cb, &data);
+
+  BLI_bvhtree_free(tree);
+  tri_grid_free(&grid);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+static void editmesh_overlap_test(const char *id, const int res)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  const float offset_a[3] = {0.0f};
+  const float offset_b[3] = {0.01f, 0.0f, 0.03f};
+  TriGrid grid_a = tri_grid_new(res, offset_a, 20.0f);
+  TriGrid grid_b = tri_grid_new(res, offset_b, 21.0f);
+  BVHTree *tree_a = tri_grid_bvhtree(&grid_a, 0.0f);
+  BVHTree *tree_b = tri_grid_bvhtree(&grid_b, 0.0f);
+  OverlapData data = {&grid_a, &grid_b};
+
+  overlap_test(id, tree_a, tree_b, editmesh_overlap_cb, &data);
+
+  BLI_bvhtree_free(tree_a);
+  BLI_bvhtree_free(tree_b);
+  tri_grid_free(&grid_a);
+  tri_grid_free(&grid_b);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(kdopbvh, ClothSelfOverlap100k)
+{
+  cloth_self_overlap_test("Cloth self overlap - 100k triangles", 225);
+}
+
+TEST(kdopbvh, ClothSelfOverlap1M)
+{
+  cloth_self_overlap_test("Cloth self overlap - 1M triangles", 708);
+}
+
+TEST(kdopbvh, EditMeshOverlap100k)
+{
+  editmesh_overlap_test("Edit-mesh overlap - 2 x 100k triangles", 225);
+}
+
+TEST(kdopbvh, EditMeshOverlap1M)
+{
+  editmesh_overlap_test("Edit-mesh overlap - 2 x 1M triangles", 708);
+}
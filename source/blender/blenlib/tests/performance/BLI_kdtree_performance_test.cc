@@ -0,0 +1,123 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_kdtree.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "BLI_utildefines.h"
+
+#include "PIL_time.h"
+
+#define NUM_RUN_AVERAGED 10
+
+#define TIMEIT_START(var) \
+  { \
+    double averaged_timing = 0.0; \
+    for (int run = 0; run < NUM_RUN_AVERAGED; run++) { \
+      const double init_time = PIL_check_seconds_timer();
+
+#define TIMEIT_END(var) \
+  averaged_timing += PIL_check_seconds_timer() - init_time; \
+  } \
+  printf("\t%s: done in %fs on average over %d runs\n", \
+         var, \
+         averaged_timing / NUM_RUN_AVERAGED, \
+         NUM_RUN_AVERAGED); \
+  } \
+  (void)0
+
+/* Points scattered on a few clusters, like instances on a terrain. */
+static float (*kdtree_test_points(const int points_num, const int seed))[3]
+{
+  float(*points)[3] = (float(*)[3])MEM_malloc_arrayN(points_num, sizeof(*points), __func__);
+  RNG *rng = BLI_rng_new(seed);
+  for (int i = 0; i < points_num; i++) {
+    float center[3];
+    BLI_rng_get_float_unit_v3(rng, center);
+    mul_v3_fl(center, (float)(i % 16) * 10.0f);
+    BLI_rng_get_float_unit_v3(rng, points[i]);
+    madd_v3_v3fl(points[i], center, BLI_rng_get_float(rng));
+  }
+  BLI_rng_free(rng);
+  return points;
+}
+
+static bool kdtree_count_cb(void *user_data,
+                            int UNUSED(index),
+                            const float UNUSED(co[3]),
+                            float UNUSED(dist_sq))
+{
+  (*(int *)user_data)++;
+  return true;
+}
+
+static bool kdtree_count_batch_cb(void *user_data,
+                                  int co_index,
+                                  int UNUSED(index),
+                                  const float UNUSED(co[3]),
+                                  float UNUSED(dist_sq))
+{
+  ((int *)user_data)[co_index]++;
+  return true;
+}
+
+static void kdtree_test(const char *id, const int points_num, const int queries_num)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  float(*points)[3] = kdtree_test_points(points_num, 0);
+  float(*queries)[3] = kdtree_test_points(queries_num, 1);
+  KDTree_3d *tree = BLI_kdtree_3d_new(points_num);
+  for (int i = 0; i < points_num; i++) {
+    BLI_kdtree_3d_insert(tree, i, points[i]);
+  }
+
+  TIMEIT_START("Balance");
+  BLI_kdtree_3d_balance(tree);
+  TIMEIT_END("Balance");
+
+  int *indices = (int *)MEM_malloc_arrayN(queries_num, sizeof(int), __func__);
+  int *counts = (int *)MEM_calloc_arrayN(queries_num, sizeof(int), __func__);
+
+  TIMEIT_START("Find nearest, one by one");
+  for (int i = 0; i < queries_num; i++) {
+    indices[i] = BLI_kdtree_3d_find_nearest(tree, queries[i], nullptr);
+  }
+  TIMEIT_END("Find nearest, one by one");
+
+  TIMEIT_START("Find nearest, batch");
+  BLI_kdtree_3d_find_nearest_batch(tree, queries, queries_num, indices, nullptr);
+  TIMEIT_END("Find nearest, batch");
+
+  TIMEIT_START("Range search, one by one");
+  for (int i = 0; i < queries_num; i++) {
+    BLI_kdtree_3d_range_search_cb(tree, queries[i], 0.05f, kdtree_count_cb, &counts[i]);
+  }
+  TIMEIT_END("Range search, one by one");
+
+  TIMEIT_START("Range search, batch");
+  BLI_kdtree_3d_range_search_batch_cb(
+      tree, queries, queries_num, 0.05f, kdtree_count_batch_cb, counts);
+  TIMEIT_END("Range search, batch");
+
+  MEM_freeN(indices);
+  MEM_freeN(counts);
+  BLI_kdtree_3d_free(tree);
+  MEM_freeN(points);
+  MEM_freeN(queries);
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(kdtree, Search100k)
+{
+  kdtree_test("KDTree - 100000 points, 100000 queries", 100000, 100000);
+}
+
+TEST(kdtree, Search1M)
+{
+  kdtree_test("KDTree - 1000000 points, 1000000 queries", 1000000, 1000000);
+}
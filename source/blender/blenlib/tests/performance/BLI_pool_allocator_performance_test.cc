@@ -0,0 +1,166 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_allocator.hh"
+#include "BLI_array.hh"
+#include "BLI_linear_allocator.hh"
+#include "BLI_map.hh"
+#include "BLI_set.hh"
+#include "BLI_task.hh"
+#include "BLI_vector.hh"
+
+#include "PIL_time.h"
+
+#define NUM_RUN_AVERAGED 10
+
+#define TIMEIT_START(var) \
+  { \
+    double averaged_timing = 0.0; \
+    for (int run = 0; run < NUM_RUN_AVERAGED; run++) { \
+      const double init_time = PIL_check_seconds_timer();
+
+#define TIMEIT_END(var) \
+  averaged_timing += PIL_check_seconds_timer() - init_time; \
+  } \
+  printf("\t%s: done in %fs on average over %d runs\n", \
+         var, \
+         averaged_timing / NUM_RUN_AVERAGED, \
+         NUM_RUN_AVERAGED); \
+  } \
+  (void)0
+
+namespace blender::tests {
+
+/* Like the depsgraph builder: every node gets a few small containers of operations and relations
+ * that grow one element at a time, and everything is freed together at the end. */
+template<typename Allocator> struct BuilderNode {
+  Map<int,
+      int,
+      0,
+      DefaultProbingStrategy,
+      DefaultHash<int>,
+      DefaultEquality,
+      DefaultMapSlot<int, int>::type,
+      Allocator>
+      operations;
+  Vector<BuilderNode *, 0, Allocator> relations;
+  Set<int,
+      0,
+      DefaultProbingStrategy,
+      DefaultHash<int>,
+      DefaultEquality,
+      DefaultSetSlot<int>::type,
+      Allocator>
+      tags;
+};
+
+template<typename Allocator> static void builder_graph_build(const int nodes_num)
+{
+  Vector<BuilderNode<Allocator> *> nodes;
+  for (const int i : IndexRange(nodes_num)) {
+    BuilderNode<Allocator> *node = new BuilderNode<Allocator>();
+    const int operations_num = 1 + i % 8;
+    for (const int j : IndexRange(operations_num)) {
+      node->operations.add(j, i + j);
+      node->tags.add(j * 7);
+    }
+    nodes.append(node);
+  }
+  for (const int i : IndexRange(nodes_num)) {
+    const int relations_num = 2 + i % 16;
+    for (const int j : IndexRange(relations_num)) {
+      nodes[i]->relations.append(nodes[(i * 31 + j * 97) % nodes_num]);
+    }
+  }
+  for (BuilderNode<Allocator> *node : nodes) {
+    delete node;
+  }
+}
+
+/* Like the geometry nodes evaluator: many node evaluations run in parallel, each of them uses
+ * temporary buffers, and the outputs are freed in other tasks than the ones that created them. */
+template<typename Allocator> static void evaluator_run(const int evaluations_num)
+{
+  Array<Vector<float, 0, Allocator>> outputs(evaluations_num);
+
+  threading::parallel_for(IndexRange(evaluations_num), 256, [&](const IndexRange range) {
+    for (const int i : range) {
+      LinearAllocator<Allocator> scope;
+      Vector<float *, 0, Allocator> inputs;
+      const int inputs_num = 1 + i % 4;
+      for (const int j : IndexRange(inputs_num)) {
+        float *input = scope.template allocate_array<float>(8 + j * 16).data();
+        input[0] = float(i + j);
+        inputs.append(input);
+      }
+      Vector<float, 0, Allocator> &output = outputs[i];
+      for (const int j : IndexRange(4 + i % 28)) {
+        output.append(inputs[j % inputs_num][0]);
+      }
+    }
+  });
+
+  /* Consumers are scheduled in a different order than the producers. */
+  threading::parallel_for(IndexRange(evaluations_num), 256, [&](const IndexRange range) {
+    for (const int i : range) {
+      outputs[evaluations_num - 1 - i].clear_and_make_inline();
+    }
+  });
+}
+
+static void builder_test(const char *id, const int nodes_num)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  TIMEIT_START("Guarded allocator");
+  builder_graph_build<GuardedAllocator>(nodes_num);
+  TIMEIT_END("Guarded allocator");
+
+  TIMEIT_START("Pool allocator");
+  builder_graph_build<PoolAllocator>(nodes_num);
+  TIMEIT_END("Pool allocator");
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+static void evaluator_test(const char *id, const int evaluations_num)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  TIMEIT_START("Guarded allocator");
+  evaluator_run<GuardedAllocator>(evaluations_num);
+  TIMEIT_END("Guarded allocator");
+
+  TIMEIT_START("Pool allocator");
+  evaluator_run<PoolAllocator>(evaluations_num);
+  TIMEIT_END("Pool allocator");
+
+  printf("\tPool allocator reserved %.3f MB\n",
+         double(pool_allocator::reserved_memory_get()) / (1024.0 * 1024.0));
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(pool_allocator, DepsgraphBuilder100k)
+{
+  builder_test("Depsgraph builder - 100000 nodes", 100000);
+}
+
+TEST(pool_allocator, DepsgraphBuilder1M)
+{
+  builder_test("Depsgraph builder - 1000000 nodes", 1000000);
+}
+
+TEST(pool_allocator, GeometryNodesEvaluator100k)
+{
+  evaluator_test("Geometry nodes evaluator - 100000 evaluations", 100000);
+}
+
+TEST(pool_allocator, GeometryNodesEvaluator1M)
+{
+  evaluator_test("Geometry nodes evaluator - 1000000 evaluations", 1000000);
+}
+
+}  // namespace blender::tests
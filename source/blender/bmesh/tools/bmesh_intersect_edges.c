@@ -39,7 +39,6 @@
 
 #define KDOP_TREE_TYPE 4
 #define KDOP_AXIS_LEN 14
-#define BLI_STACK_PAIR_LEN (2 * KDOP_TREE_TYPE)
 
 /* -------------------------------------------------------------------- */
 /** \name Weld Linked Wire Edges into Linked Faces
@@ -213,6 +212,7 @@ struct EDBMSplitElem {
 struct EDBMSplitData {
   BMesh *bm;
   BLI_Stack **pair_stack;
+  int pair_stack_len;
   int cut_edges_len;
   float dist_sq;
   float dist_sq_sq;
@@ -453,6 +453,7 @@ static void bm_elemxelem_bvhtree_overlap(const BVHTree *tree1,
                                          BLI_Stack **pair_stack)
 {
   int parallel_tasks_num = BLI_bvhtree_overlap_thread_num(tree1);
+  BLI_assert(parallel_tasks_num <= data->pair_stack_len);
   for (int i = 0; i < parallel_tasks_num; i++) {
     if (pair_stack[i] == NULL) {
       pair_stack[i] = BLI_stack_new(sizeof(const struct EDBMSplitElem[2]), __func__);
@@ -496,9 +497,11 @@ bool BM_mesh_intersect_edges(
   struct EDBMSplitElem(*pair_iter)[2], (*pair_array)[2] = NULL;
   int pair_len = 0;
 
-  BLI_Stack *pair_stack[BLI_STACK_PAIR_LEN] = {NULL};
+  /* One stack per overlap task, for vert x vert and for edge x elem. */
+  const int pair_stack_len = BLI_bvhtree_overlap_thread_num(NULL);
+  BLI_Stack **pair_stack = MEM_calloc_arrayN(2 * pair_stack_len, sizeof(*pair_stack), __func__);
   BLI_Stack **pair_stack_vertxvert = pair_stack;
-  BLI_Stack **pair_stack_edgexelem = &pair_stack[KDOP_TREE_TYPE];
+  BLI_Stack **pair_stack_edgexelem = &pair_stack[pair_stack_len];
 
   const float dist_sq = square_f(dist);
   const float dist_half = dist / 2;
@@ -506,6 +509,7 @@ bool BM_mesh_intersect_edges(
   struct EDBMSplitData data = {
       .bm = bm,
       .pair_stack = pair_stack,
+      .pair_stack_len = pair_stack_len,
       .cut_edges_len = 0,
       .dist_sq = dist_sq,
       .dist_sq_sq = square_f(dist_sq),
@@ -571,7 +575,7 @@ bool BM_mesh_intersect_edges(
     }
   }
 
-  for (i = KDOP_TREE_TYPE; i--;) {
+  for (i = pair_stack_len; i--;) {
     if (pair_stack_vertxvert[i]) {
       pair_len += BLI_stack_count(pair_stack_vertxvert[i]);
     }
@@ -672,7 +676,7 @@ bool BM_mesh_intersect_edges(
             tree_edges_remain, tree_edges_act, bm_edgexedge_isect_cb, &data, pair_stack_edgexelem);
       }
 
-      for (i = KDOP_TREE_TYPE; i--;) {
+      for (i = pair_stack_len; i--;) {
         if (pair_stack_edgexelem[i]) {
           edgexedge_pair_len += BLI_stack_count(pair_stack_edgexelem[i]);
         }
@@ -702,7 +706,7 @@ bool BM_mesh_intersect_edges(
     BLI_bvhtree_free(tree_edges_remain);
 
     int edgexelem_pair_len = 0;
-    for (i = KDOP_TREE_TYPE; i--;) {
+    for (i = pair_stack_len; i--;) {
       if (pair_stack_edgexelem[i]) {
         edgexelem_pair_len += BLI_stack_count(pair_stack_edgexelem[i]);
       }
@@ -715,7 +719,7 @@ bool BM_mesh_intersect_edges(
       pair_array = MEM_mallocN(sizeof(*pair_array) * pair_len, __func__);
 
       pair_iter = pair_array;
-      for (i = 0; i < BLI_STACK_PAIR_LEN; i++) {
+      for (i = 0; i < 2 * pair_stack_len; i++) {
         if (pair_stack[i]) {
           uint count = (uint)BLI_stack_count(pair_stack[i]);
           BLI_stack_pop_n_reverse(pair_stack[i], pair_iter, count);
@@ -823,7 +827,7 @@ bool BM_mesh_intersect_edges(
     if (pair_len && pair_array == NULL) {
       pair_array = MEM_mallocN(sizeof(*pair_array) * pair_len, __func__);
       pair_iter = pair_array;
-      for (i = 0; i < BLI_STACK_PAIR_LEN; i++) {
+      for (i = 0; i < 2 * pair_stack_len; i++) {
         if (pair_stack[i]) {
           uint count = (uint)BLI_stack_count(pair_stack[i]);
           BLI_stack_pop_n_reverse(pair_stack[i], pair_iter, count);
@@ -1045,11 +1049,12 @@ bool BM_mesh_intersect_edges(
     }
   }
 
-  for (i = BLI_STACK_PAIR_LEN; i--;) {
+  for (i = 2 * pair_stack_len; i--;) {
     if (pair_stack[i]) {
       BLI_stack_free(pair_stack[i]);
     }
   }
+  MEM_freeN(pair_stack);
   if (pair_array) {
     MEM_freeN(pair_array);
   }
@@ -164,6 +164,46 @@ void DEG_evaluate_on_framechange(Depsgraph *graph, float frame);
 /* Data changed recalculation entry point. */
 void DEG_evaluate_on_refresh(Depsgraph *graph);
 
+/* Multi-frame Evaluation ------------------------ */
+
+/* Evaluation of many frames at once, for exporters and bakes.
+ *
+ * Several dependency graphs are built for the same view layer and evaluated at different frames
+ * at the same time. They only read the original data. Every graph has its own copy of the
+ * evaluated data, so memory usage grows with the number of graphs.
+ *
+ * Frame change handlers are not called and the original scene frame is not changed. Simulations
+ * which depend on the previous frame have to be baked or cached beforehand. Images used by the
+ * user interface are updated to every frame before it is passed to the callback, and restored to
+ * the scene frame at the end. */
+typedef struct DEGFrameRangeEvalSettings {
+  struct Main *bmain;
+  struct Scene *scene;
+  struct ViewLayer *view_layer;
+  eEvaluationMode mode;
+
+  /* Frames to be evaluated, in the order in which they are passed to the callback. */
+  const float *frames;
+  int frames_num;
+
+  /* Number of dependency graphs which are evaluated at the same time. Zero evaluates the first
+   * frame with a single graph, and then uses as many graphs as fit into #memory_limit, up to the
+   * number of threads. */
+  int graphs_num;
+  /* Memory in bytes the evaluated data of all graphs may use when #graphs_num is zero. Zero uses
+   * half of the system memory that is not in use yet. */
+  size_t memory_limit;
+
+  /* Builds the relations of a new graph. Uses #DEG_graph_build_from_view_layer when NULL. */
+  void (*build_fn)(struct Depsgraph *depsgraph, void *user_data);
+  /* Called from the calling thread for every frame in order, with a graph which is evaluated at
+   * that frame. The graph is only valid during the call. */
+  void (*frame_fn)(struct Depsgraph *depsgraph, float frame, void *user_data);
+  void *user_data;
+} DEGFrameRangeEvalSettings;
+
+void DEG_evaluate_frame_range(const DEGFrameRangeEvalSettings *settings);
+
 /* Editors Integration  -------------------------- */
 
 /* Mechanism to allow editors to be informed of depsgraph updates,
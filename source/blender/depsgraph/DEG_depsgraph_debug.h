@@ -62,6 +62,10 @@ void DEG_debug_stats_gnuplot(const struct Depsgraph *graph,
                              const char *label,
                              const char *output_filename);
 
+/* Print how operations were scheduled in the last evaluation, and the estimated critical path of
+ * the graph. Only complete when time debugging was enabled during that evaluation. */
+void DEG_debug_eval_schedule_report(const struct Depsgraph *graph, FILE *fp);
+
 /* ************************************************ */
 
 /* Compare two dependency graphs. */
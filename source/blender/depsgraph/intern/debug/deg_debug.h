@@ -53,6 +53,19 @@ class DepsgraphDebug {
    * This is NOT an indication that depsgraph is at its evaluated state. */
   bool is_ever_evaluated;
 
+  /* Scheduling statistics of the last graph evaluation.
+   * Only gathered when time debug is enabled. */
+  struct ScheduleStats {
+    /* Number of evaluated operations, not counting no-op nodes. */
+    int num_operations = 0;
+    /* Number of operations which were evaluated in a task of their own. */
+    int num_tasks = 0;
+    /* Number of operations which were evaluated right away in the task of their parent. */
+    int num_inlined = 0;
+    /* Wall time spent on the evaluation of operations. */
+    double evaluation_time = 0.0;
+  } schedule_stats;
+
  protected:
   /* Maximum number of counters used to calculate frame rate of depsgraph update. */
   static const constexpr int MAX_FPS_COUNTERS = 64;
@@ -26,16 +26,26 @@
 #include "MEM_guardedalloc.h"
 
 #include "BLI_listbase.h"
+#include "BLI_math_base.h"
+#include "BLI_system.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
+#include "BLI_vector.hh"
 
+#include "BKE_image.h"
 #include "BKE_scene.h"
 
 #include "DNA_object_types.h"
 #include "DNA_scene_types.h"
 
 #include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
 #include "DEG_depsgraph_query.h"
 
+#ifdef WITH_PYTHON
+#  include "BPY_extern.h"
+#endif
+
 #include "intern/eval/deg_eval.h"
 #include "intern/eval/deg_eval_flush.h"
 
@@ -86,3 +96,134 @@ void DEG_evaluate_on_framechange(Depsgraph *graph, float frame)
   deg_graph->ctime = BKE_scene_frame_to_ctime(scene, frame);
   deg_flush_updates_and_refresh(deg_graph);
 }
+
+/* Multi-frame evaluation. */
+
+struct FrameEvalTask {
+  Depsgraph *graph;
+  float frame;
+};
+
+static void frame_eval_isolated_func(void *userdata)
+{
+  FrameEvalTask *task = (FrameEvalTask *)userdata;
+  DEG_evaluate_on_framechange(task->graph, task->frame);
+}
+
+static void frame_eval_task_func(TaskPool *__restrict UNUSED(pool), void *taskdata)
+{
+  /* Evaluation of a graph waits for its own tasks. Isolate it, so that the waiting thread does not
+   * start the evaluation of another graph, which might wait for locks held by this one. */
+  BLI_task_isolate(frame_eval_isolated_func, taskdata);
+}
+
+static Depsgraph *frame_range_graph_new(const DEGFrameRangeEvalSettings *settings)
+{
+  Depsgraph *graph = DEG_graph_new(
+      settings->bmain, settings->scene, settings->view_layer, settings->mode);
+  if (settings->build_fn) {
+    settings->build_fn(graph, settings->user_data);
+  }
+  else {
+    DEG_graph_build_from_view_layer(graph);
+  }
+  return graph;
+}
+
+/* Evaluate every task's graph at its frame, in parallel. */
+static void frame_range_evaluate(blender::MutableSpan<FrameEvalTask> tasks)
+{
+#ifdef WITH_PYTHON
+  /* Python drivers are evaluated from other threads, which need the GIL while this thread
+   * waits for them. */
+  BPy_BEGIN_ALLOW_THREADS;
+#endif
+
+  TaskPool *task_pool = BLI_task_pool_create(nullptr, TASK_PRIORITY_HIGH);
+  for (FrameEvalTask &task : tasks) {
+    BLI_task_pool_push(task_pool, frame_eval_task_func, &task, false, nullptr);
+  }
+  BLI_task_pool_work_and_wait(task_pool);
+  BLI_task_pool_free(task_pool);
+
+#ifdef WITH_PYTHON
+  BPy_END_ALLOW_THREADS;
+#endif
+}
+
+/* Pass the evaluated graphs to the callback, from the calling thread and in frame order. */
+static void frame_range_output(const DEGFrameRangeEvalSettings *settings,
+                               blender::Span<FrameEvalTask> tasks)
+{
+  for (const FrameEvalTask &task : tasks) {
+    /* Same as for a frame change of the scene, but only the calling thread may modify the
+     * original data. */
+    BKE_image_editors_update_frame(settings->bmain, (int)task.frame);
+    settings->frame_fn(task.graph, task.frame, settings->user_data);
+    DEG_ids_clear_recalc(task.graph, false);
+  }
+}
+
+/* Number of graphs that fit into the memory limit, when a single one uses graph_mem. */
+static int frame_range_graphs_num_for_memory(const DEGFrameRangeEvalSettings *settings,
+                                             const size_t graph_mem)
+{
+  size_t memory_limit = settings->memory_limit;
+  if (memory_limit == 0) {
+    const size_t system_mem = BLI_system_memory_max_in_megabytes() * 1024 * 1024;
+    const size_t mem_in_use = MEM_get_memory_in_use();
+    memory_limit = (system_mem > mem_in_use) ? (system_mem - mem_in_use) / 2 : 0;
+  }
+  const size_t graphs_num = memory_limit / max_zz(graph_mem, 1);
+  return (int)clamp_z(graphs_num, 1, (size_t)BLI_task_scheduler_num_threads());
+}
+
+void DEG_evaluate_frame_range(const DEGFrameRangeEvalSettings *settings)
+{
+  const int frames_num = settings->frames_num;
+  if (frames_num <= 0) {
+    return;
+  }
+
+  /* Build all graphs from the calling thread, building is not thread safe. */
+  blender::Vector<Depsgraph *> graphs;
+  blender::Vector<FrameEvalTask> tasks;
+  int frame_index = 0;
+
+  int graphs_num = settings->graphs_num;
+  if (graphs_num <= 0) {
+    /* Every graph has its own copy of the evaluated data. Measure how much memory it takes for
+     * the first frame, to limit the number of graphs. */
+    const size_t mem_in_use = MEM_get_memory_in_use();
+    graphs.append(frame_range_graph_new(settings));
+    tasks.append({graphs[0], settings->frames[0]});
+    frame_range_evaluate(tasks);
+    const size_t mem_in_use_graph = MEM_get_memory_in_use();
+    frame_range_output(settings, tasks);
+    frame_index = 1;
+
+    const size_t graph_mem = (mem_in_use_graph > mem_in_use) ? mem_in_use_graph - mem_in_use : 0;
+    graphs_num = frame_range_graphs_num_for_memory(settings, graph_mem);
+  }
+  graphs_num = min_ii(graphs_num, frames_num - frame_index);
+
+  while (graphs.size() < graphs_num) {
+    graphs.append(frame_range_graph_new(settings));
+  }
+
+  for (; frame_index < frames_num; frame_index += graphs_num) {
+    const int batch_size = min_ii(graphs_num, frames_num - frame_index);
+    tasks.clear();
+    for (int i = 0; i < batch_size; i++) {
+      tasks.append({graphs[i], settings->frames[frame_index + i]});
+    }
+    frame_range_evaluate(tasks);
+    frame_range_output(settings, tasks);
+  }
+
+  BKE_image_editors_update_frame(settings->bmain, settings->scene->r.cfra);
+
+  for (Depsgraph *graph : graphs) {
+    DEG_graph_free(graph);
+  }
+}
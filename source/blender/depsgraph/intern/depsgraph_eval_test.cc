@@ -0,0 +1,155 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#include "tests/blendfile_loading_base_test.h"
+
+#include <set>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_listbase.h"
+#include "BLI_string.h"
+
+#include "BKE_action.h"
+#include "BKE_anim_data.h"
+#include "BKE_collection.h"
+#include "BKE_fcurve.h"
+#include "BKE_layer.h"
+#include "BKE_main.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "DNA_anim_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_query.h"
+
+namespace blender::deg::tests {
+
+class DepsgraphFrameRangeTest : public BlendfileLoadingBaseTest {
+ protected:
+  Main *bmain = nullptr;
+  Scene *scene = nullptr;
+  Object *object = nullptr;
+
+  void SetUp() override
+  {
+    bmain = BKE_main_new();
+    scene = BKE_scene_add(bmain, "Scene");
+    object = BKE_object_add_only_object(bmain, OB_EMPTY, "Empty");
+    BKE_collection_object_add(bmain, scene->master_collection, object);
+    BKE_main_collection_sync(bmain);
+
+    /* Location X is the frame minus one. */
+    FCurve *fcu = BKE_fcurve_create();
+    fcu->rna_path = BLI_strdup("location");
+    fcu->array_index = 0;
+    fcu->totvert = 2;
+    fcu->bezt = (BezTriple *)MEM_callocN(sizeof(BezTriple) * 2, __func__);
+    for (int i = 0; i < 2; i++) {
+      fcu->bezt[i].vec[1][0] = 1.0f + 99.0f * i;
+      fcu->bezt[i].vec[1][1] = 99.0f * i;
+      fcu->bezt[i].ipo = BEZT_IPO_LIN;
+    }
+    calchandles_fcurve(fcu);
+
+    bAction *action = BKE_action_add(bmain, "Action");
+    BLI_addtail(&action->curves, fcu);
+    AnimData *adt = BKE_animdata_ensure_id(&object->id);
+    adt->action = action;
+  }
+
+  void TearDown() override
+  {
+    BKE_main_free(bmain);
+    BlendfileLoadingBaseTest::TearDown();
+  }
+};
+
+struct FrameRangeResult {
+  Object *object;
+  std::vector<float> frames;
+  std::vector<float> locations;
+  std::set<Depsgraph *> graphs;
+};
+
+static void frame_range_frame_fn(Depsgraph *depsgraph, float frame, void *user_data)
+{
+  FrameRangeResult *result = static_cast<FrameRangeResult *>(user_data);
+  EXPECT_EQ(DEG_get_ctime(depsgraph), frame);
+  Object *object_eval = DEG_get_evaluated_object(depsgraph, result->object);
+  result->frames.push_back(frame);
+  result->locations.push_back(object_eval->loc[0]);
+  result->graphs.insert(depsgraph);
+}
+
+static FrameRangeResult frame_range_evaluate(
+    Main *bmain, Scene *scene, Object *object, int graphs_num, size_t memory_limit)
+{
+  std::vector<float> frames;
+  for (int frame = 1; frame <= 10; frame++) {
+    frames.push_back(frame);
+  }
+  /* Not in order, each frame is evaluated on its own. */
+  frames.push_back(5.0f);
+
+  FrameRangeResult result;
+  result.object = object;
+
+  DEGFrameRangeEvalSettings settings = {nullptr};
+  settings.bmain = bmain;
+  settings.scene = scene;
+  settings.view_layer = BKE_view_layer_default_view(scene);
+  settings.mode = DAG_EVAL_RENDER;
+  settings.frames = frames.data();
+  settings.frames_num = (int)frames.size();
+  settings.graphs_num = graphs_num;
+  settings.memory_limit = memory_limit;
+  settings.frame_fn = frame_range_frame_fn;
+  settings.user_data = &result;
+  DEG_evaluate_frame_range(&settings);
+
+  EXPECT_EQ(result.frames, frames);
+  for (size_t i = 0; i < frames.size(); i++) {
+    EXPECT_FLOAT_EQ(result.locations[i], frames[i] - 1.0f);
+  }
+  return result;
+}
+
+TEST_F(DepsgraphFrameRangeTest, graphs_num)
+{
+  const FrameRangeResult result = frame_range_evaluate(bmain, scene, object, 3, 0);
+  EXPECT_LE(result.graphs.size(), 3u);
+  /* The original data is not changed. */
+  EXPECT_EQ(scene->r.cfra, 1);
+  EXPECT_EQ(object->loc[0], 0.0f);
+}
+
+TEST_F(DepsgraphFrameRangeTest, memory_limit)
+{
+  /* No memory for more than one graph. */
+  const FrameRangeResult result = frame_range_evaluate(bmain, scene, object, 0, 1);
+  EXPECT_EQ(result.graphs.size(), 1u);
+}
+
+}  // namespace blender::deg::tests
@@ -25,12 +25,18 @@
 
 #include "intern/eval/deg_eval.h"
 
+#include <atomic>
+
 #include "PIL_time.h"
 
 #include "BLI_compiler_attrs.h"
 #include "BLI_gsqueue.h"
+#include "BLI_heap_simple.h"
+#include "BLI_math_base.h"
 #include "BLI_task.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
+#include "BLI_vector.hh"
 
 #include "BKE_global.h"
 
@@ -73,11 +79,6 @@ void schedule_children(DepsgraphEvalState *state,
                        ScheduleFunction *schedule_function,
                        ScheduleFunctionArgs... schedule_function_args);
 
-void schedule_node_to_pool(OperationNode *node, const int UNUSED(thread_id), TaskPool *pool)
-{
-  BLI_task_pool_push(pool, deg_task_run_func, node, false, nullptr);
-}
-
 /* Denotes which part of dependency graph is being evaluated. */
 enum class EvaluationStage {
   /* Stage 1: Only  Copy-on-Write operations are to be evaluated, prior to anything else.
@@ -100,36 +101,135 @@ struct DepsgraphEvalState {
   bool do_stats;
   EvaluationStage stage;
   bool need_single_thread_pass;
+
+  /* Operations which are ready for threaded evaluation, ordered by their priority. */
+  HeapSimple *ready_operations;
+  SpinLock ready_operations_lock;
+
+  /* Cost estimate of an operation changed noticeably since the priorities were calculated. */
+  std::atomic<bool> need_update_priorities{false};
+
+  /* Scheduling statistics, only gathered when `do_stats` is set. */
+  std::atomic<int> num_operations{0};
+  std::atomic<int> num_tasks{0};
+  std::atomic<int> num_inlined{0};
 };
 
-void evaluate_node(const DepsgraphEvalState *state, OperationNode *operation_node)
+/* Weight of the latest evaluation time in the running average of the operation cost. */
+const float COST_ESTIMATE_WEIGHT = 0.25f;
+
+/* Smallest change of a cost estimate which causes the priorities to be updated. Smaller changes
+ * don't affect the critical path in a meaningful way. */
+const float COST_ESTIMATE_CHANGE_MIN = 1e-5f;
+
+/* Operations which became ready in a task are evaluated in the same task, instead of spawning a
+ * task for each of them, while the sum of their cost estimates stays below this limit (in
+ * seconds). Spawning and scheduling a task costs in the order of a microsecond, which is as much
+ * as many operations take. The limit keeps a single task from taking all the work when a lot of
+ * tiny operations become ready at once. */
+const float INLINE_OPERATIONS_COST_MAX = 2e-5f;
+
+void update_cost_estimate(DepsgraphEvalState *state,
+                          OperationNode *operation_node,
+                          const float time)
+{
+  const float old_estimate = operation_node->cost_estimate;
+  if (old_estimate < 0.0f) {
+    operation_node->cost_estimate = time;
+    state->need_update_priorities.store(true, std::memory_order_relaxed);
+    return;
+  }
+  operation_node->cost_estimate = old_estimate + (time - old_estimate) * COST_ESTIMATE_WEIGHT;
+  if (fabsf(time - old_estimate) > max_ff(old_estimate * 0.5f, COST_ESTIMATE_CHANGE_MIN)) {
+    state->need_update_priorities.store(true, std::memory_order_relaxed);
+  }
+}
+
+void evaluate_node(DepsgraphEvalState *state, OperationNode *operation_node)
 {
   ::Depsgraph *depsgraph = reinterpret_cast<::Depsgraph *>(state->graph);
 
   /* Sanity checks. */
   BLI_assert_msg(!operation_node->is_noop(), "NOOP nodes should not actually be scheduled");
-  /* Perform operation. */
+  /* Perform operation. The time is always measured, it is used to prioritize operations in the
+   * following evaluations. */
+  const double start_time = PIL_check_seconds_timer();
+  operation_node->evaluate(depsgraph);
+  const double time = PIL_check_seconds_timer() - start_time;
+  update_cost_estimate(state, operation_node, (float)time);
   if (state->do_stats) {
-    const double start_time = PIL_check_seconds_timer();
-    operation_node->evaluate(depsgraph);
-    operation_node->stats.current_time += PIL_check_seconds_timer() - start_time;
+    operation_node->stats.current_time += time;
+    state->num_operations.fetch_add(1, std::memory_order_relaxed);
   }
-  else {
-    operation_node->evaluate(depsgraph);
+}
+
+/* Scheduling of operations to the task pool. */
+struct TaskScheduleContext {
+  TaskPool *pool;
+  /* Operations to be evaluated in the current task, after the current operation.
+   * Null when scheduling from outside of a task. */
+  Vector<OperationNode *> *inline_operations;
+  /* Sum of cost estimates of the inline operations. */
+  float inline_operations_cost;
+};
+
+void schedule_node_to_pool(OperationNode *node,
+                           const int UNUSED(thread_id),
+                           TaskScheduleContext *context)
+{
+  DepsgraphEvalState *state = (DepsgraphEvalState *)BLI_task_pool_user_data(context->pool);
+
+  /* Operations which were never evaluated have no estimate, they always get a task. */
+  if (context->inline_operations != nullptr && node->cost_estimate >= 0.0f &&
+      context->inline_operations_cost + node->cost_estimate <= INLINE_OPERATIONS_COST_MAX) {
+    context->inline_operations->append(node);
+    context->inline_operations_cost += node->cost_estimate;
+    if (state->do_stats) {
+      state->num_inlined.fetch_add(1, std::memory_order_relaxed);
+    }
+    return;
+  }
+
+  BLI_spin_lock(&state->ready_operations_lock);
+  /* The heap is a min-heap, the highest priority is to be evaluated first. */
+  BLI_heapsimple_insert(state->ready_operations, -node->priority, node);
+  BLI_spin_unlock(&state->ready_operations_lock);
+
+  BLI_task_pool_push(context->pool, deg_task_run_func, nullptr, false, nullptr);
+  if (state->do_stats) {
+    state->num_tasks.fetch_add(1, std::memory_order_relaxed);
   }
 }
 
-void deg_task_run_func(TaskPool *pool, void *taskdata)
+void deg_task_run_func(TaskPool *pool, void *UNUSED(taskdata))
 {
   void *userdata_v = BLI_task_pool_user_data(pool);
   DepsgraphEvalState *state = (DepsgraphEvalState *)userdata_v;
 
-  /* Evaluate node. */
-  OperationNode *operation_node = reinterpret_cast<OperationNode *>(taskdata);
-  evaluate_node(state, operation_node);
+  /* There is a task for every ready operation, but tasks are run in an arbitrary order. Take the
+   * ready operation with the highest priority instead of the one this task was pushed for, so
+   * that the longest chains of operations are started first. */
+  BLI_spin_lock(&state->ready_operations_lock);
+  BLI_assert(!BLI_heapsimple_is_empty(state->ready_operations));
+  OperationNode *operation_node = (OperationNode *)BLI_heapsimple_pop_min(
+      state->ready_operations);
+  BLI_spin_unlock(&state->ready_operations_lock);
+
+  Vector<OperationNode *> inline_operations;
+  TaskScheduleContext context = {pool, &inline_operations, 0.0f};
+  while (true) {
+    /* Evaluate node. */
+    evaluate_node(state, operation_node);
 
-  /* Schedule children. */
-  schedule_children(state, operation_node, schedule_node_to_pool, pool);
+    /* Schedule children. */
+    schedule_children(state, operation_node, schedule_node_to_pool, &context);
+
+    if (inline_operations.is_empty()) {
+      break;
+    }
+    operation_node = inline_operations.pop_last();
+    context.inline_operations_cost -= operation_node->cost_estimate;
+  }
 }
 
 bool check_operation_node_visible(OperationNode *op_node)
@@ -361,6 +461,15 @@ static TaskPool *deg_evaluate_task_pool_create(DepsgraphEvalState *state)
   return BLI_task_pool_create_suspended(state, TASK_PRIORITY_HIGH);
 }
 
+static void deg_evaluate_threaded(DepsgraphEvalState *state)
+{
+  TaskPool *task_pool = deg_evaluate_task_pool_create(state);
+  TaskScheduleContext context = {task_pool, nullptr, 0.0f};
+  schedule_graph(state, schedule_node_to_pool, &context);
+  BLI_task_pool_work_and_wait(task_pool);
+  BLI_task_pool_free(task_pool);
+}
+
 /**
  * Evaluate all nodes tagged for updating,
  * \warning This is usually done as part of main loop, but may also be
@@ -391,34 +500,45 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   state.graph = graph;
   state.do_stats = graph->debug.do_time_debug();
   state.need_single_thread_pass = false;
+  state.ready_operations = BLI_heapsimple_new();
+  BLI_spin_init(&state.ready_operations_lock);
   /* Prepare all nodes for evaluation. */
   initialize_execution(&state, graph);
+  const double start_time = state.do_stats ? PIL_check_seconds_timer() : 0.0;
 
   /* Do actual evaluation now. */
   /* First, process all Copy-On-Write nodes. */
   state.stage = EvaluationStage::COPY_ON_WRITE;
-  TaskPool *task_pool = deg_evaluate_task_pool_create(&state);
-  schedule_graph(&state, schedule_node_to_pool, task_pool);
-  BLI_task_pool_work_and_wait(task_pool);
-  BLI_task_pool_free(task_pool);
+  deg_evaluate_threaded(&state);
 
   /* After that, process all other nodes. */
   state.stage = EvaluationStage::THREADED_EVALUATION;
-  task_pool = deg_evaluate_task_pool_create(&state);
-  schedule_graph(&state, schedule_node_to_pool, task_pool);
-  BLI_task_pool_work_and_wait(task_pool);
-  BLI_task_pool_free(task_pool);
+  deg_evaluate_threaded(&state);
 
   if (state.need_single_thread_pass) {
     state.stage = EvaluationStage::SINGLE_THREADED_WORKAROUND;
     evaluate_graph_single_threaded(&state);
   }
 
+  BLI_spin_end(&state.ready_operations_lock);
+  BLI_heapsimple_free(state.ready_operations, nullptr);
+
+  /* Prioritize operations on the critical path in the next evaluation. */
+  if (state.need_update_priorities) {
+    deg_eval_stats_update_priorities(graph);
+  }
+
   /* Finalize statistics gathering. This is because we only gather single
    * operation timing here, without aggregating anything to avoid any extra
    * synchronization. */
   if (state.do_stats) {
+    DepsgraphDebug::ScheduleStats &schedule_stats = graph->debug.schedule_stats;
+    schedule_stats.num_operations = state.num_operations;
+    schedule_stats.num_tasks = state.num_tasks;
+    schedule_stats.num_inlined = state.num_inlined;
+    schedule_stats.evaluation_time = PIL_check_seconds_timer() - start_time;
     deg_eval_stats_aggregate(graph);
+    deg_eval_stats_schedule_report(graph, stdout);
   }
   /* Clear any uncleared tags - just in case. */
   deg_graph_clear_tags(graph);
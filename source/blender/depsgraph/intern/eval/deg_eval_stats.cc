@@ -24,8 +24,10 @@
 #include "intern/eval/deg_eval_stats.h"
 
 #include "BLI_utildefines.h"
+#include "BLI_vector.hh"
 
 #include "intern/depsgraph.h"
+#include "intern/depsgraph_relation.h"
 
 #include "intern/node/deg_node.h"
 #include "intern/node/deg_node_component.h"
@@ -34,6 +36,48 @@
 
 namespace blender::deg {
 
+namespace {
+
+/* Cost of operations which were not evaluated yet. Makes the priority of such operations follow
+ * the number of operations on the longest path depending on them. */
+const float OPERATION_COST_UNKNOWN = 1e-6f;
+
+/* Relations which order the evaluation of operations. */
+bool is_schedule_relation(const Relation *rel)
+{
+  return rel->from->type == NodeType::OPERATION && rel->to->type == NodeType::OPERATION &&
+         (rel->flag & RELATION_FLAG_CYCLIC) == 0;
+}
+
+float operation_cost(const OperationNode *op_node)
+{
+  if (op_node->is_noop()) {
+    return 0.0f;
+  }
+  if (op_node->cost_estimate < 0.0f) {
+    return OPERATION_COST_UNKNOWN;
+  }
+  return op_node->cost_estimate;
+}
+
+/* Child operation with the highest priority, the next step on the critical path. */
+const OperationNode *critical_child(const OperationNode *op_node)
+{
+  const OperationNode *critical_child = nullptr;
+  for (const Relation *rel : op_node->outlinks) {
+    if (!is_schedule_relation(rel)) {
+      continue;
+    }
+    const OperationNode *child = (const OperationNode *)rel->to;
+    if (critical_child == nullptr || child->priority > critical_child->priority) {
+      critical_child = child;
+    }
+  }
+  return critical_child;
+}
+
+}  // namespace
+
 void deg_eval_stats_aggregate(Depsgraph *graph)
 {
   /* Reset current evaluation stats for ID and component nodes.
@@ -54,4 +98,84 @@ void deg_eval_stats_aggregate(Depsgraph *graph)
   }
 }
 
+void deg_eval_stats_update_priorities(Depsgraph *graph)
+{
+  /* Visit operations in reverse topological order, so that all children of an operation have
+   * their priority calculated before the operation itself. The number of children which are not
+   * visited yet is stored in the custom flags. */
+  Vector<OperationNode *> stack;
+  for (OperationNode *op_node : graph->operations) {
+    op_node->custom_flags = 0;
+    op_node->priority = 0.0f;
+    for (Relation *rel : op_node->outlinks) {
+      if (is_schedule_relation(rel)) {
+        ++op_node->custom_flags;
+      }
+    }
+    if (op_node->custom_flags == 0) {
+      stack.append(op_node);
+    }
+  }
+  while (!stack.is_empty()) {
+    OperationNode *op_node = stack.pop_last();
+    const OperationNode *child = critical_child(op_node);
+    op_node->priority = operation_cost(op_node) + (child ? child->priority : 0.0f);
+    for (Relation *rel : op_node->inlinks) {
+      if (!is_schedule_relation(rel)) {
+        continue;
+      }
+      OperationNode *parent = (OperationNode *)rel->from;
+      if (--parent->custom_flags == 0) {
+        stack.append(parent);
+      }
+    }
+  }
+}
+
+void deg_eval_stats_schedule_report(const Depsgraph *graph, FILE *fp)
+{
+  const DepsgraphDebug::ScheduleStats &schedule_stats = graph->debug.schedule_stats;
+  double operations_time = 0.0;
+  const OperationNode *critical_op_node = nullptr;
+  for (const OperationNode *op_node : graph->operations) {
+    operations_time += op_node->stats.current_time;
+    if (critical_op_node == nullptr || op_node->priority > critical_op_node->priority) {
+      critical_op_node = op_node;
+    }
+  }
+
+  fprintf(fp, "Depsgraph evaluation schedule %s\n", graph->debug.name.c_str());
+  fprintf(fp,
+          "  Operations: %d evaluated, %d in own tasks, %d inlined\n",
+          schedule_stats.num_operations,
+          schedule_stats.num_tasks,
+          schedule_stats.num_inlined);
+  fprintf(fp,
+          "  Time: %f seconds in operations, %f seconds elapsed, parallelism %.2f\n",
+          operations_time,
+          schedule_stats.evaluation_time,
+          schedule_stats.evaluation_time > 0.0 ? operations_time / schedule_stats.evaluation_time :
+                                                 0.0);
+  if (critical_op_node == nullptr) {
+    return;
+  }
+
+  /* Only list the operations which take a noticeable part of the critical path. */
+  const float critical_path_time = critical_op_node->priority;
+  const float min_listed_cost = critical_path_time * 0.05f;
+  fprintf(fp, "  Estimated critical path: %f seconds\n", critical_path_time);
+  int num_path_operations = 0;
+  for (const OperationNode *op_node = critical_op_node; op_node != nullptr;
+       op_node = critical_child(op_node)) {
+    ++num_path_operations;
+    if (operation_cost(op_node) >= min_listed_cost) {
+      fprintf(fp,
+              "    %f seconds: %s\n",
+              operation_cost(op_node),
+              op_node->full_identifier().c_str());
+    }
+  }
+  fprintf(fp, "    %d operations on the path\n", num_path_operations);
+}
+
 }  // namespace blender::deg
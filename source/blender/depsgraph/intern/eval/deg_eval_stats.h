@@ -23,6 +23,8 @@
 
 #pragma once
 
+#include <stdio.h>
+
 namespace blender {
 namespace deg {
 
@@ -31,5 +33,12 @@ struct Depsgraph;
 /* Aggregate operation timings to overall component and ID nodes timing. */
 void deg_eval_stats_aggregate(Depsgraph *graph);
 
+/* Update priorities of all operations from their cost estimates, so that operations on the
+ * critical path of the graph are scheduled first on the next evaluation. */
+void deg_eval_stats_update_priorities(Depsgraph *graph);
+
+/* Print how the last evaluation was scheduled, and the estimated critical path of the graph. */
+void deg_eval_stats_schedule_report(const Depsgraph *graph, FILE *fp);
+
 }  // namespace deg
 }  // namespace blender
@@ -265,6 +265,14 @@ struct OperationNode : public Node {
   uint32_t num_links_pending;
   bool scheduled;
 
+  /* Estimated evaluation time in seconds, averaged over the previous evaluations of this
+   * operation. Negative until the operation was evaluated once. */
+  float cost_estimate;
+  /* Estimated time from the start of this operation until everything which depends on it is
+   * evaluated, the length of the longest path through the graph starting at this operation.
+   * Operations with a higher priority are evaluated first. */
+  float priority;
+
   /* Identifier for the operation being performed. */
   OperationCode opcode;
   int name_tag;
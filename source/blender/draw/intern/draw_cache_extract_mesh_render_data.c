@@ -33,6 +33,8 @@
 #include "BKE_editmesh.h"
 #include "BKE_editmesh_cache.h"
 #include "BKE_mesh.h"
+#include "BKE_mesh_mapping.h"
+#include "BKE_mesh_runtime.h"
 
 #include "GPU_batch.h"
 
@@ -389,21 +391,25 @@ void mesh_render_data_update_normals(MeshRenderData *mr, const eMRDataType data_
     if (((data_flag & MR_DATA_LOOP_NOR) && is_auto_smooth) || (data_flag & MR_DATA_TAN_LOOP_NOR)) {
       mr->loop_normals = MEM_mallocN(sizeof(*mr->loop_normals) * mr->loop_len, __func__);
       short(*clnors)[2] = CustomData_get_layer(&mr->me->ldata, CD_CUSTOMLOOPNORMAL);
-      BKE_mesh_normals_loop_split(mr->me->mvert,
-                                  mr->vert_len,
-                                  mr->me->medge,
-                                  mr->edge_len,
-                                  mr->me->mloop,
-                                  mr->loop_normals,
-                                  mr->loop_len,
-                                  mr->me->mpoly,
-                                  mr->poly_normals,
-                                  mr->poly_len,
-                                  is_auto_smooth,
-                                  split_angle,
-                                  NULL,
-                                  clnors,
-                                  NULL);
+      const MeshElemMap *edge_to_loop_map = (is_auto_smooth && (me->id.tag & LIB_TAG_NO_MAIN)) ?
+                                                BKE_mesh_runtime_edge_loop_map_ensure(me) :
+                                                NULL;
+      BKE_mesh_normals_loop_split_with_map(mr->me->mvert,
+                                           mr->vert_len,
+                                           mr->me->medge,
+                                           mr->edge_len,
+                                           mr->me->mloop,
+                                           mr->loop_normals,
+                                           mr->loop_len,
+                                           mr->me->mpoly,
+                                           mr->poly_normals,
+                                           mr->poly_len,
+                                           is_auto_smooth,
+                                           split_angle,
+                                           NULL,
+                                           clnors,
+                                           NULL,
+                                           edge_to_loop_map);
     }
   }
   else {
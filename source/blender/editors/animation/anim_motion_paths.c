@@ -74,14 +74,8 @@ static void motionpaths_calc_update_scene(struct Depsgraph *depsgraph)
   BKE_scene_graph_update_for_newframe(depsgraph);
 }
 
-Depsgraph *animviz_depsgraph_build(Main *bmain,
-                                   Scene *scene,
-                                   ViewLayer *view_layer,
-                                   ListBase *targets)
+static void animviz_depsgraph_build_targets(Depsgraph *depsgraph, ListBase *targets)
 {
-  /* Allocate dependency graph. */
-  Depsgraph *depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
-
   /* Make a flat array of IDs for the DEG API. */
   const int num_ids = BLI_listbase_count(targets);
   ID **ids = MEM_malloc_arrayN(sizeof(ID *), num_ids, "animviz IDS");
@@ -93,6 +87,16 @@ Depsgraph *animviz_depsgraph_build(Main *bmain,
   /* Build graph from all requested IDs. */
   DEG_graph_build_from_ids(depsgraph, ids, num_ids);
   MEM_freeN(ids);
+}
+
+Depsgraph *animviz_depsgraph_build(Main *bmain,
+                                   Scene *scene,
+                                   ViewLayer *view_layer,
+                                   ListBase *targets)
+{
+  /* Allocate dependency graph. */
+  Depsgraph *depsgraph = DEG_graph_new(bmain, scene, view_layer, DAG_EVAL_VIEWPORT);
+  animviz_depsgraph_build_targets(depsgraph, targets);
 
   /* Update once so we can access pointers of evaluated animation data. */
   motionpaths_calc_update_scene(depsgraph);
@@ -138,8 +142,8 @@ void animviz_get_object_motionpaths(Object *ob, ListBase *targets)
 
 /* ........ */
 
-/* perform baking for the targets on the current frame */
-static void motionpaths_calc_bake_targets(ListBase *targets, int cframe)
+/* perform baking for the targets on the given frame, which the depsgraph is evaluated at */
+static void motionpaths_calc_bake_targets(ListBase *targets, int cframe, Depsgraph *depsgraph)
 {
   MPathTarget *mpt;
 
@@ -157,7 +161,7 @@ static void motionpaths_calc_bake_targets(ListBase *targets, int cframe)
     /* get the relevant cache vert to write to */
     bMotionPathVert *mpv = mpath->points + (cframe - mpath->start_frame);
 
-    Object *ob_eval = mpt->ob_eval;
+    Object *ob_eval = DEG_get_evaluated_object(depsgraph, mpt->ob);
 
     /* Lookup evaluated pose channel, here because the depsgraph
      * evaluation can change them so they are not cached in mpt. */
@@ -349,6 +353,42 @@ static void motionpath_calculate_update_range(MPathTarget *mpt,
   }
 }
 
+static void motionpaths_calc_build_fn(Depsgraph *depsgraph, void *user_data)
+{
+  animviz_depsgraph_build_targets(depsgraph, (ListBase *)user_data);
+}
+
+static void motionpaths_calc_frame_fn(Depsgraph *depsgraph, float frame, void *user_data)
+{
+  motionpaths_calc_bake_targets((ListBase *)user_data, (int)frame, depsgraph);
+}
+
+/* Evaluate the frames with separate dependency graphs in parallel. */
+static void motionpaths_calc_frame_range(
+    Main *bmain, Scene *scene, ViewLayer *view_layer, ListBase *targets, int sfra, int efra)
+{
+  const int frames_num = efra - sfra + 1;
+  float *frames = MEM_malloc_arrayN(frames_num, sizeof(float), __func__);
+  for (int i = 0; i < frames_num; i++) {
+    frames[i] = (float)(sfra + i);
+  }
+
+  DEGFrameRangeEvalSettings settings = {
+      .bmain = bmain,
+      .scene = scene,
+      .view_layer = view_layer,
+      .mode = DAG_EVAL_VIEWPORT,
+      .frames = frames,
+      .frames_num = frames_num,
+      .build_fn = motionpaths_calc_build_fn,
+      .frame_fn = motionpaths_calc_frame_fn,
+      .user_data = targets,
+  };
+  DEG_evaluate_frame_range(&settings);
+
+  MEM_freeN(frames);
+}
+
 static void motionpath_free_free_tree_data(ListBase *targets)
 {
   LISTBASE_FOREACH (MPathTarget *, mpt, targets) {
@@ -468,18 +508,21 @@ void animviz_calc_motionpaths(Depsgraph *depsgraph,
             sfra,
             efra,
             efra - sfra + 1);
-  for (CFRA = sfra; CFRA <= efra; CFRA++) {
-    if (range == ANIMVIZ_CALC_RANGE_CURRENT_FRAME) {
-      /* For current frame, only update tagged. */
-      BKE_scene_graph_update_tagged(depsgraph, bmain);
-    }
-    else {
-      /* Update relevant data for new frame. */
-      motionpaths_calc_update_scene(depsgraph);
-    }
+  if (range == ANIMVIZ_CALC_RANGE_CURRENT_FRAME) {
+    /* For current frame, only update tagged. */
+    BKE_scene_graph_update_tagged(depsgraph, bmain);
 
     /* perform baking for targets */
-    motionpaths_calc_bake_targets(targets, CFRA);
+    motionpaths_calc_bake_targets(targets, CFRA, depsgraph);
+  }
+  else {
+    /* Frame change handlers are not called for the frames of the range. */
+    motionpaths_calc_frame_range(bmain,
+                                 scene,
+                                 DEG_get_input_view_layer(depsgraph),
+                                 targets,
+                                 sfra,
+                                 efra);
   }
 
   /* reset original environment */
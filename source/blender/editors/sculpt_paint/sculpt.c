@@ -31,6 +31,7 @@
 #include "BLI_hash.h"
 #include "BLI_math.h"
 #include "BLI_math_color_blend.h"
+#include "BLI_simd.h"
 #include "BLI_task.h"
 #include "BLI_utildefines.h"
 
@@ -2462,16 +2463,11 @@ static float brush_strength(const Sculpt *sd,
   }
 }
 
-/* Return a multiplier for brush strength on a particular vertex. */
-float SCULPT_brush_strength_factor(SculptSession *ss,
-                                   const Brush *br,
-                                   const float brush_point[3],
-                                   const float len,
-                                   const short vno[3],
-                                   const float fno[3],
-                                   const float mask,
-                                   const int vertex_index,
-                                   const int thread_id)
+/* Strength of the brush texture at a vertex. */
+static float sculpt_brush_texture_strength(SculptSession *ss,
+                                           const Brush *br,
+                                           const float brush_point[3],
+                                           const int thread_id)
 {
   StrokeCache *cache = ss->cache;
   const Scene *scene = cache->vc->scene;
@@ -2532,6 +2528,23 @@ float SCULPT_brush_strength_factor(SculptSession *ss,
     }
   }
 
+  return avg;
+}
+
+/* Return a multiplier for brush strength on a particular vertex. */
+float SCULPT_brush_strength_factor(SculptSession *ss,
+                                   const Brush *br,
+                                   const float brush_point[3],
+                                   const float len,
+                                   const short vno[3],
+                                   const float fno[3],
+                                   const float mask,
+                                   const int vertex_index,
+                                   const int thread_id)
+{
+  StrokeCache *cache = ss->cache;
+  float avg = sculpt_brush_texture_strength(ss, br, brush_point, thread_id);
+
   /* Hardness. */
   float final_len = len;
   const float hardness = cache->paint_brush.hardness;
@@ -2560,6 +2573,307 @@ float SCULPT_brush_strength_factor(SculptSession *ss,
   return avg;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Brush Batch Evaluation
+ *
+ * Same as the per-vertex brush tests and #SCULPT_brush_strength_factor, for a batch of vertices
+ * of a node. The tests, hardness, falloff curve presets, front faces and mask are evaluated four
+ * vertices at a time with SSE2 when available, the remaining vertices of the batch use the
+ * scalar loops. The texture, custom falloff curve and auto-masking are still sampled per vertex.
+ * \{ */
+
+#ifdef BLI_HAVE_SSE2
+BLI_INLINE __m128 sculpt_batch_select(const __m128 mask, const __m128 a, const __m128 b)
+{
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+BLI_INLINE void sculpt_batch_store_active(bool active[4], const __m128 mask)
+{
+  const int bits = _mm_movemask_ps(mask);
+  active[0] = bits & 1;
+  active[1] = (bits >> 1) & 1;
+  active[2] = (bits >> 2) & 1;
+  active[3] = (bits >> 3) & 1;
+}
+#endif
+
+void SCULPT_brush_batch_init(SculptBrushBatch *batch, const bool use_normals)
+{
+  batch->totvert = 0;
+  batch->use_normals = use_normals;
+}
+
+static void sculpt_brush_batch_test_clipping(SculptBrushBatch *batch,
+                                             const SculptBrushTest *test)
+{
+  if (!test->clip_rv3d) {
+    return;
+  }
+  for (int i = 0; i < batch->totvert; i++) {
+    if (batch->active[i]) {
+      const float co[3] = {batch->co[0][i], batch->co[1][i], batch->co[2][i]};
+      batch->active[i] = !sculpt_brush_test_clipping(test, co);
+    }
+  }
+}
+
+void SCULPT_brush_batch_test(SculptBrushBatch *batch,
+                             const SculptBrushTest *test,
+                             const char falloff_shape)
+{
+  const int totvert = batch->totvert;
+  const float *co_x = batch->co[0];
+  const float *co_y = batch->co[1];
+  const float *co_z = batch->co[2];
+  const float *location = test->location;
+  const float radius_squared = test->radius_squared;
+  float *dist = batch->dist;
+  bool *active = batch->active;
+
+  /* The tube falloff uses the distance of the coordinates projected on the view plane, like
+   * #SCULPT_brush_test_circle_sq. A zero plane keeps the coordinates for the sphere falloff. */
+  float plane[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  if (falloff_shape != PAINT_FALLOFF_SHAPE_SPHERE) {
+    copy_v4_v4(plane, test->plane_view);
+  }
+
+  int i = 0;
+#ifdef BLI_HAVE_SSE2
+  const __m128 plane_x = _mm_set1_ps(plane[0]);
+  const __m128 plane_y = _mm_set1_ps(plane[1]);
+  const __m128 plane_z = _mm_set1_ps(plane[2]);
+  const __m128 plane_w = _mm_set1_ps(plane[3]);
+  const __m128 location_x = _mm_set1_ps(location[0]);
+  const __m128 location_y = _mm_set1_ps(location[1]);
+  const __m128 location_z = _mm_set1_ps(location[2]);
+  const __m128 radius_squared_v = _mm_set1_ps(radius_squared);
+  for (; i + 4 <= totvert; i += 4) {
+    const __m128 px = _mm_loadu_ps(&co_x[i]);
+    const __m128 py = _mm_loadu_ps(&co_y[i]);
+    const __m128 pz = _mm_loadu_ps(&co_z[i]);
+    const __m128 side = _mm_add_ps(
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane_x, px), _mm_mul_ps(plane_y, py)),
+                   _mm_mul_ps(plane_z, pz)),
+        plane_w);
+    const __m128 x = _mm_sub_ps(_mm_sub_ps(px, _mm_mul_ps(plane_x, side)), location_x);
+    const __m128 y = _mm_sub_ps(_mm_sub_ps(py, _mm_mul_ps(plane_y, side)), location_y);
+    const __m128 z = _mm_sub_ps(_mm_sub_ps(pz, _mm_mul_ps(plane_z, side)), location_z);
+    const __m128 dist_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+                                           _mm_mul_ps(z, z));
+    sculpt_batch_store_active(&active[i], _mm_cmple_ps(dist_squared, radius_squared_v));
+    _mm_storeu_ps(&dist[i], _mm_sqrt_ps(dist_squared));
+  }
+#endif
+  for (; i < totvert; i++) {
+    const float side = plane[0] * co_x[i] + plane[1] * co_y[i] + plane[2] * co_z[i] + plane[3];
+    const float x = (co_x[i] - plane[0] * side) - location[0];
+    const float y = (co_y[i] - plane[1] * side) - location[1];
+    const float z = (co_z[i] - plane[2] * side) - location[2];
+    const float dist_squared = x * x + y * y + z * z;
+    active[i] = dist_squared <= radius_squared;
+    dist[i] = sqrtf(dist_squared);
+  }
+  sculpt_brush_batch_test_clipping(batch, test);
+}
+
+void SCULPT_brush_batch_test_cube(SculptBrushBatch *batch,
+                                  const SculptBrushTest *test,
+                                  const float local[4][4],
+                                  const float roundness)
+{
+  const int totvert = batch->totvert;
+  const float *co_x = batch->co[0];
+  const float *co_y = batch->co[1];
+  const float *co_z = batch->co[2];
+  float *dist = batch->dist;
+  bool *active = batch->active;
+
+  /* Keep the square and circular brush tips the same size, see #SCULPT_brush_test_cube. */
+  float side = M_SQRT1_2;
+  side += (1.0f - side) * roundness;
+
+  const float hardness = 1.0f - roundness;
+  const float constant_side = hardness * side;
+  const float falloff_side = roundness * side;
+
+  /* The distance is the one to the center of the corner circle in the corners, the one to the
+   * square XY axis on the sides and constant inside the square. */
+  int i = 0;
+#ifdef BLI_HAVE_SSE2
+  __m128 mat[4][3];
+  for (int j = 0; j < 4; j++) {
+    for (int k = 0; k < 3; k++) {
+      mat[j][k] = _mm_set1_ps(local[j][k]);
+    }
+  }
+  const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  const __m128 side_v = _mm_set1_ps(side);
+  const __m128 constant_side_v = _mm_set1_ps(constant_side);
+  const __m128 falloff_side_v = _mm_set1_ps(falloff_side);
+  for (; i + 4 <= totvert; i += 4) {
+    const __m128 px = _mm_loadu_ps(&co_x[i]);
+    const __m128 py = _mm_loadu_ps(&co_y[i]);
+    const __m128 pz = _mm_loadu_ps(&co_z[i]);
+    __m128 local_co[3];
+    for (int k = 0; k < 3; k++) {
+      const __m128 co = _mm_add_ps(
+          _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, mat[0][k]), _mm_mul_ps(py, mat[1][k])),
+                     _mm_mul_ps(mat[2][k], pz)),
+          mat[3][k]);
+      local_co[k] = _mm_and_ps(co, abs_mask);
+    }
+    const __m128 inside = _mm_and_ps(
+        _mm_and_ps(_mm_cmple_ps(local_co[0], side_v), _mm_cmple_ps(local_co[1], side_v)),
+        _mm_cmple_ps(local_co[2], side_v));
+    sculpt_batch_store_active(&active[i], inside);
+
+    const __m128 corner_x = _mm_sub_ps(constant_side_v, local_co[0]);
+    const __m128 corner_y = _mm_sub_ps(constant_side_v, local_co[1]);
+    const __m128 corner_dist = _mm_div_ps(
+        _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(corner_x, corner_x), _mm_mul_ps(corner_y, corner_y))),
+        falloff_side_v);
+    const __m128 max_xy = _mm_max_ps(local_co[0], local_co[1]);
+    const __m128 min_xy = _mm_min_ps(local_co[0], local_co[1]);
+    const __m128 side_dist = _mm_div_ps(_mm_sub_ps(max_xy, constant_side_v), falloff_side_v);
+    const __m128 edge_dist = _mm_and_ps(_mm_cmpgt_ps(max_xy, constant_side_v), side_dist);
+    _mm_storeu_ps(
+        &dist[i],
+        sculpt_batch_select(_mm_cmpgt_ps(min_xy, constant_side_v), corner_dist, edge_dist));
+  }
+#endif
+  for (; i < totvert; i++) {
+    float local_co[3];
+    for (int k = 0; k < 3; k++) {
+      local_co[k] = fabsf(co_x[i] * local[0][k] + co_y[i] * local[1][k] +
+                          local[2][k] * co_z[i] + local[3][k]);
+    }
+    active[i] = local_co[0] <= side && local_co[1] <= side && local_co[2] <= side;
+
+    if (min_ff(local_co[0], local_co[1]) > constant_side) {
+      float r_point[3];
+      copy_v3_fl(r_point, constant_side);
+      dist[i] = len_v2v2(r_point, local_co) / falloff_side;
+    }
+    else if (max_ff(local_co[0], local_co[1]) > constant_side) {
+      dist[i] = (max_ff(local_co[0], local_co[1]) - constant_side) / falloff_side;
+    }
+    else {
+      dist[i] = 0.0f;
+    }
+  }
+  sculpt_brush_batch_test_clipping(batch, test);
+}
+
+void SCULPT_brush_batch_strength_factor(SculptSession *ss,
+                                        const Brush *br,
+                                        SculptBrushBatch *batch,
+                                        const int thread_id)
+{
+  StrokeCache *cache = ss->cache;
+  const int totvert = batch->totvert;
+  const float *dist = batch->dist;
+  float *fade = batch->fade;
+
+  if (br->mtex.tex) {
+    for (int i = 0; i < totvert; i++) {
+      const float co[3] = {batch->co[0][i], batch->co[1][i], batch->co[2][i]};
+      fade[i] = batch->active[i] ? sculpt_brush_texture_strength(ss, br, co, thread_id) : 0.0f;
+    }
+  }
+  else {
+    copy_vn_fl(fade, totvert, 1.0f);
+  }
+
+  /* Hardness. */
+  const float radius = cache->radius;
+  const float hardness = cache->paint_brush.hardness;
+  const bool is_hard = hardness == 1.0f;
+  float falloff[SCULPT_BRUSH_BATCH_SIZE];
+  int i = 0;
+#ifdef BLI_HAVE_SSE2
+  const __m128 radius_v = _mm_set1_ps(radius);
+  const __m128 hardness_v = _mm_set1_ps(hardness);
+  const __m128 softness_v = _mm_set1_ps(1.0f - hardness);
+  for (; i + 4 <= totvert; i += 4) {
+    const __m128 p = _mm_div_ps(_mm_loadu_ps(&dist[i]), radius_v);
+    const __m128 len = is_hard ? radius_v :
+                                 _mm_mul_ps(_mm_div_ps(_mm_sub_ps(p, hardness_v), softness_v),
+                                            radius_v);
+    _mm_storeu_ps(&falloff[i], _mm_andnot_ps(_mm_cmplt_ps(p, hardness_v), len));
+  }
+#endif
+  for (; i < totvert; i++) {
+    const float p = dist[i] / radius;
+    if (p < hardness) {
+      falloff[i] = 0.0f;
+    }
+    else if (is_hard) {
+      falloff[i] = radius;
+    }
+    else {
+      falloff[i] = ((p - hardness) / (1.0f - hardness)) * radius;
+    }
+  }
+
+  /* Falloff curve. */
+  BKE_brush_curve_strength_array(br, falloff, radius, falloff, totvert);
+
+  /* Front faces and paint mask. */
+  const bool use_frontface = br->flag & BRUSH_FRONTFACE;
+  BLI_assert(!use_frontface || batch->use_normals);
+  const float *view_normal = cache->view_normal;
+  const float *no_x = batch->no[0];
+  const float *no_y = batch->no[1];
+  const float *no_z = batch->no[2];
+  const float *mask = batch->mask;
+  i = 0;
+#ifdef BLI_HAVE_SSE2
+  const __m128 view_normal_x = _mm_set1_ps(view_normal[0]);
+  const __m128 view_normal_y = _mm_set1_ps(view_normal[1]);
+  const __m128 view_normal_z = _mm_set1_ps(view_normal[2]);
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (; i + 4 <= totvert; i += 4) {
+    __m128 fade_v = _mm_mul_ps(_mm_loadu_ps(&fade[i]), _mm_loadu_ps(&falloff[i]));
+    if (use_frontface) {
+      const __m128 dot = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&no_x[i]), view_normal_x),
+                     _mm_mul_ps(_mm_loadu_ps(&no_y[i]), view_normal_y)),
+          _mm_mul_ps(_mm_loadu_ps(&no_z[i]), view_normal_z));
+      fade_v = _mm_mul_ps(fade_v, _mm_max_ps(dot, _mm_setzero_ps()));
+    }
+    fade_v = _mm_mul_ps(fade_v, _mm_sub_ps(one, _mm_loadu_ps(&mask[i])));
+    _mm_storeu_ps(&fade[i], fade_v);
+  }
+#endif
+  for (; i < totvert; i++) {
+    fade[i] *= falloff[i];
+    if (use_frontface) {
+      const float dot = no_x[i] * view_normal[0] + no_y[i] * view_normal[1] +
+                        no_z[i] * view_normal[2];
+      fade[i] *= dot > 0.0f ? dot : 0.0f;
+    }
+    fade[i] *= 1.0f - mask[i];
+  }
+
+  /* Auto-masking. */
+  AutomaskingCache *automasking = cache->automasking;
+  if (automasking && automasking->factor) {
+    for (i = 0; i < totvert; i++) {
+      fade[i] *= automasking->factor[batch->index[i]];
+    }
+  }
+  else if (automasking) {
+    for (i = 0; i < totvert; i++) {
+      if (batch->active[i]) {
+        fade[i] *= SCULPT_automasking_factor_get(automasking, ss, batch->index[i]);
+      }
+    }
+  }
+}
+
+/** \} */
+
 /* Test AABB against sphere. */
 bool SCULPT_search_sphere_cb(PBVHNode *node, void *data_v)
 {
@@ -3259,6 +3573,33 @@ static void do_displacement_smear_brush(Sculpt *sd, Object *ob, PBVHNode **nodes
 
 /** \} */
 
+static void do_draw_brush_batch(SculptThreadedTaskData *data,
+                                SculptBrushBatch *batch,
+                                const SculptBrushTest *test,
+                                float (*proxy)[3],
+                                const int thread_id)
+{
+  SculptSession *ss = data->ob->sculpt;
+  const Brush *brush = data->brush;
+  const float *offset = data->offset;
+
+  SCULPT_brush_batch_test(batch, test, brush->falloff_shape);
+  SCULPT_brush_batch_strength_factor(ss, brush, batch, thread_id);
+
+  for (int i = 0; i < batch->totvert; i++) {
+    if (!batch->active[i]) {
+      continue;
+    }
+    /* Offset vertex. */
+    mul_v3_v3fl(proxy[batch->node_index[i]], offset, batch->fade[i]);
+
+    if (batch->mvert[i]) {
+      batch->mvert[i]->flag |= ME_VERT_PBVH_UPDATE;
+    }
+  }
+  batch->totvert = 0;
+}
+
 static void do_draw_brush_task_cb_ex(void *__restrict userdata,
                                      const int n,
                                      const TaskParallelTLS *__restrict tls)
@@ -3266,7 +3607,6 @@ static void do_draw_brush_task_cb_ex(void *__restrict userdata,
   SculptThreadedTaskData *data = userdata;
   SculptSession *ss = data->ob->sculpt;
   const Brush *brush = data->brush;
-  const float *offset = data->offset;
 
   PBVHVertexIter vd;
   float(*proxy)[3];
@@ -3274,32 +3614,20 @@ static void do_draw_brush_task_cb_ex(void *__restrict userdata,
   proxy = BKE_pbvh_node_add_proxy(ss->pbvh, data->nodes[n])->co;
 
   SculptBrushTest test;
-  SculptBrushTestFn sculpt_brush_test_sq_fn = SCULPT_brush_test_init_with_falloff_shape(
-      ss, &test, data->brush->falloff_shape);
+  SCULPT_brush_test_init_with_falloff_shape(ss, &test, data->brush->falloff_shape);
   const int thread_id = BLI_task_parallel_thread_id(tls);
 
-  BKE_pbvh_vertex_iter_begin (ss->pbvh, data->nodes[n], vd, PBVH_ITER_UNIQUE) {
-    if (!sculpt_brush_test_sq_fn(&test, vd.co)) {
-      continue;
-    }
-    /* Offset vertex. */
-    const float fade = SCULPT_brush_strength_factor(ss,
-                                                    brush,
-                                                    vd.co,
-                                                    sqrtf(test.dist),
-                                                    vd.no,
-                                                    vd.fno,
-                                                    vd.mask ? *vd.mask : 0.0f,
-                                                    vd.index,
-                                                    thread_id);
-
-    mul_v3_v3fl(proxy[vd.i], offset, fade);
+  SculptBrushBatch batch;
+  SCULPT_brush_batch_init(&batch, brush->flag & BRUSH_FRONTFACE);
 
-    if (vd.mvert) {
-      vd.mvert->flag |= ME_VERT_PBVH_UPDATE;
+  BKE_pbvh_vertex_iter_begin (ss->pbvh, data->nodes[n], vd, PBVH_ITER_UNIQUE) {
+    if (SCULPT_brush_batch_add(&batch, &vd, vd.co, vd.no, vd.fno)) {
+      do_draw_brush_batch(data, &batch, &test, proxy, thread_id);
     }
   }
   BKE_pbvh_vertex_iter_end;
+
+  do_draw_brush_batch(data, &batch, &test, proxy, thread_id);
 }
 
 static void do_draw_brush(Sculpt *sd, Object *ob, PBVHNode **nodes, int totnode)
@@ -3967,6 +4295,49 @@ static void do_pinch_brush(Sculpt *sd, Object *ob, PBVHNode **nodes, int totnode
   BLI_task_parallel_range(0, totnode, &data, do_pinch_brush_task_cb_ex, &settings);
 }
 
+static void do_grab_brush_batch(SculptThreadedTaskData *data,
+                                SculptBrushBatch *batch,
+                                const SculptBrushTest *test,
+                                float (*proxy)[3],
+                                const int thread_id)
+{
+  SculptSession *ss = data->ob->sculpt;
+  const Brush *brush = data->brush;
+  const float *grab_delta = data->grab_delta;
+  const float bstrength = ss->cache->bstrength;
+
+  SCULPT_brush_batch_test(batch, test, brush->falloff_shape);
+  SCULPT_brush_batch_strength_factor(ss, brush, batch, thread_id);
+
+  const bool grab_silhouette = brush->flag2 & BRUSH_GRAB_SILHOUETTE;
+  float silhouette_test_dir[3];
+  if (grab_silhouette) {
+    normalize_v3_v3(silhouette_test_dir, grab_delta);
+    if (dot_v3v3(ss->cache->initial_normal, ss->cache->grab_delta_symmetry) < 0.0f) {
+      mul_v3_fl(silhouette_test_dir, -1.0f);
+    }
+  }
+
+  for (int i = 0; i < batch->totvert; i++) {
+    if (!batch->active[i]) {
+      continue;
+    }
+    float fade = bstrength * batch->fade[i];
+
+    if (grab_silhouette) {
+      const float vno[3] = {batch->no[0][i], batch->no[1][i], batch->no[2][i]};
+      fade *= max_ff(dot_v3v3(vno, silhouette_test_dir), 0.0f);
+    }
+
+    mul_v3_v3fl(proxy[batch->node_index[i]], grab_delta, fade);
+
+    if (batch->mvert[i]) {
+      batch->mvert[i]->flag |= ME_VERT_PBVH_UPDATE;
+    }
+  }
+  batch->totvert = 0;
+}
+
 static void do_grab_brush_task_cb_ex(void *__restrict userdata,
                                      const int n,
                                      const TaskParallelTLS *__restrict tls)
@@ -3974,58 +4345,35 @@ static void do_grab_brush_task_cb_ex(void *__restrict userdata,
   SculptThreadedTaskData *data = userdata;
   SculptSession *ss = data->ob->sculpt;
   const Brush *brush = data->brush;
-  const float *grab_delta = data->grab_delta;
 
   PBVHVertexIter vd;
   SculptOrigVertData orig_data;
   float(*proxy)[3];
-  const float bstrength = ss->cache->bstrength;
 
   SCULPT_orig_vert_data_init(&orig_data, data->ob, data->nodes[n]);
 
   proxy = BKE_pbvh_node_add_proxy(ss->pbvh, data->nodes[n])->co;
 
   SculptBrushTest test;
-  SculptBrushTestFn sculpt_brush_test_sq_fn = SCULPT_brush_test_init_with_falloff_shape(
-      ss, &test, data->brush->falloff_shape);
+  SCULPT_brush_test_init_with_falloff_shape(ss, &test, data->brush->falloff_shape);
   const int thread_id = BLI_task_parallel_thread_id(tls);
 
-  const bool grab_silhouette = brush->flag2 & BRUSH_GRAB_SILHOUETTE;
+  /* Original normals are used for the front faces test and the silhouette. */
+  SculptBrushBatch batch;
+  SCULPT_brush_batch_init(&batch,
+                          (brush->flag & BRUSH_FRONTFACE) ||
+                              (brush->flag2 & BRUSH_GRAB_SILHOUETTE));
 
   BKE_pbvh_vertex_iter_begin (ss->pbvh, data->nodes[n], vd, PBVH_ITER_UNIQUE) {
     SCULPT_orig_vert_data_update(&orig_data, &vd);
 
-    if (!sculpt_brush_test_sq_fn(&test, orig_data.co)) {
-      continue;
-    }
-    float fade = bstrength * SCULPT_brush_strength_factor(ss,
-                                                          brush,
-                                                          orig_data.co,
-                                                          sqrtf(test.dist),
-                                                          orig_data.no,
-                                                          NULL,
-                                                          vd.mask ? *vd.mask : 0.0f,
-                                                          vd.index,
-                                                          thread_id);
-
-    if (grab_silhouette) {
-      float silhouette_test_dir[3];
-      normalize_v3_v3(silhouette_test_dir, grab_delta);
-      if (dot_v3v3(ss->cache->initial_normal, ss->cache->grab_delta_symmetry) < 0.0f) {
-        mul_v3_fl(silhouette_test_dir, -1.0f);
-      }
-      float vno[3];
-      normal_short_to_float_v3(vno, orig_data.no);
-      fade *= max_ff(dot_v3v3(vno, silhouette_test_dir), 0.0f);
-    }
-
-    mul_v3_v3fl(proxy[vd.i], grab_delta, fade);
-
-    if (vd.mvert) {
-      vd.mvert->flag |= ME_VERT_PBVH_UPDATE;
+    if (SCULPT_brush_batch_add(&batch, &vd, orig_data.co, orig_data.no, NULL)) {
+      do_grab_brush_batch(data, &batch, &test, proxy, thread_id);
     }
   }
   BKE_pbvh_vertex_iter_end;
+
+  do_grab_brush_batch(data, &batch, &test, proxy, thread_id);
 }
 
 static void do_grab_brush(Sculpt *sd, Object *ob, PBVHNode **nodes, int totnode)
@@ -5155,6 +5503,63 @@ static void do_clay_brush(Sculpt *sd, Object *ob, PBVHNode **nodes, int totnode)
   BLI_task_parallel_range(0, totnode, &data, do_clay_brush_task_cb_ex, &settings);
 }
 
+static void do_clay_strips_brush_batch(SculptThreadedTaskData *data,
+                                       SculptBrushBatch *batch,
+                                       const SculptBrushTest *test,
+                                       float (*proxy)[3],
+                                       const int thread_id)
+{
+  SculptSession *ss = data->ob->sculpt;
+  const Brush *brush = data->brush;
+  const bool flip = (ss->cache->bstrength < 0.0f);
+  const float bstrength = flip ? -ss->cache->bstrength : ss->cache->bstrength;
+
+  SCULPT_brush_batch_test_cube(batch, test, data->mat, brush->tip_roundness);
+
+  for (int i = 0; i < batch->totvert; i++) {
+    if (!batch->active[i]) {
+      continue;
+    }
+    const float co[3] = {batch->co[0][i], batch->co[1][i], batch->co[2][i]};
+
+    if (!plane_point_side_flip(co, test->plane_tool, flip)) {
+      batch->active[i] = false;
+      continue;
+    }
+
+    float intr[3];
+    float val[3];
+    closest_to_plane_normalized_v3(intr, test->plane_tool, co);
+    sub_v3_v3v3(val, intr, co);
+
+    batch->active[i] = SCULPT_plane_trim(ss->cache, brush, val);
+  }
+
+  for (int i = 0; i < batch->totvert; i++) {
+    batch->dist[i] = ss->cache->radius * batch->dist[i];
+  }
+  /* The normal from the vertices is ignored, it causes glitch with planes, see: T44390. */
+  SCULPT_brush_batch_strength_factor(ss, brush, batch, thread_id);
+
+  for (int i = 0; i < batch->totvert; i++) {
+    if (!batch->active[i]) {
+      continue;
+    }
+    const float co[3] = {batch->co[0][i], batch->co[1][i], batch->co[2][i]};
+    float intr[3];
+    float val[3];
+    closest_to_plane_normalized_v3(intr, test->plane_tool, co);
+    sub_v3_v3v3(val, intr, co);
+
+    mul_v3_v3fl(proxy[batch->node_index[i]], val, bstrength * batch->fade[i]);
+
+    if (batch->mvert[i]) {
+      batch->mvert[i]->flag |= ME_VERT_PBVH_UPDATE;
+    }
+  }
+  batch->totvert = 0;
+}
+
 static void do_clay_strips_brush_task_cb_ex(void *__restrict userdata,
                                             const int n,
                                             const TaskParallelTLS *__restrict tls)
@@ -5162,15 +5567,12 @@ static void do_clay_strips_brush_task_cb_ex(void *__restrict userdata,
   SculptThreadedTaskData *data = userdata;
   SculptSession *ss = data->ob->sculpt;
   const Brush *brush = data->brush;
-  float(*mat)[4] = data->mat;
   const float *area_no_sp = data->area_no_sp;
   const float *area_co = data->area_co;
 
   PBVHVertexIter vd;
   SculptBrushTest test;
   float(*proxy)[3];
-  const bool flip = (ss->cache->bstrength < 0.0f);
-  const float bstrength = flip ? -ss->cache->bstrength : ss->cache->bstrength;
 
   proxy = BKE_pbvh_node_add_proxy(ss->pbvh, data->nodes[n])->co;
 
@@ -5178,41 +5580,17 @@ static void do_clay_strips_brush_task_cb_ex(void *__restrict userdata,
   plane_from_point_normal_v3(test.plane_tool, area_co, area_no_sp);
   const int thread_id = BLI_task_parallel_thread_id(tls);
 
-  BKE_pbvh_vertex_iter_begin (ss->pbvh, data->nodes[n], vd, PBVH_ITER_UNIQUE) {
-    if (!SCULPT_brush_test_cube(&test, vd.co, mat, brush->tip_roundness)) {
-      continue;
-    }
-
-    if (!plane_point_side_flip(vd.co, test.plane_tool, flip)) {
-      continue;
-    }
-
-    float intr[3];
-    float val[3];
-    closest_to_plane_normalized_v3(intr, test.plane_tool, vd.co);
-    sub_v3_v3v3(val, intr, vd.co);
-
-    if (!SCULPT_plane_trim(ss->cache, brush, val)) {
-      continue;
-    }
-    /* The normal from the vertices is ignored, it causes glitch with planes, see: T44390. */
-    const float fade = bstrength * SCULPT_brush_strength_factor(ss,
-                                                                brush,
-                                                                vd.co,
-                                                                ss->cache->radius * test.dist,
-                                                                vd.no,
-                                                                vd.fno,
-                                                                vd.mask ? *vd.mask : 0.0f,
-                                                                vd.index,
-                                                                thread_id);
-
-    mul_v3_v3fl(proxy[vd.i], val, fade);
+  SculptBrushBatch batch;
+  SCULPT_brush_batch_init(&batch, brush->flag & BRUSH_FRONTFACE);
 
-    if (vd.mvert) {
-      vd.mvert->flag |= ME_VERT_PBVH_UPDATE;
+  BKE_pbvh_vertex_iter_begin (ss->pbvh, data->nodes[n], vd, PBVH_ITER_UNIQUE) {
+    if (SCULPT_brush_batch_add(&batch, &vd, vd.co, vd.no, vd.fno)) {
+      do_clay_strips_brush_batch(data, &batch, &test, proxy, thread_id);
     }
   }
   BKE_pbvh_vertex_iter_end;
+
+  do_clay_strips_brush_batch(data, &batch, &test, proxy, thread_id);
 }
 
 static void do_clay_strips_brush(Sculpt *sd, Object *ob, PBVHNode **nodes, int totnode)
@@ -631,6 +631,8 @@ typedef struct SculptUndoNode {
   short (*no)[3];
   float (*col)[4];
   float *mask;
+  /* Number of stored vertices. After the stroke only the modified ones are kept, see
+   * #sculpt_undo_compact_nodes. */
   int totvert;
 
   /* non-multires */
@@ -639,10 +641,11 @@ typedef struct SculptUndoNode {
   BLI_bitmap *vert_hidden;
 
   /* multires */
-  int maxgrid;  /* same for grid */
-  int gridsize; /* same for grid */
-  int totgrid;  /* to restore into right location */
-  int *grids;   /* to restore into right location */
+  int maxgrid;     /* same for grid */
+  int gridsize;    /* same for grid */
+  int totgrid;     /* to restore into right location */
+  int *grids;      /* to restore into right location */
+  int *grid_elems; /* element of the grids, only modified elements are kept after the stroke */
   BLI_bitmap **grid_hidden;
 
   /* bmesh */
@@ -869,6 +872,91 @@ float SCULPT_brush_strength_factor(struct SculptSession *ss,
                                    const int vertex_index,
                                    const int thread_id);
 
+/* Brush Batch Evaluation.
+ *
+ * Node vertices are gathered in batches stored as structure of arrays. The brush test and the
+ * strength factor are computed for the whole batch in simple loops, then brushes scatter the
+ * result back to the vertices or the node proxy. */
+
+#define SCULPT_BRUSH_BATCH_SIZE 128
+
+typedef struct SculptBrushBatch {
+  int totvert;
+  /* Gather vertex normals, only needed for front faces only brushes and some brush options. */
+  bool use_normals;
+
+  /* Coordinates used for the brush test and the falloff, current or original ones. */
+  float co[3][SCULPT_BRUSH_BATCH_SIZE];
+  float no[3][SCULPT_BRUSH_BATCH_SIZE];
+  float mask[SCULPT_BRUSH_BATCH_SIZE];
+  /* Vertices inside of the brush and their distance to it, set by the batch tests. */
+  bool active[SCULPT_BRUSH_BATCH_SIZE];
+  float dist[SCULPT_BRUSH_BATCH_SIZE];
+  /* Strength factor set by #SCULPT_brush_batch_strength_factor. */
+  float fade[SCULPT_BRUSH_BATCH_SIZE];
+
+  /* Vertex index in the mesh and in the node (used for proxies). */
+  int index[SCULPT_BRUSH_BATCH_SIZE];
+  int node_index[SCULPT_BRUSH_BATCH_SIZE];
+  /* Vertex data to write the result to. */
+  float *vert_co[SCULPT_BRUSH_BATCH_SIZE];
+  float *vert_mask[SCULPT_BRUSH_BATCH_SIZE];
+  struct MVert *mvert[SCULPT_BRUSH_BATCH_SIZE];
+} SculptBrushBatch;
+
+void SCULPT_brush_batch_init(SculptBrushBatch *batch, const bool use_normals);
+
+/* Add a vertex to the batch, returns true when the batch is full and has to be evaluated. */
+BLI_INLINE bool SCULPT_brush_batch_add(SculptBrushBatch *batch,
+                                       PBVHVertexIter *vd,
+                                       const float co[3],
+                                       const short no[3],
+                                       const float fno[3])
+{
+  const int i = batch->totvert;
+  batch->co[0][i] = co[0];
+  batch->co[1][i] = co[1];
+  batch->co[2][i] = co[2];
+  if (batch->use_normals) {
+    if (no) {
+      const float scale = 1.0f / 32767.0f;
+      batch->no[0][i] = no[0] * scale;
+      batch->no[1][i] = no[1] * scale;
+      batch->no[2][i] = no[2] * scale;
+    }
+    else {
+      batch->no[0][i] = fno[0];
+      batch->no[1][i] = fno[1];
+      batch->no[2][i] = fno[2];
+    }
+  }
+  batch->mask[i] = vd->mask ? *vd->mask : 0.0f;
+  batch->index[i] = vd->index;
+  batch->node_index[i] = vd->i;
+  batch->vert_co[i] = vd->co;
+  batch->vert_mask[i] = vd->mask;
+  batch->mvert[i] = vd->mvert;
+  batch->totvert++;
+  return batch->totvert == SCULPT_BRUSH_BATCH_SIZE;
+}
+
+/* Batch versions of the brush tests. The distance of the sphere and circle tests is not squared,
+ * the one of the cube test is relative to the brush radius. */
+void SCULPT_brush_batch_test(SculptBrushBatch *batch,
+                             const SculptBrushTest *test,
+                             const char falloff_shape);
+void SCULPT_brush_batch_test_cube(SculptBrushBatch *batch,
+                                  const SculptBrushTest *test,
+                                  const float local[4][4],
+                                  const float roundness);
+
+/* Same as #SCULPT_brush_strength_factor for the vertices of the batch, uses the distances of the
+ * batch test. The factor of inactive vertices is not meaningful. */
+void SCULPT_brush_batch_strength_factor(struct SculptSession *ss,
+                                        const struct Brush *br,
+                                        SculptBrushBatch *batch,
+                                        const int thread_id);
+
 /* Tilts a normal by the x and y tilt values using the view axis. */
 void SCULPT_tilt_apply_to_normal(float r_normal[3],
                                  struct StrokeCache *cache,
@@ -290,15 +290,62 @@ static void SCULPT_enhance_details_brush(Sculpt *sd,
   BLI_task_parallel_range(0, totnode, &data, do_enhance_details_brush_task_cb_ex, &settings);
 }
 
+static void do_smooth_brush_batch(SculptThreadedTaskData *data,
+                                  SculptBrushBatch *batch,
+                                  const SculptBrushTest *test,
+                                  const float bstrength,
+                                  const int thread_id)
+{
+  SculptSession *ss = data->ob->sculpt;
+  Sculpt *sd = data->sd;
+  const Brush *brush = data->brush;
+  const bool smooth_mask = data->smooth_mask;
+
+  SCULPT_brush_batch_test(batch, test, brush->falloff_shape);
+  if (smooth_mask) {
+    /* The mask is smoothed, it doesn't mask the brush. */
+    for (int i = 0; i < batch->totvert; i++) {
+      batch->mask[i] = 0.0f;
+    }
+  }
+  SCULPT_brush_batch_strength_factor(ss, brush, batch, thread_id);
+
+  /* The neighbors are averaged vertex by vertex, so the vertices smoothed before in the node are
+   * used with their new coordinates like when iterating over the node. */
+  for (int i = 0; i < batch->totvert; i++) {
+    if (!batch->active[i]) {
+      continue;
+    }
+    const float fade = bstrength * batch->fade[i];
+    if (smooth_mask) {
+      float *mask = batch->vert_mask[i];
+      float val = SCULPT_neighbor_mask_average(ss, batch->index[i]) - *mask;
+      val *= fade * bstrength;
+      *mask += val;
+      CLAMP(*mask, 0.0f, 1.0f);
+    }
+    else {
+      float *co = batch->vert_co[i];
+      float avg[3], val[3];
+      SCULPT_neighbor_coords_average_interior(ss, avg, batch->index[i]);
+      sub_v3_v3v3(val, avg, co);
+      madd_v3_v3v3fl(val, co, val, fade);
+      SCULPT_clip(sd, ss, co, val);
+    }
+    if (batch->mvert[i]) {
+      batch->mvert[i]->flag |= ME_VERT_PBVH_UPDATE;
+    }
+  }
+  batch->totvert = 0;
+}
+
 static void do_smooth_brush_task_cb_ex(void *__restrict userdata,
                                        const int n,
                                        const TaskParallelTLS *__restrict tls)
 {
   SculptThreadedTaskData *data = userdata;
   SculptSession *ss = data->ob->sculpt;
-  Sculpt *sd = data->sd;
   const Brush *brush = data->brush;
-  const bool smooth_mask = data->smooth_mask;
   float bstrength = data->strength;
 
   PBVHVertexIter vd;
@@ -306,43 +353,21 @@ static void do_smooth_brush_task_cb_ex(void *__restrict userdata,
   CLAMP(bstrength, 0.0f, 1.0f);
 
   SculptBrushTest test;
-  SculptBrushTestFn sculpt_brush_test_sq_fn = SCULPT_brush_test_init_with_falloff_shape(
-      ss, &test, data->brush->falloff_shape);
+  SCULPT_brush_test_init_with_falloff_shape(ss, &test, data->brush->falloff_shape);
 
   const int thread_id = BLI_task_parallel_thread_id(tls);
 
+  SculptBrushBatch batch;
+  SCULPT_brush_batch_init(&batch, brush->flag & BRUSH_FRONTFACE);
+
   BKE_pbvh_vertex_iter_begin (ss->pbvh, data->nodes[n], vd, PBVH_ITER_UNIQUE) {
-    if (!sculpt_brush_test_sq_fn(&test, vd.co)) {
-      continue;
-    }
-    const float fade = bstrength * SCULPT_brush_strength_factor(
-                                       ss,
-                                       brush,
-                                       vd.co,
-                                       sqrtf(test.dist),
-                                       vd.no,
-                                       vd.fno,
-                                       smooth_mask ? 0.0f : (vd.mask ? *vd.mask : 0.0f),
-                                       vd.index,
-                                       thread_id);
-    if (smooth_mask) {
-      float val = SCULPT_neighbor_mask_average(ss, vd.index) - *vd.mask;
-      val *= fade * bstrength;
-      *vd.mask += val;
-      CLAMP(*vd.mask, 0.0f, 1.0f);
-    }
-    else {
-      float avg[3], val[3];
-      SCULPT_neighbor_coords_average_interior(ss, avg, vd.index);
-      sub_v3_v3v3(val, avg, vd.co);
-      madd_v3_v3v3fl(val, vd.co, val, fade);
-      SCULPT_clip(sd, ss, vd.co, val);
-    }
-    if (vd.mvert) {
-      vd.mvert->flag |= ME_VERT_PBVH_UPDATE;
+    if (SCULPT_brush_batch_add(&batch, &vd, vd.co, vd.no, vd.fno)) {
+      do_smooth_brush_batch(data, &batch, &test, bstrength, thread_id);
     }
   }
   BKE_pbvh_vertex_iter_end;
+
+  do_smooth_brush_batch(data, &batch, &test, bstrength, thread_id);
 }
 
 void SCULPT_smooth(Sculpt *sd,
@@ -45,6 +45,7 @@
 #include "BKE_customdata.h"
 #include "BKE_global.h"
 #include "BKE_key.h"
+#include "BKE_lib_id.h"
 #include "BKE_main.h"
 #include "BKE_mesh.h"
 #include "BKE_multires.h"
@@ -180,13 +181,68 @@ static bool sculpt_undo_restore_deformed(
   return false;
 }
 
+/* Restore coordinates of a mesh without active shape key. */
+static void sculpt_undo_restore_mesh_coords(SculptSession *ss, SculptUndoNode *unode)
+{
+  const int *index = unode->index;
+  MVert *mvert = ss->mvert;
+
+  if (unode->orig_co) {
+    if (ss->deform_modifiers_active) {
+      for (int i = 0; i < unode->totvert; i++) {
+        sculpt_undo_restore_deformed(ss, unode, i, index[i], mvert[index[i]].co);
+        mvert[index[i]].flag |= ME_VERT_PBVH_UPDATE;
+      }
+    }
+    else {
+      for (int i = 0; i < unode->totvert; i++) {
+        swap_v3_v3(mvert[index[i]].co, unode->orig_co[i]);
+        mvert[index[i]].flag |= ME_VERT_PBVH_UPDATE;
+      }
+    }
+  }
+  else {
+    for (int i = 0; i < unode->totvert; i++) {
+      swap_v3_v3(mvert[index[i]].co, unode->co[i]);
+      mvert[index[i]].flag |= ME_VERT_PBVH_UPDATE;
+    }
+  }
+}
+
+static void sculpt_undo_restore_grids_coords(SculptSession *ss, SculptUndoNode *unode)
+{
+  SubdivCCG *subdiv_ccg = ss->subdiv_ccg;
+  CCGElem **grids = subdiv_ccg->grids;
+  const int gridsize = subdiv_ccg->grid_size;
+  const int grid_area = gridsize * gridsize;
+  CCGKey key;
+  BKE_subdiv_ccg_key_top_level(&key, subdiv_ccg);
+
+  float(*co)[3] = unode->co;
+  if (unode->grid_elems) {
+    for (int i = 0; i < unode->totvert; i++) {
+      const int elem = unode->grid_elems[i];
+      CCGElem *grid = grids[unode->grids[elem / grid_area]];
+      swap_v3_v3(CCG_elem_offset_co(&key, grid, elem % grid_area), co[i]);
+    }
+    return;
+  }
+
+  for (int j = 0; j < unode->totgrid; j++) {
+    CCGElem *grid = grids[unode->grids[j]];
+
+    for (int i = 0; i < grid_area; i++, co++) {
+      swap_v3_v3(CCG_elem_offset_co(&key, grid, i), co[0]);
+    }
+  }
+}
+
 static bool sculpt_undo_restore_coords(bContext *C, Depsgraph *depsgraph, SculptUndoNode *unode)
 {
   ViewLayer *view_layer = CTX_data_view_layer(C);
   Object *ob = OBACT(view_layer);
   SculptSession *ss = ob->sculpt;
   SubdivCCG *subdiv_ccg = ss->subdiv_ccg;
-  MVert *mvert;
   int *index;
 
   if (unode->maxvert) {
@@ -212,7 +268,6 @@ static bool sculpt_undo_restore_coords(bContext *C, Depsgraph *depsgraph, Sculpt
 
     /* No need for float comparison here (memory is exactly equal or not). */
     index = unode->index;
-    mvert = ss->mvert;
 
     if (ss->shapekey_active) {
       float(*vertCos)[3];
@@ -246,47 +301,12 @@ static bool sculpt_undo_restore_coords(bContext *C, Depsgraph *depsgraph, Sculpt
       MEM_freeN(vertCos);
     }
     else {
-      if (unode->orig_co) {
-        if (ss->deform_modifiers_active) {
-          for (int i = 0; i < unode->totvert; i++) {
-            sculpt_undo_restore_deformed(ss, unode, i, index[i], mvert[index[i]].co);
-            mvert[index[i]].flag |= ME_VERT_PBVH_UPDATE;
-          }
-        }
-        else {
-          for (int i = 0; i < unode->totvert; i++) {
-            swap_v3_v3(mvert[index[i]].co, unode->orig_co[i]);
-            mvert[index[i]].flag |= ME_VERT_PBVH_UPDATE;
-          }
-        }
-      }
-      else {
-        for (int i = 0; i < unode->totvert; i++) {
-          swap_v3_v3(mvert[index[i]].co, unode->co[i]);
-          mvert[index[i]].flag |= ME_VERT_PBVH_UPDATE;
-        }
-      }
+      sculpt_undo_restore_mesh_coords(ss, unode);
     }
   }
   else if (unode->maxgrid && subdiv_ccg != NULL) {
     /* Multires restore. */
-    CCGElem **grids, *grid;
-    CCGKey key;
-    float(*co)[3];
-    int gridsize;
-
-    grids = subdiv_ccg->grids;
-    gridsize = subdiv_ccg->grid_size;
-    BKE_subdiv_ccg_key_top_level(&key, subdiv_ccg);
-
-    co = unode->co;
-    for (int j = 0; j < unode->totgrid; j++) {
-      grid = grids[unode->grids[j]];
-
-      for (int i = 0; i < gridsize * gridsize; i++, co++) {
-        swap_v3_v3(CCG_elem_offset_co(&key, grid, i), co[0]);
-      }
-    }
+    sculpt_undo_restore_grids_coords(ss, unode);
   }
 
   return true;
@@ -322,12 +342,8 @@ static bool sculpt_undo_restore_hidden(bContext *C, SculptUndoNode *unode)
   return true;
 }
 
-static bool sculpt_undo_restore_color(bContext *C, SculptUndoNode *unode)
+static void sculpt_undo_restore_color(SculptSession *ss, SculptUndoNode *unode)
 {
-  ViewLayer *view_layer = CTX_data_view_layer(C);
-  Object *ob = OBACT(view_layer);
-  SculptSession *ss = ob->sculpt;
-
   if (unode->maxvert) {
     /* regular mesh restore */
     int *index = unode->index;
@@ -339,14 +355,10 @@ static bool sculpt_undo_restore_color(bContext *C, SculptUndoNode *unode)
       mvert[index[i]].flag |= ME_VERT_PBVH_UPDATE;
     }
   }
-  return true;
 }
 
-static bool sculpt_undo_restore_mask(bContext *C, SculptUndoNode *unode)
+static void sculpt_undo_restore_mask(SculptSession *ss, SculptUndoNode *unode)
 {
-  ViewLayer *view_layer = CTX_data_view_layer(C);
-  Object *ob = OBACT(view_layer);
-  SculptSession *ss = ob->sculpt;
   SubdivCCG *subdiv_ccg = ss->subdiv_ccg;
   MVert *mvert;
   float *vmask;
@@ -378,6 +390,16 @@ static bool sculpt_undo_restore_mask(bContext *C, SculptUndoNode *unode)
     BKE_subdiv_ccg_key_top_level(&key, subdiv_ccg);
 
     mask = unode->mask;
+    if (unode->grid_elems) {
+      const int grid_area = gridsize * gridsize;
+      for (int i = 0; i < unode->totvert; i++) {
+        const int elem = unode->grid_elems[i];
+        grid = grids[unode->grids[elem / grid_area]];
+        SWAP(float, *CCG_elem_offset_mask(&key, grid, elem % grid_area), mask[i]);
+      }
+      return;
+    }
+
     for (int j = 0; j < unode->totgrid; j++) {
       grid = grids[unode->grids[j]];
 
@@ -386,8 +408,6 @@ static bool sculpt_undo_restore_mask(bContext *C, SculptUndoNode *unode)
       }
     }
   }
-
-  return true;
 }
 
 static bool sculpt_undo_restore_face_sets(bContext *C, SculptUndoNode *unode)
@@ -402,6 +422,58 @@ static bool sculpt_undo_restore_face_sets(bContext *C, SculptUndoNode *unode)
   return false;
 }
 
+typedef struct SculptUndoRestoreData {
+  SculptSession *ss;
+  SculptUndoNode **nodes;
+} SculptUndoRestoreData;
+
+static void sculpt_undo_restore_task_cb(void *__restrict userdata,
+                                        const int n,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  SculptUndoRestoreData *data = userdata;
+  SculptSession *ss = data->ss;
+  SculptUndoNode *unode = data->nodes[n];
+
+  switch (unode->type) {
+    case SCULPT_UNDO_COORDS:
+      if (unode->maxvert) {
+        sculpt_undo_restore_mesh_coords(ss, unode);
+      }
+      else if (unode->maxgrid && ss->subdiv_ccg != NULL) {
+        sculpt_undo_restore_grids_coords(ss, unode);
+      }
+      break;
+    case SCULPT_UNDO_MASK:
+      sculpt_undo_restore_mask(ss, unode);
+      break;
+    case SCULPT_UNDO_COLOR:
+      sculpt_undo_restore_color(ss, unode);
+      break;
+    default:
+      BLI_assert_unreachable();
+      break;
+  }
+}
+
+/* Restore nodes which only modify their own vertices or grids in parallel, and clear the array
+ * of nodes. */
+static void sculpt_undo_restore_nodes_parallel(SculptSession *ss,
+                                               SculptUndoNode **nodes,
+                                               int *r_totnode)
+{
+  SculptUndoRestoreData data = {
+      .ss = ss,
+      .nodes = nodes,
+  };
+
+  TaskParallelSettings settings;
+  BKE_pbvh_parallel_range_settings(&settings, true, *r_totnode);
+  BLI_task_parallel_range(0, *r_totnode, &data, sculpt_undo_restore_task_cb, &settings);
+
+  *r_totnode = 0;
+}
+
 static void sculpt_undo_bmesh_restore_generic_task_cb(
     void *__restrict userdata, const int n, const TaskParallelTLS *__restrict UNUSED(tls))
 {
@@ -709,6 +781,11 @@ static void sculpt_undo_restore_list(bContext *C, Depsgraph *depsgraph, ListBase
   char *undo_modified_grids = NULL;
   bool use_multires_undo = false;
 
+  /* Nodes restored in parallel, after the loop or before nodes which depend on them. */
+  SculptUndoNode **parallel_nodes = MEM_malloc_arrayN(
+      BLI_listbase_count(lb), sizeof(*parallel_nodes), __func__);
+  int parallel_totnode = 0;
+
   for (unode = lb->first; unode; unode = unode->next) {
 
     if (!STREQ(unode->idname, ob->id.name)) {
@@ -733,7 +810,11 @@ static void sculpt_undo_restore_list(bContext *C, Depsgraph *depsgraph, ListBase
 
     switch (unode->type) {
       case SCULPT_UNDO_COORDS:
-        if (sculpt_undo_restore_coords(C, depsgraph, unode)) {
+        if (ss->shapekey_active == NULL) {
+          parallel_nodes[parallel_totnode++] = unode;
+          update = true;
+        }
+        else if (sculpt_undo_restore_coords(C, depsgraph, unode)) {
           update = true;
         }
         break;
@@ -744,20 +825,20 @@ static void sculpt_undo_restore_list(bContext *C, Depsgraph *depsgraph, ListBase
         }
         break;
       case SCULPT_UNDO_MASK:
-        if (sculpt_undo_restore_mask(C, unode)) {
-          update = true;
-          update_mask = true;
-        }
+        parallel_nodes[parallel_totnode++] = unode;
+        update = true;
+        update_mask = true;
         break;
       case SCULPT_UNDO_FACE_SETS:
         break;
       case SCULPT_UNDO_COLOR:
-        if (sculpt_undo_restore_color(C, unode)) {
-          update = true;
-        }
+        parallel_nodes[parallel_totnode++] = unode;
+        update = true;
         break;
 
       case SCULPT_UNDO_GEOMETRY:
+        /* Geometry restore replaces the mesh data, nodes before it apply to the old data. */
+        sculpt_undo_restore_nodes_parallel(ss, parallel_nodes, &parallel_totnode);
         need_refine_subdiv = true;
         sculpt_undo_geometry_restore(unode, ob);
         BKE_sculpt_update_object_for_edit(depsgraph, ob, false, need_mask, false);
@@ -771,6 +852,9 @@ static void sculpt_undo_restore_list(bContext *C, Depsgraph *depsgraph, ListBase
     }
   }
 
+  sculpt_undo_restore_nodes_parallel(ss, parallel_nodes, &parallel_totnode);
+  MEM_freeN(parallel_nodes);
+
   if (use_multires_undo) {
     for (unode = lb->first; unode; unode = unode->next) {
       if (!STREQ(unode->idname, ob->id.name)) {
@@ -868,6 +952,9 @@ static void sculpt_undo_free_list(ListBase *lb)
     if (unode->grids) {
       MEM_freeN(unode->grids);
     }
+    if (unode->grid_elems) {
+      MEM_freeN(unode->grid_elems);
+    }
     if (unode->orig_co) {
       MEM_freeN(unode->orig_co);
     }
@@ -885,6 +972,9 @@ static void sculpt_undo_free_list(ListBase *lb)
     if (unode->mask) {
       MEM_freeN(unode->mask);
     }
+    if (unode->col) {
+      MEM_freeN(unode->col);
+    }
 
     if (unode->bm_entry) {
       BM_log_entry_drop(unode->bm_entry);
@@ -1426,6 +1516,252 @@ void SCULPT_undo_push_end_ex(const bool use_nested_undo)
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Compact Undo Nodes
+ *
+ * While the stroke is running, undo nodes contain the original data of all vertices of the PBVH
+ * nodes, it's used by brushes as original data. Once the stroke is done only the vertices which
+ * were modified are needed, undo swaps the stored values with the current ones so for all other
+ * vertices it would be a no-op. The nodes are compacted to only contain those vertices before
+ * the undo step is pushed, so the size of the step is known when the undo memory limit is
+ * applied.
+ * \{ */
+
+static size_t sculpt_undo_node_data_size(const SculptUndoNode *unode)
+{
+  size_t size = 0;
+  const void *arrays[] = {
+      unode->co, unode->mask, unode->col, unode->index, unode->grids, unode->grid_elems};
+  for (int i = 0; i < ARRAY_SIZE(arrays); i++) {
+    if (arrays[i]) {
+      size += MEM_allocN_len(arrays[i]);
+    }
+  }
+  return size;
+}
+
+static bool sculpt_undo_node_can_compact(const SculptSession *ss, const SculptUndoNode *unode)
+{
+  /* Nodes pushed without PBVH node don't store the state before an edit of the current data. */
+  if (unode->node == NULL) {
+    return false;
+  }
+  switch (unode->type) {
+    case SCULPT_UNDO_COORDS:
+      /* Shape keys and deform modifiers restore the coordinates from other data. */
+      if (unode->orig_co || unode->shapeName[0] != '\0' || ss->shapekey_active) {
+        return false;
+      }
+      break;
+    case SCULPT_UNDO_MASK:
+      break;
+    case SCULPT_UNDO_COLOR:
+      if (unode->maxgrid) {
+        return false;
+      }
+      break;
+    default:
+      return false;
+  }
+  if (unode->maxvert) {
+    return ss->totvert == unode->maxvert;
+  }
+  return ss->subdiv_ccg != NULL && ss->subdiv_ccg->num_grids == unode->maxgrid &&
+         ss->subdiv_ccg->grid_size == unode->gridsize;
+}
+
+static bool sculpt_undo_vert_is_modified(const SculptSession *ss,
+                                         const SculptUndoNode *unode,
+                                         const int i)
+{
+  const int vertex = unode->index[i];
+  switch (unode->type) {
+    case SCULPT_UNDO_COORDS:
+      /* No need for float comparison here (memory is exactly equal or not). */
+      return memcmp(unode->co[i], ss->mvert[vertex].co, sizeof(float[3])) != 0;
+    case SCULPT_UNDO_MASK:
+      return unode->mask[i] != ss->vmask[vertex];
+    case SCULPT_UNDO_COLOR:
+      return memcmp(unode->col[i], ss->vcol[vertex].color, sizeof(float[4])) != 0;
+    default:
+      return false;
+  }
+}
+
+static void sculpt_undo_compact_mesh_node(const SculptSession *ss, SculptUndoNode *unode)
+{
+  int totvert = 0;
+  for (int i = 0; i < unode->totvert; i++) {
+    if (!sculpt_undo_vert_is_modified(ss, unode, i)) {
+      continue;
+    }
+    unode->index[totvert] = unode->index[i];
+    if (unode->co) {
+      copy_v3_v3(unode->co[totvert], unode->co[i]);
+    }
+    if (unode->mask) {
+      unode->mask[totvert] = unode->mask[i];
+    }
+    if (unode->col) {
+      copy_v4_v4(unode->col[totvert], unode->col[i]);
+    }
+    totvert++;
+  }
+  unode->totvert = totvert;
+}
+
+static bool sculpt_undo_grid_elem_is_modified(const CCGKey *key,
+                                              const SculptUndoNode *unode,
+                                              CCGElem *grid,
+                                              const int elem,
+                                              const int i)
+{
+  if (unode->co) {
+    return memcmp(unode->co[elem], CCG_elem_offset_co(key, grid, i), sizeof(float[3])) != 0;
+  }
+  return unode->mask[elem] != *CCG_elem_offset_mask(key, grid, i);
+}
+
+static void sculpt_undo_compact_grids_node(const SculptSession *ss, SculptUndoNode *unode)
+{
+  SubdivCCG *subdiv_ccg = ss->subdiv_ccg;
+  CCGKey key;
+  BKE_subdiv_ccg_key_top_level(&key, subdiv_ccg);
+  const int grid_area = unode->gridsize * unode->gridsize;
+  const int totelem = unode->totgrid * grid_area;
+
+  int totvert = 0;
+  for (int j = 0; j < unode->totgrid; j++) {
+    CCGElem *grid = subdiv_ccg->grids[unode->grids[j]];
+    for (int i = 0; i < grid_area; i++) {
+      totvert += sculpt_undo_grid_elem_is_modified(&key, unode, grid, j * grid_area + i, i);
+    }
+  }
+
+  const size_t elem_size = unode->co ? sizeof(*unode->co) : sizeof(*unode->mask);
+  if ((elem_size + sizeof(*unode->grid_elems)) * totvert >= elem_size * totelem) {
+    /* Storing the indices of the modified elements takes more memory than it saves. */
+    unode->totvert = totelem;
+    return;
+  }
+
+  if (totvert == 0) {
+    /* Nothing was modified, there are no grids to restore. */
+    MEM_freeN(unode->grids);
+    unode->grids = NULL;
+    unode->totgrid = 0;
+    unode->totvert = 0;
+    return;
+  }
+
+  unode->grid_elems = MEM_malloc_arrayN(
+      totvert, sizeof(*unode->grid_elems), "SculptUndoNode.grid_elems");
+
+  int index = 0;
+  for (int j = 0; j < unode->totgrid; j++) {
+    CCGElem *grid = subdiv_ccg->grids[unode->grids[j]];
+    for (int i = 0; i < grid_area; i++) {
+      const int elem = j * grid_area + i;
+      if (!sculpt_undo_grid_elem_is_modified(&key, unode, grid, elem, i)) {
+        continue;
+      }
+      if (unode->co) {
+        copy_v3_v3(unode->co[index], unode->co[elem]);
+      }
+      else {
+        unode->mask[index] = unode->mask[elem];
+      }
+      unode->grid_elems[index] = elem;
+      index++;
+    }
+  }
+  unode->totvert = totvert;
+}
+
+/* Shrink an array to the given number of elements, freeing it when it becomes empty. */
+static void *sculpt_undo_array_shrink(void *array, const size_t elem_size, const int num)
+{
+  if (array == NULL) {
+    return NULL;
+  }
+  if (num == 0) {
+    MEM_freeN(array);
+    return NULL;
+  }
+  if (MEM_allocN_len(array) <= elem_size * (size_t)num) {
+    return array;
+  }
+  return MEM_reallocN(array, elem_size * (size_t)num);
+}
+
+static void sculpt_undo_compact_task_cb(void *__restrict userdata,
+                                        const int n,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  SculptUndoRestoreData *data = userdata;
+  const SculptSession *ss = data->ss;
+  SculptUndoNode *unode = data->nodes[n];
+
+  if (unode->maxvert) {
+    sculpt_undo_compact_mesh_node(ss, unode);
+  }
+  else {
+    sculpt_undo_compact_grids_node(ss, unode);
+  }
+
+  const int totvert = unode->totvert;
+  unode->co = sculpt_undo_array_shrink(unode->co, sizeof(*unode->co), totvert);
+  unode->mask = sculpt_undo_array_shrink(unode->mask, sizeof(*unode->mask), totvert);
+  unode->col = sculpt_undo_array_shrink(unode->col, sizeof(*unode->col), totvert);
+  unode->index = sculpt_undo_array_shrink(unode->index, sizeof(*unode->index), totvert);
+
+  /* The node is not valid as original data for brushes anymore. */
+  unode->node = NULL;
+}
+
+static void sculpt_undo_compact_nodes(Main *bmain, UndoSculpt *usculpt)
+{
+  SculptUndoNode *first_unode = usculpt->nodes.first;
+  if (first_unode == NULL || first_unode->bm_entry) {
+    return;
+  }
+
+  Object *ob = (Object *)BKE_libblock_find_name(bmain, ID_OB, first_unode->idname + 2);
+  SculptSession *ss = ob ? ob->sculpt : NULL;
+  if (ss == NULL || ss->bm != NULL) {
+    return;
+  }
+
+  SculptUndoNode **nodes = MEM_malloc_arrayN(
+      BLI_listbase_count(&usculpt->nodes), sizeof(*nodes), __func__);
+  int totnode = 0;
+  size_t data_size = 0;
+  LISTBASE_FOREACH (SculptUndoNode *, unode, &usculpt->nodes) {
+    if (STREQ(unode->idname, ob->id.name) && sculpt_undo_node_can_compact(ss, unode)) {
+      nodes[totnode++] = unode;
+      data_size += sculpt_undo_node_data_size(unode);
+    }
+  }
+
+  SculptUndoRestoreData data = {
+      .ss = ss,
+      .nodes = nodes,
+  };
+  TaskParallelSettings settings;
+  BKE_pbvh_parallel_range_settings(&settings, true, totnode);
+  BLI_task_parallel_range(0, totnode, &data, sculpt_undo_compact_task_cb, &settings);
+
+  size_t data_size_compact = 0;
+  for (int i = 0; i < totnode; i++) {
+    data_size_compact += sculpt_undo_node_data_size(nodes[i]);
+  }
+  usculpt->undo_size = usculpt->undo_size - data_size + data_size_compact;
+
+  MEM_freeN(nodes);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Implements ED Undo System
  * \{ */
@@ -1450,6 +1786,7 @@ static bool sculpt_undosys_step_encode(struct bContext *UNUSED(C),
   /* Dummy, encoding is done along the way by adding tiles
    * to the current 'SculptUndoStep' added by encode_init. */
   SculptUndoStep *us = (SculptUndoStep *)us_p;
+  sculpt_undo_compact_nodes(bmain, &us->data);
   us->step.data_size = us->data.undo_size;
 
   SculptUndoNode *unode = us->data.nodes.last;
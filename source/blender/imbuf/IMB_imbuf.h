@@ -342,6 +342,14 @@ typedef enum eIMBInterpolationFilterMode {
   IMB_FILTER_BILINEAR,
 } eIMBInterpolationFilterMode;
 
+/* Filters for #IMB_scaleImBuf_filter, from fastest to sharpest. */
+typedef enum eIMBScaleFilter {
+  IMB_SCALE_FILTER_BOX,
+  IMB_SCALE_FILTER_BILINEAR,
+  IMB_SCALE_FILTER_BICUBIC,
+  IMB_SCALE_FILTER_LANCZOS,
+} eIMBScaleFilter;
+
 /* Defaults to BL_proxy within the directory of the animation. */
 void IMB_anim_set_index_dir(struct anim *anim, const char *dir);
 void IMB_anim_get_fname(struct anim *anim, char *file, int size);
@@ -474,6 +482,15 @@ struct ImBuf *IMB_onehalf(struct ImBuf *ibuf1);
  */
 bool IMB_scaleImBuf(struct ImBuf *ibuf, unsigned int newx, unsigned int newy);
 
+/**
+ * Resample using \a filter, which is widened when shrinking so every source pixel contributes.
+ * \attention Defined in scaling.c
+ */
+bool IMB_scaleImBuf_filter(struct ImBuf *ibuf,
+                           unsigned int newx,
+                           unsigned int newy,
+                           eIMBScaleFilter filter);
+
 /**
  *
  * \attention Defined in scaling.c
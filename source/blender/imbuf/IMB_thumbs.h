@@ -74,6 +74,9 @@ void IMB_thumb_delete(const char *path, ThumbSize size);
 /* return the state of the thumb, needed to determine how to manage the thumb */
 struct ImBuf *IMB_thumb_manage(const char *path, ThumbSize size, ThumbSource source);
 
+/* write the per directory thumbnail indices to disk and free them */
+void IMB_thumb_index_flush(void);
+
 /* create the necessary dirs to store the thumbnails */
 void IMB_thumb_makedirs(void);
 
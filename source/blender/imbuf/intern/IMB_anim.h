@@ -136,6 +136,9 @@ struct anim {
   int64_t cur_pts;
   int64_t cur_key_frame_pts;
   AVPacket *cur_packet;
+
+  /* Background decoding of upcoming frames, allocated on first sequential access. */
+  struct AnimDecodeAhead *decode_ahead;
 #endif
 
   char index_dir[768];
@@ -151,3 +154,7 @@ struct anim {
 
   struct IDProperty *metadata;
 };
+
+#ifdef WITH_FFMPEG
+void imb_anim_decode_ahead_stop(struct anim *anim);
+#endif
@@ -126,6 +126,23 @@ void colorspace_set_default_role(char *colorspace, int size, int role);
 void colormanage_imbuf_set_default_spaces(struct ImBuf *ibuf);
 void colormanage_imbuf_make_linear(struct ImBuf *ibuf, const char *from_colorspace);
 
+/* colormanagement_lut.c */
+
+typedef struct ColormanageDisplayLUT ColormanageDisplayLUT;
+
+/* Transform \a num_pixels packed RGB values in place. */
+typedef void (*ColormanageDisplayLUTEvaluateFn)(void *userdata, float *rgb, int num_pixels);
+
+ColormanageDisplayLUT *colormanage_display_lut_bake(ColormanageDisplayLUTEvaluateFn evaluate,
+                                                    void *userdata);
+void colormanage_display_lut_free(ColormanageDisplayLUT *lut);
+void colormanage_display_lut_apply(const ColormanageDisplayLUT *lut,
+                                   float *buffer,
+                                   int width,
+                                   int height,
+                                   int channels,
+                                   bool predivide);
+
 #ifdef __cplusplus
 }
 #endif
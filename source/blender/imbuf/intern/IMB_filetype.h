@@ -48,6 +48,18 @@ typedef struct ImFileType {
                         char colorspace[IM_MAX_SPACE]);
   /** Load an image from a file. */
   struct ImBuf *(*load_filepath)(const char *filepath, int flags, char colorspace[IM_MAX_SPACE]);
+  /**
+   * Optional, load a reduced size image from a file for thumbnails. The result is at least
+   * `max_thumb_size` along its longest edge unless the image is smaller than that, the full
+   * resolution size is returned in `r_width` and `r_height`.
+   * May return NULL when the file can't be read at a reduced size, to use the regular loader.
+   */
+  struct ImBuf *(*load_filepath_thumbnail)(const char *filepath,
+                                           int flags,
+                                           size_t max_thumb_size,
+                                           char colorspace[IM_MAX_SPACE],
+                                           size_t *r_width,
+                                           size_t *r_height);
   /** Save to a file (or memory if #IB_mem is set in `flags` and the format supports it). */
   bool (*save)(struct ImBuf *ibuf, const char *filepath, int flags);
   void (*load_tile)(struct ImBuf *ibuf,
@@ -78,6 +90,11 @@ void imb_tile_cache_init(void);
 void imb_tile_cache_exit(void);
 
 void imb_loadtile(struct ImBuf *ibuf, int tx, int ty, unsigned int *rect);
+struct ImBuf *imb_load_filepath_thumbnail(const char *filepath,
+                                          size_t max_thumb_size,
+                                          char colorspace[IM_MAX_SPACE],
+                                          size_t *r_width,
+                                          size_t *r_height);
 void imb_tile_cache_tile_free(struct ImBuf *ibuf, int tx, int ty);
 
 /* Type Specific Functions */
@@ -124,6 +141,12 @@ struct ImBuf *imb_load_jpeg(const unsigned char *buffer,
                             size_t size,
                             int flags,
                             char colorspace[IM_MAX_SPACE]);
+struct ImBuf *imb_thumbnail_jpeg(const char *filepath,
+                                 int flags,
+                                 size_t max_thumb_size,
+                                 char colorspace[IM_MAX_SPACE],
+                                 size_t *r_width,
+                                 size_t *r_height);
 
 /* bmp */
 bool imb_is_a_bmp(const unsigned char *buf, const size_t size);
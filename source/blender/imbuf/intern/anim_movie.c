@@ -53,6 +53,7 @@
 #  include <io.h>
 #endif
 
+#include "BLI_math_base.h"
 #include "BLI_path_util.h"
 #include "BLI_string.h"
 #include "BLI_threads.h"
@@ -581,11 +582,14 @@ static int startffmpeg(struct anim *anim)
     pCodecCtx->thread_count = BLI_system_thread_count();
   }
 
+  /* Request both, FFmpeg uses frame threading when the codec supports it and falls back to
+   * slice threading otherwise. */
+  pCodecCtx->thread_type = 0;
   if (pCodec->capabilities & AV_CODEC_CAP_FRAME_THREADS) {
-    pCodecCtx->thread_type = FF_THREAD_FRAME;
+    pCodecCtx->thread_type |= FF_THREAD_FRAME;
   }
-  else if (pCodec->capabilities & AV_CODEC_CAP_SLICE_THREADS) {
-    pCodecCtx->thread_type = FF_THREAD_SLICE;
+  if (pCodec->capabilities & AV_CODEC_CAP_SLICE_THREADS) {
+    pCodecCtx->thread_type |= FF_THREAD_SLICE;
   }
 
   if (avcodec_open2(pCodecCtx, pCodec, NULL) < 0) {
@@ -1381,15 +1385,14 @@ static int ffmpeg_seek_to_key_frame(struct anim *anim,
   return ret;
 }
 
-static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Type tc)
+/* Decode the frame at `position` into `anim->cur_frame_final` and return a new user of it.
+ * Callers serialize access to the decoder state, see #ffmpeg_fetchibuf. */
+static ImBuf *ffmpeg_decode_position(struct anim *anim,
+                                     int position,
+                                     struct anim_index *tc_index)
 {
-  if (anim == NULL) {
-    return NULL;
-  }
-
   av_log(anim->pFormatCtx, AV_LOG_DEBUG, "FETCH: pos=%d\n", position);
 
-  struct anim_index *tc_index = IMB_anim_open_index(anim, tc);
   int64_t pts_to_search = ffmpeg_get_pts_to_search(anim, tc_index, position);
   AVStream *v_st = anim->pFormatCtx->streams[anim->videoStream];
   double frame_rate = av_q2d(v_st->r_frame_rate);
@@ -1459,12 +1462,345 @@ static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Typ
   return anim->cur_frame_final;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Decode-Ahead
+ *
+ * During playback a background thread keeps decoding the frames following the playhead, in the
+ * direction of playback. This hides the decoder latency, including the scan from the last key
+ * frame of long GOP sources, and the color space conversion from the caller.
+ *
+ * The decoder state of the anim is guarded by `decode_mutex`, the decoded frames and the playhead
+ * by `mutex`. The thread is only started once frames are requested in sequence, so one-off reads
+ * like thumbnails or the preview frame don't pay for it.
+ * \{ */
+
+/* Number of frames decoded ahead of the playhead, further limited by #DECODE_AHEAD_MEM_LIMIT. */
+#  define DECODE_AHEAD_FRAMES_MAX 8
+#  define DECODE_AHEAD_MEM_LIMIT ((size_t)256 * 1024 * 1024)
+/* Limit for frames held by all anims together, so a timeline with many movie strips doesn't
+ * multiply #DECODE_AHEAD_MEM_LIMIT by the number of strips. */
+#  define DECODE_AHEAD_MEM_LIMIT_ALL ((size_t)1024 * 1024 * 1024)
+
+static ThreadMutex decode_ahead_mem_mutex = BLI_MUTEX_INITIALIZER;
+static size_t decode_ahead_mem_used = 0;
+
+typedef struct AnimDecodeAheadFrame {
+  int position;
+  ImBuf *ibuf;
+  /* Memory accounted for this frame in #decode_ahead_mem_used. */
+  size_t mem_size;
+} AnimDecodeAheadFrame;
+
+typedef struct AnimDecodeAhead {
+  ListBase threads;
+  ThreadMutex decode_mutex;
+  ThreadMutex mutex;
+  ThreadCondition cond;
+  bool stop;
+
+  /* Last requested frame and direction of playback: 1, -1 or 0 for random access. */
+  int playhead;
+  int direction;
+  /* Refilling the window when playing backwards, see #decode_ahead_next_position. */
+  bool refill;
+  struct anim_index *tc_index;
+
+  /* Size of the window ahead of the playhead, the extra slot holds the playhead frame. */
+  int num_frames;
+  AnimDecodeAheadFrame frames[DECODE_AHEAD_FRAMES_MAX + 1];
+} AnimDecodeAhead;
+
+static bool decode_ahead_mem_available(size_t mem_size)
+{
+  BLI_mutex_lock(&decode_ahead_mem_mutex);
+  const bool available = decode_ahead_mem_used + mem_size <= DECODE_AHEAD_MEM_LIMIT_ALL;
+  BLI_mutex_unlock(&decode_ahead_mem_mutex);
+  return available;
+}
+
+static bool decode_ahead_mem_reserve(size_t mem_size)
+{
+  BLI_mutex_lock(&decode_ahead_mem_mutex);
+  const bool available = decode_ahead_mem_used + mem_size <= DECODE_AHEAD_MEM_LIMIT_ALL;
+  if (available) {
+    decode_ahead_mem_used += mem_size;
+  }
+  BLI_mutex_unlock(&decode_ahead_mem_mutex);
+  return available;
+}
+
+static void decode_ahead_frame_free(AnimDecodeAheadFrame *frame)
+{
+  if (frame->ibuf == NULL) {
+    return;
+  }
+
+  BLI_mutex_lock(&decode_ahead_mem_mutex);
+  BLI_assert(decode_ahead_mem_used >= frame->mem_size);
+  decode_ahead_mem_used -= frame->mem_size;
+  BLI_mutex_unlock(&decode_ahead_mem_mutex);
+
+  IMB_freeImBuf(frame->ibuf);
+  frame->ibuf = NULL;
+  frame->mem_size = 0;
+}
+
+static bool decode_ahead_is_wanted(const AnimDecodeAhead *da, int position)
+{
+  if (position == da->playhead) {
+    return true;
+  }
+  if (da->direction > 0) {
+    return position > da->playhead && position <= da->playhead + da->num_frames;
+  }
+  if (da->direction < 0) {
+    return position < da->playhead && position >= da->playhead - da->num_frames;
+  }
+  return false;
+}
+
+static AnimDecodeAheadFrame *decode_ahead_find(AnimDecodeAhead *da, int position)
+{
+  for (int i = 0; i <= da->num_frames; i++) {
+    if (da->frames[i].ibuf && da->frames[i].position == position) {
+      return &da->frames[i];
+    }
+  }
+  return NULL;
+}
+
+static void decode_ahead_clear(AnimDecodeAhead *da)
+{
+  for (int i = 0; i <= da->num_frames; i++) {
+    decode_ahead_frame_free(&da->frames[i]);
+  }
+}
+
+/* Take ownership of a decoded frame, dropping it when the playhead moved on meanwhile or when
+ * frames of all anims use up #DECODE_AHEAD_MEM_LIMIT_ALL. */
+static void decode_ahead_store(struct anim *anim,
+                               AnimDecodeAhead *da,
+                               int position,
+                               ImBuf *ibuf)
+{
+  if (ibuf == NULL || !decode_ahead_is_wanted(da, position) || decode_ahead_find(da, position)) {
+    IMB_freeImBuf(ibuf);
+    return;
+  }
+
+  for (int i = 0; i <= da->num_frames; i++) {
+    AnimDecodeAheadFrame *frame = &da->frames[i];
+    if (frame->ibuf == NULL || !decode_ahead_is_wanted(da, frame->position)) {
+      decode_ahead_frame_free(frame);
+      if (!decode_ahead_mem_reserve(anim->framesize)) {
+        break;
+      }
+      frame->position = position;
+      frame->ibuf = ibuf;
+      frame->mem_size = anim->framesize;
+      return;
+    }
+  }
+
+  IMB_freeImBuf(ibuf);
+}
+
+/* Next frame for the thread to decode, -1 when the window is filled. */
+static int decode_ahead_next_position(const struct anim *anim, AnimDecodeAhead *da)
+{
+  if (da->direction > 0) {
+    for (int i = 1; i <= da->num_frames; i++) {
+      const int position = da->playhead + i;
+      if (position >= anim->duration_in_frames) {
+        break;
+      }
+      if (!decode_ahead_find(da, position)) {
+        return position;
+      }
+    }
+  }
+  else if (da->direction < 0) {
+    /* Every step backwards needs a seek and a scan from the previous key frame. Refill the window
+     * in batches from its start instead, so only the first frame of a batch has to seek. */
+    int first_missing = -1;
+    int num_missing = 0;
+    for (int position = max_ii(da->playhead - da->num_frames, 0); position < da->playhead;
+         position++) {
+      if (!decode_ahead_find(da, position)) {
+        if (first_missing == -1) {
+          first_missing = position;
+        }
+        num_missing++;
+      }
+    }
+
+    if (num_missing == 0) {
+      da->refill = false;
+    }
+    else if (num_missing * 2 >= da->num_frames || !decode_ahead_find(da, da->playhead - 1)) {
+      da->refill = true;
+    }
+
+    if (da->refill) {
+      return first_missing;
+    }
+  }
+  return -1;
+}
+
+static void *ffmpeg_decode_ahead_thread(void *data)
+{
+  struct anim *anim = data;
+  AnimDecodeAhead *da = anim->decode_ahead;
+
+  BLI_mutex_lock(&da->mutex);
+  while (!da->stop) {
+    const int position = decode_ahead_next_position(anim, da);
+    /* When the memory of all anims is used up, wait for the next fetch to check again. */
+    if (position == -1 || !decode_ahead_mem_available(anim->framesize)) {
+      BLI_condition_wait(&da->cond, &da->mutex);
+      continue;
+    }
+
+    struct anim_index *tc_index = da->tc_index;
+    BLI_mutex_unlock(&da->mutex);
+
+    BLI_mutex_lock(&da->decode_mutex);
+    ImBuf *ibuf = ffmpeg_decode_position(anim, position, tc_index);
+    BLI_mutex_unlock(&da->decode_mutex);
+
+    BLI_mutex_lock(&da->mutex);
+    if (tc_index == da->tc_index) {
+      decode_ahead_store(anim, da, position, ibuf);
+    }
+    else {
+      IMB_freeImBuf(ibuf);
+    }
+  }
+  BLI_mutex_unlock(&da->mutex);
+
+  return NULL;
+}
+
+static void ffmpeg_decode_ahead_start(struct anim *anim,
+                                      int playhead,
+                                      int direction,
+                                      struct anim_index *tc_index)
+{
+  AnimDecodeAhead *da = MEM_callocN(sizeof(*da), "AnimDecodeAhead");
+
+  BLI_mutex_init(&da->decode_mutex);
+  BLI_mutex_init(&da->mutex);
+  BLI_condition_init(&da->cond);
+
+  da->playhead = playhead;
+  da->direction = direction;
+  da->tc_index = tc_index;
+  da->num_frames = (int)MIN2(DECODE_AHEAD_MEM_LIMIT / MAX2(anim->framesize, 1),
+                             DECODE_AHEAD_FRAMES_MAX);
+  da->num_frames = max_ii(da->num_frames, 1);
+
+  anim->decode_ahead = da;
+
+  BLI_threadpool_init(&da->threads, ffmpeg_decode_ahead_thread, 1);
+  BLI_threadpool_insert(&da->threads, anim);
+}
+
+void imb_anim_decode_ahead_stop(struct anim *anim)
+{
+  AnimDecodeAhead *da = anim->decode_ahead;
+  if (da == NULL) {
+    return;
+  }
+
+  BLI_mutex_lock(&da->mutex);
+  da->stop = true;
+  BLI_condition_notify_all(&da->cond);
+  BLI_mutex_unlock(&da->mutex);
+
+  BLI_threadpool_end(&da->threads);
+
+  decode_ahead_clear(da);
+  BLI_condition_end(&da->cond);
+  BLI_mutex_end(&da->mutex);
+  BLI_mutex_end(&da->decode_mutex);
+  MEM_freeN(da);
+
+  anim->decode_ahead = NULL;
+}
+
+#  undef DECODE_AHEAD_FRAMES_MAX
+#  undef DECODE_AHEAD_MEM_LIMIT
+#  undef DECODE_AHEAD_MEM_LIMIT_ALL
+
+/** \} */
+
+static ImBuf *ffmpeg_fetchibuf(struct anim *anim, int position, IMB_Timecode_Type tc)
+{
+  if (anim == NULL) {
+    return NULL;
+  }
+
+  struct anim_index *tc_index = IMB_anim_open_index(anim, tc);
+  AnimDecodeAhead *da = anim->decode_ahead;
+  ImBuf *ibuf = NULL;
+
+  if (da == NULL) {
+    const int prev_position = anim->cur_position;
+    ibuf = ffmpeg_decode_position(anim, position, tc_index);
+
+    if (prev_position != -1 && ELEM(position - prev_position, 1, -1)) {
+      ffmpeg_decode_ahead_start(anim, position, position - prev_position, tc_index);
+    }
+    return ibuf;
+  }
+
+  BLI_mutex_lock(&da->mutex);
+  if (da->tc_index != tc_index) {
+    decode_ahead_clear(da);
+    da->tc_index = tc_index;
+  }
+  const int step = position - da->playhead;
+  if (step != 0) {
+    da->direction = ELEM(step, 1, -1) ? step : 0;
+    da->playhead = position;
+  }
+  AnimDecodeAheadFrame *frame = decode_ahead_find(da, position);
+  if (frame) {
+    ibuf = frame->ibuf;
+    IMB_refImBuf(ibuf);
+  }
+  BLI_condition_notify_all(&da->cond);
+  BLI_mutex_unlock(&da->mutex);
+
+  if (ibuf) {
+    return ibuf;
+  }
+
+  /* Not decoded yet, or a jump outside of the window: decode synchronously, waiting for the
+   * frame the thread is currently working on. */
+  BLI_mutex_lock(&da->decode_mutex);
+  ibuf = ffmpeg_decode_position(anim, position, tc_index);
+  BLI_mutex_unlock(&da->decode_mutex);
+
+  BLI_mutex_lock(&da->mutex);
+  if (ibuf && tc_index == da->tc_index) {
+    IMB_refImBuf(ibuf);
+    decode_ahead_store(anim, da, position, ibuf);
+  }
+  BLI_mutex_unlock(&da->mutex);
+
+  return ibuf;
+}
+
 static void free_anim_ffmpeg(struct anim *anim)
 {
   if (anim == NULL) {
     return;
   }
 
+  imb_anim_decode_ahead_stop(anim);
+
   if (anim->pCodecCtx) {
     avcodec_free_context(&anim->pCodecCtx);
     avformat_close_input(&anim->pFormatCtx);
@@ -1643,10 +1979,8 @@ struct ImBuf *IMB_anim_absolute(struct anim *anim,
 #endif
 #ifdef WITH_FFMPEG
     case ANIM_FFMPEG:
+      /* The decoder position is owned by the decode-ahead thread, it is set internally. */
       ibuf = ffmpeg_fetchibuf(anim, position, tc);
-      if (ibuf) {
-        anim->cur_position = position;
-      }
       filter_y = 0; /* done internally */
       break;
 #endif
@@ -1656,7 +1990,7 @@ struct ImBuf *IMB_anim_absolute(struct anim *anim,
     if (filter_y) {
       IMB_filtery(ibuf);
     }
-    BLI_snprintf(ibuf->name, sizeof(ibuf->name), "%s.%04d", anim->name, anim->cur_position + 1);
+    BLI_snprintf(ibuf->name, sizeof(ibuf->name), "%s.%04d", anim->name, position + 1);
   }
   return ibuf;
 }
@@ -32,6 +32,7 @@
 #include "DNA_movieclip_types.h"
 #include "DNA_scene_types.h"
 #include "DNA_space_types.h"
+#include "DNA_userdef_types.h"
 
 #include "IMB_filetype.h"
 #include "IMB_filter.h"
@@ -100,8 +101,14 @@ static float imbuf_linear_srgb_to_xyz[3][3] = {{0.0f}};
  */
 static pthread_mutex_t processor_lock = BLI_MUTEX_INITIALIZER;
 
+/* Baked display LUTs of recently used view settings, see #display_processor_use_lut. */
+static pthread_mutex_t display_lut_lock = BLI_MUTEX_INITIALIZER;
+static ListBase global_display_lut_cache = {NULL, NULL};
+
 typedef struct ColormanageProcessor {
   OCIO_ConstCPUProcessorRcPtr *cpu_processor;
+  /* Replaces cpu_processor for buffers when set. */
+  struct DisplayLUTCacheEntry *display_lut;
   CurveMapping *curve_mapping;
   bool is_data_result;
 } ColormanageProcessor;
@@ -455,6 +462,148 @@ static void colormanage_cache_handle_release(void *cache_handle)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Baked Display LUT
+ *
+ * Experimental fast path for display buffers: the view, look and display chain is baked into a
+ * 3D LUT, see colormanagement_lut.c. LUTs are shared between processors and cached for a few
+ * view settings, so dragging the exposure slider doesn't keep all of them around.
+ * \{ */
+
+#define DISPLAY_LUT_CACHE_SIZE 4
+#define DISPLAY_LUT_KEY_SIZE (MAX_COLORSPACE_NAME * 4 + 64)
+
+typedef struct DisplayLUTCacheEntry {
+  struct DisplayLUTCacheEntry *next, *prev;
+  char key[DISPLAY_LUT_KEY_SIZE];
+  ColormanageDisplayLUT *lut;
+  /* Processors using the LUT, unused entries can be evicted. */
+  int users;
+} DisplayLUTCacheEntry;
+
+static void display_lut_evaluate(void *userdata, float *rgb, int num_pixels)
+{
+  OCIO_ConstCPUProcessorRcPtr *cpu_processor = userdata;
+  OCIO_PackedImageDesc *img = OCIO_createOCIO_PackedImageDesc(rgb,
+                                                              num_pixels,
+                                                              1,
+                                                              3,
+                                                              sizeof(float),
+                                                              3 * sizeof(float),
+                                                              (size_t)num_pixels * 3 *
+                                                                  sizeof(float));
+  OCIO_cpuProcessorApply(cpu_processor, img);
+  OCIO_PackedImageDescRelease(img);
+}
+
+static DisplayLUTCacheEntry *display_lut_cache_find(const char *key)
+{
+  LISTBASE_FOREACH (DisplayLUTCacheEntry *, entry, &global_display_lut_cache) {
+    if (STREQ(entry->key, key)) {
+      /* Keep the most recently used entries first. */
+      BLI_remlink(&global_display_lut_cache, entry);
+      BLI_addhead(&global_display_lut_cache, entry);
+      entry->users++;
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+static DisplayLUTCacheEntry *display_lut_cache_acquire(const char *key,
+                                                       OCIO_ConstCPUProcessorRcPtr *cpu_processor)
+{
+  BLI_mutex_lock(&display_lut_lock);
+  DisplayLUTCacheEntry *entry = display_lut_cache_find(key);
+  BLI_mutex_unlock(&display_lut_lock);
+
+  if (entry) {
+    return entry;
+  }
+
+  /* Bake without holding the lock, at worst two threads bake the same LUT. */
+  ColormanageDisplayLUT *lut = colormanage_display_lut_bake(display_lut_evaluate, cpu_processor);
+
+  BLI_mutex_lock(&display_lut_lock);
+  entry = display_lut_cache_find(key);
+  if (entry) {
+    colormanage_display_lut_free(lut);
+  }
+  else {
+    entry = MEM_callocN(sizeof(DisplayLUTCacheEntry), "DisplayLUTCacheEntry");
+    BLI_strncpy(entry->key, key, sizeof(entry->key));
+    entry->lut = lut;
+    entry->users = 1;
+    BLI_addhead(&global_display_lut_cache, entry);
+
+    /* Evict the least recently used LUTs that are not in use. */
+    int num_entries = BLI_listbase_count(&global_display_lut_cache);
+    DisplayLUTCacheEntry *evict = global_display_lut_cache.last;
+    while (evict && num_entries > DISPLAY_LUT_CACHE_SIZE) {
+      DisplayLUTCacheEntry *evict_prev = evict->prev;
+      if (evict->users == 0) {
+        BLI_remlink(&global_display_lut_cache, evict);
+        colormanage_display_lut_free(evict->lut);
+        MEM_freeN(evict);
+        num_entries--;
+      }
+      evict = evict_prev;
+    }
+  }
+  BLI_mutex_unlock(&display_lut_lock);
+
+  return entry;
+}
+
+static void display_lut_cache_release(DisplayLUTCacheEntry *entry)
+{
+  BLI_mutex_lock(&display_lut_lock);
+  entry->users--;
+  BLI_mutex_unlock(&display_lut_lock);
+}
+
+static void display_lut_cache_free(void)
+{
+  LISTBASE_FOREACH_MUTABLE (DisplayLUTCacheEntry *, entry, &global_display_lut_cache) {
+    BLI_assert(entry->users == 0);
+    colormanage_display_lut_free(entry->lut);
+    MEM_freeN(entry);
+  }
+  BLI_listbase_clear(&global_display_lut_cache);
+}
+
+/* Apply the display transform of \a cm_processor with a baked LUT, when enabled. */
+static void display_processor_use_lut(ColormanageProcessor *cm_processor,
+                                      const ColorManagedViewSettings *view_settings,
+                                      const ColorManagedDisplaySettings *display_settings)
+{
+  if (!USER_EXPERIMENTAL_TEST(&U, use_display_lut) || cm_processor->cpu_processor == NULL) {
+    return;
+  }
+
+  ColorManagedViewSettings default_view_settings;
+  if (view_settings == NULL) {
+    IMB_colormanagement_init_default_view_settings(&default_view_settings, display_settings);
+    view_settings = &default_view_settings;
+  }
+
+  /* Everything create_display_buffer_processor() depends on, curves are applied separately. */
+  char key[DISPLAY_LUT_KEY_SIZE];
+  BLI_snprintf(key,
+               sizeof(key),
+               "%s\n%s\n%s\n%s\n%.9g\n%.9g",
+               view_settings->look,
+               view_settings->view_transform,
+               display_settings->display_device,
+               global_role_scene_linear,
+               view_settings->exposure,
+               view_settings->gamma);
+
+  cm_processor->display_lut = display_lut_cache_acquire(key, cm_processor->cpu_processor);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Initialization / De-initialization
  * \{ */
@@ -732,6 +881,8 @@ void colormanagement_exit(void)
   memset(&global_gpu_state, 0, sizeof(global_gpu_state));
   memset(&global_color_picking_state, 0, sizeof(global_color_picking_state));
 
+  display_lut_cache_free();
+
   colormanage_free_config();
 }
 
@@ -1763,6 +1914,7 @@ static void colormanage_display_buffer_process_ex(
 
   if (skip_transform == false) {
     cm_processor = IMB_colormanagement_display_processor_new(view_settings, display_settings);
+    display_processor_use_lut(cm_processor, view_settings, display_settings);
   }
 
   display_buffer_apply_threaded(ibuf,
@@ -3883,7 +4035,11 @@ void IMB_colormanagement_processor_apply(ColormanageProcessor *cm_processor,
     }
   }
 
-  if (cm_processor->cpu_processor && channels >= 3) {
+  if (cm_processor->display_lut && ELEM(channels, 3, 4)) {
+    colormanage_display_lut_apply(
+        cm_processor->display_lut->lut, buffer, width, height, channels, predivide);
+  }
+  else if (cm_processor->cpu_processor && channels >= 3) {
     OCIO_PackedImageDesc *img;
 
     /* apply OCIO processor */
@@ -3932,6 +4088,9 @@ void IMB_colormanagement_processor_free(ColormanageProcessor *cm_processor)
   if (cm_processor->cpu_processor) {
     OCIO_cpuProcessorRelease(cm_processor->cpu_processor);
   }
+  if (cm_processor->display_lut) {
+    display_lut_cache_release(cm_processor->display_lut);
+  }
 
   MEM_freeN(cm_processor);
 }
@@ -0,0 +1,371 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup imbuf
+ *
+ * Baked 3D LUT for display transforms.
+ *
+ * Running the OCIO view, look and display chain for every pixel is the most expensive part of
+ * display buffer updates. Instead the chain is evaluated once on a lattice, which is then applied
+ * with tetrahedral interpolation.
+ *
+ * Scene linear input is HDR, so lattice coordinates go through a logarithmic shaper. The bit
+ * pattern of a positive float is a piecewise linear approximation of its base 2 logarithm, which
+ * is cheap to compute for every pixel and exactly invertible when baking. Below
+ * #DISPLAY_LUT_SHAPER_MIN the shaper is linear down to zero, inputs outside of the lattice are
+ * clamped.
+ */
+
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_math_base.h"
+#include "BLI_math_vector.h"
+#include "BLI_simd.h"
+#include "BLI_task.h"
+#include "BLI_utildefines.h"
+
+#include "IMB_colormanagement_intern.h"
+
+/* Three lattice nodes per stop from 2^-11 to 2^10. 1.0 falls exactly on a node, so views that
+ * clamp there stay accurate. */
+#define DISPLAY_LUT_SIZE 65
+#define DISPLAY_LUT_SHAPER_MIN (1.0f / 2048.0f)
+#define DISPLAY_LUT_SHAPER_MAX 1024.0f
+
+struct ColormanageDisplayLUT {
+  /* RGB and padding for every lattice node, red varies fastest. */
+  float (*nodes)[4];
+  /* Shaper parameters, see #display_lut_shaper. */
+  float bits_min;
+  float inv_bits_step;
+};
+
+BLI_INLINE int display_lut_float_bits(const float value)
+{
+  int bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+/* Input value of lattice node \a index along one axis. */
+static float display_lut_node_value(const int index)
+{
+  if (index == 0) {
+    return 0.0f;
+  }
+  const int bits_min = display_lut_float_bits(DISPLAY_LUT_SHAPER_MIN);
+  const int bits_max = display_lut_float_bits(DISPLAY_LUT_SHAPER_MAX);
+  const double bits_step = (double)(bits_max - bits_min) / (DISPLAY_LUT_SIZE - 2);
+  const int bits = bits_min + (int)((index - 1) * bits_step + 0.5);
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+/* Lattice coordinate of an input value, in [0, DISPLAY_LUT_SIZE - 1]. */
+BLI_INLINE float display_lut_shaper(const ColormanageDisplayLUT *lut, const float value)
+{
+  float coord;
+  if (!(value > 0.0f)) {
+    /* Negative and NaN. */
+    coord = 0.0f;
+  }
+  else if (value < DISPLAY_LUT_SHAPER_MIN) {
+    coord = value * (1.0f / DISPLAY_LUT_SHAPER_MIN);
+  }
+  else {
+    coord = 1.0f + ((float)display_lut_float_bits(value) - lut->bits_min) * lut->inv_bits_step;
+  }
+  return min_ff(coord, (float)(DISPLAY_LUT_SIZE - 1));
+}
+
+typedef struct DisplayLUTBakeData {
+  ColormanageDisplayLUT *lut;
+  const float *axis_values;
+  ColormanageDisplayLUTEvaluateFn evaluate;
+  void *userdata;
+} DisplayLUTBakeData;
+
+/* Bake one slice of constant blue. */
+static void display_lut_bake_slice(void *__restrict userdata,
+                                   const int ib,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const DisplayLUTBakeData *data = userdata;
+  const int slice_size = DISPLAY_LUT_SIZE * DISPLAY_LUT_SIZE;
+  float(*rgb)[3] = MEM_malloc_arrayN(slice_size, sizeof(*rgb), __func__);
+
+  for (int ig = 0; ig < DISPLAY_LUT_SIZE; ig++) {
+    for (int ir = 0; ir < DISPLAY_LUT_SIZE; ir++) {
+      float *value = rgb[ig * DISPLAY_LUT_SIZE + ir];
+      value[0] = data->axis_values[ir];
+      value[1] = data->axis_values[ig];
+      value[2] = data->axis_values[ib];
+    }
+  }
+
+  data->evaluate(data->userdata, (float *)rgb, slice_size);
+
+  float(*nodes)[4] = data->lut->nodes + (size_t)ib * slice_size;
+  for (int i = 0; i < slice_size; i++) {
+    copy_v3_v3(nodes[i], rgb[i]);
+    nodes[i][3] = 0.0f;
+  }
+
+  MEM_freeN(rgb);
+}
+
+/**
+ * Bake a LUT by calling \a evaluate on packed RGB lattice inputs, from multiple threads.
+ */
+ColormanageDisplayLUT *colormanage_display_lut_bake(ColormanageDisplayLUTEvaluateFn evaluate,
+                                                    void *userdata)
+{
+  ColormanageDisplayLUT *lut = MEM_callocN(sizeof(ColormanageDisplayLUT), __func__);
+  const size_t num_nodes = (size_t)DISPLAY_LUT_SIZE * DISPLAY_LUT_SIZE * DISPLAY_LUT_SIZE;
+
+  lut->nodes = MEM_mallocN_aligned(sizeof(*lut->nodes) * num_nodes, 16, "display lut nodes");
+  lut->bits_min = (float)display_lut_float_bits(DISPLAY_LUT_SHAPER_MIN);
+  lut->inv_bits_step = (float)(DISPLAY_LUT_SIZE - 2) /
+                       ((float)display_lut_float_bits(DISPLAY_LUT_SHAPER_MAX) - lut->bits_min);
+
+  float axis_values[DISPLAY_LUT_SIZE];
+  for (int i = 0; i < DISPLAY_LUT_SIZE; i++) {
+    axis_values[i] = display_lut_node_value(i);
+  }
+
+  DisplayLUTBakeData data = {lut, axis_values, evaluate, userdata};
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(0, DISPLAY_LUT_SIZE, &data, display_lut_bake_slice, &settings);
+
+  return lut;
+}
+
+void colormanage_display_lut_free(ColormanageDisplayLUT *lut)
+{
+  MEM_freeN(lut->nodes);
+  MEM_freeN(lut);
+}
+
+/* The point is in the tetrahedron going from the cell origin along the axis with the largest
+ * fraction, then the middle one, then the smallest. Corner weights are the differences between
+ * consecutive sorted fractions. Corners are indexed by the ordering bits of
+ * #display_lut_order. */
+#define LUT_DR 1
+#define LUT_DG DISPLAY_LUT_SIZE
+#define LUT_DB (DISPLAY_LUT_SIZE * DISPLAY_LUT_SIZE)
+static const int display_lut_corners[8][2] = {
+    {LUT_DB, LUT_DB + LUT_DG}, /* b >= g >= r */
+    {LUT_DB, LUT_DB + LUT_DR}, /* b >= r > g */
+    {LUT_DG, LUT_DG + LUT_DB}, /* g >= b >= r */
+    {LUT_DR, LUT_DR + LUT_DG}, /* Not reachable. */
+    {LUT_DB, LUT_DB + LUT_DG}, /* Not reachable. */
+    {LUT_DR, LUT_DR + LUT_DB}, /* r > b >= g */
+    {LUT_DG, LUT_DG + LUT_DR}, /* g >= r > b */
+    {LUT_DR, LUT_DR + LUT_DG}, /* r > g > b */
+};
+
+BLI_INLINE int display_lut_order(const float f[3])
+{
+  return (f[0] > f[1]) | ((f[1] > f[2]) << 1) | ((f[0] > f[2]) << 2);
+}
+
+/* Tetrahedral interpolation of the lattice cell at \a index, with fractions \a f in [0, 1]. */
+BLI_INLINE void display_lut_tetrahedral(const ColormanageDisplayLUT *lut,
+                                        const int index,
+                                        const float f[3],
+                                        float r_rgb[3])
+{
+  const float(*c)[4] = lut->nodes + index;
+  const int *corner = display_lut_corners[display_lut_order(f)];
+  const float f_max = max_fff(f[0], f[1], f[2]);
+  const float f_min = min_fff(f[0], f[1], f[2]);
+  const float f_mid = f[0] + f[1] + f[2] - f_max - f_min;
+  const float w[4] = {1.0f - f_max, f_max - f_mid, f_mid - f_min, f_min};
+
+  for (int i = 0; i < 3; i++) {
+    r_rgb[i] = w[0] * c[0][i] + w[1] * c[corner[0]][i] + w[2] * c[corner[1]][i] +
+               w[3] * c[LUT_DR + LUT_DG + LUT_DB][i];
+  }
+}
+
+static void display_lut_apply_rgb(const ColormanageDisplayLUT *lut, float rgb[3])
+{
+  int index = 0;
+  float f[3];
+  for (int i = 0, stride = 1; i < 3; i++, stride *= DISPLAY_LUT_SIZE) {
+    const float coord = display_lut_shaper(lut, rgb[i]);
+    const int cell = min_ii((int)coord, DISPLAY_LUT_SIZE - 2);
+    f[i] = coord - (float)cell;
+    index += cell * stride;
+  }
+  display_lut_tetrahedral(lut, index, f, rgb);
+}
+
+static void display_lut_apply_pixel(const ColormanageDisplayLUT *lut,
+                                    float *pixel,
+                                    const int channels,
+                                    const bool predivide)
+{
+  if (predivide && channels == 4 && !ELEM(pixel[3], 0.0f, 1.0f)) {
+    const float alpha = pixel[3];
+    mul_v3_fl(pixel, 1.0f / alpha);
+    display_lut_apply_rgb(lut, pixel);
+    mul_v3_fl(pixel, alpha);
+  }
+  else {
+    display_lut_apply_rgb(lut, pixel);
+  }
+}
+
+#ifdef BLI_HAVE_SSE2
+/* #display_lut_shaper for four values, max() also maps NaN to zero. */
+BLI_INLINE __m128 display_lut_shaper_v4(const ColormanageDisplayLUT *lut, const __m128 value_in)
+{
+  const __m128 value = _mm_max_ps(value_in, _mm_setzero_ps());
+  const __m128 coord_lin = _mm_mul_ps(value, _mm_set1_ps(1.0f / DISPLAY_LUT_SHAPER_MIN));
+  const __m128 bits = _mm_cvtepi32_ps(_mm_castps_si128(value));
+  const __m128 coord_log = _mm_add_ps(
+      _mm_set1_ps(1.0f),
+      _mm_mul_ps(_mm_sub_ps(bits, _mm_set1_ps(lut->bits_min)), _mm_set1_ps(lut->inv_bits_step)));
+  const __m128 is_lin = _mm_cmplt_ps(value, _mm_set1_ps(DISPLAY_LUT_SHAPER_MIN));
+  const __m128 coord = _mm_or_ps(_mm_and_ps(is_lin, coord_lin),
+                                 _mm_andnot_ps(is_lin, coord_log));
+  return _mm_min_ps(coord, _mm_set1_ps((float)(DISPLAY_LUT_SIZE - 1)));
+}
+
+/* Split coordinates into the cell, as float, and the fraction inside of it. */
+BLI_INLINE __m128 display_lut_cell_v4(const __m128 coord, __m128 *r_frac)
+{
+  /* Coordinates are positive, so truncation is floor. */
+  const __m128 cell = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(coord)),
+                                 _mm_set1_ps((float)(DISPLAY_LUT_SIZE - 2)));
+  *r_frac = _mm_sub_ps(coord, cell);
+  return cell;
+}
+
+/**
+ * Four RGBA pixels at a time. They are transposed so every register holds one channel of all
+ * pixels, only the final blend of the lattice nodes is done per pixel.
+ */
+static void display_lut_apply_rgba_v4(const ColormanageDisplayLUT *lut,
+                                      float *pixels,
+                                      const bool predivide)
+{
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  __m128 r = _mm_loadu_ps(pixels);
+  __m128 g = _mm_loadu_ps(pixels + 4);
+  __m128 b = _mm_loadu_ps(pixels + 8);
+  __m128 a = _mm_loadu_ps(pixels + 12);
+  _MM_TRANSPOSE4_PS(r, g, b, a);
+
+  __m128 alpha_scale = one;
+  if (predivide) {
+    const __m128 use_alpha = _mm_and_ps(_mm_cmpneq_ps(a, zero), _mm_cmpneq_ps(a, one));
+    const __m128 inv_alpha = _mm_div_ps(one, _mm_or_ps(a, _mm_andnot_ps(use_alpha, one)));
+    const __m128 unassociate = _mm_or_ps(_mm_and_ps(use_alpha, inv_alpha),
+                                         _mm_andnot_ps(use_alpha, one));
+    r = _mm_mul_ps(r, unassociate);
+    g = _mm_mul_ps(g, unassociate);
+    b = _mm_mul_ps(b, unassociate);
+    alpha_scale = _mm_or_ps(_mm_and_ps(use_alpha, a), _mm_andnot_ps(use_alpha, one));
+  }
+
+  __m128 fr, fg, fb;
+  const __m128 cell_r = display_lut_cell_v4(display_lut_shaper_v4(lut, r), &fr);
+  const __m128 cell_g = display_lut_cell_v4(display_lut_shaper_v4(lut, g), &fg);
+  const __m128 cell_b = display_lut_cell_v4(display_lut_shaper_v4(lut, b), &fb);
+
+  /* Exact in float, the lattice has far less than 2^24 nodes. */
+  const __m128 size = _mm_set1_ps((float)DISPLAY_LUT_SIZE);
+  int index[4];
+  _mm_storeu_si128(
+      (__m128i *)index,
+      _mm_cvttps_epi32(_mm_add_ps(cell_r, _mm_mul_ps(_mm_add_ps(cell_g, _mm_mul_ps(cell_b, size)),
+                                                     size))));
+
+  const __m128i order_v = _mm_or_si128(
+      _mm_or_si128(_mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(fr, fg)), _mm_set1_epi32(1)),
+                   _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(fg, fb)), _mm_set1_epi32(2))),
+      _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(fr, fb)), _mm_set1_epi32(4)));
+  int order[4];
+  _mm_storeu_si128((__m128i *)order, order_v);
+
+  const __m128 f_max = _mm_max_ps(_mm_max_ps(fr, fg), fb);
+  const __m128 f_min = _mm_min_ps(_mm_min_ps(fr, fg), fb);
+  const __m128 f_mid = _mm_sub_ps(_mm_add_ps(_mm_add_ps(fr, fg), fb), _mm_add_ps(f_max, f_min));
+  float w[4][4];
+  _mm_storeu_ps(w[0], _mm_sub_ps(one, f_max));
+  _mm_storeu_ps(w[1], _mm_sub_ps(f_max, f_mid));
+  _mm_storeu_ps(w[2], _mm_sub_ps(f_mid, f_min));
+  _mm_storeu_ps(w[3], f_min);
+
+  __m128 result[4];
+  for (int i = 0; i < 4; i++) {
+    const float(*c)[4] = lut->nodes + index[i];
+    const int *corner = display_lut_corners[order[i]];
+    __m128 sum = _mm_mul_ps(_mm_set1_ps(w[0][i]), _mm_load_ps(c[0]));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(w[1][i]), _mm_load_ps(c[corner[0]])));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(w[2][i]), _mm_load_ps(c[corner[1]])));
+    sum = _mm_add_ps(
+        sum, _mm_mul_ps(_mm_set1_ps(w[3][i]), _mm_load_ps(c[LUT_DR + LUT_DG + LUT_DB])));
+    result[i] = sum;
+  }
+
+  _MM_TRANSPOSE4_PS(result[0], result[1], result[2], result[3]);
+  r = _mm_mul_ps(result[0], alpha_scale);
+  g = _mm_mul_ps(result[1], alpha_scale);
+  b = _mm_mul_ps(result[2], alpha_scale);
+  _MM_TRANSPOSE4_PS(r, g, b, a);
+  _mm_storeu_ps(pixels, r);
+  _mm_storeu_ps(pixels + 4, g);
+  _mm_storeu_ps(pixels + 8, b);
+  _mm_storeu_ps(pixels + 12, a);
+}
+#endif
+
+/**
+ * Apply the LUT to the RGB of a buffer with 3 or 4 channels, alpha is left as is.
+ * With \a predivide, color is unassociated from alpha for the lookup like OCIO does.
+ */
+void colormanage_display_lut_apply(const ColormanageDisplayLUT *lut,
+                                   float *buffer,
+                                   const int width,
+                                   const int height,
+                                   const int channels,
+                                   const bool predivide)
+{
+  BLI_assert(ELEM(channels, 3, 4));
+  const size_t num_pixels = (size_t)width * height;
+  size_t i = 0;
+
+#ifdef BLI_HAVE_SSE2
+  if (channels == 4) {
+    for (; i + 4 <= num_pixels; i += 4) {
+      display_lut_apply_rgba_v4(lut, buffer + i * 4, predivide);
+    }
+  }
+#endif
+
+  for (; i < num_pixels; i++) {
+    display_lut_apply_pixel(lut, buffer + i * channels, channels, predivide);
+  }
+}
@@ -0,0 +1,163 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "testing/testing.h"
+
+#include <cmath>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_math_color.h"
+#include "BLI_rand.h"
+
+#include "IMB_colormanagement_intern.h"
+
+namespace blender::imbuf::tests {
+
+/* Compares the baked LUT with the transform it was baked from. An analytic stand-in for the
+ * OCIO display transform is used (exposure, sRGB curve and gamma, like the "Standard" view), so
+ * the test doesn't depend on an OCIO configuration. */
+class DisplayLUTTest : public testing::Test {
+ protected:
+  struct DisplayTransform {
+    float exposure;
+    float gamma;
+  } transform = {1.0f, 1.0f};
+  ColormanageDisplayLUT *lut = nullptr;
+
+  void TearDown() override
+  {
+    if (lut) {
+      colormanage_display_lut_free(lut);
+    }
+  }
+
+  static float display_transform(const DisplayTransform &transform, const float value)
+  {
+    const float display = linearrgb_to_srgb(std::max(value * transform.exposure, 0.0f));
+    return powf(display, 1.0f / transform.gamma);
+  }
+
+  static void evaluate(void *userdata, float *rgb, int num_pixels)
+  {
+    const DisplayTransform &transform = *static_cast<const DisplayTransform *>(userdata);
+    for (int i = 0; i < num_pixels * 3; i++) {
+      rgb[i] = display_transform(transform, rgb[i]);
+    }
+  }
+
+  void bake(const float exposure, const float gamma)
+  {
+    transform.exposure = powf(2.0f, exposure);
+    transform.gamma = gamma;
+    lut = colormanage_display_lut_bake(evaluate, &transform);
+  }
+
+  /* Largest difference between the LUT and the transform, relative to the output for values
+   * above 1. */
+  float max_error(const float *input, const int num_pixels, const int channels, bool predivide)
+  {
+    const size_t size = static_cast<size_t>(num_pixels) * channels;
+    float *result = static_cast<float *>(MEM_mallocN(sizeof(float) * size, __func__));
+    memcpy(result, input, sizeof(float) * size);
+
+    colormanage_display_lut_apply(lut, result, num_pixels, 1, channels, predivide);
+
+    float error = 0.0f;
+    for (int i = 0; i < num_pixels; i++) {
+      const float *pixel = input + i * channels;
+      const float alpha = (channels == 4) ? pixel[3] : 1.0f;
+      const bool unassociate = predivide && !ELEM(alpha, 0.0f, 1.0f);
+
+      for (int c = 0; c < 3; c++) {
+        float expected = unassociate ? display_transform(transform, pixel[c] / alpha) * alpha :
+                                       display_transform(transform, pixel[c]);
+        error = std::max(error,
+                         fabsf(result[i * channels + c] - expected) / std::max(1.0f, expected));
+      }
+      if (channels == 4) {
+        EXPECT_EQ(result[i * channels + 3], alpha);
+      }
+    }
+
+    MEM_freeN(result);
+    return error;
+  }
+};
+
+/* One 8 bit step, display buffers are mostly bytes. */
+static const float max_display_error = 1.0f / 255.0f;
+
+TEST_F(DisplayLUTTest, gradient)
+{
+  bake(0.0f, 1.0f);
+
+  /* Gray and primaries over the whole range of the lattice, 16 steps per stop. */
+  const int num_steps = 16 * 21;
+  const int num_pixels = num_steps * 4;
+  float(*input)[3] = static_cast<float(*)[3]>(
+      MEM_callocN(sizeof(*input) * num_pixels, __func__));
+  for (int i = 0; i < num_steps; i++) {
+    const float value = (i == 0) ? 0.0f : powf(2.0f, i / 16.0f - 11.0f);
+    input[i * 4][0] = input[i * 4][1] = input[i * 4][2] = value;
+    for (int axis = 0; axis < 3; axis++) {
+      input[i * 4 + 1 + axis][axis] = value;
+    }
+  }
+
+  EXPECT_LT(max_error(&input[0][0], num_pixels, 3, false), max_display_error);
+  MEM_freeN(input);
+}
+
+TEST_F(DisplayLUTTest, random_rgba)
+{
+  bake(1.5f, 1.2f);
+
+  const int num_pixels = 10007;
+  float(*input)[4] = static_cast<float(*)[4]>(MEM_mallocN(sizeof(*input) * num_pixels, __func__));
+  RNG *rng = BLI_rng_new(0);
+  for (int i = 0; i < num_pixels; i++) {
+    /* Log distributed over the usual HDR range, with a few exact zeros and ones for alpha. Alpha
+     * is kept high enough for unassociated color to stay inside the lattice. */
+    for (int c = 0; c < 3; c++) {
+      input[i][c] = powf(2.0f, BLI_rng_get_float(rng) * 16.0f - 10.0f);
+    }
+    input[i][3] = (i % 7 == 0) ? 0.0f :
+                  (i % 7 == 1) ? 1.0f :
+                                 0.25f + 0.75f * BLI_rng_get_float(rng);
+  }
+  BLI_rng_free(rng);
+
+  EXPECT_LT(max_error(&input[0][0], num_pixels, 4, false), max_display_error);
+  EXPECT_LT(max_error(&input[0][0], num_pixels, 4, true), max_display_error);
+  MEM_freeN(input);
+}
+
+TEST_F(DisplayLUTTest, out_of_range)
+{
+  bake(0.0f, 1.0f);
+
+  /* Negative and NaN map to the black node, very bright values to the last one. */
+  float pixels[3][4] = {{-1.0f, NAN, 0.0f, 1.0f}, {1e30f, 1e30f, 1e30f, 1.0f}, {0}};
+  colormanage_display_lut_apply(lut, &pixels[0][0], 3, 1, 4, false);
+  EXPECT_EQ(pixels[0][0], pixels[2][0]);
+  EXPECT_EQ(pixels[0][1], pixels[2][1]);
+  EXPECT_FALSE(std::isnan(pixels[0][1]));
+  EXPECT_GT(pixels[1][0], 1.0f);
+  EXPECT_FALSE(std::isinf(pixels[1][0]));
+}
+
+}  // namespace blender::imbuf::tests
@@ -33,6 +33,10 @@
 #include "BLI_string.h"
 #include "BLI_threads.h"
 #include "BLI_utildefines.h"
+#include "PIL_time.h"
+
+#include "BKE_global.h"
+
 #ifdef _WIN32
 #  include "BLI_winstuff.h"
 #endif
@@ -486,6 +490,26 @@ typedef struct IndexBuildContext {
 
 #ifdef WITH_FFMPEG
 
+/* Number of decoded frames buffered for the encode threads, limits how far decoding can run
+ * ahead of the slowest proxy size. */
+#  define PROXY_FRAME_QUEUE_SIZE 16
+
+/* Decoded frames handed from the decoding thread to one scale & encode thread per proxy size.
+ * Every proxy size gets its own reference of the frame, the slot is reused once all of them
+ * are consumed. */
+typedef struct ProxyFrameQueue {
+  ThreadMutex mutex;
+  ThreadCondition cond;
+  AVFrame *frames[PROXY_FRAME_QUEUE_SIZE][IMB_PROXY_MAX_SLOT];
+  int frame_users[PROXY_FRAME_QUEUE_SIZE];
+  int num_consumers;
+  int64_t num_pushed;
+  /* No more frames will be pushed, encode what is left. */
+  bool finished;
+  /* Building was stopped, the output is discarded. */
+  bool cancel;
+} ProxyFrameQueue;
+
 struct proxy_output_ctx {
   AVFormatContext *of;
   AVStream *st;
@@ -497,6 +521,12 @@ struct proxy_output_ctx {
   int proxy_size;
   int orig_height;
   struct anim *anim;
+
+  /* Position in #ProxyFrameQueue, owned by the encode thread of this proxy size. */
+  ProxyFrameQueue *queue;
+  int queue_index;
+  int64_t queue_pos;
+  double time_encode;
 };
 
 static struct proxy_output_ctx *alloc_proxy_output_ffmpeg(
@@ -789,6 +819,9 @@ static void free_proxy_output_ffmpeg(struct proxy_output_ctx *ctx, int rollback)
 typedef struct FFmpegIndexBuilderContext {
   int anim_type;
 
+  ListBase encode_threads;
+  ProxyFrameQueue *encode_queue;
+
   AVFormatContext *iFormatCtx;
   AVCodecContext *iCodecCtx;
   AVCodec *iCodec;
@@ -815,8 +848,152 @@ typedef struct FFmpegIndexBuilderContext {
   double pts_time_base;
   int frameno, frameno_gapless;
   int start_pts_set;
+
+  /* Throughput statistics. */
+  int num_frames_decoded;
+  double time_start;
 } FFmpegIndexBuilderContext;
 
+static void *index_rebuild_ffmpeg_encode_thread(void *data)
+{
+  struct proxy_output_ctx *ctx = data;
+  ProxyFrameQueue *queue = ctx->queue;
+
+  BLI_mutex_lock(&queue->mutex);
+  while (true) {
+    while (ctx->queue_pos == queue->num_pushed && !queue->finished && !queue->cancel) {
+      BLI_condition_wait(&queue->cond, &queue->mutex);
+    }
+    if (queue->cancel || ctx->queue_pos == queue->num_pushed) {
+      break;
+    }
+
+    const int slot = ctx->queue_pos % PROXY_FRAME_QUEUE_SIZE;
+    AVFrame *frame = queue->frames[slot][ctx->queue_index];
+    queue->frames[slot][ctx->queue_index] = NULL;
+    BLI_mutex_unlock(&queue->mutex);
+
+    const double time_start = PIL_check_seconds_timer();
+    add_to_proxy_output_ffmpeg(ctx, frame);
+    ctx->time_encode += PIL_check_seconds_timer() - time_start;
+    av_frame_free(&frame);
+
+    BLI_mutex_lock(&queue->mutex);
+    ctx->queue_pos++;
+    queue->frame_users[slot]--;
+    BLI_condition_notify_all(&queue->cond);
+  }
+  BLI_mutex_unlock(&queue->mutex);
+
+  return NULL;
+}
+
+static void index_rebuild_ffmpeg_start_encoders(FFmpegIndexBuilderContext *context)
+{
+  ProxyFrameQueue *queue = MEM_callocN(sizeof(ProxyFrameQueue), "ProxyFrameQueue");
+  BLI_mutex_init(&queue->mutex);
+  BLI_condition_init(&queue->cond);
+
+  for (int i = 0; i < context->num_proxy_sizes; i++) {
+    if (context->proxy_ctx[i]) {
+      queue->num_consumers++;
+    }
+  }
+
+  context->encode_queue = queue;
+  if (queue->num_consumers == 0) {
+    return;
+  }
+
+  BLI_threadpool_init(
+      &context->encode_threads, index_rebuild_ffmpeg_encode_thread, queue->num_consumers);
+  for (int i = 0; i < context->num_proxy_sizes; i++) {
+    struct proxy_output_ctx *ctx = context->proxy_ctx[i];
+    if (ctx) {
+      ctx->queue = queue;
+      ctx->queue_index = i;
+      ctx->queue_pos = 0;
+      BLI_threadpool_insert(&context->encode_threads, ctx);
+    }
+  }
+}
+
+/* Hand a decoded frame to the encode threads, blocks while the queue is full. */
+static void index_rebuild_ffmpeg_push_frame(FFmpegIndexBuilderContext *context, AVFrame *frame)
+{
+  ProxyFrameQueue *queue = context->encode_queue;
+  if (queue->num_consumers == 0) {
+    return;
+  }
+
+  const int slot = queue->num_pushed % PROXY_FRAME_QUEUE_SIZE;
+
+  BLI_mutex_lock(&queue->mutex);
+  while (queue->frame_users[slot] > 0 && !queue->cancel) {
+    BLI_condition_wait(&queue->cond, &queue->mutex);
+  }
+  if (!queue->cancel) {
+    for (int i = 0; i < context->num_proxy_sizes; i++) {
+      if (context->proxy_ctx[i]) {
+        queue->frames[slot][i] = av_frame_clone(frame);
+      }
+    }
+    queue->frame_users[slot] = queue->num_consumers;
+    queue->num_pushed++;
+    BLI_condition_notify_all(&queue->cond);
+  }
+  BLI_mutex_unlock(&queue->mutex);
+}
+
+static void index_rebuild_ffmpeg_stop_encoders(FFmpegIndexBuilderContext *context, bool cancel)
+{
+  ProxyFrameQueue *queue = context->encode_queue;
+
+  BLI_mutex_lock(&queue->mutex);
+  queue->finished = true;
+  queue->cancel = cancel;
+  BLI_condition_notify_all(&queue->cond);
+  BLI_mutex_unlock(&queue->mutex);
+
+  if (queue->num_consumers != 0) {
+    BLI_threadpool_end(&context->encode_threads);
+  }
+
+  for (int slot = 0; slot < PROXY_FRAME_QUEUE_SIZE; slot++) {
+    for (int i = 0; i < IMB_PROXY_MAX_SLOT; i++) {
+      av_frame_free(&queue->frames[slot][i]);
+    }
+  }
+
+  BLI_condition_end(&queue->cond);
+  BLI_mutex_end(&queue->mutex);
+  MEM_freeN(queue);
+  context->encode_queue = NULL;
+}
+
+static void index_rebuild_ffmpeg_print_stats(const FFmpegIndexBuilderContext *context)
+{
+  const double time_total = PIL_check_seconds_timer() - context->time_start;
+
+  fprintf(stderr,
+          "Proxy rebuild of '%s': %d frames in %.2f s (%.1f fps)\n",
+          context->iFormatCtx->url,
+          context->num_frames_decoded,
+          time_total,
+          time_total > 0.0 ? context->num_frames_decoded / time_total : 0.0);
+
+  for (int i = 0; i < context->num_proxy_sizes; i++) {
+    const struct proxy_output_ctx *ctx = context->proxy_ctx[i];
+    if (ctx) {
+      fprintf(stderr,
+              "  %d%% proxy: scale & encode %.2f s (%.0f%% busy)\n",
+              (int)(proxy_fac[i] * 100.0f),
+              ctx->time_encode,
+              time_total > 0.0 ? ctx->time_encode / time_total * 100.0 : 0.0);
+    }
+  }
+}
+
 static IndexBuildContext *index_ffmpeg_create_context(struct anim *anim,
                                                       IMB_Timecode_Type tcs_in_use,
                                                       IMB_Proxy_Size proxy_sizes_in_use,
@@ -965,9 +1142,8 @@ static void index_rebuild_ffmpeg_proc_decoded_frame(FFmpegIndexBuilderContext *c
   uint64_t s_dts = context->seek_pos_dts;
   uint64_t pts = av_get_pts_from_frame(in_frame);
 
-  for (i = 0; i < context->num_proxy_sizes; i++) {
-    add_to_proxy_output_ffmpeg(context->proxy_ctx[i], in_frame);
-  }
+  index_rebuild_ffmpeg_push_frame(context, in_frame);
+  context->num_frames_decoded++;
 
   if (!context->start_pts_set) {
     context->start_pts = pts;
@@ -1024,6 +1200,11 @@ static int index_rebuild_ffmpeg(FFmpegIndexBuilderContext *context,
 
   context->frame_rate = av_q2d(context->iStream->r_frame_rate);
   context->pts_time_base = av_q2d(context->iStream->time_base);
+  context->time_start = PIL_check_seconds_timer();
+
+  /* Decoding and the timecode indices stay on this thread, scaling and encoding every proxy size
+   * runs on its own thread. */
+  index_rebuild_ffmpeg_start_encoders(context);
 
   while (av_read_frame(context->iFormatCtx, next_packet) >= 0) {
     float next_progress =
@@ -1090,6 +1271,12 @@ static int index_rebuild_ffmpeg(FFmpegIndexBuilderContext *context,
     }
   }
 
+  index_rebuild_ffmpeg_stop_encoders(context, *stop);
+
+  if (!*stop && (G.debug & G_DEBUG_FFMPEG)) {
+    index_rebuild_ffmpeg_print_stats(context);
+  }
+
   av_packet_free(&next_packet);
   av_free(in_frame);
 
@@ -1246,7 +1433,7 @@ static void index_rebuild_fallback(FallbackIndexBuilderContext *context,
 
         struct ImBuf *s_ibuf = IMB_dupImBuf(tmp_ibuf);
 
-        IMB_scalefastImBuf(s_ibuf, x, y);
+        IMB_scaleImBuf_threaded(s_ibuf, x, y);
 
         IMB_convert_rgba_to_abgr(s_ibuf);
 
@@ -1395,6 +1582,11 @@ void IMB_free_indices(struct anim *anim)
 {
   int i;
 
+#ifdef WITH_FFMPEG
+  /* The decode-ahead thread may be using one of the indices. */
+  imb_anim_decode_ahead_stop(anim);
+#endif
+
   for (i = 0; i < IMB_PROXY_MAX_SLOT; i++) {
     if (anim->proxy_anim[i]) {
       IMB_close_anim(anim->proxy_anim[i]);
@@ -26,6 +26,7 @@
 #include "IMB_colormanagement_intern.h"
 #include "IMB_filetype.h"
 #include "IMB_imbuf.h"
+#include "IMB_thumbs.h"
 
 void IMB_init(void)
 {
@@ -38,6 +39,7 @@ void IMB_init(void)
 
 void IMB_exit(void)
 {
+  IMB_thumb_index_flush();
   imb_tile_cache_exit();
   imb_filetypes_exit();
   colormanagement_exit();
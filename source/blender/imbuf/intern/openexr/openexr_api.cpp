@@ -55,6 +55,7 @@
 #include <ImfOutputPart.h>
 #include <ImfPartHelper.h>
 #include <ImfPartType.h>
+#include <ImfTiledInputPart.h>
 #include <ImfTiledOutputPart.h>
 
 #include "DNA_scene_types.h" /* For OpenEXR compression constants */
@@ -627,6 +628,8 @@ struct ExrHandle {
 
   IStream *ifile_stream;
   MultiPartInputFile *ifile;
+  /** Headers are still accessible, but pixels can't be read: the stream memory is gone. */
+  bool ifile_detached;
 
   OFileStream *ofile_stream;
   MultiPartOutputFile *mpofile;
@@ -659,6 +662,9 @@ struct ExrChannel {
   char chan_id;                   /* quick lookup of channel char */
   int view_id;                    /* quick lookup of channel view */
   bool use_half_float;            /* when saving use half float for file storage */
+
+  struct ExrPass *pass; /* pass the channel is part of, when parsed from a multilayer file */
+  int pass_offset;      /* offset of the first pixel in the buffer of the pass */
 };
 
 /* hierarchical; layers -> passes -> channels[] */
@@ -666,13 +672,15 @@ struct ExrPass {
   struct ExrPass *next, *prev;
   char name[EXR_PASS_MAXNAME];
   int totchan;
-  float *rect;
+  float *rect; /* allocated when the pass is read, see #imb_exr_read_passes */
   struct ExrChannel *chan[EXR_PASS_MAXCHAN];
   char chan_id[EXR_PASS_MAXCHAN];
 
   char internal_name[EXR_PASS_MAXNAME]; /* name with no view */
   char view[EXR_VIEW_MAXNAME];
   int view_id;
+
+  bool read_pending; /* rect is allocated, pixels still have to be decoded */
 };
 
 struct ExrLayer {
@@ -1220,17 +1228,25 @@ void IMB_exrtile_write_channels(
   }
 }
 
-void IMB_exr_read_channels(void *handle)
+/* Previous versions of Blender wrote multilayer files flipped. */
+static bool imb_exr_is_flipped(ExrHandle *data)
 {
-  ExrHandle *data = (ExrHandle *)handle;
-  int numparts = data->ifile->parts();
-
-  /* Check if EXR was saved with previous versions of blender which flipped images. */
   const StringAttribute *ta = data->ifile->header(0).findTypedAttribute<StringAttribute>(
       "BlenderMultiChannel");
 
-  /* 'previous multilayer attribute, flipped. */
-  short flip = (ta && STRPREFIX(ta->value().c_str(), "Blender V2.43"));
+  return ta && STRPREFIX(ta->value().c_str(), "Blender V2.43");
+}
+
+/**
+ * Decode channels into their buffers. Channels of passes are only read while the pass is
+ * pending, other channels only when `read_unparsed` is set and the caller assigned a buffer.
+ * Parts without any channel to read are skipped entirely, within a part OpenEXR only converts
+ * the channels inserted into the frame-buffer and decodes line blocks on its thread pool.
+ */
+static void imb_exr_read_channels_ex(ExrHandle *data, const bool read_unparsed)
+{
+  const int numparts = data->ifile->parts();
+  const bool flip = imb_exr_is_flipped(data);
 
   exr_printf(
       "\nIMB_exr_read_channels\n%s %-6s %-22s "
@@ -1241,19 +1257,18 @@ void IMB_exr_read_channels(void *handle)
       "internal_name");
 
   for (int i = 0; i < numparts; i++) {
-    /* Read part header. */
-    InputPart in(*data->ifile, i);
-    Header header = in.header();
-    Box2i dw = header.dataWindow();
-
     /* Insert all matching channel into frame-buffer. */
     FrameBuffer frameBuffer;
     ExrChannel *echan;
+    bool has_channels = false;
 
     for (echan = (ExrChannel *)data->channels.first; echan; echan = echan->next) {
       if (echan->m->part_number != i) {
         continue;
       }
+      if (echan->pass ? !echan->pass->read_pending : !read_unparsed) {
+        continue;
+      }
 
       exr_printf("%d %-6s %-22s \"%s\"\n",
                  echan->m->part_number,
@@ -1262,6 +1277,8 @@ void IMB_exr_read_channels(void *handle)
                  echan->m->internal_name.c_str());
 
       if (echan->rect) {
+        /* Read part header, only for parts which have channels to read. */
+        const Box2i dw = data->ifile->header(i).dataWindow();
         float *rect = echan->rect;
         size_t xstride = echan->xstride * sizeof(float);
         size_t ystride = echan->ystride * sizeof(float);
@@ -1280,14 +1297,22 @@ void IMB_exr_read_channels(void *handle)
 
         frameBuffer.insert(echan->m->internal_name,
                            Slice(Imf::FLOAT, (char *)rect, xstride, ystride));
+        has_channels = true;
       }
       else {
         printf("warning, channel with no rect set %s\n", echan->m->internal_name.c_str());
       }
     }
 
+    if (!has_channels) {
+      continue;
+    }
+
     /* Read pixels. */
     try {
+      InputPart in(*data->ifile, i);
+      const Box2i dw = in.header().dataWindow();
+
       in.setFrameBuffer(frameBuffer);
       exr_printf("readPixels:readPixels[%d]: min.y: %d, max.y: %d\n", i, dw.min.y, dw.max.y);
       in.readPixels(dw.min.y, dw.max.y);
@@ -1297,6 +1322,91 @@ void IMB_exr_read_channels(void *handle)
       break;
     }
   }
+
+  LISTBASE_FOREACH (ExrLayer *, lay, &data->layers) {
+    LISTBASE_FOREACH (ExrPass *, pass, &lay->passes) {
+      pass->read_pending = false;
+    }
+  }
+}
+
+/* Allocate the buffer of a pass and point its channels into it, the pixels are read by
+ * #imb_exr_read_channels_ex. */
+static void imb_exr_pass_begin_read(ExrHandle *data, ExrPass *pass)
+{
+  if (pass->rect != nullptr || pass->totchan == 0) {
+    return;
+  }
+
+  pass->rect = (float *)MEM_callocN(
+      sizeof(float) * data->width * data->height * pass->totchan, "pass rect");
+  pass->read_pending = true;
+
+  for (int a = 0; a < pass->totchan; a++) {
+    ExrChannel *echan = pass->chan[a];
+    echan->rect = pass->rect + echan->pass_offset;
+  }
+}
+
+/* Read all passes which were not read yet. */
+static void imb_exr_read_all_passes(ExrHandle *data, const bool read_unparsed)
+{
+  LISTBASE_FOREACH (ExrLayer *, lay, &data->layers) {
+    LISTBASE_FOREACH (ExrPass *, pass, &lay->passes) {
+      imb_exr_pass_begin_read(data, pass);
+    }
+  }
+
+  imb_exr_read_channels_ex(data, read_unparsed);
+}
+
+void IMB_exr_read_channels(void *handle)
+{
+  ExrHandle *data = (ExrHandle *)handle;
+  imb_exr_read_all_passes(data, true);
+}
+
+/**
+ * Get the pixels of a single pass of a multilayer file opened with #IMB_exr_begin_read and
+ * `parse_channels`, decoding only that pass on first access. The buffer is owned by the handle.
+ */
+float *IMB_exr_pass_read(void *handle,
+                         const char *layname,
+                         const char *passname,
+                         const char *viewname,
+                         int *r_totchan)
+{
+  ExrHandle *data = (ExrHandle *)handle;
+  char name[EXR_PASS_MAXNAME];
+
+  /* Passes of other views than the default one are stored with the view in their name. */
+  if (viewname && viewname[0] != '\0') {
+    BLI_snprintf(name, sizeof(name), "%s.%s", passname, viewname);
+  }
+  else {
+    BLI_strncpy(name, passname, sizeof(name));
+  }
+
+  ExrLayer *lay = (ExrLayer *)BLI_findstring(
+      &data->layers, layname ? layname : "", offsetof(ExrLayer, name));
+  if (lay == nullptr) {
+    return nullptr;
+  }
+
+  ExrPass *pass = (ExrPass *)BLI_findstring(&lay->passes, name, offsetof(ExrPass, name));
+  if (pass == nullptr) {
+    return nullptr;
+  }
+
+  if (pass->rect == nullptr && data->ifile && !data->ifile_detached) {
+    imb_exr_pass_begin_read(data, pass);
+    imb_exr_read_channels_ex(data, false);
+  }
+
+  if (r_totchan) {
+    *r_totchan = pass->totchan;
+  }
+  return pass->rect;
 }
 
 void IMB_exr_multilayer_convert(void *handle,
@@ -1331,6 +1441,11 @@ void IMB_exr_multilayer_convert(void *handle,
     return;
   }
 
+  /* Decode whatever was not requested yet, in a single pass over the file. */
+  if (data->ifile && !data->ifile_detached) {
+    imb_exr_read_all_passes(data, false);
+  }
+
   for (lay = (ExrLayer *)data->layers.first; lay; lay = lay->next) {
     void *laybase = addlayer(base, lay->name);
     if (laybase) {
@@ -1580,6 +1695,7 @@ static bool imb_exr_multilayer_parse_channels_from_file(ExrHandle *data)
 
       pass->chan[pass->totchan] = echan;
       pass->totchan++;
+      echan->pass = pass;
       pass->view_id = echan->view_id;
       BLI_strncpy(pass->view, view, sizeof(pass->view));
       BLI_strncpy(pass->internal_name, internal_name, EXR_PASS_MAXNAME);
@@ -1594,15 +1710,14 @@ static bool imb_exr_multilayer_parse_channels_from_file(ExrHandle *data)
     return false;
   }
 
-  /* with some heuristics, try to merge the channels in buffers */
+  /* With some heuristics, try to merge the channels in buffers. Only the layout is decided here,
+   * buffers are allocated when a pass is read. */
   for (ExrLayer *lay = (ExrLayer *)data->layers.first; lay; lay = lay->next) {
     for (ExrPass *pass = (ExrPass *)lay->passes.first; pass; pass = pass->next) {
       if (pass->totchan) {
-        pass->rect = (float *)MEM_callocN(
-            data->width * data->height * pass->totchan * sizeof(float), "pass rect");
         if (pass->totchan == 1) {
           ExrChannel *echan = pass->chan[0];
-          echan->rect = pass->rect;
+          echan->pass_offset = 0;
           echan->xstride = 1;
           echan->ystride = data->width;
           pass->chan_id[0] = echan->chan_id;
@@ -1635,7 +1750,7 @@ static bool imb_exr_multilayer_parse_channels_from_file(ExrHandle *data)
             }
             for (int a = 0; a < pass->totchan; a++) {
               echan = pass->chan[a];
-              echan->rect = pass->rect + lookup[(unsigned int)echan->chan_id];
+              echan->pass_offset = lookup[(unsigned int)echan->chan_id];
               echan->xstride = pass->totchan;
               echan->ystride = data->width * pass->totchan;
               pass->chan_id[(unsigned int)lookup[(unsigned int)echan->chan_id]] = echan->chan_id;
@@ -1644,7 +1759,7 @@ static bool imb_exr_multilayer_parse_channels_from_file(ExrHandle *data)
           else { /* unknown */
             for (int a = 0; a < pass->totchan; a++) {
               ExrChannel *echan = pass->chan[a];
-              echan->rect = pass->rect + a;
+              echan->pass_offset = a;
               echan->xstride = pass->totchan;
               echan->ystride = data->width * pass->totchan;
               pass->chan_id[a] = echan->chan_id;
@@ -1992,6 +2107,8 @@ struct ImBuf *imb_load_openexr(const unsigned char *mem,
           ExrHandle *handle = imb_exr_begin_read_mem(*membuf, *file, width, height);
           if (handle) {
             IMB_exr_read_channels(handle);
+            /* `mem` is freed by the caller once loading is done. */
+            handle->ifile_detached = true;
             ibuf->userdata = handle; /* potential danger, the caller has to check for this! */
           }
         }
@@ -2113,6 +2230,110 @@ struct ImBuf *imb_load_openexr(const unsigned char *mem,
   }
 }
 
+struct ImBuf *imb_load_filepath_thumbnail_openexr(const char *filepath,
+                                                  const int UNUSED(flags),
+                                                  const size_t max_thumb_size,
+                                                  char colorspace[IM_MAX_SPACE],
+                                                  size_t *r_width,
+                                                  size_t *r_height)
+{
+  struct ImBuf *ibuf = nullptr;
+  IStream *stream = nullptr;
+  MultiPartInputFile *file = nullptr;
+
+  try {
+    stream = new IFileStream(filepath);
+    file = new MultiPartInputFile(*stream);
+
+    const Header &header = file->header(0);
+    const char *rgb_channels[3];
+    const int num_rgb_channels = exr_has_rgb(*file, rgb_channels);
+
+    /* Only mip-mapped images can be read at a lower resolution, leave others and multilayer
+     * files to the regular loader. */
+    if (!header.hasTileDescription() || header.tileDescription().mode == ONE_LEVEL ||
+        imb_exr_is_multi(*file) || num_rgb_channels == 0) {
+      delete file;
+      delete stream;
+      return nullptr;
+    }
+
+    TiledInputPart in(*file, 0);
+
+    /* Smallest level that is still at least as large as the thumbnail. */
+    const int num_levels = std::min(in.numXLevels(), in.numYLevels());
+    int level = 0;
+    while (level + 1 < num_levels) {
+      const int size = std::max(in.levelWidth(level + 1), in.levelHeight(level + 1));
+      if ((size_t)size < max_thumb_size) {
+        break;
+      }
+      level++;
+    }
+
+    if (level == 0) {
+      delete file;
+      delete stream;
+      return nullptr;
+    }
+
+    const Box2i dw = in.dataWindowForLevel(level, level);
+    const int width = in.levelWidth(level);
+    const int height = in.levelHeight(level);
+
+    *r_width = header.dataWindow().max.x - header.dataWindow().min.x + 1;
+    *r_height = header.dataWindow().max.y - header.dataWindow().min.y + 1;
+
+    colorspace_set_default_role(colorspace, IM_MAX_SPACE, COLOR_ROLE_DEFAULT_FLOAT);
+
+    ibuf = IMB_allocImBuf(width, height, exr_has_alpha(*file) ? 32 : 24, IB_rectfloat);
+    ibuf->ftype = IMB_FTYPE_OPENEXR;
+
+    FrameBuffer frameBuffer;
+    const int xstride = sizeof(float[4]);
+    const int ystride = -xstride * width;
+
+    /* Same y-flipped layout as #imb_load_openexr, for the level data-window. */
+    float *first = ibuf->rect_float - 4 * (dw.min.x - dw.min.y * width);
+    first += 4 * (height - 1) * width;
+
+    for (int i = 0; i < num_rgb_channels; i++) {
+      frameBuffer.insert(exr_rgba_channelname(*file, rgb_channels[i]),
+                         Slice(Imf::FLOAT, (char *)(first + i), xstride, ystride));
+    }
+    frameBuffer.insert(exr_rgba_channelname(*file, "A"),
+                       Slice(Imf::FLOAT, (char *)(first + 3), xstride, ystride, 1, 1, 1.0f));
+
+    in.setFrameBuffer(frameBuffer);
+    in.readTiles(0, in.numXTiles(level) - 1, 0, in.numYTiles(level) - 1, level, level);
+
+    if (num_rgb_channels <= 2) {
+      for (size_t a = 0; a < (size_t)ibuf->x * ibuf->y; a++) {
+        float *color = ibuf->rect_float + a * 4;
+        if (num_rgb_channels <= 1) {
+          color[1] = color[0];
+        }
+        color[2] = color[0];
+      }
+    }
+
+    delete file;
+    delete stream;
+
+    return ibuf;
+  }
+  catch (const std::exception &exc) {
+    std::cerr << exc.what() << std::endl;
+    if (ibuf) {
+      IMB_freeImBuf(ibuf);
+    }
+    delete file;
+    delete stream;
+
+    return nullptr;
+  }
+}
+
 void imb_initopenexr(void)
 {
   int num_threads = BLI_system_thread_count();
@@ -89,6 +89,14 @@ float *IMB_exr_channel_rect(void * /*handle*/,
 void IMB_exr_read_channels(void * /*handle*/)
 {
 }
+float *IMB_exr_pass_read(void * /*handle*/,
+                         const char * /*layname*/,
+                         const char * /*passname*/,
+                         const char * /*viewname*/,
+                         int * /*r_totchan*/)
+{
+  return nullptr;
+}
 void IMB_exr_write_channels(void * /*handle*/)
 {
 }
@@ -204,6 +204,37 @@ ImBuf *IMB_loadifffile(
   return ibuf;
 }
 
+/**
+ * Load an image at a reduced size for thumbnails, for file types that can decode that directly.
+ * Returns NULL when the regular loader has to be used instead.
+ */
+ImBuf *imb_load_filepath_thumbnail(const char *filepath,
+                                   const size_t max_thumb_size,
+                                   char colorspace[IM_MAX_SPACE],
+                                   size_t *r_width,
+                                   size_t *r_height)
+{
+  const int flags = IB_rect;
+  const ImFileType *type = IMB_file_type_from_ftype(IMB_ispic_type(filepath));
+  char effective_colorspace[IM_MAX_SPACE] = "";
+
+  if (type == NULL || type->load_filepath_thumbnail == NULL) {
+    return NULL;
+  }
+
+  if (colorspace) {
+    BLI_strncpy(effective_colorspace, colorspace, sizeof(effective_colorspace));
+  }
+
+  ImBuf *ibuf = type->load_filepath_thumbnail(
+      filepath, flags, max_thumb_size, effective_colorspace, r_width, r_height);
+  if (ibuf) {
+    imb_handle_alpha(ibuf, flags, colorspace, effective_colorspace);
+  }
+
+  return ibuf;
+}
+
 static void imb_cache_filename(char *filename, const char *name, int flags)
 {
   /* read .tx instead if it exists and is not older */
@@ -23,9 +23,12 @@
  */
 
 #include <math.h>
+#include <string.h>
 
+#include "BLI_math_base.h"
 #include "BLI_math_color.h"
-#include "BLI_math_interp.h"
+#include "BLI_simd.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #include "MEM_guardedalloc.h"
 
@@ -908,694 +911,437 @@ static bool q_scale_linear_interpolation(struct ImBuf *ibuf, int newx, int newy)
   return true;
 }
 
-static ImBuf *scaledownx(struct ImBuf *ibuf, int newx)
+/* -------------------------------------------------------------------- */
+/** \name Separable Resampling
+ *
+ * Images are scaled in two 1D passes, starting with the axis that shrinks the most so the
+ * second pass has less to do. Filter weights are computed once per axis: every destination
+ * pixel gets a first source pixel and up to #ScaleFilterTable.max_taps weights. When shrinking,
+ * the filter is widened by the inverse scale so the box filter averages the covered area.
+ *
+ * Intermediate results are float, byte images are converted on read and rounded on write.
+ * Rows of both passes are processed in parallel.
+ * \{ */
+
+typedef struct ScaleFilterTable {
+  /* First source pixel and number of taps of every destination pixel. */
+  int *start;
+  int *num_taps;
+  /* #max_taps weights per destination pixel, normalized to sum to one. */
+  float *weights;
+  int max_taps;
+} ScaleFilterTable;
+
+static float scale_filter_support(const eIMBScaleFilter filter)
 {
-  const int do_rect = (ibuf->rect != NULL);
-  const int do_float = (ibuf->rect_float != NULL);
-  const size_t rect_size = ibuf->x * ibuf->y * 4;
-
-  uchar *rect, *_newrect, *newrect;
-  float *rectf, *_newrectf, *newrectf;
-  float sample, add, val[4], nval[4], valf[4], nvalf[4];
-  int x, y;
-
-  rectf = _newrectf = newrectf = NULL;
-  rect = _newrect = newrect = NULL;
-  nval[0] = nval[1] = nval[2] = nval[3] = 0.0f;
-  nvalf[0] = nvalf[1] = nvalf[2] = nvalf[3] = 0.0f;
+  switch (filter) {
+    case IMB_SCALE_FILTER_BOX:
+      return 0.5f;
+    case IMB_SCALE_FILTER_BILINEAR:
+      return 1.0f;
+    case IMB_SCALE_FILTER_BICUBIC:
+      return 2.0f;
+    case IMB_SCALE_FILTER_LANCZOS:
+      return 3.0f;
+  }
+  return 1.0f;
+}
 
-  if (!do_rect && !do_float) {
-    return ibuf;
+static float scale_filter_sinc(const float x)
+{
+  if (x == 0.0f) {
+    return 1.0f;
   }
+  const float px = (float)M_PI * x;
+  return sinf(px) / px;
+}
 
-  if (do_rect) {
-    _newrect = MEM_mallocN(sizeof(uchar[4]) * newx * ibuf->y, "scaledownx");
-    if (_newrect == NULL) {
-      return ibuf;
-    }
-  }
-  if (do_float) {
-    _newrectf = MEM_mallocN(sizeof(float[4]) * newx * ibuf->y, "scaledownxf");
-    if (_newrectf == NULL) {
-      if (_newrect) {
-        MEM_freeN(_newrect);
+/* Filter kernel at distance \a x, in source pixels of the filter before widening. */
+static float scale_filter_eval(const eIMBScaleFilter filter, float x)
+{
+  x = fabsf(x);
+  switch (filter) {
+    case IMB_SCALE_FILTER_BOX:
+      return (x < 0.5f) ? 1.0f : 0.0f;
+    case IMB_SCALE_FILTER_BILINEAR:
+      return (x < 1.0f) ? 1.0f - x : 0.0f;
+    case IMB_SCALE_FILTER_BICUBIC:
+      /* Catmull-Rom. */
+      if (x < 1.0f) {
+        return (1.5f * x - 2.5f) * x * x + 1.0f;
       }
-      return ibuf;
-    }
-  }
-
-  add = (ibuf->x - 0.01) / newx;
-
-  if (do_rect) {
-    rect = (uchar *)ibuf->rect;
-    newrect = _newrect;
-  }
-  if (do_float) {
-    rectf = ibuf->rect_float;
-    newrectf = _newrectf;
+      if (x < 2.0f) {
+        return ((-0.5f * x + 2.5f) * x - 4.0f) * x + 2.0f;
+      }
+      return 0.0f;
+    case IMB_SCALE_FILTER_LANCZOS:
+      return (x < 3.0f) ? scale_filter_sinc(x) * scale_filter_sinc(x / 3.0f) : 0.0f;
   }
+  return 0.0f;
+}
 
-  for (y = ibuf->y; y > 0; y--) {
-    sample = 0.0f;
-    val[0] = val[1] = val[2] = val[3] = 0.0f;
-    valf[0] = valf[1] = valf[2] = valf[3] = 0.0f;
-
-    for (x = newx; x > 0; x--) {
-      if (do_rect) {
-        nval[0] = -val[0] * sample;
-        nval[1] = -val[1] * sample;
-        nval[2] = -val[2] * sample;
-        nval[3] = -val[3] * sample;
-      }
-      if (do_float) {
-        nvalf[0] = -valf[0] * sample;
-        nvalf[1] = -valf[1] * sample;
-        nvalf[2] = -valf[2] * sample;
-        nvalf[3] = -valf[3] * sample;
+static void scale_filter_table_init(ScaleFilterTable *table,
+                                    const int src_size,
+                                    const int dst_size,
+                                    const eIMBScaleFilter filter)
+{
+  const float scale = (float)dst_size / (float)src_size;
+  const float filter_scale = min_ff(scale, 1.0f);
+  const float support = scale_filter_support(filter) / filter_scale;
+
+  table->max_taps = (int)ceilf(support * 2.0f) + 1;
+  table->start = MEM_malloc_arrayN(dst_size, sizeof(int), "scale filter start");
+  table->num_taps = MEM_malloc_arrayN(dst_size, sizeof(int), "scale filter taps");
+  table->weights = MEM_calloc_arrayN(
+      (size_t)dst_size * table->max_taps, sizeof(float), "scale filter weights");
+
+  for (int i = 0; i < dst_size; i++) {
+    /* Center of the destination pixel, in source pixel coordinates. */
+    const float center = (i + 0.5f) / scale;
+    const int start = max_ii((int)floorf(center - support), 0);
+    const int end = min_iii((int)ceilf(center + support), src_size, start + table->max_taps);
+    float *weights = &table->weights[(size_t)i * table->max_taps];
+    float total = 0.0f;
+
+    for (int j = start; j < end; j++) {
+      float weight;
+      if (filter == IMB_SCALE_FILTER_BOX) {
+        /* Part of the source pixel covered by the filter, exact area averaging. */
+        weight = max_ff(min_ff(j + 1.0f, center + support) - max_ff((float)j, center - support),
+                        0.0f);
       }
-
-      sample += add;
-
-      while (sample >= 1.0f) {
-        sample -= 1.0f;
-
-        if (do_rect) {
-          nval[0] += rect[0];
-          nval[1] += rect[1];
-          nval[2] += rect[2];
-          nval[3] += rect[3];
-          rect += 4;
-        }
-        if (do_float) {
-          nvalf[0] += rectf[0];
-          nvalf[1] += rectf[1];
-          nvalf[2] += rectf[2];
-          nvalf[3] += rectf[3];
-          rectf += 4;
-        }
+      else {
+        weight = scale_filter_eval(filter, (j + 0.5f - center) * filter_scale);
       }
+      weights[j - start] = weight;
+      total += weight;
+    }
 
-      if (do_rect) {
-        val[0] = rect[0];
-        val[1] = rect[1];
-        val[2] = rect[2];
-        val[3] = rect[3];
-        rect += 4;
-
-        newrect[0] = roundf((nval[0] + sample * val[0]) / add);
-        newrect[1] = roundf((nval[1] + sample * val[1]) / add);
-        newrect[2] = roundf((nval[2] + sample * val[2]) / add);
-        newrect[3] = roundf((nval[3] + sample * val[3]) / add);
-
-        newrect += 4;
-      }
-      if (do_float) {
-
-        valf[0] = rectf[0];
-        valf[1] = rectf[1];
-        valf[2] = rectf[2];
-        valf[3] = rectf[3];
-        rectf += 4;
-
-        newrectf[0] = ((nvalf[0] + sample * valf[0]) / add);
-        newrectf[1] = ((nvalf[1] + sample * valf[1]) / add);
-        newrectf[2] = ((nvalf[2] + sample * valf[2]) / add);
-        newrectf[3] = ((nvalf[3] + sample * valf[3]) / add);
+    table->start[i] = start;
+    table->num_taps[i] = end - start;
 
-        newrectf += 4;
+    if (total != 0.0f) {
+      /* Taps outside of the image are dropped, renormalize the remaining ones. */
+      for (int j = 0; j < end - start; j++) {
+        weights[j] /= total;
       }
-
-      sample -= 1.0f;
+    }
+    else {
+      table->start[i] = clamp_i((int)center, 0, src_size - 1);
+      table->num_taps[i] = 1;
+      weights[0] = 1.0f;
     }
   }
-
-  if (do_rect) {
-    // printf("%ld %ld\n", (uchar *)rect - ((uchar *)ibuf->rect), rect_size);
-    BLI_assert((uchar *)rect - ((uchar *)ibuf->rect) == rect_size); /* see bug T26502. */
-    imb_freerectImBuf(ibuf);
-    ibuf->mall |= IB_rect;
-    ibuf->rect = (unsigned int *)_newrect;
-  }
-  if (do_float) {
-    // printf("%ld %ld\n", rectf - ibuf->rect_float, rect_size);
-    BLI_assert((rectf - ibuf->rect_float) == rect_size); /* see bug T26502. */
-    imb_freerectfloatImBuf(ibuf);
-    ibuf->mall |= IB_rectfloat;
-    ibuf->rect_float = _newrectf;
-  }
-  (void)rect_size; /* UNUSED in release builds */
-
-  ibuf->x = newx;
-  return ibuf;
 }
 
-static ImBuf *scaledowny(struct ImBuf *ibuf, int newy)
+static void scale_filter_table_free(ScaleFilterTable *table)
 {
-  const int do_rect = (ibuf->rect != NULL);
-  const int do_float = (ibuf->rect_float != NULL);
-  const size_t rect_size = ibuf->x * ibuf->y * 4;
+  MEM_SAFE_FREE(table->start);
+  MEM_SAFE_FREE(table->num_taps);
+  MEM_SAFE_FREE(table->weights);
+}
 
-  uchar *rect, *_newrect, *newrect;
-  float *rectf, *_newrectf, *newrectf;
-  float sample, add, val[4], nval[4], valf[4], nvalf[4];
-  int x, y, skipx;
+BLI_INLINE uchar scale_round_byte(const float value)
+{
+  return (uchar)clamp_i((int)(value + 0.5f), 0, 255);
+}
 
-  rectf = _newrectf = newrectf = NULL;
-  rect = _newrect = newrect = NULL;
-  nval[0] = nval[1] = nval[2] = nval[3] = 0.0f;
-  nvalf[0] = nvalf[1] = nvalf[2] = nvalf[3] = 0.0f;
+#ifdef BLI_HAVE_SSE2
+BLI_INLINE __m128 scale_load_byte4(const uchar *src)
+{
+  const __m128i zero = _mm_setzero_si128();
+  int pixel;
+  memcpy(&pixel, src, sizeof(pixel));
+  const __m128i pixel_i = _mm_cvtsi32_si128(pixel);
+  return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(pixel_i, zero), zero));
+}
 
-  if (!do_rect && !do_float) {
-    return ibuf;
-  }
+BLI_INLINE void scale_store_byte4(uchar *dst, const __m128 value)
+{
+  /* Conversion rounds to nearest, packing saturates to [0, 255]. */
+  const __m128i value_i = _mm_cvtps_epi32(value);
+  const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(value_i, value_i), value_i);
+  const int pixel = _mm_cvtsi128_si32(packed);
+  memcpy(dst, &pixel, sizeof(pixel));
+}
+#endif
 
-  if (do_rect) {
-    _newrect = MEM_mallocN(sizeof(uchar[4]) * newy * ibuf->x, "scaledowny");
-    if (_newrect == NULL) {
-      return ibuf;
-    }
+/* `dst[i] += weight * src[i]` over \a len values. */
+static void scale_row_madd_float(float *dst, const float *src, const float weight, const size_t len)
+{
+  size_t i = 0;
+#ifdef BLI_HAVE_SSE2
+  const __m128 weight4 = _mm_set1_ps(weight);
+  for (; i + 4 <= len; i += 4) {
+    const __m128 value = _mm_mul_ps(weight4, _mm_loadu_ps(src + i));
+    _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), value));
   }
-  if (do_float) {
-    _newrectf = MEM_mallocN(sizeof(float[4]) * newy * ibuf->x, "scaledownyf");
-    if (_newrectf == NULL) {
-      if (_newrect) {
-        MEM_freeN(_newrect);
-      }
-      return ibuf;
-    }
+#endif
+  for (; i < len; i++) {
+    dst[i] += weight * src[i];
   }
+}
 
-  add = (ibuf->y - 0.01) / newy;
-  skipx = 4 * ibuf->x;
-
-  for (x = skipx - 4; x >= 0; x -= 4) {
-    if (do_rect) {
-      rect = ((uchar *)ibuf->rect) + x;
-      newrect = _newrect + x;
-    }
-    if (do_float) {
-      rectf = ibuf->rect_float + x;
-      newrectf = _newrectf + x;
-    }
-
-    sample = 0.0f;
-    val[0] = val[1] = val[2] = val[3] = 0.0f;
-    valf[0] = valf[1] = valf[2] = valf[3] = 0.0f;
-
-    for (y = newy; y > 0; y--) {
-      if (do_rect) {
-        nval[0] = -val[0] * sample;
-        nval[1] = -val[1] * sample;
-        nval[2] = -val[2] * sample;
-        nval[3] = -val[3] * sample;
-      }
-      if (do_float) {
-        nvalf[0] = -valf[0] * sample;
-        nvalf[1] = -valf[1] * sample;
-        nvalf[2] = -valf[2] * sample;
-        nvalf[3] = -valf[3] * sample;
-      }
-
-      sample += add;
-
-      while (sample >= 1.0f) {
-        sample -= 1.0f;
-
-        if (do_rect) {
-          nval[0] += rect[0];
-          nval[1] += rect[1];
-          nval[2] += rect[2];
-          nval[3] += rect[3];
-          rect += skipx;
-        }
-        if (do_float) {
-          nvalf[0] += rectf[0];
-          nvalf[1] += rectf[1];
-          nvalf[2] += rectf[2];
-          nvalf[3] += rectf[3];
-          rectf += skipx;
-        }
-      }
-
-      if (do_rect) {
-        val[0] = rect[0];
-        val[1] = rect[1];
-        val[2] = rect[2];
-        val[3] = rect[3];
-        rect += skipx;
-
-        newrect[0] = roundf((nval[0] + sample * val[0]) / add);
-        newrect[1] = roundf((nval[1] + sample * val[1]) / add);
-        newrect[2] = roundf((nval[2] + sample * val[2]) / add);
-        newrect[3] = roundf((nval[3] + sample * val[3]) / add);
-
-        newrect += skipx;
-      }
-      if (do_float) {
-
-        valf[0] = rectf[0];
-        valf[1] = rectf[1];
-        valf[2] = rectf[2];
-        valf[3] = rectf[3];
-        rectf += skipx;
-
-        newrectf[0] = ((nvalf[0] + sample * valf[0]) / add);
-        newrectf[1] = ((nvalf[1] + sample * valf[1]) / add);
-        newrectf[2] = ((nvalf[2] + sample * valf[2]) / add);
-        newrectf[3] = ((nvalf[3] + sample * valf[3]) / add);
-
-        newrectf += skipx;
-      }
-
-      sample -= 1.0f;
+static void scale_row_madd_byte(float *dst, const uchar *src, const float weight, const size_t len)
+{
+  size_t i = 0;
+#ifdef BLI_HAVE_SSE2
+  const __m128 weight4 = _mm_set1_ps(weight);
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= len; i += 16) {
+    const __m128i bytes = _mm_loadu_si128((const __m128i *)(src + i));
+    const __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+    const __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+    const __m128i values[4] = {_mm_unpacklo_epi16(lo, zero),
+                               _mm_unpackhi_epi16(lo, zero),
+                               _mm_unpacklo_epi16(hi, zero),
+                               _mm_unpackhi_epi16(hi, zero)};
+    for (int j = 0; j < 4; j++) {
+      float *d = dst + i + j * 4;
+      const __m128 value = _mm_mul_ps(weight4, _mm_cvtepi32_ps(values[j]));
+      _mm_storeu_ps(d, _mm_add_ps(_mm_loadu_ps(d), value));
     }
   }
-
-  if (do_rect) {
-    // printf("%ld %ld\n", (uchar *)rect - ((uchar *)ibuf->rect), rect_size);
-    BLI_assert((uchar *)rect - ((uchar *)ibuf->rect) == rect_size); /* see bug T26502. */
-    imb_freerectImBuf(ibuf);
-    ibuf->mall |= IB_rect;
-    ibuf->rect = (unsigned int *)_newrect;
-  }
-  if (do_float) {
-    // printf("%ld %ld\n", rectf - ibuf->rect_float, rect_size);
-    BLI_assert((rectf - ibuf->rect_float) == rect_size); /* see bug T26502. */
-    imb_freerectfloatImBuf(ibuf);
-    ibuf->mall |= IB_rectfloat;
-    ibuf->rect_float = (float *)_newrectf;
+#endif
+  for (; i < len; i++) {
+    dst[i] += weight * (float)src[i];
   }
-  (void)rect_size; /* UNUSED in release builds */
-
-  ibuf->y = newy;
-  return ibuf;
 }
 
-static ImBuf *scaleupx(struct ImBuf *ibuf, int newx)
+static void scale_row_store_byte(uchar *dst, const float *src, const size_t len)
 {
-  uchar *rect, *_newrect = NULL, *newrect;
-  float *rectf, *_newrectf = NULL, *newrectf;
-  int x, y;
-  bool do_rect = false, do_float = false;
-
-  if (ibuf == NULL) {
-    return NULL;
+  size_t i = 0;
+#ifdef BLI_HAVE_SSE2
+  for (; i + 16 <= len; i += 16) {
+    const __m128i a = _mm_cvtps_epi32(_mm_loadu_ps(src + i));
+    const __m128i b = _mm_cvtps_epi32(_mm_loadu_ps(src + i + 4));
+    const __m128i c = _mm_cvtps_epi32(_mm_loadu_ps(src + i + 8));
+    const __m128i d = _mm_cvtps_epi32(_mm_loadu_ps(src + i + 12));
+    const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+    _mm_storeu_si128((__m128i *)(dst + i), packed);
+  }
+#endif
+  for (; i < len; i++) {
+    dst[i] = scale_round_byte(src[i]);
   }
-  if (ibuf->rect == NULL && ibuf->rect_float == NULL) {
-    return ibuf;
-  }
-
-  if (ibuf->rect) {
-    do_rect = true;
-    _newrect = MEM_mallocN(newx * ibuf->y * sizeof(int), "scaleupx");
-    if (_newrect == NULL) {
-      return ibuf;
-    }
-  }
-  if (ibuf->rect_float) {
-    do_float = true;
-    _newrectf = MEM_mallocN(sizeof(float[4]) * newx * ibuf->y, "scaleupxf");
-    if (_newrectf == NULL) {
-      if (_newrect) {
-        MEM_freeN(_newrect);
-      }
-      return ibuf;
-    }
-  }
-
-  rect = (uchar *)ibuf->rect;
-  rectf = (float *)ibuf->rect_float;
-  newrect = _newrect;
-  newrectf = _newrectf;
+}
 
-  /* Special case, copy all columns, needed since the scaling logic assumes there is at least
-   * two rows to interpolate between causing out of bounds read for 1px images, see T70356. */
-  if (UNLIKELY(ibuf->x == 1)) {
-    if (do_rect) {
-      for (y = ibuf->y; y > 0; y--) {
-        for (x = newx; x > 0; x--) {
-          memcpy(newrect, rect, sizeof(char[4]));
-          newrect += 4;
+typedef struct ScalePassData {
+  const ScaleFilterTable *table;
+  /* Only one of the byte and float pointers is set, for both the source and destination. */
+  const uchar *src_byte;
+  const float *src_float;
+  uchar *dst_byte;
+  float *dst_float;
+  /* Row lengths in pixels, these only differ for the horizontal pass. */
+  int src_width;
+  int dst_width;
+  int channels;
+} ScalePassData;
+
+/* Per thread row of sums, for the vertical pass writing bytes. */
+typedef struct ScaleRowChunk {
+  float *row;
+} ScaleRowChunk;
+
+static void scale_pass_x_row(void *__restrict userdata,
+                             const int y,
+                             const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const ScalePassData *data = userdata;
+  const ScaleFilterTable *table = data->table;
+  const int channels = data->channels;
+  const size_t src_row = (size_t)y * data->src_width * channels;
+  const size_t dst_row = (size_t)y * data->dst_width * channels;
+
+  for (int x = 0; x < data->dst_width; x++) {
+    const float *weights = &table->weights[(size_t)x * table->max_taps];
+    const int num_taps = table->num_taps[x];
+    const size_t src = src_row + (size_t)table->start[x] * channels;
+    const size_t dst = dst_row + (size_t)x * channels;
+
+#ifdef BLI_HAVE_SSE2
+    if (channels == 4) {
+      __m128 sum = _mm_setzero_ps();
+      if (data->src_byte) {
+        for (int i = 0; i < num_taps; i++) {
+          const __m128 value = scale_load_byte4(data->src_byte + src + (size_t)i * 4);
+          sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[i]), value));
         }
-        rect += 4;
       }
-    }
-    if (do_float) {
-      for (y = ibuf->y; y > 0; y--) {
-        for (x = newx; x > 0; x--) {
-          memcpy(newrectf, rectf, sizeof(float[4]));
-          newrectf += 4;
+      else {
+        for (int i = 0; i < num_taps; i++) {
+          const __m128 value = _mm_loadu_ps(data->src_float + src + (size_t)i * 4);
+          sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[i]), value));
         }
-        rectf += 4;
       }
-    }
-  }
-  else {
-    const float add = (ibuf->x - 1.001) / (newx - 1.0);
-    float sample;
-
-    float val_a, nval_a, diff_a;
-    float val_b, nval_b, diff_b;
-    float val_g, nval_g, diff_g;
-    float val_r, nval_r, diff_r;
-    float val_af, nval_af, diff_af;
-    float val_bf, nval_bf, diff_bf;
-    float val_gf, nval_gf, diff_gf;
-    float val_rf, nval_rf, diff_rf;
 
-    val_a = nval_a = diff_a = val_b = nval_b = diff_b = 0;
-    val_g = nval_g = diff_g = val_r = nval_r = diff_r = 0;
-    val_af = nval_af = diff_af = val_bf = nval_bf = diff_bf = 0;
-    val_gf = nval_gf = diff_gf = val_rf = nval_rf = diff_rf = 0;
-
-    for (y = ibuf->y; y > 0; y--) {
-
-      sample = 0;
-
-      if (do_rect) {
-        val_a = rect[0];
-        nval_a = rect[4];
-        diff_a = nval_a - val_a;
-        val_a += 0.5f;
-
-        val_b = rect[1];
-        nval_b = rect[5];
-        diff_b = nval_b - val_b;
-        val_b += 0.5f;
-
-        val_g = rect[2];
-        nval_g = rect[6];
-        diff_g = nval_g - val_g;
-        val_g += 0.5f;
-
-        val_r = rect[3];
-        nval_r = rect[7];
-        diff_r = nval_r - val_r;
-        val_r += 0.5f;
-
-        rect += 8;
+      if (data->dst_byte) {
+        scale_store_byte4(data->dst_byte + dst, sum);
       }
-      if (do_float) {
-        val_af = rectf[0];
-        nval_af = rectf[4];
-        diff_af = nval_af - val_af;
-
-        val_bf = rectf[1];
-        nval_bf = rectf[5];
-        diff_bf = nval_bf - val_bf;
-
-        val_gf = rectf[2];
-        nval_gf = rectf[6];
-        diff_gf = nval_gf - val_gf;
-
-        val_rf = rectf[3];
-        nval_rf = rectf[7];
-        diff_rf = nval_rf - val_rf;
-
-        rectf += 8;
+      else {
+        _mm_storeu_ps(data->dst_float + dst, sum);
       }
-      for (x = newx; x > 0; x--) {
-        if (sample >= 1.0f) {
-          sample -= 1.0f;
-
-          if (do_rect) {
-            val_a = nval_a;
-            nval_a = rect[0];
-            diff_a = nval_a - val_a;
-            val_a += 0.5f;
-
-            val_b = nval_b;
-            nval_b = rect[1];
-            diff_b = nval_b - val_b;
-            val_b += 0.5f;
-
-            val_g = nval_g;
-            nval_g = rect[2];
-            diff_g = nval_g - val_g;
-            val_g += 0.5f;
-
-            val_r = nval_r;
-            nval_r = rect[3];
-            diff_r = nval_r - val_r;
-            val_r += 0.5f;
-            rect += 4;
-          }
-          if (do_float) {
-            val_af = nval_af;
-            nval_af = rectf[0];
-            diff_af = nval_af - val_af;
-
-            val_bf = nval_bf;
-            nval_bf = rectf[1];
-            diff_bf = nval_bf - val_bf;
-
-            val_gf = nval_gf;
-            nval_gf = rectf[2];
-            diff_gf = nval_gf - val_gf;
-
-            val_rf = nval_rf;
-            nval_rf = rectf[3];
-            diff_rf = nval_rf - val_rf;
-            rectf += 4;
-          }
-        }
-        if (do_rect) {
-          newrect[0] = val_a + sample * diff_a;
-          newrect[1] = val_b + sample * diff_b;
-          newrect[2] = val_g + sample * diff_g;
-          newrect[3] = val_r + sample * diff_r;
-          newrect += 4;
-        }
-        if (do_float) {
-          newrectf[0] = val_af + sample * diff_af;
-          newrectf[1] = val_bf + sample * diff_bf;
-          newrectf[2] = val_gf + sample * diff_gf;
-          newrectf[3] = val_rf + sample * diff_rf;
-          newrectf += 4;
-        }
-        sample += add;
+      continue;
+    }
+#endif
+
+    float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < num_taps; i++) {
+      const size_t index = src + (size_t)i * channels;
+      for (int c = 0; c < channels; c++) {
+        const float value = data->src_byte ? (float)data->src_byte[index + c] :
+                                             data->src_float[index + c];
+        sum[c] += weights[i] * value;
       }
     }
-  }
 
-  if (do_rect) {
-    imb_freerectImBuf(ibuf);
-    ibuf->mall |= IB_rect;
-    ibuf->rect = (unsigned int *)_newrect;
-  }
-  if (do_float) {
-    imb_freerectfloatImBuf(ibuf);
-    ibuf->mall |= IB_rectfloat;
-    ibuf->rect_float = (float *)_newrectf;
+    for (int c = 0; c < channels; c++) {
+      if (data->dst_byte) {
+        data->dst_byte[dst + c] = scale_round_byte(sum[c]);
+      }
+      else {
+        data->dst_float[dst + c] = sum[c];
+      }
+    }
   }
-
-  ibuf->x = newx;
-  return ibuf;
 }
 
-static ImBuf *scaleupy(struct ImBuf *ibuf, int newy)
+static void scale_pass_y_row(void *__restrict userdata,
+                             const int y,
+                             const TaskParallelTLS *__restrict tls)
 {
-  uchar *rect, *_newrect = NULL, *newrect;
-  float *rectf, *_newrectf = NULL, *newrectf;
-  int x, y, skipx;
-  bool do_rect = false, do_float = false;
-
-  if (ibuf == NULL) {
-    return NULL;
-  }
-  if (ibuf->rect == NULL && ibuf->rect_float == NULL) {
-    return ibuf;
-  }
+  const ScalePassData *data = userdata;
+  const ScaleFilterTable *table = data->table;
+  const size_t row_len = (size_t)data->dst_width * data->channels;
+  const float *weights = &table->weights[(size_t)y * table->max_taps];
+  float *sum;
 
-  if (ibuf->rect) {
-    do_rect = true;
-    _newrect = MEM_mallocN(ibuf->x * newy * sizeof(int), "scaleupy");
-    if (_newrect == NULL) {
-      return ibuf;
-    }
+  /* Accumulate whole source rows, so memory is read sequentially. */
+  if (data->dst_float) {
+    sum = data->dst_float + (size_t)y * row_len;
   }
-  if (ibuf->rect_float) {
-    do_float = true;
-    _newrectf = MEM_mallocN(sizeof(float[4]) * ibuf->x * newy, "scaleupyf");
-    if (_newrectf == NULL) {
-      if (_newrect) {
-        MEM_freeN(_newrect);
-      }
-      return ibuf;
+  else {
+    ScaleRowChunk *chunk = tls->userdata_chunk;
+    if (chunk->row == NULL) {
+      chunk->row = MEM_malloc_arrayN(row_len, sizeof(float), "scale row");
     }
+    sum = chunk->row;
   }
+  memset(sum, 0, sizeof(float) * row_len);
 
-  rect = (uchar *)ibuf->rect;
-  rectf = (float *)ibuf->rect_float;
-  newrect = _newrect;
-  newrectf = _newrectf;
-
-  skipx = 4 * ibuf->x;
-
-  /* Special case, copy all rows, needed since the scaling logic assumes there is at least
-   * two rows to interpolate between causing out of bounds read for 1px images, see T70356. */
-  if (UNLIKELY(ibuf->y == 1)) {
-    if (do_rect) {
-      for (y = newy; y > 0; y--) {
-        memcpy(newrect, rect, sizeof(char) * skipx);
-        newrect += skipx;
-      }
+  for (int i = 0; i < table->num_taps[y]; i++) {
+    const size_t src_row = (size_t)(table->start[y] + i) * row_len;
+    if (data->src_byte) {
+      scale_row_madd_byte(sum, data->src_byte + src_row, weights[i], row_len);
     }
-    if (do_float) {
-      for (y = newy; y > 0; y--) {
-        memcpy(newrectf, rectf, sizeof(float) * skipx);
-        newrectf += skipx;
-      }
+    else {
+      scale_row_madd_float(sum, data->src_float + src_row, weights[i], row_len);
     }
   }
-  else {
-    const float add = (ibuf->y - 1.001) / (newy - 1.0);
-    float sample;
-
-    float val_a, nval_a, diff_a;
-    float val_b, nval_b, diff_b;
-    float val_g, nval_g, diff_g;
-    float val_r, nval_r, diff_r;
-    float val_af, nval_af, diff_af;
-    float val_bf, nval_bf, diff_bf;
-    float val_gf, nval_gf, diff_gf;
-    float val_rf, nval_rf, diff_rf;
-
-    val_a = nval_a = diff_a = val_b = nval_b = diff_b = 0;
-    val_g = nval_g = diff_g = val_r = nval_r = diff_r = 0;
-    val_af = nval_af = diff_af = val_bf = nval_bf = diff_bf = 0;
-    val_gf = nval_gf = diff_gf = val_rf = nval_rf = diff_rf = 0;
-
-    for (x = ibuf->x; x > 0; x--) {
-      sample = 0;
-      if (do_rect) {
-        rect = ((uchar *)ibuf->rect) + 4 * (x - 1);
-        newrect = _newrect + 4 * (x - 1);
-
-        val_a = rect[0];
-        nval_a = rect[skipx];
-        diff_a = nval_a - val_a;
-        val_a += 0.5f;
-
-        val_b = rect[1];
-        nval_b = rect[skipx + 1];
-        diff_b = nval_b - val_b;
-        val_b += 0.5f;
-
-        val_g = rect[2];
-        nval_g = rect[skipx + 2];
-        diff_g = nval_g - val_g;
-        val_g += 0.5f;
-
-        val_r = rect[3];
-        nval_r = rect[skipx + 3];
-        diff_r = nval_r - val_r;
-        val_r += 0.5f;
-
-        rect += 2 * skipx;
-      }
-      if (do_float) {
-        rectf = ibuf->rect_float + 4 * (x - 1);
-        newrectf = _newrectf + 4 * (x - 1);
 
-        val_af = rectf[0];
-        nval_af = rectf[skipx];
-        diff_af = nval_af - val_af;
-
-        val_bf = rectf[1];
-        nval_bf = rectf[skipx + 1];
-        diff_bf = nval_bf - val_bf;
+  if (data->dst_byte) {
+    scale_row_store_byte(data->dst_byte + (size_t)y * row_len, sum, row_len);
+  }
+}
 
-        val_gf = rectf[2];
-        nval_gf = rectf[skipx + 2];
-        diff_gf = nval_gf - val_gf;
+static void scale_row_chunk_free(const void *__restrict UNUSED(userdata), void *__restrict chunk_v)
+{
+  ScaleRowChunk *chunk = chunk_v;
+  MEM_SAFE_FREE(chunk->row);
+}
 
-        val_rf = rectf[3];
-        nval_rf = rectf[skipx + 3];
-        diff_rf = nval_rf - val_rf;
+/**
+ * Run one pass over \a num_rows destination rows, from \a src to \a dst.
+ * For a \a vertical pass the source and destination have the same width.
+ */
+static void scale_pass(const ScaleFilterTable *table,
+                       const bool vertical,
+                       const void *src,
+                       const bool src_is_float,
+                       void *dst,
+                       const bool dst_is_float,
+                       const int src_width,
+                       const int dst_width,
+                       const int num_rows,
+                       const int channels)
+{
+  ScalePassData data = {NULL};
+  data.table = table;
+  data.src_byte = src_is_float ? NULL : src;
+  data.src_float = src_is_float ? src : NULL;
+  data.dst_byte = dst_is_float ? NULL : dst;
+  data.dst_float = dst_is_float ? dst : NULL;
+  data.src_width = src_width;
+  data.dst_width = dst_width;
+  data.channels = channels;
+
+  ScaleRowChunk chunk = {NULL};
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = ((size_t)num_rows * dst_width > 64 * 64);
+  /* Bands of rows, each thread keeps a few source rows in cache. */
+  settings.min_iter_per_thread = 8;
+  settings.userdata_chunk = &chunk;
+  settings.userdata_chunk_size = sizeof(chunk);
+  settings.func_free = scale_row_chunk_free;
+
+  BLI_task_parallel_range(
+      0, num_rows, &data, vertical ? scale_pass_y_row : scale_pass_x_row, &settings);
+
+  /* Only allocated here when running single threaded. */
+  MEM_SAFE_FREE(chunk.row);
+}
 
-        rectf += 2 * skipx;
-      }
+/**
+ * Resample a byte or float buffer, a NULL table leaves that axis unchanged.
+ * \return A new buffer of the same type.
+ */
+static void *scale_buffer(const void *src,
+                          const bool is_float,
+                          const int channels,
+                          const int src_x,
+                          const int src_y,
+                          const int dst_x,
+                          const int dst_y,
+                          const ScaleFilterTable *table_x,
+                          const ScaleFilterTable *table_y)
+{
+  const size_t elem_size = is_float ? sizeof(float) : sizeof(uchar);
+  void *dst = MEM_mallocN(elem_size * channels * dst_x * dst_y,
+                          is_float ? "scale rectfloat" : "scale rect");
 
-      for (y = newy; y > 0; y--) {
-        if (sample >= 1.0f) {
-          sample -= 1.0f;
-
-          if (do_rect) {
-            val_a = nval_a;
-            nval_a = rect[0];
-            diff_a = nval_a - val_a;
-            val_a += 0.5f;
-
-            val_b = nval_b;
-            nval_b = rect[1];
-            diff_b = nval_b - val_b;
-            val_b += 0.5f;
-
-            val_g = nval_g;
-            nval_g = rect[2];
-            diff_g = nval_g - val_g;
-            val_g += 0.5f;
-
-            val_r = nval_r;
-            nval_r = rect[3];
-            diff_r = nval_r - val_r;
-            val_r += 0.5f;
-            rect += skipx;
-          }
-          if (do_float) {
-            val_af = nval_af;
-            nval_af = rectf[0];
-            diff_af = nval_af - val_af;
-
-            val_bf = nval_bf;
-            nval_bf = rectf[1];
-            diff_bf = nval_bf - val_bf;
-
-            val_gf = nval_gf;
-            nval_gf = rectf[2];
-            diff_gf = nval_gf - val_gf;
-
-            val_rf = nval_rf;
-            nval_rf = rectf[3];
-            diff_rf = nval_rf - val_rf;
-            rectf += skipx;
-          }
-        }
-        if (do_rect) {
-          newrect[0] = val_a + sample * diff_a;
-          newrect[1] = val_b + sample * diff_b;
-          newrect[2] = val_g + sample * diff_g;
-          newrect[3] = val_r + sample * diff_r;
-          newrect += skipx;
-        }
-        if (do_float) {
-          newrectf[0] = val_af + sample * diff_af;
-          newrectf[1] = val_bf + sample * diff_bf;
-          newrectf[2] = val_gf + sample * diff_gf;
-          newrectf[3] = val_rf + sample * diff_rf;
-          newrectf += skipx;
-        }
-        sample += add;
-      }
-    }
+  if (table_x == NULL) {
+    scale_pass(table_y, true, src, is_float, dst, is_float, src_x, dst_x, dst_y, channels);
+    return dst;
+  }
+  if (table_y == NULL) {
+    scale_pass(table_x, false, src, is_float, dst, is_float, src_x, dst_x, dst_y, channels);
+    return dst;
   }
 
-  if (do_rect) {
-    imb_freerectImBuf(ibuf);
-    ibuf->mall |= IB_rect;
-    ibuf->rect = (unsigned int *)_newrect;
+  /* Do the axis that shrinks the most first, the second pass then reads the smallest image. */
+  const bool x_first = ((float)dst_x / src_x) <= ((float)dst_y / src_y);
+  const int tmp_x = x_first ? dst_x : src_x;
+  const int tmp_y = x_first ? src_y : dst_y;
+  float *tmp = MEM_malloc_arrayN(
+      (size_t)tmp_x * tmp_y * channels, sizeof(float), "scale intermediate");
+
+  if (x_first) {
+    scale_pass(table_x, false, src, is_float, tmp, true, src_x, dst_x, src_y, channels);
+    scale_pass(table_y, true, tmp, true, dst, is_float, dst_x, dst_x, dst_y, channels);
   }
-  if (do_float) {
-    imb_freerectfloatImBuf(ibuf);
-    ibuf->mall |= IB_rectfloat;
-    ibuf->rect_float = (float *)_newrectf;
+  else {
+    scale_pass(table_y, true, src, is_float, tmp, true, src_x, src_x, dst_y, channels);
+    scale_pass(table_x, false, tmp, true, dst, is_float, src_x, dst_x, dst_y, channels);
   }
 
-  ibuf->y = newy;
-  return ibuf;
+  MEM_freeN(tmp);
+  return dst;
 }
 
+/** \} */
+
 static void scalefast_Z_ImBuf(ImBuf *ibuf, int newx, int newy)
 {
   int *zbuf, *newzbuf, *_newzbuf = NULL;
@@ -1661,10 +1407,11 @@ static void scalefast_Z_ImBuf(ImBuf *ibuf, int newx, int newy)
   }
 }
 
-/**
- * Return true if \a ibuf is modified.
- */
-bool IMB_scaleImBuf(struct ImBuf *ibuf, unsigned int newx, unsigned int newy)
+static bool imb_scale_filtered(struct ImBuf *ibuf,
+                               unsigned int newx,
+                               unsigned int newy,
+                               const eIMBScaleFilter filter_x,
+                               const eIMBScaleFilter filter_y)
 {
   BLI_assert_msg(newx > 0 && newy > 0, "Images must be at least 1 on both dimensions!");
 
@@ -1679,32 +1426,73 @@ bool IMB_scaleImBuf(struct ImBuf *ibuf, unsigned int newx, unsigned int newy)
     return false;
   }
 
-  /* Scale-up / scale-down functions below change ibuf->x and ibuf->y
-   * so we first scale the Z-buffer (if any). */
+  /* The filtering below changes ibuf->x and ibuf->y so we first scale the Z-buffer (if any). */
   scalefast_Z_ImBuf(ibuf, newx, newy);
 
-  /* try to scale common cases in a fast way */
-  /* disabled, quality loss is unacceptable, see report T18609  (ton) */
-  if (0 && q_scale_linear_interpolation(ibuf, newx, newy)) {
-    return true;
+  ScaleFilterTable table_x = {NULL}, table_y = {NULL};
+  if (newx != ibuf->x) {
+    scale_filter_table_init(&table_x, ibuf->x, newx, filter_x);
   }
-
-  if (newx && (newx < ibuf->x)) {
-    scaledownx(ibuf, newx);
+  if (newy != ibuf->y) {
+    scale_filter_table_init(&table_y, ibuf->y, newy, filter_y);
   }
-  if (newy && (newy < ibuf->y)) {
-    scaledowny(ibuf, newy);
-  }
-  if (newx && (newx > ibuf->x)) {
-    scaleupx(ibuf, newx);
+  const ScaleFilterTable *table_x_p = (newx != ibuf->x) ? &table_x : NULL;
+  const ScaleFilterTable *table_y_p = (newy != ibuf->y) ? &table_y : NULL;
+
+  if (ibuf->rect) {
+    unsigned int *newrect = scale_buffer(
+        ibuf->rect, false, 4, ibuf->x, ibuf->y, newx, newy, table_x_p, table_y_p);
+    imb_freerectImBuf(ibuf);
+    ibuf->mall |= IB_rect;
+    ibuf->rect = newrect;
   }
-  if (newy && (newy > ibuf->y)) {
-    scaleupy(ibuf, newy);
+  if (ibuf->rect_float) {
+    float *newrectf = scale_buffer(
+        ibuf->rect_float, true, ibuf->channels, ibuf->x, ibuf->y, newx, newy, table_x_p, table_y_p);
+    imb_freerectfloatImBuf(ibuf);
+    ibuf->mall |= IB_rectfloat;
+    ibuf->rect_float = newrectf;
   }
 
+  scale_filter_table_free(&table_x);
+  scale_filter_table_free(&table_y);
+
+  ibuf->x = newx;
+  ibuf->y = newy;
   return true;
 }
 
+/**
+ * Return true if \a ibuf is modified.
+ */
+bool IMB_scaleImBuf_filter(struct ImBuf *ibuf,
+                           unsigned int newx,
+                           unsigned int newy,
+                           eIMBScaleFilter filter)
+{
+  return imb_scale_filtered(ibuf, newx, newy, filter, filter);
+}
+
+/**
+ * Return true if \a ibuf is modified.
+ */
+bool IMB_scaleImBuf(struct ImBuf *ibuf, unsigned int newx, unsigned int newy)
+{
+  /* try to scale common cases in a fast way */
+  /* disabled, quality loss is unacceptable, see report T18609  (ton) */
+  if (0 && q_scale_linear_interpolation(ibuf, newx, newy)) {
+    return true;
+  }
+
+  /* Area average when shrinking and interpolate when enlarging, per axis. */
+  return imb_scale_filtered(
+      ibuf,
+      newx,
+      newy,
+      (ibuf && newx < ibuf->x) ? IMB_SCALE_FILTER_BOX : IMB_SCALE_FILTER_BILINEAR,
+      (ibuf && newy < ibuf->y) ? IMB_SCALE_FILTER_BOX : IMB_SCALE_FILTER_BILINEAR);
+}
+
 struct imbufRGBA {
   float r, g, b, a;
 };
@@ -1810,121 +1598,8 @@ bool IMB_scalefastImBuf(struct ImBuf *ibuf, unsigned int newx, unsigned int newy
   return true;
 }
 
-/* ******** threaded scaling ******** */
-
-typedef struct ScaleTreadInitData {
-  ImBuf *ibuf;
-
-  unsigned int newx;
-  unsigned int newy;
-
-  unsigned char *byte_buffer;
-  float *float_buffer;
-} ScaleTreadInitData;
-
-typedef struct ScaleThreadData {
-  ImBuf *ibuf;
-
-  unsigned int newx;
-  unsigned int newy;
-
-  int start_line;
-  int tot_line;
-
-  unsigned char *byte_buffer;
-  float *float_buffer;
-} ScaleThreadData;
-
-static void scale_thread_init(void *data_v, int start_line, int tot_line, void *init_data_v)
-{
-  ScaleThreadData *data = (ScaleThreadData *)data_v;
-  ScaleTreadInitData *init_data = (ScaleTreadInitData *)init_data_v;
-
-  data->ibuf = init_data->ibuf;
-
-  data->newx = init_data->newx;
-  data->newy = init_data->newy;
-
-  data->start_line = start_line;
-  data->tot_line = tot_line;
-
-  data->byte_buffer = init_data->byte_buffer;
-  data->float_buffer = init_data->float_buffer;
-}
-
-static void *do_scale_thread(void *data_v)
-{
-  ScaleThreadData *data = (ScaleThreadData *)data_v;
-  ImBuf *ibuf = data->ibuf;
-  int i;
-  float factor_x = (float)ibuf->x / data->newx;
-  float factor_y = (float)ibuf->y / data->newy;
-
-  for (i = 0; i < data->tot_line; i++) {
-    int y = data->start_line + i;
-    int x;
-
-    for (x = 0; x < data->newx; x++) {
-      float u = (float)x * factor_x;
-      float v = (float)y * factor_y;
-      int offset = y * data->newx + x;
-
-      if (data->byte_buffer) {
-        unsigned char *pixel = data->byte_buffer + 4 * offset;
-        BLI_bilinear_interpolation_char(
-            (unsigned char *)ibuf->rect, pixel, ibuf->x, ibuf->y, 4, u, v);
-      }
-
-      if (data->float_buffer) {
-        float *pixel = data->float_buffer + ibuf->channels * offset;
-        BLI_bilinear_interpolation_fl(
-            ibuf->rect_float, pixel, ibuf->x, ibuf->y, ibuf->channels, u, v);
-      }
-    }
-  }
-
-  return NULL;
-}
-
 void IMB_scaleImBuf_threaded(ImBuf *ibuf, unsigned int newx, unsigned int newy)
 {
-  BLI_assert_msg(newx > 0 && newy > 0, "Images must be at least 1 on both dimensions!");
-
-  ScaleTreadInitData init_data = {NULL};
-
-  /* prepare initialization data */
-  init_data.ibuf = ibuf;
-
-  init_data.newx = newx;
-  init_data.newy = newy;
-
-  if (ibuf->rect) {
-    init_data.byte_buffer = MEM_mallocN(4 * newx * newy * sizeof(char),
-                                        "threaded scale byte buffer");
-  }
-
-  if (ibuf->rect_float) {
-    init_data.float_buffer = MEM_mallocN(ibuf->channels * newx * newy * sizeof(float),
-                                         "threaded scale float buffer");
-  }
-
-  /* actual scaling threads */
-  IMB_processor_apply_threaded(
-      newy, sizeof(ScaleThreadData), &init_data, scale_thread_init, do_scale_thread);
-
-  /* alter image buffer */
-  ibuf->x = newx;
-  ibuf->y = newy;
-
-  if (ibuf->rect) {
-    imb_freerectImBuf(ibuf);
-    ibuf->mall |= IB_rect;
-    ibuf->rect = (unsigned int *)init_data.byte_buffer;
-  }
-
-  if (ibuf->rect_float) {
-    imb_freerectfloatImBuf(ibuf);
-    ibuf->mall |= IB_rectfloat;
-    ibuf->rect_float = init_data.float_buffer;
-  }
+  /* The resampling engine is threaded already. */
+  IMB_scaleImBuf_filter(ibuf, newx, newy, IMB_SCALE_FILTER_BILINEAR);
 }
@@ -40,6 +40,7 @@
 
 #include "BLO_readfile.h"
 
+#include "IMB_filetype.h"
 #include "IMB_imbuf.h"
 #include "IMB_imbuf_types.h"
 #include "IMB_metadata.h"
@@ -318,6 +319,308 @@ void IMB_thumb_makedirs(void)
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Thumbnail Index
+ *
+ * Checking whether the thumbnail of a file is up to date means looking for a fail thumbnail and
+ * reading the modification time stored in the thumbnail itself. For large directories that is
+ * most of the cost of browsing them again, so a small index per directory remembers the source
+ * file modification time and size that thumbnails were created for. Only the source file then
+ * needs to be stat'ed.
+ *
+ * Indices are kept in memory once read, and written next to the fail thumbnails when the last
+ * thumbnail lock is released.
+ * \{ */
+
+#define THUMB_INDEX_VERSION 1
+
+static const char thumb_index_magic[8] = {'B', 'T', 'H', 'U', 'M', 'B', 'I', 'X'};
+
+typedef enum eThumbIndexState {
+  THUMB_INDEX_UNKNOWN = 0,
+  /** The thumbnail exists and was created from the current file. */
+  THUMB_INDEX_VALID,
+  /** Creating a thumbnail for the current file failed. */
+  THUMB_INDEX_FAILED,
+} eThumbIndexState;
+
+typedef struct ThumbIndexEntry {
+  int64_t mtime;
+  int64_t size;
+  /** Bit for each #ThumbSize that is up to date, `1 << THB_FAIL` when creation failed. */
+  int flag;
+} ThumbIndexEntry;
+
+/** Layout of an entry in the index file, followed by the file name (without terminator). */
+typedef struct ThumbIndexFileEntry {
+  int64_t mtime;
+  int64_t size;
+  int32_t flag;
+  int32_t name_len;
+} ThumbIndexFileEntry;
+
+typedef struct ThumbIndexFileHeader {
+  char magic[8];
+  int32_t version;
+  int32_t entries_num;
+} ThumbIndexFileHeader;
+
+typedef struct ThumbIndex {
+  /** File name to #ThumbIndexEntry. */
+  GHash *entries;
+  char dir[FILE_MAX];
+  bool is_dirty;
+} ThumbIndex;
+
+/** Directory to #ThumbIndex, for the directories used since the last flush. */
+static GHash *thumb_indices = NULL;
+static ThreadMutex thumb_index_lock = BLI_MUTEX_INITIALIZER;
+
+static bool thumb_index_filepath(const char *dir, char *r_path, const int path_len)
+{
+  char uri[URI_MAX];
+  char tdir[FILE_MAX];
+
+  if (!uri_from_filename(dir, uri) || !get_thumb_dir(tdir, THB_FAIL)) {
+    return false;
+  }
+
+  char hexdigest[33];
+  unsigned char digest[16];
+  BLI_hash_md5_buffer(uri, strlen(uri), digest);
+  hexdigest[0] = '\0';
+  BLI_snprintf(
+      r_path, path_len, "%s%s.index", tdir, BLI_hash_md5_to_hexdigest(digest, hexdigest));
+  return true;
+}
+
+static void thumb_index_read(ThumbIndex *index)
+{
+  char path[FILE_MAX];
+  size_t data_len;
+
+  if (!thumb_index_filepath(index->dir, path, sizeof(path))) {
+    return;
+  }
+
+  char *data = BLI_file_read_binary_as_mem(path, 0, &data_len);
+  if (data == NULL) {
+    return;
+  }
+
+  const ThumbIndexFileHeader *header = (const ThumbIndexFileHeader *)data;
+  if (data_len < sizeof(*header) || memcmp(header->magic, thumb_index_magic, 8) != 0 ||
+      header->version != THUMB_INDEX_VERSION) {
+    MEM_freeN(data);
+    return;
+  }
+
+  size_t offset = sizeof(*header);
+  for (int i = 0; i < header->entries_num; i++) {
+    ThumbIndexFileEntry file_entry;
+    if (offset + sizeof(file_entry) > data_len) {
+      break;
+    }
+    memcpy(&file_entry, data + offset, sizeof(file_entry));
+    offset += sizeof(file_entry);
+
+    if (file_entry.name_len <= 0 || file_entry.name_len >= FILE_MAX ||
+        offset + (size_t)file_entry.name_len > data_len) {
+      break;
+    }
+
+    char *name = BLI_strdupn(data + offset, (size_t)file_entry.name_len);
+    offset += (size_t)file_entry.name_len;
+
+    void **key_p, **entry_p;
+    if (BLI_ghash_ensure_p_ex(index->entries, name, &key_p, &entry_p)) {
+      MEM_freeN(name);
+      continue;
+    }
+    ThumbIndexEntry *entry = MEM_mallocN(sizeof(*entry), __func__);
+    entry->mtime = file_entry.mtime;
+    entry->size = file_entry.size;
+    entry->flag = file_entry.flag;
+    *key_p = name;
+    *entry_p = entry;
+  }
+
+  MEM_freeN(data);
+}
+
+static void thumb_index_write(const ThumbIndex *index)
+{
+  char path[FILE_MAX];
+  char temp[FILE_MAX];
+
+  if (!thumb_index_filepath(index->dir, path, sizeof(path))) {
+    return;
+  }
+  BLI_snprintf(temp, sizeof(temp), "%s.%d", path, abs(getpid()));
+
+  FILE *file = BLI_fopen(temp, "wb");
+  if (file == NULL) {
+    return;
+  }
+
+  ThumbIndexFileHeader header;
+  memcpy(header.magic, thumb_index_magic, sizeof(header.magic));
+  header.version = THUMB_INDEX_VERSION;
+  header.entries_num = (int32_t)BLI_ghash_len(index->entries);
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+  GHashIterator gh_iter;
+  GHASH_ITER (gh_iter, index->entries) {
+    const char *name = BLI_ghashIterator_getKey(&gh_iter);
+    const ThumbIndexEntry *entry = BLI_ghashIterator_getValue(&gh_iter);
+    ThumbIndexFileEntry file_entry = {
+        .mtime = entry->mtime,
+        .size = entry->size,
+        .flag = entry->flag,
+        .name_len = (int32_t)strlen(name),
+    };
+    ok = ok && fwrite(&file_entry, sizeof(file_entry), 1, file) == 1;
+    ok = ok && fwrite(name, (size_t)file_entry.name_len, 1, file) == 1;
+  }
+
+  ok = (fclose(file) == 0) && ok;
+
+  if (ok) {
+#ifndef WIN32
+    chmod(temp, S_IRUSR | S_IWUSR);
+#endif
+    BLI_rename(temp, path);
+  }
+  else {
+    BLI_delete(temp, false, false);
+  }
+}
+
+static void thumb_index_free(void *index_v)
+{
+  ThumbIndex *index = index_v;
+  BLI_ghash_free(index->entries, MEM_freeN, MEM_freeN);
+  MEM_freeN(index);
+}
+
+/** Index of the directory containing \a path, read on first use. Expects #thumb_index_lock. */
+static ThumbIndex *thumb_index_get(const char *path, char r_name[FILE_MAX])
+{
+  char dir[FILE_MAX];
+  BLI_split_dirfile(path, dir, r_name, sizeof(dir), FILE_MAX);
+  if (r_name[0] == '\0') {
+    return NULL;
+  }
+
+  if (thumb_indices == NULL) {
+    thumb_indices = BLI_ghash_str_new(__func__);
+  }
+
+  void **key_p, **index_p;
+  if (!BLI_ghash_ensure_p_ex(thumb_indices, dir, &key_p, &index_p)) {
+    ThumbIndex *index = MEM_callocN(sizeof(*index), __func__);
+    index->entries = BLI_ghash_str_new(__func__);
+    BLI_strncpy(index->dir, dir, sizeof(index->dir));
+    thumb_index_read(index);
+    *key_p = BLI_strdup(dir);
+    *index_p = index;
+  }
+  return *index_p;
+}
+
+static bool thumb_index_entry_matches(const ThumbIndexEntry *entry, const BLI_stat_t *st)
+{
+  return entry->mtime == (int64_t)st->st_mtime && entry->size == (int64_t)st->st_size;
+}
+
+static eThumbIndexState thumb_index_lookup(const char *path,
+                                           const BLI_stat_t *st,
+                                           const ThumbSize size)
+{
+  eThumbIndexState state = THUMB_INDEX_UNKNOWN;
+  char name[FILE_MAX];
+
+  BLI_mutex_lock(&thumb_index_lock);
+  const ThumbIndex *index = thumb_index_get(path, name);
+  const ThumbIndexEntry *entry = index ? BLI_ghash_lookup(index->entries, name) : NULL;
+  if (entry && thumb_index_entry_matches(entry, st)) {
+    if (entry->flag & (1 << THB_FAIL)) {
+      state = THUMB_INDEX_FAILED;
+    }
+    else if (entry->flag & (1 << size)) {
+      state = THUMB_INDEX_VALID;
+    }
+  }
+  BLI_mutex_unlock(&thumb_index_lock);
+
+  return state;
+}
+
+static void thumb_index_update(const char *path,
+                               const BLI_stat_t *st,
+                               const ThumbSize size,
+                               const bool success)
+{
+  char name[FILE_MAX];
+
+  BLI_mutex_lock(&thumb_index_lock);
+  ThumbIndex *index = thumb_index_get(path, name);
+  if (index) {
+    void **key_p, **entry_p;
+    if (!BLI_ghash_ensure_p_ex(index->entries, name, &key_p, &entry_p)) {
+      *key_p = BLI_strdup(name);
+      *entry_p = MEM_callocN(sizeof(ThumbIndexEntry), __func__);
+    }
+    ThumbIndexEntry *entry = *entry_p;
+
+    int flag = thumb_index_entry_matches(entry, st) ? entry->flag : 0;
+    flag = success ? ((flag & ~(1 << THB_FAIL)) | (1 << size)) : (1 << THB_FAIL);
+
+    if (!thumb_index_entry_matches(entry, st) || flag != entry->flag) {
+      entry->mtime = (int64_t)st->st_mtime;
+      entry->size = (int64_t)st->st_size;
+      entry->flag = flag;
+      index->is_dirty = true;
+    }
+  }
+  BLI_mutex_unlock(&thumb_index_lock);
+}
+
+/** Forget about the thumbnail of \a size for \a path, when it gets deleted. */
+static void thumb_index_clear(const char *path, const ThumbSize size)
+{
+  char name[FILE_MAX];
+
+  BLI_mutex_lock(&thumb_index_lock);
+  ThumbIndex *index = thumb_index_get(path, name);
+  ThumbIndexEntry *entry = index ? BLI_ghash_lookup(index->entries, name) : NULL;
+  if (entry && (entry->flag & (1 << size))) {
+    entry->flag &= ~(1 << size);
+    index->is_dirty = true;
+  }
+  BLI_mutex_unlock(&thumb_index_lock);
+}
+
+/* Write modified thumbnail indices and free them. */
+void IMB_thumb_index_flush(void)
+{
+  BLI_mutex_lock(&thumb_index_lock);
+  if (thumb_indices) {
+    GHashIterator gh_iter;
+    GHASH_ITER (gh_iter, thumb_indices) {
+      const ThumbIndex *index = BLI_ghashIterator_getValue(&gh_iter);
+      if (index->is_dirty) {
+        thumb_index_write(index);
+      }
+    }
+    BLI_ghash_free(thumb_indices, MEM_freeN, thumb_index_free);
+    thumb_indices = NULL;
+  }
+  BLI_mutex_unlock(&thumb_index_lock);
+}
+
+/** \} */
+
 /* create thumbnail for file and returns new imbuf for thumbnail */
 static ImBuf *thumb_create_ex(const char *file_path,
                               const char *uri,
@@ -340,6 +643,7 @@ static ImBuf *thumb_create_ex(const char *file_path,
   short tsize = 128;
   short ex, ey;
   float scaledx, scaledy;
+  size_t source_width = 0, source_height = 0;
   BLI_stat_t info;
 
   switch (size) {
@@ -384,7 +688,12 @@ static ImBuf *thumb_create_ex(const char *file_path,
         if (img == NULL) {
           switch (source) {
             case THB_SOURCE_IMAGE:
-              img = IMB_loadiffname(file_path, IB_rect | IB_metadata, NULL);
+              /* Decode at a reduced size when the file type allows it. */
+              img = imb_load_filepath_thumbnail(
+                  file_path, tsize, NULL, &source_width, &source_height);
+              if (img == NULL) {
+                img = IMB_loadiffname(file_path, IB_rect | IB_metadata, NULL);
+              }
               break;
             case THB_SOURCE_BLEND:
               img = IMB_thumb_load_blend(file_path, blen_group, blen_id);
@@ -401,8 +710,12 @@ static ImBuf *thumb_create_ex(const char *file_path,
           if (BLI_stat(file_path, &info) != -1) {
             BLI_snprintf(mtime, sizeof(mtime), "%ld", (long int)info.st_mtime);
           }
-          BLI_snprintf(cwidth, sizeof(cwidth), "%d", img->x);
-          BLI_snprintf(cheight, sizeof(cheight), "%d", img->y);
+          if (source_width == 0) {
+            source_width = (size_t)img->x;
+            source_height = (size_t)img->y;
+          }
+          BLI_snprintf(cwidth, sizeof(cwidth), "%zu", source_width);
+          BLI_snprintf(cheight, sizeof(cheight), "%zu", source_height);
         }
       }
       else if (THB_SOURCE_MOVIE == source) {
@@ -556,6 +869,7 @@ void IMB_thumb_delete(const char *path, ThumbSize size)
     if (BLI_exists(thumb)) {
       BLI_delete(thumb, false, false);
     }
+    thumb_index_clear(path, size);
   }
 }
 
@@ -591,6 +905,29 @@ ImBuf *IMB_thumb_manage(const char *org_path, ThumbSize size, ThumbSource source
   if (!uri_from_filename(path, uri)) {
     return NULL;
   }
+
+  /* Blend file IDs and fonts depend on more than the file, leave them out of the index. */
+  const bool use_index = (file_path == path) && (source != THB_SOURCE_FONT);
+  if (use_index) {
+    switch (thumb_index_lookup(path, &st, size)) {
+      case THUMB_INDEX_FAILED:
+        return NULL;
+      case THUMB_INDEX_VALID:
+        if (thumbpath_from_uri(uri, thumb_path, sizeof(thumb_path), size)) {
+          img = IMB_loadiffname(thumb_path, IB_rect, NULL);
+        }
+        /* When the thumbnail was removed behind our back, continue as if there was no index. */
+        if (img) {
+          IMB_rect_from_float(img);
+          imb_freerectfloatImBuf(img);
+          return img;
+        }
+        break;
+      case THUMB_INDEX_UNKNOWN:
+        break;
+    }
+  }
+
   if (thumbpath_from_uri(uri, thumb_path, sizeof(thumb_path), THB_FAIL)) {
     /* failure thumb exists, don't try recreating */
     if (BLI_exists(thumb_path)) {
@@ -599,6 +936,9 @@ ImBuf *IMB_thumb_manage(const char *org_path, ThumbSize size, ThumbSource source
         BLI_delete(thumb_path, false, false);
       }
       else {
+        if (use_index) {
+          thumb_index_update(path, &st, size, false);
+        }
         return NULL;
       }
     }
@@ -668,6 +1008,10 @@ ImBuf *IMB_thumb_manage(const char *org_path, ThumbSize size, ThumbSource source
     imb_freerectfloatImBuf(img);
   }
 
+  if (use_index) {
+    thumb_index_update(path, &st, size, img != NULL);
+  }
+
   return img;
 }
 
@@ -705,13 +1049,19 @@ void IMB_thumb_locks_release(void)
   BLI_assert((thumb_locks.locked_paths != NULL) && (thumb_locks.lock_counter > 0));
 
   thumb_locks.lock_counter--;
-  if (thumb_locks.lock_counter == 0) {
+  const bool is_last = (thumb_locks.lock_counter == 0);
+  if (is_last) {
     BLI_gset_free(thumb_locks.locked_paths, MEM_freeN);
     thumb_locks.locked_paths = NULL;
     BLI_condition_end(&thumb_locks.cond);
   }
 
   BLI_thread_unlock(LOCK_IMAGE);
+
+  /* Nothing is generating thumbnails anymore, a good time to store what was learned. */
+  if (is_last) {
+    IMB_thumb_index_flush();
+  }
 }
 
 void IMB_thumb_path_lock(const char *path)
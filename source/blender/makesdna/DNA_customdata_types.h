@@ -32,6 +32,7 @@ extern "C" {
 #endif
 
 struct AnonymousAttributeID;
+struct CustomDataLayerSharing;
 
 /** Descriptor and storage for a custom data layer. */
 typedef struct CustomDataLayer {
@@ -62,6 +63,11 @@ typedef struct CustomDataLayer {
    * automatically.
    */
   const struct AnonymousAttributeID *anonymous_id;
+  /**
+   * Run-time user count of #data when it is shared with layers of other custom data, see
+   * #CD_SHARE. Shared layers also have the #CD_FLAG_NOFREE flag, like referenced layers.
+   */
+  struct CustomDataLayerSharing *sharing;
 } CustomDataLayer;
 
 #define MAX_CUSTOMDATA_LAYER_NAME 64
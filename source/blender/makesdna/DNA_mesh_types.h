@@ -103,6 +103,12 @@ typedef struct Mesh_Runtime {
   /** Non-manifold boundary data for Shrinkwrap Target Project. */
   struct ShrinkwrapBoundaryData *shrinkwrap_data;
 
+  /**
+   * `MeshTopologyCache` defined in 'mesh_topology_cache.cc',
+   * may be shared with other meshes using the same topology arrays.
+   */
+  struct MeshTopologyCache *topology_cache;
+
   /** Set by modifier stack if only deformed from original. */
   char deformed_only;
   /**
@@ -122,7 +128,13 @@ typedef struct Mesh_Runtime {
    */
   char wrapper_type_finalize;
 
-  char _pad[4];
+  /**
+   * Set while tools keep pointers to the arrays of an original mesh to write them in place, like
+   * sculpt mode. Copy-on-write meshes don't share the layers of such a mesh, see #CD_SHARE.
+   */
+  char is_written_in_place;
+
+  char _pad[3];
 
   /** Needed in case we need to lazily initialize the mesh. */
   CustomData_MeshMasks cd_mask_extra;
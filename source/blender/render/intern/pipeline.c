@@ -84,6 +84,8 @@
 #include "IMB_metadata.h"
 #include "PIL_time.h"
 
+#include "intern/openexr/openexr_multi.h"
+
 #include "RE_engine.h"
 #include "RE_pipeline.h"
 #include "RE_texture.h"
@@ -2635,13 +2637,53 @@ void RE_init_threadcount(Render *re)
   re->r.threads = BKE_render_num_threads(&re->r);
 }
 
+/* Copy the combined pass of the matching layer of a multilayer EXR file into `rpass`, decoding
+ * only that pass. Returns false when the file has no such pass, so it can be loaded as an image. */
+static bool render_layer_load_from_multilayer_exr(RenderLayer *layer,
+                                                  RenderPass *rpass,
+                                                  ReportList *reports,
+                                                  const char *filename,
+                                                  int x,
+                                                  int y)
+{
+  void *exrhandle = IMB_exr_get_handle();
+  int width, height, totchan;
+  float *rect = NULL;
+
+  if (IMB_exr_begin_read(exrhandle, filename, &width, &height, true)) {
+    rect = IMB_exr_pass_read(exrhandle, layer->name, RE_PASSNAME_COMBINED, "", &totchan);
+  }
+
+  if (rect == NULL || totchan != 4) {
+    IMB_exr_close(exrhandle);
+    return false;
+  }
+
+  if (width == layer->rectx && height == layer->recty) {
+    memcpy(rpass->rect, rect, sizeof(float[4]) * layer->rectx * layer->recty);
+  }
+  else if ((width - x >= layer->rectx) && (height - y >= layer->recty)) {
+    for (int row = 0; row < layer->recty; row++) {
+      memcpy(rpass->rect + 4 * (size_t)row * layer->rectx,
+             rect + 4 * ((size_t)(y + row) * width + x),
+             sizeof(float[4]) * layer->rectx);
+    }
+  }
+  else {
+    BKE_reportf(
+        reports, RPT_ERROR, "%s: incorrect dimensions for partial copy '%s'", __func__, filename);
+  }
+
+  IMB_exr_close(exrhandle);
+  return true;
+}
+
 /* loads in image into a result, size must match
  * x/y offsets are only used on a partial copy when dimensions don't match */
 void RE_layer_load_from_file(
     RenderLayer *layer, ReportList *reports, const char *filename, int x, int y)
 {
-  /* OCIO_TODO: assume layer was saved in default color space */
-  ImBuf *ibuf = IMB_loadiffname(filename, IB_rect, NULL);
+  ImBuf *ibuf;
   RenderPass *rpass = NULL;
 
   /* multiview: since the API takes no 'view', we use the first combined pass found */
@@ -2657,8 +2699,16 @@ void RE_layer_load_from_file(
                 "%s: no Combined pass found in the render layer '%s'",
                 __func__,
                 filename);
+    return;
+  }
+
+  if (render_layer_load_from_multilayer_exr(layer, rpass, reports, filename, x, y)) {
+    return;
   }
 
+  /* OCIO_TODO: assume layer was saved in default color space */
+  ibuf = IMB_loadiffname(filename, IB_rect, NULL);
+
   if (ibuf && (ibuf->rect || ibuf->rect_float)) {
     if (ibuf->x == layer->rectx && ibuf->y == layer->recty) {
       if (ibuf->rect_float == NULL) {
@@ -34,6 +34,7 @@ struct Main;
 struct Scene;
 struct Sequence;
 
+/* Prefetch workers use consecutive IDs starting at #SEQ_TASK_PREFETCH_RENDER. */
 typedef enum eSeqTaskId {
   SEQ_TASK_MAIN_RENDER,
   SEQ_TASK_PREFETCH_RENDER,
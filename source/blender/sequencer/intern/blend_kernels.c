@@ -0,0 +1,476 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup sequencer
+ */
+
+#include <string.h>
+
+#include "BLI_math_base.h"
+#include "BLI_math_color.h"
+#include "BLI_simd.h"
+#include "BLI_utildefines.h"
+
+#include "DNA_sequence_types.h"
+
+#include "blend_kernels.h"
+
+/* -------------------------------------------------------------------- */
+/** \name Cross
+ * \{ */
+
+void seq_blend_cross_byte(const unsigned char *rect1,
+                          const unsigned char *rect2,
+                          unsigned char *out,
+                          int num_pixels,
+                          float fac)
+{
+  const int fac2 = (int)(256.0f * fac);
+  const int fac1 = 256 - fac2;
+  int i = 0;
+
+#ifdef BLI_HAVE_SSE2
+  /* Weighted sum fits 16 bits only for factors in 0..256 range. */
+  if (fac2 >= 0 && fac2 <= 256) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i fac1_v = _mm_set1_epi16((short)fac1);
+    const __m128i fac2_v = _mm_set1_epi16((short)fac2);
+
+    for (; i + 4 <= num_pixels; i += 4) {
+      const __m128i a = _mm_loadu_si128((const __m128i *)(rect1 + i * 4));
+      const __m128i b = _mm_loadu_si128((const __m128i *)(rect2 + i * 4));
+
+      __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), fac1_v),
+                                 _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), fac2_v));
+      __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), fac1_v),
+                                 _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), fac2_v));
+      lo = _mm_srli_epi16(lo, 8);
+      hi = _mm_srli_epi16(hi, 8);
+
+      _mm_storeu_si128((__m128i *)(out + i * 4), _mm_packus_epi16(lo, hi));
+    }
+  }
+#endif
+
+  for (; i < num_pixels; i++) {
+    const unsigned char *rt1 = rect1 + i * 4;
+    const unsigned char *rt2 = rect2 + i * 4;
+    unsigned char *rt = out + i * 4;
+
+    rt[0] = (fac1 * rt1[0] + fac2 * rt2[0]) >> 8;
+    rt[1] = (fac1 * rt1[1] + fac2 * rt2[1]) >> 8;
+    rt[2] = (fac1 * rt1[2] + fac2 * rt2[2]) >> 8;
+    rt[3] = (fac1 * rt1[3] + fac2 * rt2[3]) >> 8;
+  }
+}
+
+void seq_blend_cross_float(
+    const float *rect1, const float *rect2, float *out, int num_pixels, float fac)
+{
+  const float fac2 = fac;
+  const float fac1 = 1.0f - fac2;
+  int i = 0;
+
+#ifdef BLI_HAVE_SSE2
+  const __m128 fac1_v = _mm_set1_ps(fac1);
+  const __m128 fac2_v = _mm_set1_ps(fac2);
+
+  for (; i < num_pixels; i++) {
+    const __m128 a = _mm_loadu_ps(rect1 + i * 4);
+    const __m128 b = _mm_loadu_ps(rect2 + i * 4);
+    _mm_storeu_ps(out + i * 4, _mm_add_ps(_mm_mul_ps(fac1_v, a), _mm_mul_ps(fac2_v, b)));
+  }
+#endif
+
+  for (; i < num_pixels; i++) {
+    const float *rt1 = rect1 + i * 4;
+    const float *rt2 = rect2 + i * 4;
+    float *rt = out + i * 4;
+
+    rt[0] = fac1 * rt1[0] + fac2 * rt2[0];
+    rt[1] = fac1 * rt1[1] + fac2 * rt2[1];
+    rt[2] = fac1 * rt1[2] + fac2 * rt2[2];
+    rt[3] = fac1 * rt1[3] + fac2 * rt2[3];
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Alpha Over
+ * \{ */
+
+#ifdef BLI_HAVE_SSE2
+
+/* Same as `straight_uchar_to_premul_float()`. */
+BLI_INLINE __m128 straight_uchar_to_premul_float_sse2(const unsigned char color[4])
+{
+  const __m128 inv_255 = _mm_set1_ps(1.0f / 255.0f);
+  const __m128 alpha_mask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+  const __m128i zero = _mm_setzero_si128();
+  int packed;
+  memcpy(&packed, color, sizeof(packed));
+
+  const __m128 c = _mm_cvtepi32_ps(
+      _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero));
+  const __m128 alpha = _mm_mul_ps(_mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3)), inv_255);
+  const __m128 premul = _mm_mul_ps(c, _mm_mul_ps(alpha, inv_255));
+  return _mm_or_ps(_mm_and_ps(alpha_mask, alpha), _mm_andnot_ps(alpha_mask, premul));
+}
+
+/* Same as `premul_float_to_straight_uchar()`. */
+BLI_INLINE void premul_float_to_straight_uchar_sse2(unsigned char result[4], const __m128 color)
+{
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 alpha_mask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+
+  /* Color is unchanged for zero and one alpha, and alpha is never divided. */
+  const __m128 alpha = _mm_shuffle_ps(color, color, _MM_SHUFFLE(3, 3, 3, 3));
+  const __m128 keep = _mm_or_ps(_mm_or_ps(_mm_cmpeq_ps(alpha, zero), _mm_cmpeq_ps(alpha, one)),
+                                alpha_mask);
+  const __m128 alpha_inv = _mm_div_ps(one, alpha);
+  const __m128 straight = _mm_mul_ps(
+      color, _mm_or_ps(_mm_and_ps(keep, one), _mm_andnot_ps(keep, alpha_inv)));
+
+  /* Same as `unit_float_to_uchar_clamp()`. */
+  __m128i value = _mm_cvttps_epi32(
+      _mm_add_ps(_mm_mul_ps(straight, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+  value = _mm_andnot_si128(_mm_castps_si128(_mm_cmple_ps(straight, zero)), value);
+  const __m128i clamp = _mm_castps_si128(
+      _mm_cmpgt_ps(straight, _mm_set1_ps(1.0f - 0.5f / 255.0f)));
+  value = _mm_or_si128(_mm_and_si128(clamp, _mm_set1_epi32(255)),
+                       _mm_andnot_si128(clamp, value));
+
+  value = _mm_packs_epi32(value, value);
+  const int packed = _mm_cvtsi128_si32(_mm_packus_epi16(value, value));
+  memcpy(result, &packed, sizeof(packed));
+}
+
+#endif /* BLI_HAVE_SSE2 */
+
+void seq_blend_alphaover_byte(const unsigned char *rect1,
+                              const unsigned char *rect2,
+                              unsigned char *out,
+                              int num_pixels,
+                              float fac)
+{
+  /* rt = rt1 over rt2  (alpha from rt1), blended in premultiplied float. */
+  if (fac <= 0.0f) {
+    memcpy(out, rect2, sizeof(unsigned char[4]) * num_pixels);
+    return;
+  }
+
+  int i = 0;
+
+#ifdef BLI_HAVE_SSE2
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 fac_v = _mm_set1_ps(fac);
+
+  for (; i < num_pixels; i++) {
+    const __m128 a = straight_uchar_to_premul_float_sse2(rect1 + i * 4);
+    const __m128 alpha = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128 mfac = _mm_sub_ps(one, _mm_mul_ps(fac_v, alpha));
+
+    if (_mm_cvtss_f32(mfac) <= 0.0f) {
+      /* Opaque foreground replaces background. */
+      memcpy(out + i * 4, rect1 + i * 4, sizeof(unsigned char[4]));
+      continue;
+    }
+
+    const __m128 b = straight_uchar_to_premul_float_sse2(rect2 + i * 4);
+    premul_float_to_straight_uchar_sse2(out + i * 4,
+                                        _mm_add_ps(_mm_mul_ps(fac_v, a), _mm_mul_ps(mfac, b)));
+  }
+#endif
+
+  for (; i < num_pixels; i++) {
+    const unsigned char *cp1 = rect1 + i * 4;
+    const unsigned char *cp2 = rect2 + i * 4;
+    unsigned char *rt = out + i * 4;
+    float rt1[4], rt2[4], tempc[4];
+
+    straight_uchar_to_premul_float(rt1, cp1);
+    const float mfac = 1.0f - (fac * rt1[3]);
+
+    if (mfac <= 0.0f) {
+      memcpy(rt, cp1, sizeof(unsigned char[4]));
+    }
+    else {
+      straight_uchar_to_premul_float(rt2, cp2);
+      tempc[0] = fac * rt1[0] + mfac * rt2[0];
+      tempc[1] = fac * rt1[1] + mfac * rt2[1];
+      tempc[2] = fac * rt1[2] + mfac * rt2[2];
+      tempc[3] = fac * rt1[3] + mfac * rt2[3];
+      premul_float_to_straight_uchar(rt, tempc);
+    }
+  }
+}
+
+void seq_blend_alphaover_float(
+    const float *rect1, const float *rect2, float *out, int num_pixels, float fac)
+{
+  /* rt = rt1 over rt2  (alpha from rt1) */
+  if (fac <= 0.0f) {
+    memcpy(out, rect2, sizeof(float[4]) * num_pixels);
+    return;
+  }
+
+  int i = 0;
+
+#ifdef BLI_HAVE_SSE2
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 fac_v = _mm_set1_ps(fac);
+
+  for (; i < num_pixels; i++) {
+    const __m128 a = _mm_loadu_ps(rect1 + i * 4);
+    const __m128 b = _mm_loadu_ps(rect2 + i * 4);
+    const __m128 alpha = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128 mfac = _mm_sub_ps(one, _mm_mul_ps(fac_v, alpha));
+    const __m128 blend = _mm_add_ps(_mm_mul_ps(fac_v, a), _mm_mul_ps(mfac, b));
+    /* Opaque foreground replaces background. */
+    const __m128 opaque = _mm_cmple_ps(mfac, zero);
+    _mm_storeu_ps(out + i * 4, _mm_or_ps(_mm_and_ps(opaque, a), _mm_andnot_ps(opaque, blend)));
+  }
+#endif
+
+  for (; i < num_pixels; i++) {
+    const float *rt1 = rect1 + i * 4;
+    const float *rt2 = rect2 + i * 4;
+    float *rt = out + i * 4;
+    const float mfac = 1.0f - (fac * rt1[3]);
+
+    if (mfac <= 0.0f) {
+      memcpy(rt, rt1, sizeof(float[4]));
+    }
+    else {
+      rt[0] = fac * rt1[0] + mfac * rt2[0];
+      rt[1] = fac * rt1[1] + mfac * rt2[1];
+      rt[2] = fac * rt1[2] + mfac * rt2[2];
+      rt[3] = fac * rt1[3] + mfac * rt2[3];
+    }
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Add
+ * \{ */
+
+void seq_blend_add_byte(const unsigned char *rect1,
+                        const unsigned char *rect2,
+                        unsigned char *out,
+                        int num_pixels,
+                        float fac)
+{
+  const int fac1 = (int)(256.0f * fac);
+  int i = 0;
+
+#ifdef BLI_HAVE_SSE2
+  /* `fac1 * alpha` fits 16 bits only for factors in 0..256 range. */
+  if (fac1 >= 0 && fac1 <= 256) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i fac_v = _mm_set1_epi16((short)fac1);
+    const __m128i rgb_mask = _mm_set1_epi32(0x00ffffff);
+
+    for (; i + 4 <= num_pixels; i += 4) {
+      const __m128i a = _mm_loadu_si128((const __m128i *)(rect1 + i * 4));
+      const __m128i b = _mm_loadu_si128((const __m128i *)(rect2 + i * 4));
+      const __m128i b_lo = _mm_unpacklo_epi8(b, zero);
+      const __m128i b_hi = _mm_unpackhi_epi8(b, zero);
+
+      /* Broadcast alpha of each pixel to its channels, `m = fac1 * alpha`. */
+      __m128i m_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(b_lo, _MM_SHUFFLE(3, 3, 3, 3)),
+                                         _MM_SHUFFLE(3, 3, 3, 3));
+      __m128i m_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(b_hi, _MM_SHUFFLE(3, 3, 3, 3)),
+                                         _MM_SHUFFLE(3, 3, 3, 3));
+      m_lo = _mm_mullo_epi16(m_lo, fac_v);
+      m_hi = _mm_mullo_epi16(m_hi, fac_v);
+
+      /* `(m * b) >> 16`, added to foreground with saturation. Alpha is taken from foreground. */
+      __m128i add = _mm_packus_epi16(_mm_mulhi_epu16(m_lo, b_lo), _mm_mulhi_epu16(m_hi, b_hi));
+      add = _mm_and_si128(add, rgb_mask);
+      _mm_storeu_si128((__m128i *)(out + i * 4), _mm_adds_epu8(a, add));
+    }
+  }
+#endif
+
+  for (; i < num_pixels; i++) {
+    const unsigned char *cp1 = rect1 + i * 4;
+    const unsigned char *cp2 = rect2 + i * 4;
+    unsigned char *rt = out + i * 4;
+    const int m = fac1 * (int)cp2[3];
+
+    rt[0] = min_ii(cp1[0] + ((m * cp2[0]) >> 16), 255);
+    rt[1] = min_ii(cp1[1] + ((m * cp2[1]) >> 16), 255);
+    rt[2] = min_ii(cp1[2] + ((m * cp2[2]) >> 16), 255);
+    rt[3] = cp1[3];
+  }
+}
+
+void seq_blend_add_float(
+    const float *rect1, const float *rect2, float *out, int num_pixels, float fac)
+{
+  int i = 0;
+
+#ifdef BLI_HAVE_SSE2
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 mfac_v = _mm_set1_ps(1.0f - fac);
+  const __m128 alpha_mask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+
+  for (; i < num_pixels; i++) {
+    const __m128 a = _mm_loadu_ps(rect1 + i * 4);
+    const __m128 b = _mm_loadu_ps(rect2 + i * 4);
+    const __m128 a_alpha = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128 b_alpha = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128 m = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(a_alpha, mfac_v)), b_alpha);
+    const __m128 sum = _mm_add_ps(a, _mm_mul_ps(m, b));
+    _mm_storeu_ps(out + i * 4, _mm_or_ps(_mm_and_ps(alpha_mask, a), _mm_andnot_ps(alpha_mask, sum)));
+  }
+#endif
+
+  for (; i < num_pixels; i++) {
+    const float *rt1 = rect1 + i * 4;
+    const float *rt2 = rect2 + i * 4;
+    float *rt = out + i * 4;
+    const float m = (1.0f - (rt1[3] * (1.0f - fac))) * rt2[3];
+
+    rt[0] = rt1[0] + m * rt2[0];
+    rt[1] = rt1[1] + m * rt2[1];
+    rt[2] = rt1[2] + m * rt2[2];
+    rt[3] = rt1[3];
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Blend Modes
+ *
+ * Foreground alpha is multiplied by factor before blending, and alpha of the result is taken from
+ * foreground, see `apply_blend_function_float()`.
+ * \{ */
+
+#ifdef BLI_HAVE_SSE2
+
+typedef enum eBlendKernel {
+  BLEND_KERNEL_ADD,
+  BLEND_KERNEL_SUB,
+  BLEND_KERNEL_MUL,
+  BLEND_KERNEL_LIGHTEN,
+  BLEND_KERNEL_DARKEN,
+  BLEND_KERNEL_SCREEN,
+} eBlendKernel;
+
+BLI_INLINE void blend_mode_float_sse2(const float *rect1,
+                                      const float *rect2,
+                                      float *out,
+                                      int num_pixels,
+                                      float fac,
+                                      const eBlendKernel kernel)
+{
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 fac_v = _mm_set1_ps(fac);
+  const __m128 alpha_mask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+
+  for (int i = 0; i < num_pixels; i++) {
+    const __m128 src1 = _mm_loadu_ps(rect1 + i * 4);
+    const __m128 src2 = _mm_loadu_ps(rect2 + i * 4);
+    const __m128 alpha1 = _mm_mul_ps(_mm_shuffle_ps(src1, src1, _MM_SHUFFLE(3, 3, 3, 3)), fac_v);
+    const __m128 t = _mm_shuffle_ps(src2, src2, _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128 mt = _mm_sub_ps(one, t);
+    __m128 dst;
+
+    switch (kernel) {
+      case BLEND_KERNEL_ADD:
+        dst = _mm_add_ps(src1, _mm_mul_ps(src2, alpha1));
+        break;
+      case BLEND_KERNEL_SUB:
+        dst = _mm_max_ps(_mm_sub_ps(src1, _mm_mul_ps(src2, alpha1)), zero);
+        break;
+      case BLEND_KERNEL_MUL:
+        dst = _mm_add_ps(_mm_mul_ps(mt, src1), _mm_mul_ps(_mm_mul_ps(src1, src2), alpha1));
+        break;
+      case BLEND_KERNEL_LIGHTEN: {
+        const __m128 map = _mm_mul_ps(src2, _mm_div_ps(alpha1, t));
+        dst = _mm_add_ps(_mm_mul_ps(mt, src1), _mm_mul_ps(t, _mm_max_ps(src1, map)));
+        break;
+      }
+      case BLEND_KERNEL_DARKEN: {
+        const __m128 map = _mm_mul_ps(src2, _mm_div_ps(alpha1, t));
+        dst = _mm_add_ps(_mm_mul_ps(mt, src1), _mm_mul_ps(t, _mm_min_ps(src1, map)));
+        break;
+      }
+      case BLEND_KERNEL_SCREEN: {
+        const __m128 screen = _mm_max_ps(
+            _mm_sub_ps(one, _mm_mul_ps(_mm_sub_ps(one, src1), _mm_sub_ps(one, src2))), zero);
+        dst = _mm_add_ps(_mm_mul_ps(screen, t), _mm_mul_ps(src1, mt));
+        break;
+      }
+      default:
+        BLI_assert_unreachable();
+        dst = src1;
+        break;
+    }
+
+    /* Transparent background pixels leave foreground unchanged. */
+    const __m128 keep = _mm_or_ps(_mm_cmpeq_ps(t, zero), alpha_mask);
+    _mm_storeu_ps(out + i * 4, _mm_or_ps(_mm_and_ps(keep, src1), _mm_andnot_ps(keep, dst)));
+  }
+}
+
+#endif /* BLI_HAVE_SSE2 */
+
+bool seq_blend_mode_float(const float *rect1,
+                          const float *rect2,
+                          float *out,
+                          int num_pixels,
+                          float fac,
+                          int blend_mode)
+{
+#ifdef BLI_HAVE_SSE2
+  switch (blend_mode) {
+    case SEQ_TYPE_ADD:
+      blend_mode_float_sse2(rect1, rect2, out, num_pixels, fac, BLEND_KERNEL_ADD);
+      return true;
+    case SEQ_TYPE_SUB:
+      blend_mode_float_sse2(rect1, rect2, out, num_pixels, fac, BLEND_KERNEL_SUB);
+      return true;
+    case SEQ_TYPE_MUL:
+      blend_mode_float_sse2(rect1, rect2, out, num_pixels, fac, BLEND_KERNEL_MUL);
+      return true;
+    case SEQ_TYPE_LIGHTEN:
+      blend_mode_float_sse2(rect1, rect2, out, num_pixels, fac, BLEND_KERNEL_LIGHTEN);
+      return true;
+    case SEQ_TYPE_DARKEN:
+      blend_mode_float_sse2(rect1, rect2, out, num_pixels, fac, BLEND_KERNEL_DARKEN);
+      return true;
+    case SEQ_TYPE_SCREEN:
+      blend_mode_float_sse2(rect1, rect2, out, num_pixels, fac, BLEND_KERNEL_SCREEN);
+      return true;
+  }
+#else
+  UNUSED_VARS(rect1, rect2, out, num_pixels, fac, blend_mode);
+#endif
+
+  return false;
+}
+
+/** \} */
@@ -0,0 +1,66 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup sequencer
+ *
+ * Row kernels for blending two images in effect strips and strip blend modes.
+ * Each kernel processes `num_pixels` RGBA pixels with a single factor, and gives the same result
+ * as scalar code. SSE2 is used when available.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void seq_blend_cross_byte(const unsigned char *rect1,
+                          const unsigned char *rect2,
+                          unsigned char *out,
+                          int num_pixels,
+                          float fac);
+void seq_blend_cross_float(
+    const float *rect1, const float *rect2, float *out, int num_pixels, float fac);
+
+void seq_blend_alphaover_byte(const unsigned char *rect1,
+                              const unsigned char *rect2,
+                              unsigned char *out,
+                              int num_pixels,
+                              float fac);
+void seq_blend_alphaover_float(
+    const float *rect1, const float *rect2, float *out, int num_pixels, float fac);
+
+void seq_blend_add_byte(const unsigned char *rect1,
+                        const unsigned char *rect2,
+                        unsigned char *out,
+                        int num_pixels,
+                        float fac);
+void seq_blend_add_float(
+    const float *rect1, const float *rect2, float *out, int num_pixels, float fac);
+
+/* Blend modes, same as `apply_blend_function_float()` with `blend_color_*_float()` functions.
+ * Returns false if there is no kernel for given blend mode. */
+bool seq_blend_mode_float(const float *rect1,
+                          const float *rect2,
+                          float *out,
+                          int num_pixels,
+                          float fac,
+                          int blend_mode);
+
+#ifdef __cplusplus
+}
+#endif
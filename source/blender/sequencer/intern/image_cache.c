@@ -43,6 +43,7 @@
 #include "BLI_listbase.h"
 #include "BLI_mempool.h"
 #include "BLI_path_util.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "BKE_main.h"
@@ -89,11 +90,12 @@
  * For each cached non-temp image, image data and supplementary info are written to HDD.
  * Multiple(DCACHE_IMAGES_PER_FILE) images share the same file.
  * Each of these files contains header DiskCacheHeader followed by image data.
- * Zlib compression with user definable level can be used to compress image data(per image)
+ * Zstd compression with user definable level can be used to compress image data(per image)
  * Images are written in order in which they are rendered.
  * Overwriting of individual entry is not possible.
  * Stored images are deleted by invalidation, or when size of all files exceeds maximum
- * size specified in user preferences.
+ * size specified in user preferences. Files are kept in least recently used order, and
+ * exceeding files are deleted in background, so writing images doesn't wait for deletion.
  * To distinguish 2 blend files with same name, scene->ed->disk_cache_timestamp
  * is used as UID. Blend file can still be copied manually which may cause conflict.
  *
@@ -105,6 +107,8 @@
 #define DCACHE_CURRENT_VERSION 2
 #define COLORSPACE_NAME_MAX 64 /* XXX: defined in imb intern */
 #define THUMB_CACHE_LIMIT 5000
+/* Main render task and one task per prefetch worker, see #eSeqTaskId. */
+#define SEQ_CACHE_TASKS_MAX (SEQ_TASK_PREFETCH_RENDER + SEQ_PREFETCH_THREADS_MAX)
 
 typedef struct DiskCacheHeaderEntry {
   unsigned char encoding;
@@ -122,9 +126,13 @@ typedef struct DiskCacheHeader {
 typedef struct SeqDiskCache {
   Main *bmain;
   int64_t timestamp;
+  /* Least recently used file first. */
   ListBase files;
   ThreadMutex read_write_mutex;
   size_t size_total;
+  /* Deletes files exceeding size limit in background. */
+  struct TaskPool *eviction_pool;
+  bool eviction_pending;
 } SeqDiskCache;
 
 typedef struct DiskCacheFile {
@@ -147,7 +155,9 @@ typedef struct SeqCache {
   ThreadMutex iterator_mutex;
   struct BLI_mempool *keys_pool;
   struct BLI_mempool *items_pool;
-  struct SeqCacheKey *last_key;
+  /* Last key stored by each task, used to link intermediate items of a frame together.
+   * Tasks render concurrently, so every task has its own chain. */
+  struct SeqCacheKey *last_key[SEQ_CACHE_TASKS_MAX];
   SeqDiskCache *disk_cache;
   int thumbnail_count;
 } SeqCache;
@@ -272,19 +282,30 @@ static void seq_disk_cache_get_files(SeqDiskCache *disk_cache, char *path)
   BLI_filelist_free(filelist, nbr);
 }
 
-static DiskCacheFile *seq_disk_cache_get_oldest_file(SeqDiskCache *disk_cache)
+static int seq_disk_cache_file_cmp_mtime(const void *a_, const void *b_)
 {
-  DiskCacheFile *oldest_file = disk_cache->files.first;
-  if (oldest_file == NULL) {
-    return NULL;
-  }
-  for (DiskCacheFile *cache_file = oldest_file->next; cache_file; cache_file = cache_file->next) {
-    if (cache_file->fstat.st_mtime < oldest_file->fstat.st_mtime) {
-      oldest_file = cache_file;
-    }
-  }
+  const DiskCacheFile *a = a_;
+  const DiskCacheFile *b = b_;
+  return a->fstat.st_mtime > b->fstat.st_mtime;
+}
 
-  return oldest_file;
+/* Scan cache directory and store files in least recently used order. */
+static void seq_disk_cache_get_files_sorted(SeqDiskCache *disk_cache)
+{
+  seq_disk_cache_get_files(disk_cache, seq_disk_cache_base_dir());
+  BLI_listbase_sort(&disk_cache->files, seq_disk_cache_file_cmp_mtime);
+}
+
+/* Mark file as most recently used. */
+static void seq_disk_cache_file_used(SeqDiskCache *disk_cache, DiskCacheFile *cache_file)
+{
+  BLI_remlink(&disk_cache->files, cache_file);
+  BLI_addtail(&disk_cache->files, cache_file);
+}
+
+static DiskCacheFile *seq_disk_cache_get_oldest_file(SeqDiskCache *disk_cache)
+{
+  return disk_cache->files.first;
 }
 
 static void seq_disk_cache_delete_file(SeqDiskCache *disk_cache, DiskCacheFile *file)
@@ -295,30 +316,46 @@ static void seq_disk_cache_delete_file(SeqDiskCache *disk_cache, DiskCacheFile *
   MEM_freeN(file);
 }
 
-static bool seq_disk_cache_enforce_limits(SeqDiskCache *disk_cache)
+static void seq_disk_cache_enforce_limits_task(TaskPool *__restrict UNUSED(pool), void *taskdata)
 {
+  SeqDiskCache *disk_cache = taskdata;
+
   BLI_mutex_lock(&disk_cache->read_write_mutex);
   while (disk_cache->size_total > seq_disk_cache_size_limit()) {
     DiskCacheFile *oldest_file = seq_disk_cache_get_oldest_file(disk_cache);
 
     if (!oldest_file) {
       /* We shouldn't enforce limits with no files, do re-scan. */
-      seq_disk_cache_get_files(disk_cache, seq_disk_cache_base_dir());
+      seq_disk_cache_get_files_sorted(disk_cache);
+      if (disk_cache->files.first == NULL) {
+        break;
+      }
       continue;
     }
 
     if (BLI_exists(oldest_file->path) == 0) {
       /* File may have been manually deleted during runtime, do re-scan. */
       BLI_freelistN(&disk_cache->files);
-      seq_disk_cache_get_files(disk_cache, seq_disk_cache_base_dir());
+      seq_disk_cache_get_files_sorted(disk_cache);
       continue;
     }
 
     seq_disk_cache_delete_file(disk_cache, oldest_file);
   }
+  disk_cache->eviction_pending = false;
   BLI_mutex_unlock(&disk_cache->read_write_mutex);
+}
 
-  return true;
+/* Must be called with `read_write_mutex` locked. */
+static void seq_disk_cache_enforce_limits(SeqDiskCache *disk_cache)
+{
+  if (disk_cache->size_total <= seq_disk_cache_size_limit() || disk_cache->eviction_pending) {
+    return;
+  }
+
+  disk_cache->eviction_pending = true;
+  BLI_task_pool_push(
+      disk_cache->eviction_pool, seq_disk_cache_enforce_limits_task, disk_cache, false, NULL);
 }
 
 static DiskCacheFile *seq_disk_cache_get_file_entry_by_path(SeqDiskCache *disk_cache, char *path)
@@ -656,6 +693,7 @@ static bool seq_disk_cache_write_file(SeqDiskCache *disk_cache, SeqCacheKey *key
     header.entry[entry_index].size_compressed = bytes_written;
     seq_disk_cache_write_header(file, &header);
     seq_disk_cache_update_file(disk_cache, path);
+    seq_disk_cache_file_used(disk_cache, cache_file);
     fclose(file);
 
     return true;
@@ -719,6 +757,10 @@ static ImBuf *seq_disk_cache_read_file(SeqDiskCache *disk_cache, SeqCacheKey *ke
   }
   BLI_file_touch(path);
   seq_disk_cache_update_file(disk_cache, path);
+  DiskCacheFile *cache_file = seq_disk_cache_get_file_entry_by_path(disk_cache, path);
+  if (cache_file != NULL) {
+    seq_disk_cache_file_used(disk_cache, cache_file);
+  }
   fclose(file);
 
   return ibuf;
@@ -817,11 +859,16 @@ static void seq_cache_unlock(Scene *scene)
   }
 }
 
-static size_t seq_cache_get_mem_total(void)
+size_t seq_cache_get_mem_total(void)
 {
   return ((size_t)U.memcachelimit) * 1024 * 1024;
 }
 
+static void seq_cache_reset_links(SeqCache *cache)
+{
+  memset(cache->last_key, 0, sizeof(cache->last_key));
+}
+
 static void seq_cache_keyfree(void *val)
 {
   SeqCacheKey *key = val;
@@ -858,6 +905,7 @@ static int get_stored_types_flag(Scene *scene, SeqCacheKey *key)
 static void seq_cache_put_ex(Scene *scene, SeqCacheKey *key, ImBuf *ibuf)
 {
   SeqCache *cache = seq_cache_get_from_scene(scene);
+  SeqCacheKey **last_key = &cache->last_key[key->task_id];
   SeqCacheItem *item;
   item = BLI_mempool_alloc(cache->items_pool);
   item->cache_owner = cache;
@@ -868,30 +916,30 @@ static void seq_cache_put_ex(Scene *scene, SeqCacheKey *key, ImBuf *ibuf)
   /* Item stored for later use. */
   if (stored_types_flag & key->type) {
     key->is_temp_cache = false;
-    key->link_prev = cache->last_key;
+    key->link_prev = *last_key;
   }
 
   /* Store pointer to last cached key. */
-  SeqCacheKey *temp_last_key = cache->last_key;
+  SeqCacheKey *temp_last_key = *last_key;
 
   if (BLI_ghash_reinsert(cache->hash, key, item, seq_cache_keyfree, seq_cache_valfree)) {
     IMB_refImBuf(ibuf);
 
     if (!key->is_temp_cache || key->type != SEQ_CACHE_STORE_THUMBNAIL) {
-      cache->last_key = key;
+      *last_key = key;
     }
   }
 
   /* Set last_key's reference to this key so we can look up chain backwards.
-   * Item is already put in cache, so cache->last_key points to current key.
+   * Item is already put in cache, so last_key points to current key.
    */
   if (!key->is_temp_cache && temp_last_key) {
-    temp_last_key->link_next = cache->last_key;
+    temp_last_key->link_next = *last_key;
   }
 
   /* Reset linking. */
   if (key->type == SEQ_CACHE_STORE_FINAL_OUT) {
-    cache->last_key = NULL;
+    *last_key = NULL;
   }
 }
 
@@ -1147,8 +1195,10 @@ static void seq_disk_cache_create(Main *bmain, Scene *scene)
   cache->disk_cache = MEM_callocN(sizeof(SeqDiskCache), "SeqDiskCache");
   cache->disk_cache->bmain = bmain;
   BLI_mutex_init(&cache->disk_cache->read_write_mutex);
+  cache->disk_cache->eviction_pool = BLI_task_pool_create_background(cache->disk_cache,
+                                                                     TASK_PRIORITY_LOW);
   seq_disk_cache_handle_versioning(cache->disk_cache);
-  seq_disk_cache_get_files(cache->disk_cache, seq_disk_cache_base_dir());
+  seq_disk_cache_get_files_sorted(cache->disk_cache);
   cache->disk_cache->timestamp = scene->ed->disk_cache_timestamp;
   BLI_mutex_unlock(&cache_create_lock);
 }
@@ -1161,7 +1211,7 @@ static void seq_cache_create(Main *bmain, Scene *scene)
     cache->keys_pool = BLI_mempool_create(sizeof(SeqCacheKey), 0, 64, BLI_MEMPOOL_NOP);
     cache->items_pool = BLI_mempool_create(sizeof(SeqCacheItem), 0, 64, BLI_MEMPOOL_NOP);
     cache->hash = BLI_ghash_new(seq_cache_hashhash, seq_cache_hashcmp, "SeqCache hash");
-    cache->last_key = NULL;
+    seq_cache_reset_links(cache);
     cache->bmain = bmain;
     cache->thumbnail_count = 0;
     BLI_mutex_init(&cache->iterator_mutex);
@@ -1246,6 +1296,8 @@ void seq_cache_destruct(Scene *scene)
   BLI_mutex_end(&cache->iterator_mutex);
 
   if (cache->disk_cache != NULL) {
+    BLI_task_pool_work_and_wait(cache->disk_cache->eviction_pool);
+    BLI_task_pool_free(cache->disk_cache->eviction_pool);
     BLI_freelistN(&cache->disk_cache->files);
     BLI_mutex_end(&cache->disk_cache->read_write_mutex);
     MEM_freeN(cache->disk_cache);
@@ -1280,7 +1332,7 @@ void SEQ_cache_cleanup(Scene *scene)
     BLI_ghashIterator_step(&gh_iter);
     BLI_ghash_remove(cache->hash, key, seq_cache_keyfree, seq_cache_valfree);
   }
-  cache->last_key = NULL;
+  seq_cache_reset_links(cache);
   cache->thumbnail_count = 0;
   seq_cache_unlock(scene);
 }
@@ -1345,7 +1397,7 @@ void seq_cache_cleanup_sequence(Scene *scene,
       BLI_ghash_remove(cache->hash, key, seq_cache_keyfree, seq_cache_valfree);
     }
   }
-  cache->last_key = NULL;
+  seq_cache_reset_links(cache);
   seq_cache_unlock(scene);
 }
 
@@ -1386,7 +1438,7 @@ void seq_cache_thumbnail_cleanup(Scene *scene, rctf *view_area_safe)
       cache->thumbnail_count--;
     }
   }
-  cache->last_key = NULL;
+  seq_cache_reset_links(cache);
 }
 
 struct ImBuf *seq_cache_get(const SeqRenderData *context,
@@ -1475,8 +1527,9 @@ bool seq_cache_put_if_possible(
     return true;
   }
 
-  seq_cache_set_temp_cache_linked(scene, scene->ed->cache->last_key);
-  scene->ed->cache->last_key = NULL;
+  SeqCacheKey **last_key = &scene->ed->cache->last_key[context->task_id];
+  seq_cache_set_temp_cache_linked(scene, *last_key);
+  *last_key = NULL;
   return false;
 }
 
@@ -1552,8 +1605,8 @@ void seq_cache_put(
 
       BLI_mutex_lock(&cache->disk_cache->read_write_mutex);
       seq_disk_cache_write_file(cache->disk_cache, key, i);
-      BLI_mutex_unlock(&cache->disk_cache->read_write_mutex);
       seq_disk_cache_enforce_limits(cache->disk_cache);
+      BLI_mutex_unlock(&cache->disk_cache->read_write_mutex);
     }
   }
 }
@@ -1582,7 +1635,7 @@ void SEQ_cache_iterate(
     interrupt = callback_iter(userdata, key->seq, key->timeline_frame, key->type);
   }
 
-  cache->last_key = NULL;
+  seq_cache_reset_links(cache);
   seq_cache_unlock(scene);
 }
 
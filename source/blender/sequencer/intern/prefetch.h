@@ -27,6 +27,11 @@
 extern "C" {
 #endif
 
+/* Upper bound of prefetch workers. Each worker uses its own evaluated depsgraph and a cache task
+ * ID of `SEQ_TASK_PREFETCH_RENDER + worker index`. Workers evaluate their frames concurrently,
+ * strips are rendered one at a time like any other sequencer render. */
+#define SEQ_PREFETCH_THREADS_MAX 8
+
 struct Scene;
 struct SeqRenderData;
 struct Sequence;
@@ -560,6 +560,15 @@ void SEQ_proxy_rebuild(SeqIndexBuildContext *context,
   }
 }
 
+/**
+ * Movie strips are built from their own decoder, without the sequencer render pipeline,
+ * so several of them can be rebuilt at the same time.
+ */
+bool seq_proxy_rebuild_is_threadsafe(const SeqIndexBuildContext *context)
+{
+  return context->seq->type == SEQ_TYPE_MOVIE;
+}
+
 void SEQ_proxy_rebuild_finish(SeqIndexBuildContext *context, bool stop)
 {
   if (context->index_context) {
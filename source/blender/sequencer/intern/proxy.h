@@ -28,6 +28,7 @@ extern "C" {
 #endif
 
 struct ImBuf;
+struct SeqIndexBuildContext;
 struct SeqRenderData;
 struct Sequence;
 struct anim;
@@ -39,6 +40,7 @@ struct ImBuf *seq_proxy_fetch(const struct SeqRenderData *context,
 bool seq_proxy_get_custom_file_fname(struct Sequence *seq, char *name, const int view_id);
 void free_proxy_seq(Sequence *seq);
 void seq_proxy_index_dir_set(struct anim *anim, const char *base_dir);
+bool seq_proxy_rebuild_is_threadsafe(const struct SeqIndexBuildContext *context);
 
 #ifdef __cplusplus
 }
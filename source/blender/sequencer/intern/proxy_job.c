@@ -28,8 +28,14 @@
 
 #include "BLI_blenlib.h"
 #include "BLI_ghash.h"
+#include "BLI_math_base.h"
+#include "BLI_threads.h"
 #include "BLI_timecode.h"
 
+#include "PIL_time.h"
+
+#include "atomic_ops.h"
+
 #include "DNA_scene_types.h"
 #include "DNA_sequence_types.h"
 
@@ -48,6 +54,8 @@
 
 #include "RNA_define.h"
 
+#include "proxy.h"
+
 static void proxy_freejob(void *pjv)
 {
   ProxyJob *pj = pjv;
@@ -57,23 +65,118 @@ static void proxy_freejob(void *pjv)
   MEM_freeN(pj);
 }
 
+/* Movie strips rebuilt at the same time. Each of them already decodes on its own thread and
+ * encodes every proxy size on another, so this is kept low. */
+#define PROXY_JOB_THREADS_MAX 4
+
+typedef struct ProxyJobThreadState {
+  struct SeqIndexBuildContext **contexts;
+  float *progress;
+  int num_contexts;
+  int next_context;
+  int num_threads_running;
+
+  short *stop;
+  short *do_update;
+} ProxyJobThreadState;
+
+static void *proxy_rebuild_thread(void *data)
+{
+  ProxyJobThreadState *state = data;
+
+  while (!*state->stop) {
+    const int i = atomic_fetch_and_add_int32(&state->next_context, 1);
+    if (i >= state->num_contexts) {
+      break;
+    }
+    SEQ_proxy_rebuild(state->contexts[i], state->stop, state->do_update, &state->progress[i]);
+    state->progress[i] = 1.0f;
+  }
+
+  atomic_sub_and_fetch_int32(&state->num_threads_running, 1);
+  return NULL;
+}
+
+/* Rebuild movie strips concurrently, while this thread reports their combined progress. */
+static void proxy_rebuild_threaded(struct SeqIndexBuildContext **contexts,
+                                   int num_contexts,
+                                   short *stop,
+                                   short *do_update,
+                                   float *progress)
+{
+  ProxyJobThreadState state = {NULL};
+  state.contexts = contexts;
+  state.progress = MEM_calloc_arrayN(num_contexts, sizeof(float), "proxy job progress");
+  state.num_contexts = num_contexts;
+  state.stop = stop;
+  state.do_update = do_update;
+
+  const int num_threads = min_ii(
+      num_contexts, clamp_i(BLI_system_thread_count() / 4, 1, PROXY_JOB_THREADS_MAX));
+  state.num_threads_running = num_threads;
+
+  ListBase threads;
+  BLI_threadpool_init(&threads, proxy_rebuild_thread, num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    BLI_threadpool_insert(&threads, &state);
+  }
+
+  while (atomic_add_and_fetch_int32(&state.num_threads_running, 0) > 0) {
+    float progress_sum = 0.0f;
+    for (int i = 0; i < num_contexts; i++) {
+      progress_sum += state.progress[i];
+    }
+    *progress = progress_sum / num_contexts;
+    *do_update = true;
+
+    PIL_sleep_ms(50);
+  }
+
+  BLI_threadpool_end(&threads);
+  MEM_freeN(state.progress);
+}
+
 /* Only this runs inside thread. */
 static void proxy_startjob(void *pjv, short *stop, short *do_update, float *progress)
 {
   ProxyJob *pj = pjv;
   LinkData *link;
+  const double time_start = PIL_check_seconds_timer();
+  const int num_contexts = BLI_listbase_count(&pj->queue);
+
+  struct SeqIndexBuildContext **threaded_contexts = MEM_malloc_arrayN(
+      num_contexts, sizeof(*threaded_contexts), "proxy job contexts");
+  int num_threaded_contexts = 0;
 
   for (link = pj->queue.first; link; link = link->next) {
-    struct SeqIndexBuildContext *context = link->data;
+    if (seq_proxy_rebuild_is_threadsafe(link->data)) {
+      threaded_contexts[num_threaded_contexts++] = link->data;
+    }
+  }
 
-    SEQ_proxy_rebuild(context, stop, do_update, progress);
+  if (num_threaded_contexts != 0) {
+    proxy_rebuild_threaded(threaded_contexts, num_threaded_contexts, stop, do_update, progress);
+  }
+  MEM_freeN(threaded_contexts);
 
-    if (*stop) {
-      pj->stop = 1;
-      fprintf(stderr, "Canceling proxy rebuild on users request...\n");
-      break;
+  for (link = pj->queue.first; link && !*stop; link = link->next) {
+    struct SeqIndexBuildContext *context = link->data;
+
+    if (!seq_proxy_rebuild_is_threadsafe(context)) {
+      SEQ_proxy_rebuild(context, stop, do_update, progress);
     }
   }
+
+  if (*stop) {
+    pj->stop = 1;
+    fprintf(stderr, "Canceling proxy rebuild on users request...\n");
+  }
+  else if (G.debug & G_DEBUG) {
+    fprintf(stderr,
+            "Proxy rebuild of %d strip(s) done in %.2f s\n",
+            num_contexts,
+            PIL_check_seconds_timer() - time_start);
+  }
 }
 
 static void proxy_endjob(void *pjv)
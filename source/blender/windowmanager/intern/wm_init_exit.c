@@ -64,6 +64,7 @@
 #include "BKE_lib_remap.h"
 #include "BKE_main.h"
 #include "BKE_mball_tessellate.h"
+#include "BKE_mesh_runtime.h"
 #include "BKE_node.h"
 #include "BKE_report.h"
 #include "BKE_scene.h"
@@ -647,6 +648,10 @@ void WM_exit_ex(bContext *C, const bool do_python)
   BKE_appdir_exit();
   CLG_exit();
 
+  if (G.debug & G_DEBUG) {
+    BKE_mesh_runtime_topology_map_stats_print();
+  }
+
   BKE_blender_atexit();
 
   wm_autosave_delete();
@@ -40,6 +40,7 @@
 #  include "BLI_string.h"
 #  include "BLI_string_utf8.h"
 #  include "BLI_system.h"
+#  include "BLI_task.h"
 #  include "BLI_threads.h"
 #  include "BLI_utildefines.h"
 
@@ -517,6 +518,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
   BLI_args_print_arg_doc(ba, "--render-output");
   BLI_args_print_arg_doc(ba, "--engine");
   BLI_args_print_arg_doc(ba, "--threads");
+  BLI_args_print_arg_doc(ba, "--threads-background");
 
   printf("\n");
   printf("Format Options:\n");
@@ -1494,6 +1496,35 @@ static int arg_handle_threads_set(int argc, const char **argv, void *UNUSED(data
   return 0;
 }
 
+static const char arg_handle_threads_background_set_doc[] =
+    "<threads>\n"
+    "\tLimit the number of threads used by background jobs such as file browser previews,\n"
+    "\tkeeping the other threads available for the interface\n"
+    "\t[0-" STRINGIFY(BLENDER_MAX_THREADS) "], 0 for no limit.";
+static int arg_handle_threads_background_set(int argc, const char **argv, void *UNUSED(data))
+{
+  const char *arg_id = "--threads-background";
+  const int min = 0, max = BLENDER_MAX_THREADS;
+  if (argc > 1) {
+    const char *err_msg = NULL;
+    int threads;
+    if (!parse_int_strict_range(argv[1], NULL, min, max, &threads, &err_msg)) {
+      printf("\nError: %s '%s %s', expected number in [%d..%d].\n",
+             err_msg,
+             arg_id,
+             argv[1],
+             min,
+             max);
+      return 1;
+    }
+
+    BLI_task_scheduler_background_threads_set(threads);
+    return 1;
+  }
+  printf("\nError: you must specify a number of threads in [%d..%d] '%s'.\n", min, max, arg_id);
+  return 0;
+}
+
 static const char arg_handle_verbosity_set_doc[] =
     "<verbose>\n"
     "\tSet the logging verbosity level for debug messages that support it.";
@@ -2054,6 +2085,7 @@ void main_args_setup(bContext *C, bArgs *ba)
   BLI_args_add(ba, NULL, "--env-system-python", CB_EX(arg_handle_env_system_set, python), NULL);
 
   BLI_args_add(ba, "-t", "--threads", CB(arg_handle_threads_set), NULL);
+  BLI_args_add(ba, NULL, "--threads-background", CB(arg_handle_threads_background_set), NULL);
 
   /* Include in the environment pass so it's possible display errors initializing subsystems,
    * especially `bpy.appdir` since it's useful to show errors finding paths on startup. */
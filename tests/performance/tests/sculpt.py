@@ -0,0 +1,161 @@
+# Apache License, Version 2.0
+
+import api
+
+
+def _run(args):
+    import bpy
+    import time
+
+    # Replace the default objects by a single grid.
+    bpy.ops.object.select_all(action='SELECT')
+    bpy.ops.object.delete()
+
+    subdivisions = args['subdivisions']
+    bpy.ops.mesh.primitive_grid_add(x_subdivisions=subdivisions,
+                                    y_subdivisions=subdivisions,
+                                    size=2.0)
+    ob = bpy.context.active_object
+
+    mode = args['mode']
+    if mode == 'MULTIRES':
+        bpy.ops.object.modifier_add(type='MULTIRES')
+        for _ in range(args['levels']):
+            bpy.ops.object.multires_subdivide(modifier="Multires", mode='CATMULL_CLARK')
+
+    # Entering sculpt mode builds the PBVH, dynamic topology rebuilds it from a BMesh.
+    num_builds = 0
+    elapsed_time = 0.0
+
+    while num_builds < 3 or elapsed_time < 10.0:
+        if mode == 'DYNTOPO':
+            bpy.ops.object.mode_set(mode='SCULPT')
+            start_time = time.time()
+            bpy.ops.sculpt.dynamic_topology_toggle()
+            elapsed_time += time.time() - start_time
+            bpy.ops.sculpt.dynamic_topology_toggle()
+        else:
+            start_time = time.time()
+            bpy.ops.object.mode_set(mode='SCULPT')
+            elapsed_time += time.time() - start_time
+        bpy.ops.object.mode_set(mode='OBJECT')
+        num_builds += 1
+
+    result = {'time': elapsed_time / num_builds}
+    return result
+
+
+def _run_stroke(args):
+    import bpy
+    import time
+
+    # Replace the default objects by a single grid.
+    bpy.ops.object.select_all(action='SELECT')
+    bpy.ops.object.delete()
+
+    subdivisions = args['subdivisions']
+    bpy.ops.mesh.primitive_grid_add(x_subdivisions=subdivisions,
+                                    y_subdivisions=subdivisions,
+                                    size=2.0)
+    bpy.ops.object.mode_set(mode='SCULPT')
+
+    # Brush strokes need a 3D viewport, look at the grid from the top.
+    window = bpy.context.window
+    screen = window.screen
+    area = next(area for area in screen.areas if area.type == 'VIEW_3D')
+    region = next(region for region in area.regions if region.type == 'WINDOW')
+    region_3d = area.spaces.active.region_3d
+    region_3d.view_perspective = 'ORTHO'
+    region_3d.view_rotation = (1.0, 0.0, 0.0, 0.0)
+    region_3d.view_location = (0.0, 0.0, 0.0)
+    region_3d.view_distance = 2.5
+
+    tool_settings = bpy.context.scene.tool_settings
+    brush = bpy.data.brushes[args['brush']]
+    tool_settings.sculpt.brush = brush
+    radius = args['radius']
+    brush.size = radius
+    tool_settings.unified_paint_settings.size = radius
+
+    # Replay the same stroke across the grid, one dab per stroke element.
+    num_dabs = 100
+    stroke = []
+    for i in range(num_dabs):
+        t = i / (num_dabs - 1)
+        mouse = (region.width * (0.25 + 0.5 * t), region.height * 0.5)
+        stroke.append({'name': "",
+                       'location': (0.0, 0.0, 0.0),
+                       'mouse': mouse,
+                       'mouse_event': mouse,
+                       'pressure': 1.0,
+                       'size': radius,
+                       'pen_flip': False,
+                       'x_tilt': 0.0,
+                       'y_tilt': 0.0,
+                       'time': t,
+                       'is_start': i == 0})
+
+    override = {'window': window, 'screen': screen, 'area': area, 'region': region}
+    num_strokes = 0
+    elapsed_time = 0.0
+
+    while num_strokes < 3 or elapsed_time < 10.0:
+        start_time = time.time()
+        bpy.ops.sculpt.brush_stroke(override, stroke=stroke, mode='NORMAL')
+        elapsed_time += time.time() - start_time
+        num_strokes += 1
+
+    result = {'time': elapsed_time / num_strokes}
+    return result
+
+
+class SculptBuildTest(api.Test):
+    def __init__(self, mode, subdivisions, levels=0):
+        self.mode = mode
+        self.subdivisions = subdivisions
+        self.levels = levels
+
+    def name(self):
+        return "pbvh_build_%s" % self.mode.lower()
+
+    def category(self):
+        return "sculpt"
+
+    def run(self, env, device_id):
+        args = {'mode': self.mode,
+                'subdivisions': self.subdivisions,
+                'levels': self.levels}
+        result, _ = env.run_in_blender(_run, args, ['--factory-startup'])
+        return result
+
+
+class SculptStrokeTest(api.Test):
+    def __init__(self, brush, subdivisions, radius):
+        self.brush = brush
+        self.subdivisions = subdivisions
+        self.radius = radius
+
+    def name(self):
+        return "stroke_%s" % self.brush.lower().replace(' ', '_')
+
+    def category(self):
+        return "sculpt"
+
+    def run(self, env, device_id):
+        args = {'brush': self.brush,
+                'subdivisions': self.subdivisions,
+                'radius': self.radius}
+        result, _ = env.run_in_blender(_run_stroke, args, foreground=True)
+        return result
+
+
+def generate(env):
+    # About 10 million faces for meshes and grids, and 1 million faces for dynamic topology.
+    # Strokes use a large radius on a mesh with about 1 million faces.
+    return [SculptBuildTest('MESH', 3163),
+            SculptBuildTest('MULTIRES', 395, levels=3),
+            SculptBuildTest('DYNTOPO', 1000),
+            SculptStrokeTest('SculptDraw', 1000, 200),
+            SculptStrokeTest('Clay Strips', 1000, 200),
+            SculptStrokeTest('Smooth', 1000, 200),
+            SculptStrokeTest('Grab', 1000, 200)]
@@ -0,0 +1,79 @@
+# Apache License, Version 2.0
+
+import api
+import os
+
+
+def _run(args):
+    import bpy
+    import time
+
+    scene = bpy.context.scene
+    scene.render.resolution_x = 3840
+    scene.render.resolution_y = 2160
+    scene.render.resolution_percentage = 100
+    scene.frame_start = 1
+    scene.frame_end = 10
+
+    # Stack of color strips, each blended over strips below it.
+    ed = scene.sequence_editor_create()
+    ed.use_cache_raw = False
+    ed.use_cache_preprocessed = False
+    ed.use_cache_composite = False
+    ed.use_cache_final = False
+
+    num_channels = args['num_channels']
+    for channel in range(1, num_channels + 1):
+        strip = ed.sequences.new_effect(name="Color %d" % channel,
+                                        type='COLOR',
+                                        channel=channel,
+                                        frame_start=scene.frame_start,
+                                        frame_end=scene.frame_end + 1)
+        strip.color = (channel / num_channels, 0.5, 1.0 - channel / num_channels)
+        strip.use_float = args['use_float']
+        if channel > 1:
+            strip.blend_type = args['blend_type']
+            strip.blend_alpha = 0.5
+
+    start_time = time.time()
+    elapsed_time = 0.0
+    num_frames = 0
+
+    while elapsed_time < 10.0:
+        for i in range(scene.frame_start, scene.frame_end + 1):
+            scene.frame_set(i)
+            bpy.ops.render.render()
+
+        num_frames += scene.frame_end + 1 - scene.frame_start
+        elapsed_time = time.time() - start_time
+
+    time_per_frame = elapsed_time / num_frames
+
+    result = {'time': time_per_frame}
+    return result
+
+
+class SequencerBlendTest(api.Test):
+    def __init__(self, blend_type, use_float):
+        self.blend_type = blend_type
+        self.use_float = use_float
+
+    def name(self):
+        return "blend_%s_%s" % (self.blend_type.lower(), "float" if self.use_float else "byte")
+
+    def category(self):
+        return "sequencer"
+
+    def run(self, env, device_id):
+        args = {'blend_type': self.blend_type,
+                'use_float': self.use_float,
+                'num_channels': 10}
+        result, _ = env.run_in_blender(_run, args, ['--factory-startup'])
+        return result
+
+
+def generate(env):
+    blend_types = ('CROSS', 'ALPHA_OVER', 'ADD', 'MULTIPLY', 'SCREEN', 'OVERLAY')
+    return [SequencerBlendTest(blend_type, use_float)
+            for blend_type in blend_types
+            for use_float in (False, True)]